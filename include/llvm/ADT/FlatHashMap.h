@@ -0,0 +1,661 @@
+//===- llvm/ADT/FlatHashMap.h - Group probed hash table ---------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the FlatHashMap class, an open-addressing hash table with
+// the same interface as DenseMap.
+//
+// Instead of comparing full keys against empty and tombstone sentinels while
+// probing, FlatHashMap keeps one control byte per bucket. A control byte is
+// either "empty", "deleted", or holds 7 bits of the key's hash. Buckets are
+// organized in groups of 16 and a lookup compares the control bytes of a
+// whole group against the hash tag at once (with SSE2 or NEON when available),
+// so that keys are only compared for buckets whose tag matches. Keys do not
+// need reserved empty/tombstone values, although the DenseMapInfo traits are
+// still used for hashing and equality.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ADT_FLATHASHMAP_H
+#define LLVM_ADT_FLATHASHMAP_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseMapInfo.h"
+#include "llvm/ADT/EpochTracker.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/MathExtras.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LLVM_FLATHASHMAP_SSE2 1
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define LLVM_FLATHASHMAP_NEON 1
+#endif
+
+namespace llvm {
+
+namespace detail {
+
+/// The control bytes of one group of FlatHashMap buckets. A full bucket has a
+/// control byte in [0, 127]; empty and deleted buckets have the sign bit set.
+class FlatHashMapGroup {
+public:
+  enum : int8_t { Empty = -128, Deleted = -2 };
+  enum : unsigned { Width = 16 };
+
+#if defined(LLVM_FLATHASHMAP_NEON)
+  // The NEON masks use 4 bits per lane, of which only the top one is kept.
+  enum : unsigned { LaneShift = 2 };
+#else
+  enum : unsigned { LaneShift = 0 };
+#endif
+
+  /// A bit set of the buckets in a group that satisfied a query. Iterate it
+  /// with empty(), first() and dropFirst().
+  class Mask {
+    uint64_t Bits;
+
+  public:
+    explicit Mask(uint64_t Bits) : Bits(Bits) {}
+    bool empty() const { return Bits == 0; }
+    unsigned first() const { return countTrailingZeros(Bits) >> LaneShift; }
+    void dropFirst() { Bits &= Bits - 1; }
+  };
+
+  explicit FlatHashMapGroup(const int8_t *Ctrl) {
+#if defined(LLVM_FLATHASHMAP_SSE2)
+    V = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Ctrl));
+#elif defined(LLVM_FLATHASHMAP_NEON)
+    V = vld1q_s8(Ctrl);
+#else
+    std::memcpy(V, Ctrl, Width);
+#endif
+  }
+
+  /// Buckets whose control byte equals \p Tag.
+  Mask match(int8_t Tag) const {
+#if defined(LLVM_FLATHASHMAP_SSE2)
+    return Mask(static_cast<uint16_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(Tag), V))));
+#elif defined(LLVM_FLATHASHMAP_NEON)
+    return fromNEON(vceqq_s8(vdupq_n_s8(Tag), V));
+#else
+    uint64_t Bits = 0;
+    for (unsigned I = 0; I != Width; ++I)
+      Bits |= uint64_t(V[I] == Tag) << I;
+    return Mask(Bits);
+#endif
+  }
+
+  /// Buckets that have never been used since the table was last rehashed.
+  Mask matchEmpty() const { return match(Empty); }
+
+  /// Buckets that can receive a new entry.
+  Mask matchEmptyOrDeleted() const {
+#if defined(LLVM_FLATHASHMAP_SSE2)
+    return Mask(static_cast<uint16_t>(_mm_movemask_epi8(V)));
+#elif defined(LLVM_FLATHASHMAP_NEON)
+    return fromNEON(vcltzq_s8(V));
+#else
+    uint64_t Bits = 0;
+    for (unsigned I = 0; I != Width; ++I)
+      Bits |= uint64_t(V[I] < 0) << I;
+    return Mask(Bits);
+#endif
+  }
+
+private:
+#if defined(LLVM_FLATHASHMAP_SSE2)
+  __m128i V;
+#elif defined(LLVM_FLATHASHMAP_NEON)
+  int8x16_t V;
+
+  static Mask fromNEON(uint8x16_t Cmp) {
+    // Narrow each 16-bit lane pair to 8 bits, leaving 4 bits per byte lane.
+    uint8x8_t Narrow = vshrn_n_u16(vreinterpretq_u16_u8(Cmp), 4);
+    return Mask(vget_lane_u64(vreinterpret_u64_u8(Narrow), 0) &
+                0x8888888888888888ULL);
+  }
+#else
+  int8_t V[Width];
+#endif
+};
+
+} // end namespace detail
+
+template <typename KeyT, typename ValueT, typename KeyInfoT, typename BucketT,
+          bool IsConst>
+class FlatHashMapIterator;
+
+/// An open-addressing hash map with DenseMap's interface that probes whole
+/// groups of buckets using per-bucket control bytes. Unlike DenseMap it does
+/// not compare keys against sentinel values while probing, which makes
+/// lookups cheaper when collisions are frequent or keys are expensive to
+/// compare. Like DenseMap, insertions invalidate iterators and references.
+template <typename KeyT, typename ValueT,
+          typename KeyInfoT = DenseMapInfo<KeyT>,
+          typename BucketT = detail::DenseMapPair<KeyT, ValueT>>
+class FlatHashMap : public DebugEpochBase {
+  typedef detail::FlatHashMapGroup Group;
+
+  /// Control bytes, one per bucket.
+  int8_t *Ctrl = nullptr;
+  BucketT *Buckets = nullptr;
+  unsigned NumBuckets = 0;
+  unsigned NumEntries = 0;
+  unsigned NumDeleted = 0;
+
+public:
+  typedef unsigned size_type;
+  typedef KeyT key_type;
+  typedef ValueT mapped_type;
+  typedef BucketT value_type;
+
+  typedef FlatHashMapIterator<KeyT, ValueT, KeyInfoT, BucketT, false> iterator;
+  typedef FlatHashMapIterator<KeyT, ValueT, KeyInfoT, BucketT, true>
+      const_iterator;
+
+  explicit FlatHashMap(unsigned InitialReserve = 0) {
+    if (InitialReserve)
+      reserve(InitialReserve);
+  }
+
+  FlatHashMap(const FlatHashMap &Other) : DebugEpochBase() {
+    copyFrom(Other);
+  }
+
+  FlatHashMap(FlatHashMap &&Other) : DebugEpochBase() { swap(Other); }
+
+  template <typename InputIt> FlatHashMap(const InputIt &I, const InputIt &E) {
+    reserve(std::distance(I, E));
+    insert(I, E);
+  }
+
+  ~FlatHashMap() {
+    destroyAll();
+    deallocate();
+  }
+
+  FlatHashMap &operator=(const FlatHashMap &Other) {
+    if (&Other != this) {
+      destroyAll();
+      deallocate();
+      copyFrom(Other);
+    }
+    return *this;
+  }
+
+  FlatHashMap &operator=(FlatHashMap &&Other) {
+    destroyAll();
+    deallocate();
+    Ctrl = nullptr;
+    Buckets = nullptr;
+    NumBuckets = NumEntries = NumDeleted = 0;
+    swap(Other);
+    return *this;
+  }
+
+  void swap(FlatHashMap &RHS) {
+    this->incrementEpoch();
+    RHS.incrementEpoch();
+    std::swap(Ctrl, RHS.Ctrl);
+    std::swap(Buckets, RHS.Buckets);
+    std::swap(NumBuckets, RHS.NumBuckets);
+    std::swap(NumEntries, RHS.NumEntries);
+    std::swap(NumDeleted, RHS.NumDeleted);
+  }
+
+  iterator begin() {
+    return iterator(Ctrl, Ctrl + NumBuckets, Buckets, *this);
+  }
+  iterator end() {
+    return iterator(Ctrl + NumBuckets, Ctrl + NumBuckets,
+                    Buckets + NumBuckets, *this, true);
+  }
+  const_iterator begin() const {
+    return const_iterator(Ctrl, Ctrl + NumBuckets, Buckets, *this);
+  }
+  const_iterator end() const {
+    return const_iterator(Ctrl + NumBuckets, Ctrl + NumBuckets,
+                          Buckets + NumBuckets, *this, true);
+  }
+
+  LLVM_NODISCARD bool empty() const { return NumEntries == 0; }
+  unsigned size() const { return NumEntries; }
+
+  /// Grow the map so that it can hold at least \p NumEntries entries without
+  /// rehashing.
+  void reserve(size_type NumEntries) {
+    unsigned Needed = getMinBucketsForEntries(NumEntries);
+    incrementEpoch();
+    if (Needed > NumBuckets)
+      rehash(Needed);
+  }
+
+  void clear() {
+    incrementEpoch();
+    if (NumEntries == 0 && NumDeleted == 0)
+      return;
+
+    destroyAll();
+    std::memset(Ctrl, Group::Empty, NumBuckets);
+    NumEntries = NumDeleted = 0;
+  }
+
+  /// Return 1 if the specified key is in the map, 0 otherwise.
+  size_type count(const KeyT &Val) const {
+    return findBucket(Val) ? 1 : 0;
+  }
+
+  iterator find(const KeyT &Val) { return find_as(Val); }
+  const_iterator find(const KeyT &Val) const { return find_as(Val); }
+
+  /// Alternate version of find() which allows a different, and possibly less
+  /// expensive, key type. The KeyInfoT must provide getHashValue and isEqual
+  /// for LookupKeyT.
+  template <class LookupKeyT> iterator find_as(const LookupKeyT &Val) {
+    if (const BucketT *B = findBucket(Val))
+      return makeIterator(const_cast<BucketT *>(B));
+    return end();
+  }
+  template <class LookupKeyT>
+  const_iterator find_as(const LookupKeyT &Val) const {
+    if (const BucketT *B = findBucket(Val))
+      return makeConstIterator(B);
+    return end();
+  }
+
+  /// Return the entry for the specified key, or a default constructed value
+  /// if no such entry exists.
+  ValueT lookup(const KeyT &Val) const {
+    if (const BucketT *B = findBucket(Val))
+      return B->getSecond();
+    return ValueT();
+  }
+
+  std::pair<iterator, bool> insert(const std::pair<KeyT, ValueT> &KV) {
+    return try_emplace(KV.first, KV.second);
+  }
+
+  std::pair<iterator, bool> insert(std::pair<KeyT, ValueT> &&KV) {
+    return try_emplace(std::move(KV.first), std::move(KV.second));
+  }
+
+  /// Insert a range of elements. Existing keys are left untouched.
+  template <typename InputIt> void insert(InputIt I, InputIt E) {
+    for (; I != E; ++I)
+      insert(*I);
+  }
+
+  /// Inserts a key with a value constructed from \p Args if the key is not
+  /// already in the map. Returns the entry for the key and whether an
+  /// insertion took place.
+  template <typename... Ts>
+  std::pair<iterator, bool> try_emplace(KeyT &&Key, Ts &&... Args) {
+    BucketT *B;
+    if (lookupOrPrepareInsert(Key, B))
+      return std::make_pair(makeIterator(B), false);
+
+    ::new (&B->getFirst()) KeyT(std::move(Key));
+    ::new (&B->getSecond()) ValueT(std::forward<Ts>(Args)...);
+    return std::make_pair(makeIterator(B), true);
+  }
+
+  template <typename... Ts>
+  std::pair<iterator, bool> try_emplace(const KeyT &Key, Ts &&... Args) {
+    BucketT *B;
+    if (lookupOrPrepareInsert(Key, B))
+      return std::make_pair(makeIterator(B), false);
+
+    ::new (&B->getFirst()) KeyT(Key);
+    ::new (&B->getSecond()) ValueT(std::forward<Ts>(Args)...);
+    return std::make_pair(makeIterator(B), true);
+  }
+
+  bool erase(const KeyT &Val) {
+    const BucketT *B = findBucket(Val);
+    if (!B)
+      return false;
+    eraseBucket(const_cast<BucketT *>(B));
+    return true;
+  }
+
+  void erase(iterator I) { eraseBucket(&*I); }
+
+  value_type &FindAndConstruct(const KeyT &Key) {
+    return *try_emplace(Key).first;
+  }
+
+  ValueT &operator[](const KeyT &Key) { return FindAndConstruct(Key).second; }
+
+  value_type &FindAndConstruct(KeyT &&Key) {
+    return *try_emplace(std::move(Key)).first;
+  }
+
+  ValueT &operator[](KeyT &&Key) {
+    return FindAndConstruct(std::move(Key)).second;
+  }
+
+  /// Return true if the specified pointer points somewhere into the map's
+  /// bucket array.
+  bool isPointerIntoBucketsArray(const void *Ptr) const {
+    return Ptr >= Buckets && Ptr < Buckets + NumBuckets;
+  }
+
+  /// Return an opaque pointer into the buckets array. In conjunction with the
+  /// previous method, this can be used to determine whether an insertion
+  /// caused the map to reallocate.
+  const void *getPointerIntoBucketsArray() const { return Buckets; }
+
+  /// Return the approximate size (in bytes) of the actual map, including the
+  /// control bytes.
+  size_t getMemorySize() const {
+    return NumBuckets * (sizeof(BucketT) + sizeof(int8_t));
+  }
+
+private:
+  static unsigned getMinBucketsForEntries(unsigned NumEntries) {
+    if (NumEntries == 0)
+      return 0;
+    // Keep the load factor at or below 7/8.
+    return std::max<unsigned>(Group::Width,
+                              NextPowerOf2((uint64_t)NumEntries * 8 / 7));
+  }
+
+  /// Spread the bits of the DenseMapInfo hash, which is often weak (pointer
+  /// hashes only shift and xor the address), over 64 bits. The top 7 bits
+  /// become the control byte tag and the bits below select the first group.
+  template <typename LookupKeyT> static uint64_t hashOf(const LookupKeyT &Val) {
+    return uint64_t(KeyInfoT::getHashValue(Val)) * 0x9E3779B97F4A7C15ULL;
+  }
+  static int8_t tagOf(uint64_t Hash) { return int8_t(Hash >> 57); }
+  unsigned firstGroupOf(uint64_t Hash) const {
+    return unsigned(Hash >> 25) & (NumBuckets / Group::Width - 1);
+  }
+
+  /// Groups are visited using triangular numbers, which covers every group
+  /// of a power-of-two table exactly once.
+  unsigned nextGroup(unsigned G, unsigned &Step) const {
+    return (G + ++Step) & (NumBuckets / Group::Width - 1);
+  }
+
+  template <typename LookupKeyT>
+  const BucketT *findBucket(const LookupKeyT &Val) const {
+    if (NumBuckets == 0)
+      return nullptr;
+
+    uint64_t Hash = hashOf(Val);
+    int8_t Tag = tagOf(Hash);
+    unsigned G = firstGroupOf(Hash);
+    unsigned Step = 0;
+    while (true) {
+      unsigned Base = G * Group::Width;
+      Group Grp(Ctrl + Base);
+      for (auto M = Grp.match(Tag); !M.empty(); M.dropFirst()) {
+        const BucketT *B = Buckets + Base + M.first();
+        if (LLVM_LIKELY(KeyInfoT::isEqual(Val, B->getFirst())))
+          return B;
+      }
+      // An empty bucket ends the probe sequence: the key was never inserted
+      // beyond this group.
+      if (LLVM_LIKELY(!Grp.matchEmpty().empty()))
+        return nullptr;
+      G = nextGroup(G, Step);
+    }
+  }
+
+  /// Return the index of the first bucket along the probe sequence of \p
+  /// Hash that is free to receive a new entry.
+  unsigned findInsertSlot(uint64_t Hash) const {
+    unsigned G = firstGroupOf(Hash);
+    unsigned Step = 0;
+    while (true) {
+      auto M = Group(Ctrl + G * Group::Width).matchEmptyOrDeleted();
+      if (!M.empty())
+        return G * Group::Width + M.first();
+      G = nextGroup(G, Step);
+    }
+  }
+
+  /// Looks up \p Key. If it is present, sets \p Found to its bucket and
+  /// returns true. Otherwise claims a bucket for it, growing the table if
+  /// needed, sets \p Found to that bucket and returns false; the caller must
+  /// then construct the key and value in it.
+  template <typename LookupKeyT>
+  bool lookupOrPrepareInsert(const LookupKeyT &Key, BucketT *&Found) {
+    if (const BucketT *B = findBucket(Key)) {
+      Found = const_cast<BucketT *>(B);
+      return true;
+    }
+
+    incrementEpoch();
+
+    // Deleted buckets still lengthen probe sequences, so they count against
+    // the load factor. If most of the load is made of deleted buckets, rehash
+    // in place instead of growing.
+    uint64_t Hash = hashOf(Key);
+    if (LLVM_UNLIKELY((uint64_t)(NumEntries + NumDeleted + 1) * 8 >
+                      (uint64_t)NumBuckets * 7)) {
+      if (NumBuckets && NumDeleted > NumBuckets / 4)
+        rehash(NumBuckets);
+      else
+        rehash(std::max<unsigned>(Group::Width, NumBuckets * 2));
+    }
+
+    unsigned Idx = findInsertSlot(Hash);
+    if (Ctrl[Idx] == Group::Deleted)
+      --NumDeleted;
+    Ctrl[Idx] = tagOf(Hash);
+    ++NumEntries;
+    Found = Buckets + Idx;
+    return false;
+  }
+
+  void eraseBucket(BucketT *B) {
+    unsigned Idx = B - Buckets;
+    B->getSecond().~ValueT();
+    B->getFirst().~KeyT();
+
+    // If this group still has an empty bucket, no probe sequence ever went
+    // past it, so the bucket can go back to empty. Otherwise later lookups
+    // must keep probing through it.
+    unsigned Base = Idx - Idx % Group::Width;
+    if (!Group(Ctrl + Base).matchEmpty().empty()) {
+      Ctrl[Idx] = Group::Empty;
+    } else {
+      Ctrl[Idx] = Group::Deleted;
+      ++NumDeleted;
+    }
+    --NumEntries;
+    incrementEpoch();
+  }
+
+  void destroyAll() {
+    for (unsigned I = 0; I != NumBuckets; ++I) {
+      if (Ctrl[I] < 0)
+        continue;
+      Buckets[I].getSecond().~ValueT();
+      Buckets[I].getFirst().~KeyT();
+    }
+  }
+
+  void deallocate() {
+    operator delete(Buckets);
+    delete[] Ctrl;
+  }
+
+  void allocate(unsigned Num) {
+    NumBuckets = Num;
+    NumEntries = NumDeleted = 0;
+    if (Num == 0) {
+      Ctrl = nullptr;
+      Buckets = nullptr;
+      return;
+    }
+    Ctrl = new int8_t[Num];
+    std::memset(Ctrl, Group::Empty, Num);
+    Buckets = static_cast<BucketT *>(operator new(sizeof(BucketT) * Num));
+  }
+
+  /// Move every entry into a fresh table of \p NewNumBuckets buckets, which
+  /// also drops all deleted markers.
+  void rehash(unsigned NewNumBuckets) {
+    assert(isPowerOf2_32(NewNumBuckets) && NewNumBuckets >= Group::Width &&
+           "Bucket count must be a power of two of at least one group");
+    int8_t *OldCtrl = Ctrl;
+    BucketT *OldBuckets = Buckets;
+    unsigned OldNumBuckets = NumBuckets;
+    unsigned OldNumEntries = NumEntries;
+
+    allocate(NewNumBuckets);
+    for (unsigned I = 0; I != OldNumBuckets; ++I) {
+      if (OldCtrl[I] < 0)
+        continue;
+      BucketT &Old = OldBuckets[I];
+      uint64_t Hash = hashOf(Old.getFirst());
+      unsigned Idx = findInsertSlot(Hash);
+      Ctrl[Idx] = tagOf(Hash);
+      ::new (&Buckets[Idx].getFirst()) KeyT(std::move(Old.getFirst()));
+      ::new (&Buckets[Idx].getSecond()) ValueT(std::move(Old.getSecond()));
+      Old.getSecond().~ValueT();
+      Old.getFirst().~KeyT();
+    }
+    NumEntries = OldNumEntries;
+
+    operator delete(OldBuckets);
+    delete[] OldCtrl;
+  }
+
+  void copyFrom(const FlatHashMap &Other) {
+    allocate(Other.NumBuckets);
+    if (NumBuckets == 0)
+      return;
+
+    std::memcpy(Ctrl, Other.Ctrl, NumBuckets);
+    for (unsigned I = 0; I != NumBuckets; ++I) {
+      if (Ctrl[I] < 0)
+        continue;
+      ::new (&Buckets[I].getFirst()) KeyT(Other.Buckets[I].getFirst());
+      ::new (&Buckets[I].getSecond()) ValueT(Other.Buckets[I].getSecond());
+    }
+    NumEntries = Other.NumEntries;
+    NumDeleted = Other.NumDeleted;
+  }
+
+  iterator makeIterator(BucketT *B) {
+    unsigned Idx = B - Buckets;
+    return iterator(Ctrl + Idx, Ctrl + NumBuckets, B, *this, true);
+  }
+  const_iterator makeConstIterator(const BucketT *B) const {
+    unsigned Idx = B - Buckets;
+    return const_iterator(Ctrl + Idx, Ctrl + NumBuckets, B, *this, true);
+  }
+};
+
+template <typename KeyT, typename ValueT, typename KeyInfoT, typename BucketT,
+          bool IsConst>
+class FlatHashMapIterator : DebugEpochBase::HandleBase {
+  typedef FlatHashMapIterator<KeyT, ValueT, KeyInfoT, BucketT, true>
+      ConstIterator;
+  friend class FlatHashMapIterator<KeyT, ValueT, KeyInfoT, BucketT, true>;
+  friend class FlatHashMapIterator<KeyT, ValueT, KeyInfoT, BucketT, false>;
+
+public:
+  typedef ptrdiff_t difference_type;
+  typedef typename std::conditional<IsConst, const BucketT, BucketT>::type
+      value_type;
+  typedef value_type *pointer;
+  typedef value_type &reference;
+  typedef std::forward_iterator_tag iterator_category;
+
+private:
+  const int8_t *Ctrl = nullptr;
+  const int8_t *End = nullptr;
+  pointer Ptr = nullptr;
+
+public:
+  FlatHashMapIterator() = default;
+
+  FlatHashMapIterator(const int8_t *Ctrl, const int8_t *End, pointer Pos,
+                      const DebugEpochBase &Epoch, bool NoAdvance = false)
+      : DebugEpochBase::HandleBase(&Epoch), Ctrl(Ctrl), End(End), Ptr(Pos) {
+    assert(isHandleInSync() && "invalid construction!");
+    if (!NoAdvance)
+      AdvancePastEmptyBuckets();
+  }
+
+  // Converting ctor from non-const iterators to const iterators. SFINAE'd out
+  // for const iterator destinations so it doesn't end up as a user defined copy
+  // constructor.
+  template <bool IsConstSrc,
+            typename = typename std::enable_if<!IsConstSrc && IsConst>::type>
+  FlatHashMapIterator(
+      const FlatHashMapIterator<KeyT, ValueT, KeyInfoT, BucketT, IsConstSrc> &I)
+      : DebugEpochBase::HandleBase(I), Ctrl(I.Ctrl), End(I.End), Ptr(I.Ptr) {}
+
+  reference operator*() const {
+    assert(isHandleInSync() && "invalid iterator access!");
+    return *Ptr;
+  }
+  pointer operator->() const {
+    assert(isHandleInSync() && "invalid iterator access!");
+    return Ptr;
+  }
+
+  bool operator==(const ConstIterator &RHS) const {
+    assert((!Ptr || isHandleInSync()) && "handle not in sync!");
+    assert((!RHS.Ptr || RHS.isHandleInSync()) && "handle not in sync!");
+    assert(getEpochAddress() == RHS.getEpochAddress() &&
+           "comparing incomparable iterators!");
+    return Ptr == RHS.Ptr;
+  }
+  bool operator!=(const ConstIterator &RHS) const { return !(*this == RHS); }
+
+  FlatHashMapIterator &operator++() { // Preincrement
+    assert(isHandleInSync() && "invalid iterator access!");
+    ++Ctrl;
+    ++Ptr;
+    AdvancePastEmptyBuckets();
+    return *this;
+  }
+  FlatHashMapIterator operator++(int) { // Postincrement
+    assert(isHandleInSync() && "invalid iterator access!");
+    FlatHashMapIterator Tmp = *this;
+    ++*this;
+    return Tmp;
+  }
+
+private:
+  void AdvancePastEmptyBuckets() {
+    while (Ctrl != End && *Ctrl < 0) {
+      ++Ctrl;
+      ++Ptr;
+    }
+  }
+};
+
+template <typename KeyT, typename ValueT, typename KeyInfoT>
+static inline size_t
+capacity_in_bytes(const FlatHashMap<KeyT, ValueT, KeyInfoT> &X) {
+  return X.getMemorySize();
+}
+
+} // end namespace llvm
+
+#endif // LLVM_ADT_FLATHASHMAP_H
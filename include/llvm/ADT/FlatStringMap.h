@@ -0,0 +1,266 @@
+//===- llvm/ADT/FlatStringMap.h - Group probed string map -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the FlatStringMap class, a StringMap variant tuned for
+// tables with many long keys such as symbol tables.
+//
+// Entries are the same StringMapEntry objects StringMap uses, so code that
+// holds on to entries (or their keys) works with either map. The table itself
+// differs: keys are hashed with xxHash64 instead of the Bernstein hash, the
+// full 64-bit hash of each entry is cached so that growing never rehashes a
+// string, and lookups compare a 7-bit tag of the hash against a whole group
+// of 16 buckets at once (see FlatHashMap.h) before looking at any key.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ADT_FLATSTRINGMAP_H
+#define LLVM_ADT_FLATSTRINGMAP_H
+
+#include "llvm/ADT/FlatHashMap.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Allocator.h"
+#include <cstdint>
+#include <utility>
+
+namespace llvm {
+
+/// FlatStringMapImpl - This is the base class of FlatStringMap that is shared
+/// among all of its instantiations.
+///
+/// The table is a single allocation holding, for NumBuckets buckets, the
+/// entry pointers (plus a non-null sentinel so that StringMap's iterators stop
+/// at the end), the cached hashes and the control bytes. Buckets that do not
+/// hold an entry have a null pointer, which is what StringMap's iterators
+/// expect.
+class FlatStringMapImpl {
+protected:
+  StringMapEntryBase **TheTable = nullptr;
+  uint64_t *Hashes = nullptr;
+  int8_t *Ctrl = nullptr;
+  unsigned NumBuckets = 0;
+  unsigned NumItems = 0;
+  unsigned NumDeleted = 0;
+  unsigned ItemSize;
+
+  explicit FlatStringMapImpl(unsigned ItemSize) : ItemSize(ItemSize) {}
+  FlatStringMapImpl(unsigned InitSize, unsigned ItemSize);
+  FlatStringMapImpl(FlatStringMapImpl &&RHS) : ItemSize(RHS.ItemSize) {
+    swap(RHS);
+  }
+  ~FlatStringMapImpl();
+
+  /// Look up the bucket that \p Name should be in. If the key is already in
+  /// the map, returns its bucket; its entry pointer is non-null. Otherwise
+  /// claims a bucket for the key, growing the table first if needed, and
+  /// returns it with a null entry pointer that the caller must fill in.
+  unsigned LookupBucketFor(StringRef Name);
+
+  /// Return the bucket holding \p Key, or -1 if the key is not in the map.
+  int FindKey(StringRef Key) const;
+
+  /// Remove the entry \p V from the table, but do not delete it. This aborts
+  /// if the entry is not in the table.
+  void RemoveKey(StringMapEntryBase *V);
+
+  /// Remove the entry for \p Key from the table and return it, or return null
+  /// if the key is not in the table.
+  StringMapEntryBase *RemoveKey(StringRef Key);
+
+  /// Allocate an empty table of \p Size buckets.
+  void init(unsigned Size);
+
+  /// Forget every entry without destroying them.
+  void resetBuckets();
+
+private:
+  int findKey(StringRef Key, uint64_t Hash) const;
+  void eraseBucket(unsigned Bucket);
+  unsigned findInsertSlot(uint64_t Hash) const;
+  void rehash(unsigned NewSize);
+
+public:
+  unsigned getNumItems() const { return NumItems; }
+  unsigned getNumBuckets() const { return NumBuckets; }
+
+  bool empty() const { return NumItems == 0; }
+  unsigned size() const { return NumItems; }
+
+  void swap(FlatStringMapImpl &Other) {
+    std::swap(TheTable, Other.TheTable);
+    std::swap(Hashes, Other.Hashes);
+    std::swap(Ctrl, Other.Ctrl);
+    std::swap(NumBuckets, Other.NumBuckets);
+    std::swap(NumItems, Other.NumItems);
+    std::swap(NumDeleted, Other.NumDeleted);
+  }
+};
+
+/// FlatStringMap - A map from strings to values with StringMap's interface
+/// and entry layout, built for large tables of long keys. See the file
+/// comment for how it differs from StringMap.
+template <typename ValueTy, typename AllocatorTy = MallocAllocator>
+class FlatStringMap : public FlatStringMapImpl {
+  AllocatorTy Allocator;
+
+public:
+  typedef StringMapEntry<ValueTy> MapEntryTy;
+
+  FlatStringMap()
+      : FlatStringMapImpl(static_cast<unsigned>(sizeof(MapEntryTy))) {}
+  explicit FlatStringMap(unsigned InitialSize)
+      : FlatStringMapImpl(InitialSize,
+                          static_cast<unsigned>(sizeof(MapEntryTy))) {}
+
+  explicit FlatStringMap(AllocatorTy A)
+      : FlatStringMapImpl(static_cast<unsigned>(sizeof(MapEntryTy))),
+        Allocator(A) {}
+
+  FlatStringMap(unsigned InitialSize, AllocatorTy A)
+      : FlatStringMapImpl(InitialSize,
+                          static_cast<unsigned>(sizeof(MapEntryTy))),
+        Allocator(A) {}
+
+  FlatStringMap(FlatStringMap &&RHS)
+      : FlatStringMapImpl(std::move(RHS)), Allocator(std::move(RHS.Allocator)) {
+  }
+
+  FlatStringMap &operator=(FlatStringMap &&RHS) {
+    FlatStringMapImpl::swap(RHS);
+    std::swap(Allocator, RHS.Allocator);
+    return *this;
+  }
+
+  FlatStringMap(const FlatStringMap &) = delete;
+  FlatStringMap &operator=(const FlatStringMap &) = delete;
+
+  ~FlatStringMap() {
+    for (unsigned I = 0, E = NumBuckets; I != E; ++I)
+      if (StringMapEntryBase *Bucket = TheTable[I])
+        static_cast<MapEntryTy *>(Bucket)->Destroy(Allocator);
+  }
+
+  AllocatorTy &getAllocator() { return Allocator; }
+  const AllocatorTy &getAllocator() const { return Allocator; }
+
+  typedef const char *key_type;
+  typedef ValueTy mapped_type;
+  typedef StringMapEntry<ValueTy> value_type;
+  typedef size_t size_type;
+
+  typedef StringMapConstIterator<ValueTy> const_iterator;
+  typedef StringMapIterator<ValueTy> iterator;
+
+  iterator begin() { return iterator(TheTable, NumBuckets == 0); }
+  iterator end() { return iterator(TheTable + NumBuckets, true); }
+  const_iterator begin() const {
+    return const_iterator(TheTable, NumBuckets == 0);
+  }
+  const_iterator end() const {
+    return const_iterator(TheTable + NumBuckets, true);
+  }
+
+  iterator find(StringRef Key) {
+    int Bucket = FindKey(Key);
+    if (Bucket == -1)
+      return end();
+    return iterator(TheTable + Bucket, true);
+  }
+
+  const_iterator find(StringRef Key) const {
+    int Bucket = FindKey(Key);
+    if (Bucket == -1)
+      return end();
+    return const_iterator(TheTable + Bucket, true);
+  }
+
+  /// lookup - Return the entry for the specified key, or a default
+  /// constructed value if no such entry exists.
+  ValueTy lookup(StringRef Key) const {
+    const_iterator It = find(Key);
+    if (It != end())
+      return It->second;
+    return ValueTy();
+  }
+
+  /// Lookup the ValueTy for the \p Key, or create a default constructed value
+  /// if the key is not in the map.
+  ValueTy &operator[](StringRef Key) { return try_emplace(Key).first->second; }
+
+  /// count - Return 1 if the element is in the map, 0 otherwise.
+  size_type count(StringRef Key) const { return FindKey(Key) == -1 ? 0 : 1; }
+
+  /// insert - Insert the specified entry into the map. If the key already
+  /// exists in the map, return false and ignore the request, otherwise insert
+  /// it and return true.
+  bool insert(MapEntryTy *KeyValue) {
+    unsigned BucketNo = LookupBucketFor(KeyValue->getKey());
+    StringMapEntryBase *&Bucket = TheTable[BucketNo];
+    if (Bucket)
+      return false; // Already exists in map.
+    Bucket = KeyValue;
+    return true;
+  }
+
+  /// insert - Inserts the specified key/value pair into the map if the key
+  /// isn't already in the map. The bool component of the returned pair is true
+  /// if and only if the insertion takes place, and the iterator component of
+  /// the pair points to the element with key equivalent to the key of the pair.
+  std::pair<iterator, bool> insert(std::pair<StringRef, ValueTy> KV) {
+    return try_emplace(KV.first, std::move(KV.second));
+  }
+
+  /// Emplace a new element for the specified key into the map if the key isn't
+  /// already in the map. The bool component of the returned pair is true
+  /// if and only if the insertion takes place, and the iterator component of
+  /// the pair points to the element with key equivalent to the key of the pair.
+  template <typename... ArgsTy>
+  std::pair<iterator, bool> try_emplace(StringRef Key, ArgsTy &&... Args) {
+    unsigned BucketNo = LookupBucketFor(Key);
+    StringMapEntryBase *&Bucket = TheTable[BucketNo];
+    if (Bucket)
+      return std::make_pair(iterator(TheTable + BucketNo, true), false);
+
+    Bucket = MapEntryTy::Create(Key, Allocator, std::forward<ArgsTy>(Args)...);
+    return std::make_pair(iterator(TheTable + BucketNo, true), true);
+  }
+
+  /// clear - Empties out the map.
+  void clear() {
+    if (empty())
+      return;
+
+    for (unsigned I = 0, E = NumBuckets; I != E; ++I)
+      if (StringMapEntryBase *Bucket = TheTable[I])
+        static_cast<MapEntryTy *>(Bucket)->Destroy(Allocator);
+    resetBuckets();
+  }
+
+  /// remove - Remove the specified key/value pair from the map, but do not
+  /// erase it. This aborts if the key is not in the map.
+  void remove(MapEntryTy *KeyValue) { RemoveKey(KeyValue); }
+
+  void erase(iterator I) {
+    MapEntryTy &V = *I;
+    remove(&V);
+    V.Destroy(Allocator);
+  }
+
+  bool erase(StringRef Key) {
+    StringMapEntryBase *V = RemoveKey(Key);
+    if (!V)
+      return false;
+    static_cast<MapEntryTy *>(V)->Destroy(Allocator);
+    return true;
+  }
+};
+
+} // end namespace llvm
+
+#endif // LLVM_ADT_FLATSTRINGMAP_H
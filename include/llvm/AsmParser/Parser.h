@@ -67,6 +67,25 @@ std::unique_ptr<Module> parseAssembly(MemoryBufferRef F, SMDiagnostic &Err,
                                       LLVMContext &Context,
                                       SlotMapping *Slots = nullptr);
 
+/// Parse LLVM Assembly from a MemoryBuffer without parsing the function
+/// bodies. Each body is skipped over and only parsed when its function is
+/// materialized, like getLazyBitcodeModule does for bitcode. The module takes
+/// ownership of the buffer. Assembly with uselistorder directives is parsed
+/// eagerly, since use list orders can only be restored once every body has
+/// been parsed.
+/// \param Buffer The MemoryBuffer containing assembly
+/// \param Err Error result info for the parts parsed up front. Errors in a
+///            function body are reported when the function is materialized.
+/// \param Context Context in which to allocate globals info.
+std::unique_ptr<Module> parseLazyAssembly(std::unique_ptr<MemoryBuffer> Buffer,
+                                          SMDiagnostic &Err,
+                                          LLVMContext &Context);
+
+/// Like parseLazyAssembly, but reads the assembly from the file \p Filename.
+std::unique_ptr<Module> parseLazyAssemblyFile(StringRef Filename,
+                                              SMDiagnostic &Err,
+                                              LLVMContext &Context);
+
 /// This function is the low-level interface to the LLVM Assembly Parser.
 /// This is kept as an independent function instead of being inlined into
 /// parseAssembly for the convenience of interactive users that want to add
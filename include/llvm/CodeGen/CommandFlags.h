@@ -107,6 +107,17 @@ ExceptionModel("exception-model",
                           clEnumValN(ExceptionHandling::WinEH, "wineh",
                                      "Windows exception model")));
 
+cl::opt<DebugCompressionType> CompressDebugSections(
+    "compress-debug-sections",
+    cl::desc("Choose DWARF debug sections compression"),
+    cl::init(DebugCompressionType::DCT_None),
+    cl::values(clEnumValN(DebugCompressionType::DCT_None, "none",
+                          "No compression"),
+               clEnumValN(DebugCompressionType::DCT_Zlib, "zlib",
+                          "Use zlib compression"),
+               clEnumValN(DebugCompressionType::DCT_ZlibGnu, "zlib-gnu",
+                          "Use zlib-gnu compression (deprecated)")));
+
 cl::opt<TargetMachine::CodeGenFileType>
 FileType("filetype", cl::init(TargetMachine::CGFT_AssemblyFile),
   cl::desc("Choose a file type (not all types are supported by all targets):"),
@@ -299,6 +310,7 @@ static inline TargetOptions InitTargetOptionsFromCodeGenFlags() {
   Options.UniqueSectionNames = UniqueSectionNames;
   Options.EmulatedTLS = EmulatedTLS;
   Options.ExceptionModel = ExceptionModel;
+  Options.CompressDebugSections = CompressDebugSections;
 
   Options.MCOptions = InitMCTargetOptionsFromFlags();
 
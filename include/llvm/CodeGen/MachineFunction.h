@@ -226,8 +226,10 @@ class MachineFunction {
   // numbered and this vector keeps track of the mapping from ID's to MBB's.
   std::vector<MachineBasicBlock*> MBBNumbering;
 
-  // Pool-allocate MachineFunction-lifetime and IR objects.
-  BumpPtrAllocator Allocator;
+  // Pool-allocate MachineFunction-lifetime and IR objects. The arena is
+  // borrowed from MachineModuleInfo and handed back when the function dies.
+  std::unique_ptr<BumpPtrAllocator> Arena;
+  BumpPtrAllocator &Allocator;
 
   // Allocation management for instructions in function.
   Recycler<MachineInstr> InstructionRecycler;
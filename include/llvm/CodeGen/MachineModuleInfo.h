@@ -41,6 +41,7 @@
 #include "llvm/MC/MCSymbol.h"
 #include "llvm/MC/MachineLocation.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/Allocator.h"
 #include "llvm/Support/DataTypes.h"
 
 namespace llvm {
@@ -135,6 +136,11 @@ class MachineModuleInfo : public ImmutablePass {
   bool UsesMorestackAddr;
 
   MachineFunctionInitializer *MFInitializer;
+  /// Arenas handed back by destroyed MachineFunctions. They are reset and
+  /// reused by the next MachineFunction so that codegen of a large module does
+  /// not allocate and free a fresh arena for every function. This must be
+  /// declared before MachineFunctions, which recycle into it when destroyed.
+  std::vector<std::unique_ptr<BumpPtrAllocator>> FunctionArenas;
   /// Maps IR Functions to their corresponding MachineFunctions.
   DenseMap<const Function*, std::unique_ptr<MachineFunction>> MachineFunctions;
   /// Next unique number available for a MachineFunction.
@@ -171,6 +177,14 @@ public:
   /// Machine Function map.
   void deleteMachineFunctionFor(Function &F);
 
+  /// Returns an empty arena for a new MachineFunction, reusing one released
+  /// by a previous function when available.
+  std::unique_ptr<BumpPtrAllocator> takeFunctionArena();
+
+  /// Resets \p Arena and keeps it for the next MachineFunction. Everything
+  /// allocated from it becomes invalid.
+  void recycleFunctionArena(std::unique_ptr<BumpPtrAllocator> Arena);
+
   /// Keep track of various per-function pieces of information for backends
   /// that would like to do so.
   template<typename Ty>
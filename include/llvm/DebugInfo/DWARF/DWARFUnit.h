@@ -128,6 +128,20 @@ class DWARFUnit {
   // The compile unit debug information entry items.
   std::vector<DWARFDebugInfoEntry> DieArray;
 
+  /// An address range of a subprogram DIE.
+  struct SubprogramRange {
+    uint64_t LowPC;
+    uint64_t HighPC;
+    /// The largest HighPC of this range and all ranges before it.
+    uint64_t MaxHighPC;
+    /// The index of the subprogram in DieArray.
+    uint32_t DIEIndex;
+  };
+  /// The address ranges of all subprograms in DieArray sorted by LowPC, built
+  /// by the first address lookup after the DIEs are extracted.
+  std::vector<SubprogramRange> SubprogramRanges;
+  bool SubprogramRangesBuilt = false;
+
   class DWOHolder {
     object::OwningBinary<object::ObjectFile> DWOFile;
     std::unique_ptr<DWARFContext> DWOContext;
@@ -309,6 +323,10 @@ private:
   /// it was actually constructed.
   bool parseDWO();
 
+  /// buildSubprogramRanges - Collects the address ranges of all subprogram
+  /// DIEs into SubprogramRanges.
+  void buildSubprogramRanges();
+
   /// getSubprogramForAddress - Returns subprogram DIE with address range
   /// encompassing the provided address. The pointer is alive as long as parsed
   /// compile unit DIEs are not cleared.
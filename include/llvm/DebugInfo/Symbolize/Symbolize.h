@@ -13,13 +13,16 @@
 #ifndef LLVM_DEBUGINFO_SYMBOLIZE_SYMBOLIZE_H
 #define LLVM_DEBUGINFO_SYMBOLIZE_SYMBOLIZE_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/DebugInfo/Symbolize/SymbolizableModule.h"
 #include "llvm/Object/ObjectFile.h"
 #include "llvm/Support/ErrorOr.h"
+#include <list>
 #include <map>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace llvm {
 namespace symbolize {
@@ -36,12 +39,16 @@ public:
     bool RelativeAddresses : 1;
     std::string DefaultArch;
     std::vector<std::string> DsymHints;
+    /// Approximate number of bytes of binaries to keep loaded, or 0 for no
+    /// limit. When loading a module goes over the limit, the least recently
+    /// used modules are dropped along with the binaries only they use.
+    uint64_t MaxCacheSize;
     Options(FunctionNameKind PrintFunctions = FunctionNameKind::LinkageName,
             bool UseSymbolTable = true, bool Demangle = true,
             bool RelativeAddresses = false, std::string DefaultArch = "")
         : PrintFunctions(PrintFunctions), UseSymbolTable(UseSymbolTable),
           Demangle(Demangle), RelativeAddresses(RelativeAddresses),
-          DefaultArch(std::move(DefaultArch)) {}
+          DefaultArch(std::move(DefaultArch)), MaxCacheSize(0) {}
   };
 
   LLVMSymbolizer(const Options &Opts = Options()) : Opts(Opts) {}
@@ -55,7 +62,28 @@ public:
                                                 uint64_t ModuleOffset);
   Expected<DIGlobal> symbolizeData(const std::string &ModuleName,
                                    uint64_t ModuleOffset);
+
+  /// Batch versions of the queries above, which look \p ModuleName up once
+  /// and return one result per offset, in the same order. Passing the offsets
+  /// sorted keeps lookups that fall into the same compile unit together.
+  Expected<std::vector<DILineInfo>>
+  symbolizeCodeBatch(const std::string &ModuleName,
+                     ArrayRef<uint64_t> ModuleOffsets);
+  Expected<std::vector<DIInliningInfo>>
+  symbolizeInlinedCodeBatch(const std::string &ModuleName,
+                            ArrayRef<uint64_t> ModuleOffsets);
+  Expected<std::vector<DIGlobal>>
+  symbolizeDataBatch(const std::string &ModuleName,
+                     ArrayRef<uint64_t> ModuleOffsets);
+
   void flush();
+
+  /// Returns the number of modules currently cached.
+  size_t getNumCachedModules() const { return Modules.size(); }
+  /// Returns the approximate size, in bytes, of the binaries the cached
+  /// modules keep loaded.
+  uint64_t getCacheSize() const { return CacheSize; }
+
   static std::string DemangleName(const std::string &Name,
                                   const SymbolizableModule *ModInfo);
 
@@ -64,13 +92,40 @@ private:
   // corresponding debug info. These objects can be the same.
   typedef std::pair<ObjectFile*, ObjectFile*> ObjectPair;
 
+  /// A loaded module, or a null module if loading it failed.
+  struct CachedModule {
+    std::unique_ptr<SymbolizableModule> Module;
+    /// The objects the module was created from.
+    ObjectPair Objects;
+    /// Bytes of the objects, counted against Options::MaxCacheSize.
+    uint64_t Size;
+    /// The position of the module name in ModuleLRU.
+    std::list<std::string>::iterator LRUPos;
+  };
+
+  DILineInfo symbolizeCode(SymbolizableModule *Info, uint64_t ModuleOffset);
+  DIInliningInfo symbolizeInlinedCode(SymbolizableModule *Info,
+                                      uint64_t ModuleOffset);
+  DIGlobal symbolizeData(SymbolizableModule *Info, uint64_t ModuleOffset);
+
   /// Returns a SymbolizableModule or an error if loading debug info failed.
-  /// Only one attempt is made to load a module, and errors during loading are
-  /// only reported once. Subsequent calls to get module info for a module that
-  /// failed to load will return nullptr.
+  /// Only one attempt is made to load a module while it stays in the cache,
+  /// and errors during loading are only reported once. Subsequent calls to get
+  /// module info for a module that failed to load will return nullptr.
   Expected<SymbolizableModule *>
   getOrCreateModuleInfo(const std::string &ModuleName);
 
+  /// Caches \p Module, created from \p Objects, under \p ModuleName, then
+  /// drops least recently used modules until the cache fits in
+  /// Options::MaxCacheSize again.
+  SymbolizableModule *addModule(const std::string &ModuleName,
+                                std::unique_ptr<SymbolizableModule> Module,
+                                ObjectPair Objects);
+
+  /// Drops the least recently used module, then every cached binary and
+  /// object that no remaining module was created from.
+  void evictModule();
+
   ObjectFile *lookUpDsymFile(const std::string &Path,
                              const MachOObjectFile *ExeObj,
                              const std::string &ArchName);
@@ -88,7 +143,13 @@ private:
   Expected<ObjectFile *> getOrCreateObject(const std::string &Path,
                                           const std::string &ArchName);
 
-  std::map<std::string, std::unique_ptr<SymbolizableModule>> Modules;
+  std::map<std::string, CachedModule> Modules;
+
+  /// \brief Names of the cached modules, most recently used first.
+  std::list<std::string> ModuleLRU;
+
+  /// \brief Sum of the sizes of the cached modules.
+  uint64_t CacheSize = 0;
 
   /// \brief Contains cached results of getOrCreateObjectPair().
   std::map<std::pair<std::string, std::string>, ObjectPair>
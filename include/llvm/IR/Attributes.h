@@ -231,6 +231,11 @@ private:
                               ArrayRef<std::pair<unsigned,
                                                  AttributeSetNode*> > Attrs);
 
+  /// \brief Return a copy of this list with the attributes at \p Index
+  /// replaced by \p Node, or removed if \p Node is null.
+  AttributeSet setAttributes(LLVMContext &C, unsigned Index,
+                             AttributeSetNode *Node) const;
+
   explicit AttributeSet(AttributeSetImpl *LI) : pImpl(LI) {}
 
 public:
@@ -451,6 +456,12 @@ class AttrBuilder {
   uint64_t DerefOrNullBytes;
   uint64_t AllocSizeArgs;
 
+  friend class AttributeSet;
+
+  /// \brief Create a builder holding the attributes in \p ASN, which may be
+  /// null.
+  explicit AttrBuilder(const AttributeSetNode *ASN);
+
 public:
   AttrBuilder()
       : Attrs(0), Alignment(0), StackAlignment(0), DerefBytes(0),
@@ -37,6 +37,18 @@ extern template void Calculate<Function, BasicBlock *>(
 extern template void Calculate<Function, Inverse<BasicBlock *>>(
     DominatorTreeBaseByGraphTraits<GraphTraits<Inverse<BasicBlock *>>> &DT,
     Function &F);
+extern template void InsertEdge<BasicBlock>(DominatorTreeBase<BasicBlock> &DT,
+                                           BasicBlock *From, BasicBlock *To);
+extern template void DeleteEdge<BasicBlock>(DominatorTreeBase<BasicBlock> &DT,
+                                           BasicBlock *From, BasicBlock *To);
+extern template void ApplyUpdates<BasicBlock>(
+    DominatorTreeBase<BasicBlock> &DT,
+    ArrayRef<DominatorTreeBase<BasicBlock>::UpdateType> Updates);
+extern template bool Verify<BasicBlock>(const DominatorTreeBase<BasicBlock> &DT);
+
+/// Whether to verify dominator trees that passes preserve, and the ones they
+/// update incrementally, against recalculated ones (-verify-dom-info).
+extern bool VerifyDomInfo;
 
 typedef DomTreeNodeBase<BasicBlock> DomTreeNode;
 
@@ -746,10 +746,11 @@ public:
   /// Print the module to an output stream with an optional
   /// AssemblyAnnotationWriter.  If \c ShouldPreserveUseListOrder, then include
   /// uselistorder directives so that use-lists can be recreated when reading
-  /// the assembly.
+  /// the assembly. If \c Threads is more than one, the functions may be
+  /// printed on that many threads, which does not change the output.
   void print(raw_ostream &OS, AssemblyAnnotationWriter *AAW,
              bool ShouldPreserveUseListOrder = false,
-             bool IsForDebug = false) const;
+             bool IsForDebug = false, unsigned Threads = 1) const;
 
   /// Dump the module to stderr (for debugging).
   void dump() const;
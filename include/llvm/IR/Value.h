@@ -240,6 +240,7 @@ public:
 private:
   void destroyValueName();
   void doRAUW(Value *New, bool NoMetadata);
+  void transferUseListTo(Value *New);
   void setNameImpl(const Twine &Name);
 
 public:
@@ -19,7 +19,8 @@
 // legal to call back into the ValueMap from a Config's callbacks.  Config
 // parameters should inherit from ValueMapConfig<KeyT> to get default
 // implementations of all the methods ValueMap uses.  See ValueMapConfig for
-// documentation of the functions you can override.
+// documentation of the functions you can override.  The Config also picks the
+// underlying map type, which is a DenseMap by default.
 //
 //===----------------------------------------------------------------------===//
 
@@ -80,6 +81,11 @@ struct ValueMapConfig {
   /// mutex is necessary.
   template<typename ExtraDataT>
   static mutex_type *getMutex(const ExtraDataT &/*Data*/) { return nullptr; }
+
+  /// The map the ValueMap keeps its entries in.  Configs can replace this with
+  /// any map that provides DenseMap's interface, such as FlatHashMap.
+  template <typename MapKeyT, typename MapValueT, typename MapKeyInfoT>
+  using MapType = DenseMap<MapKeyT, MapValueT, MapKeyInfoT>;
 };
 
 /// See the file comment.
@@ -88,7 +94,9 @@ class ValueMap {
   friend class ValueMapCallbackVH<KeyT, ValueT, Config>;
 
   typedef ValueMapCallbackVH<KeyT, ValueT, Config> ValueMapCVH;
-  typedef DenseMap<ValueMapCVH, ValueT, DenseMapInfo<ValueMapCVH>> MapT;
+  typedef typename Config::template MapType<ValueMapCVH, ValueT,
+                                           DenseMapInfo<ValueMapCVH>>
+      MapT;
   typedef DenseMap<const Metadata *, TrackingMDRef> MDMapT;
   typedef typename Config::ExtraData ExtraData;
   MapT Map;
@@ -85,8 +85,12 @@ bool verifyFunction(const Function &F, raw_ostream *OS = nullptr);
 /// supplied, DebugInfo verification failures won't be considered as
 /// error and instead *BrokenDebugInfo will be set to true. Debug
 /// info errors can be "recovered" from by stripping the debug info.
+///
+/// If Threads is greater than one, function bodies are verified concurrently
+/// on that many threads before the module-level checks. The result and any
+/// messages are the same as when verifying sequentially.
 bool verifyModule(const Module &M, raw_ostream *OS = nullptr,
-                  bool *BrokenDebugInfo = nullptr);
+                  bool *BrokenDebugInfo = nullptr, unsigned Threads = 1);
 
 FunctionPass *createVerifierPass(bool FatalErrors = true);
 
@@ -15,6 +15,7 @@
 #define LLVM_OBJECT_ARCHIVE_H
 
 #include "llvm/ADT/Optional.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/iterator_range.h"
 #include "llvm/Object/Binary.h"
@@ -240,6 +241,11 @@ public:
   // check if a symbol is in the archive
   Expected<Optional<Child>> findSym(StringRef name) const;
 
+  /// Find the first member called \p Name. The first call walks the archive
+  /// once to build a hash index of the member names, so later lookups take
+  /// constant time. Building the index is not thread safe.
+  Expected<Optional<Child>> findMember(StringRef Name) const;
+
   bool isEmpty() const;
   bool hasSymbolTable() const;
   StringRef getSymbolTable() const { return SymbolTable; }
@@ -261,6 +267,10 @@ private:
   unsigned Format : 3;
   unsigned IsThin : 1;
   mutable std::vector<std::unique_ptr<MemoryBuffer>> ThinBuffers;
+
+  /// The first member with each name, built by findMember().
+  mutable StringMap<Child> MemberIndex;
+  mutable bool HasMemberIndex = false;
 };
 
 }
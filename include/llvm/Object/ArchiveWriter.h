@@ -25,6 +25,11 @@ struct NewArchiveMember {
   sys::TimePoint<std::chrono::seconds> ModTime;
   unsigned UID = 0, GID = 0, Perms = 0644;
 
+  /// For members made by getLazyFile(), Buf is null and the contents are
+  /// only read from LazyPath while the archive is being written.
+  std::string LazyPath;
+  uint64_t LazySize = 0;
+
   bool IsNew = false;
   NewArchiveMember() = default;
   NewArchiveMember(MemoryBufferRef BufRef);
@@ -34,12 +39,29 @@ struct NewArchiveMember {
 
   static Expected<NewArchiveMember> getFile(StringRef FileName,
                                             bool Deterministic);
+
+  /// Like getFile(), but only stats the file. writeArchive() reads it when
+  /// it needs the contents and drops them again right after, so a thin
+  /// archive of many large members can be written without holding them all
+  /// in memory at once.
+  static Expected<NewArchiveMember> getLazyFile(StringRef FileName,
+                                                bool Deterministic);
+
+  /// The path the member was read from.
+  StringRef getPath() const {
+    return Buf ? Buf->getBufferIdentifier() : StringRef(LazyPath);
+  }
+  /// The size of the member's contents.
+  uint64_t getSize() const { return Buf ? Buf->getBufferSize() : LazySize; }
 };
 
+/// Write the archive \p ArcName with the members \p NewMembers. The members
+/// are scanned for the symbol table on up to \p NumThreads threads.
 std::pair<StringRef, std::error_code>
 writeArchive(StringRef ArcName, std::vector<NewArchiveMember> &NewMembers,
              bool WriteSymtab, object::Archive::Kind Kind, bool Deterministic,
-             bool Thin, std::unique_ptr<MemoryBuffer> OldArchiveBuf = nullptr);
+             bool Thin, std::unique_ptr<MemoryBuffer> OldArchiveBuf = nullptr,
+             unsigned NumThreads = 1);
 }
 
 #endif
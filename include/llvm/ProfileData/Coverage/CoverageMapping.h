@@ -450,9 +450,13 @@ public:
     return load(ArrayRef<StringRef>(ObjectFilename), ProfileFilename, Arch);
   }
 
+  /// \brief Load the coverage mapping from the given files, reading and
+  /// decoding the object files on up to \p NumThreads threads (0 means one
+  /// per hardware thread). The profile is consulted in the order of the
+  /// object files, so the result does not depend on the number of threads.
   static Expected<std::unique_ptr<CoverageMapping>>
   load(ArrayRef<StringRef> ObjectFilenames, StringRef ProfileFilename,
-       StringRef Arch = StringRef());
+       StringRef Arch = StringRef(), unsigned NumThreads = 1);
 
   /// \brief The number of functions that couldn't have their profiles mapped.
   ///
@@ -401,7 +401,10 @@ public:
   /// Return the maximum of all known function counts.
   uint64_t getMaximumFunctionCount() { return Summary->getMaxFunctionCount(); }
 
-  /// Factory method to create an indexed reader.
+  /// Factory method to create an indexed reader. The file is mapped rather
+  /// than read into memory, and only the records that are looked up are
+  /// decoded, so a compiler looking up the functions of one module touches
+  /// little of a large profile. The summary comes from the file header.
   static Expected<std::unique_ptr<IndexedInstrProfReader>>
   create(const Twine &Path);
 
@@ -204,10 +204,34 @@
 //          in the text format documentation above).
 //        FUNCTION BODY
 //          A FUNCTION BODY entry describing the inlined function.
+//
+//
+// Compact binary format
+// ---------------------
+//
+// This is the binary format with an index of the top-level functions, so that
+// a reader can load the profiles of just the functions it needs. The magic
+// number is SPMagic(SPF_Compact_Binary). The SUMMARY and NAME TABLE follow as
+// in the binary format, and then:
+//
+// FUNCTION OFFSET TABLE
+//    SIZE (uint32_t)
+//        Number of top-level functions in the profile.
+//    ENTRIES
+//        A list of SIZE entries, one for each function:
+//          NAME_IDX (uint32_t)
+//            Index into the name table with the function name.
+//          OFFSET (uint64_t)
+//            Offset of the function's FUNCTION BODY, counted from the end
+//            of the function offset table.
+//
+// The FUNCTION BODY entries of the binary format follow.
 //===----------------------------------------------------------------------===//
 #ifndef LLVM_PROFILEDATA_SAMPLEPROFREADER_H
 #define LLVM_PROFILEDATA_SAMPLEPROFREADER_H
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/Twine.h"
@@ -225,6 +249,8 @@
 
 namespace llvm {
 
+class Module;
+
 namespace sampleprof {
 
 /// \brief Sample-based profile reader.
@@ -267,6 +293,11 @@ public:
   /// \brief Read sample profiles from the associated file.
   virtual std::error_code read() = 0;
 
+  /// \brief Limit what read() loads to the profiles of the functions defined
+  /// in \p M. Formats without a function index ignore this and read every
+  /// profile.
+  virtual void collectFuncsToUse(const Module &M) {}
+
   /// \brief Print the profile for \p FName on stream \p OS.
   void dumpFunctionProfile(StringRef FName, raw_ostream &OS = dbgs());
 
@@ -374,6 +405,13 @@ protected:
   /// Read the contents of the given profile instance.
   std::error_code readProfile(FunctionSamples &FProfile);
 
+  /// Read the profile of a top-level function, starting with its head
+  /// samples.
+  std::error_code readFuncProfile();
+
+  /// \brief Check that \p Magic identifies the format of this reader.
+  virtual std::error_code verifySPMagic(uint64_t Magic);
+
   /// \brief Points to the current location in the buffer.
   const uint8_t *Data;
 
@@ -390,6 +428,40 @@ private:
   std::error_code readSummary();
 };
 
+class SampleProfileReaderCompactBinary : public SampleProfileReaderBinary {
+public:
+  SampleProfileReaderCompactBinary(std::unique_ptr<MemoryBuffer> B,
+                                   LLVMContext &C)
+      : SampleProfileReaderBinary(std::move(B), C) {}
+
+  /// \brief Read and validate the file header, including the function
+  /// offset table.
+  std::error_code readHeader() override;
+
+  /// \brief Read the profiles of the functions passed to
+  /// collectFuncsToUse(), or of every function if it was not called.
+  std::error_code read() override;
+
+  void collectFuncsToUse(const Module &M) override;
+
+  /// \brief Return true if \p Buffer is in the format supported by this class.
+  static bool hasFormat(const MemoryBuffer &Buffer);
+
+private:
+  std::error_code verifySPMagic(uint64_t Magic) override;
+
+  /// The offset of each top-level function's body, counted from
+  /// BodiesStart.
+  DenseMap<StringRef, uint64_t> FuncOffsetTable;
+
+  /// The start of the function bodies.
+  const uint8_t *BodiesStart = nullptr;
+
+  /// The functions to read, if collectFuncsToUse() was called.
+  DenseSet<StringRef> FuncsToUse;
+  bool UseAllFuncs = true;
+};
+
 typedef SmallVector<FunctionSamples *, 10> InlineCallStack;
 
 // Supported histogram types in GCC.  Currently, we only need support for
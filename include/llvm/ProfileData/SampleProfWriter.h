@@ -25,8 +25,6 @@ namespace llvm {
 
 namespace sampleprof {
 
-enum SampleProfileFormat { SPF_None = 0, SPF_Text, SPF_Binary, SPF_GCC };
-
 /// \brief Sample-based profile writer. Base class.
 class SampleProfileWriter {
 public:
@@ -40,7 +38,7 @@ public:
   /// Write all the sample profiles in the given map of samples.
   ///
   /// \returns status code of the file update operation.
-  std::error_code write(const StringMap<FunctionSamples> &ProfileMap) {
+  virtual std::error_code write(const StringMap<FunctionSamples> &ProfileMap) {
     if (std::error_code EC = writeHeader(ProfileMap))
       return EC;
     for (const auto &I : ProfileMap) {
@@ -110,12 +108,15 @@ private:
 /// \brief Sample-based profile writer (binary format).
 class SampleProfileWriterBinary : public SampleProfileWriter {
 public:
+  using SampleProfileWriter::write;
   std::error_code write(const FunctionSamples &S) override;
 
 protected:
   SampleProfileWriterBinary(std::unique_ptr<raw_ostream> &OS)
       : SampleProfileWriter(OS), NameTable() {}
 
+  /// \brief Write the magic number and version that start the file.
+  virtual std::error_code writeMagicIdent();
   std::error_code
   writeHeader(const StringMap<FunctionSamples> &ProfileMap) override;
   std::error_code writeSummary();
@@ -133,6 +134,28 @@ private:
                               SampleProfileFormat Format);
 };
 
+/// \brief Sample-based profile writer (compact binary format).
+///
+/// The profiles are written as in the binary format, preceded by a table
+/// with the offset of each function's profile so that readers can load just
+/// the functions they need.
+class SampleProfileWriterCompactBinary : public SampleProfileWriterBinary {
+public:
+  using SampleProfileWriterBinary::write;
+  std::error_code write(const StringMap<FunctionSamples> &ProfileMap) override;
+
+protected:
+  SampleProfileWriterCompactBinary(std::unique_ptr<raw_ostream> &OS)
+      : SampleProfileWriterBinary(OS) {}
+
+  std::error_code writeMagicIdent() override;
+
+private:
+  friend ErrorOr<std::unique_ptr<SampleProfileWriter>>
+  SampleProfileWriter::create(std::unique_ptr<raw_ostream> &OS,
+                              SampleProfileFormat Format);
+};
+
 } // End namespace sampleprof
 
 } // End namespace llvm
@@ -24,6 +24,7 @@
 #ifndef LLVM_SUPPORT_GENERICDOMTREE_H
 #define LLVM_SUPPORT_GENERICDOMTREE_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DepthFirstIterator.h"
 #include "llvm/ADT/GraphTraits.h"
@@ -87,14 +88,18 @@ public:
 
 struct PostDominatorTree;
 
+template <class NodeT, bool IsPostDom> struct DomTreeIncrementalUpdater;
+
 /// \brief Base class for the actual dominator tree node.
 template <class NodeT> class DomTreeNodeBase {
   NodeT *TheBB;
   DomTreeNodeBase<NodeT> *IDom;
   std::vector<DomTreeNodeBase<NodeT> *> Children;
+  unsigned Level;
   mutable int DFSNumIn, DFSNumOut;
 
   template <class N> friend class DominatorTreeBase;
+  template <class N, bool IsPostDom> friend struct DomTreeIncrementalUpdater;
   friend struct PostDominatorTree;
 
 public:
@@ -113,8 +118,13 @@ public:
     return Children;
   }
 
+  /// getLevel - Return the depth of this node in the tree; the root is at
+  /// level 0.
+  unsigned getLevel() const { return Level; }
+
   DomTreeNodeBase(NodeT *BB, DomTreeNodeBase<NodeT> *iDom)
-      : TheBB(BB), IDom(iDom), DFSNumIn(-1), DFSNumOut(-1) {}
+      : TheBB(BB), IDom(iDom), Level(iDom ? iDom->Level + 1 : 0),
+        DFSNumIn(-1), DFSNumOut(-1) {}
 
   std::unique_ptr<DomTreeNodeBase<NodeT>>
   addChild(std::unique_ptr<DomTreeNodeBase<NodeT>> C) {
@@ -157,6 +167,8 @@ public:
       // Switch to new dominator
       IDom = NewIDom;
       IDom->Children.push_back(this);
+
+      updateLevel();
     }
   }
 
@@ -173,6 +185,24 @@ private:
     return this->DFSNumIn >= other->DFSNumIn &&
            this->DFSNumOut <= other->DFSNumOut;
   }
+
+  // Recompute the levels of this node and of the part of its subtree whose
+  // levels are out of date after the immediate dominator changed.
+  void updateLevel() {
+    assert(IDom);
+    if (Level == IDom->Level + 1)
+      return;
+
+    SmallVector<DomTreeNodeBase<NodeT> *, 64> WorkStack = {this};
+    while (!WorkStack.empty()) {
+      DomTreeNodeBase<NodeT> *Current = WorkStack.pop_back_val();
+      Current->Level = Current->IDom->Level + 1;
+
+      for (DomTreeNodeBase<NodeT> *C : Current->Children)
+        if (C->Level != Current->Level + 1)
+          WorkStack.push_back(C);
+    }
+  }
 };
 
 template <class NodeT>
@@ -201,6 +231,17 @@ void PrintDomTree(const DomTreeNodeBase<NodeT> *N, raw_ostream &o,
 template <class FuncT, class N>
 void Calculate(DominatorTreeBaseByGraphTraits<GraphTraits<N>> &DT, FuncT &F);
 
+// So are the incremental update and verification routines.
+template <class NodeT>
+void InsertEdge(DominatorTreeBase<NodeT> &DT, NodeT *From, NodeT *To);
+template <class NodeT>
+void DeleteEdge(DominatorTreeBase<NodeT> &DT, NodeT *From, NodeT *To);
+template <class NodeT>
+void ApplyUpdates(
+    DominatorTreeBase<NodeT> &DT,
+    ArrayRef<typename DominatorTreeBase<NodeT>::UpdateType> Updates);
+template <class NodeT> bool Verify(const DominatorTreeBase<NodeT> &DT);
+
 /// \brief Core dominator tree base class.
 ///
 /// This class is a generic template over graph nodes. It is instantiated for
@@ -241,6 +282,7 @@ protected:
 
   mutable bool DFSInfoValid;
   mutable unsigned int SlowQueries;
+  bool VerifyUpdates;
   // Information record used during immediate dominators computation.
   struct InfoRec {
     unsigned DFSNum;
@@ -335,8 +377,17 @@ protected:
   }
 
 public:
+  /// A change to the CFG that the incremental update API is told about.
+  enum UpdateKind : unsigned char { Insert, Delete };
+  struct UpdateType {
+    UpdateKind Kind;
+    NodeT *From;
+    NodeT *To;
+  };
+
   explicit DominatorTreeBase(bool isPostDom)
-      : DominatorBase<NodeT>(isPostDom), DFSInfoValid(false), SlowQueries(0) {}
+      : DominatorBase<NodeT>(isPostDom), DFSInfoValid(false), SlowQueries(0),
+        VerifyUpdates(false) {}
 
   DominatorTreeBase(DominatorTreeBase &&Arg)
       : DominatorBase<NodeT>(
@@ -344,7 +395,8 @@ public:
         DomTreeNodes(std::move(Arg.DomTreeNodes)),
         RootNode(std::move(Arg.RootNode)),
         DFSInfoValid(std::move(Arg.DFSInfoValid)),
-        SlowQueries(std::move(Arg.SlowQueries)), IDoms(std::move(Arg.IDoms)),
+        SlowQueries(std::move(Arg.SlowQueries)),
+        VerifyUpdates(Arg.VerifyUpdates), IDoms(std::move(Arg.IDoms)),
         Vertex(std::move(Arg.Vertex)), Info(std::move(Arg.Info)) {
     Arg.wipe();
   }
@@ -355,6 +407,7 @@ public:
     RootNode = std::move(RHS.RootNode);
     DFSInfoValid = std::move(RHS.DFSInfoValid);
     SlowQueries = std::move(RHS.SlowQueries);
+    VerifyUpdates = RHS.VerifyUpdates;
     IDoms = std::move(RHS.IDoms);
     Vertex = std::move(RHS.Vertex);
     Info = std::move(RHS.Info);
@@ -629,6 +682,38 @@ public:
       this->Split<NodeT *, GraphTraits<NodeT *>>(*this, NewBB);
   }
 
+  /// insertEdge - Update the tree after the edge From -> To was added to the
+  /// CFG. For a CFG with multiple edges between the same blocks, only the
+  /// first one has to be reported.
+  ///
+  /// This and the other incremental updates only recompute the part of the
+  /// tree that the change affects. They fall back to recalculating the whole
+  /// tree when that is cheaper, or when the change turns a block into a root
+  /// or out of one.
+  void insertEdge(NodeT *From, NodeT *To) { InsertEdge(*this, From, To); }
+
+  /// deleteEdge - Update the tree after the edge From -> To was removed from
+  /// the CFG. Removing one of several edges between the same blocks does not
+  /// change anything.
+  void deleteEdge(NodeT *From, NodeT *To) { DeleteEdge(*this, From, To); }
+
+  /// applyUpdates - Update the tree after all of the given edges were added to
+  /// or removed from the CFG. This is better than reporting them one at a
+  /// time after the fact: an edge that is both added and removed is ignored,
+  /// and each change is applied to the CFG as it was at that point, not to
+  /// the final one.
+  void applyUpdates(ArrayRef<UpdateType> Updates) {
+    ApplyUpdates(*this, Updates);
+  }
+
+  /// verify - Check the tree against one recalculated from scratch, and
+  /// check the node levels. Return true if it is correct. This is expensive.
+  bool verify() const { return Verify(*this); }
+
+  /// setVerifyUpdates - If enabled, verify the tree after every incremental
+  /// update and abort with both trees printed if it is wrong.
+  void setVerifyUpdates(bool Enable) { VerifyUpdates = Enable; }
+
   /// print - Convert to human readable form
   ///
   void print(raw_ostream &o) const {
@@ -660,6 +745,8 @@ protected:
   friend void Calculate(DominatorTreeBaseByGraphTraits<GraphTraits<N>> &DT,
                         FuncT &F);
 
+  template <class N, bool IsPostDom> friend struct DomTreeIncrementalUpdater;
+
   DomTreeNodeBase<NodeT> *getNodeForBlock(NodeT *BB) {
     if (DomTreeNodeBase<NodeT> *Node = getNode(BB))
       return Node;
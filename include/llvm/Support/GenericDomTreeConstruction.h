@@ -19,13 +19,25 @@
 /// out that the theoretically slower O(n*log(n)) implementation is actually
 /// faster than the almost-linear O(n*alpha(n)) version, even for large CFGs.
 ///
+/// It also provides the incremental updates of an existing tree after edges
+/// are inserted into or deleted from the flow-graph, based on the depth-based
+/// search algorithm described in:
+///
+///   An Experimental Study of Dynamic Dominators
+///   L. Georgiadis, et al., ESA 2012, pgs 491-502.
+///
 //===----------------------------------------------------------------------===//
 
 #ifndef LLVM_SUPPORT_GENERICDOMTREECONSTRUCTION_H
 #define LLVM_SUPPORT_GENERICDOMTREECONSTRUCTION_H
 
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/GenericDomTree.h"
+#include <queue>
+#include <type_traits>
 
 namespace llvm {
 
@@ -282,6 +294,543 @@ void Calculate(DominatorTreeBaseByGraphTraits<GraphTraits<NodeT>> &DT,
 
   DT.updateDFSNumbers();
 }
+
+/// DomTreeIncrementalUpdater - Brings a dominator tree up to date with
+/// changes to the edges of the CFG.
+///
+/// Post dominator trees are dominator trees of the reverse CFG, so everything
+/// below works on the graph the tree is built on: "successors" are CFG
+/// predecessors when IsPostDom is set. Changes that add or remove roots of a
+/// post dominator tree, or change which blocks can reach an exit, recalculate
+/// the tree instead.
+template <class NodeT, bool IsPostDom> struct DomTreeIncrementalUpdater {
+  typedef DominatorTreeBase<NodeT> DomTreeT;
+  typedef DomTreeNodeBase<NodeT> TreeNode;
+  typedef typename DomTreeT::UpdateType UpdateType;
+  typedef typename std::conditional<IsPostDom, Inverse<NodeT *>,
+                                    NodeT *>::type ForwardRef;
+  typedef typename std::conditional<IsPostDom, NodeT *,
+                                    Inverse<NodeT *>>::type BackwardRef;
+  typedef DenseMap<NodeT *, SmallVector<NodeT *, 2>> EdgeMap;
+
+  DomTreeT &DT;
+
+  // While a batch of updates is applied, the CFG already has all of them.
+  // Each update has to see the graph as it was at its point of the batch, so
+  // the edges that later updates add are hidden and the ones they remove are
+  // added back. The maps are keyed by the source (target) of the edge in the
+  // graph the tree is built on.
+  EdgeMap HiddenSuccs, HiddenPreds;
+  EdgeMap ExtraSuccs, ExtraPreds;
+
+  explicit DomTreeIncrementalUpdater(DomTreeT &DT) : DT(DT) {}
+
+  template <bool Backward>
+  SmallVector<NodeT *, 8> getChildren(NodeT *N) const {
+    typedef GraphTraits<typename std::conditional<Backward, BackwardRef,
+                                                  ForwardRef>::type> GT;
+    SmallVector<NodeT *, 8> Res(GT::child_begin(N), GT::child_end(N));
+
+    const EdgeMap &Hidden = Backward ? HiddenPreds : HiddenSuccs;
+    auto HI = Hidden.find(N);
+    if (HI != Hidden.end())
+      Res.erase(remove_if(Res,
+                          [&](NodeT *C) { return is_contained(HI->second, C); }),
+                Res.end());
+
+    const EdgeMap &Extra = Backward ? ExtraPreds : ExtraSuccs;
+    auto EI = Extra.find(N);
+    if (EI != Extra.end())
+      Res.append(EI->second.begin(), EI->second.end());
+    return Res;
+  }
+
+  // Record or forget the edge From -> To of the graph the tree is built on in
+  // the given pair of maps.
+  static void addEdge(EdgeMap &Succs, EdgeMap &Preds, NodeT *From, NodeT *To) {
+    Succs[From].push_back(To);
+    Preds[To].push_back(From);
+  }
+  static void removeEdge(EdgeMap &Succs, EdgeMap &Preds, NodeT *From,
+                         NodeT *To) {
+    auto &S = Succs[From];
+    S.erase(find(S, To));
+    auto &P = Preds[To];
+    P.erase(find(P, From));
+  }
+
+  // Recompute the whole tree. The CFG has all updates of a batch at this
+  // point, so this ends the batch.
+  bool recalculate(NodeT *BB) {
+    DT.recalculate(*BB->getParent());
+    return true;
+  }
+
+  static TreeNode *findNCA(TreeNode *A, TreeNode *B) {
+    while (A != B) {
+      if (A->getLevel() < B->getLevel())
+        std::swap(A, B);
+      A = A->getIDom();
+    }
+    return A;
+  }
+
+  /// Compute the immediate dominators of the blocks that are reachable from
+  /// Entry through blocks accepted by InRegion, treating Entry as the root of
+  /// the graph. The blocks are returned in reverse post order, which lists
+  /// every block after its immediate dominator, together with the index of
+  /// the immediate dominator of each one but Entry.
+  ///
+  /// This uses the iterative algorithm of Cooper, Harvey and Kennedy, which
+  /// is simple and fast on the small regions the updates rebuild.
+  template <typename RegionFn>
+  void computeIDoms(NodeT *Entry, RegionFn InRegion,
+                    SmallVectorImpl<NodeT *> &Order,
+                    SmallVectorImpl<unsigned> &IDoms) const {
+    // Number the region in post order.
+    SmallVector<NodeT *, 32> PostOrder;
+    DenseMap<NodeT *, unsigned> PONum;
+    struct Frame {
+      NodeT *N;
+      SmallVector<NodeT *, 8> Children;
+      unsigned Next;
+    };
+    SmallVector<Frame, 32> Stack;
+    PONum[Entry] = ~0u;
+    Stack.push_back({Entry, getChildren<false>(Entry), 0});
+    while (!Stack.empty()) {
+      Frame &F = Stack.back();
+      if (F.Next == F.Children.size()) {
+        PONum[F.N] = PostOrder.size();
+        PostOrder.push_back(F.N);
+        Stack.pop_back();
+        continue;
+      }
+      NodeT *C = F.Children[F.Next++];
+      if (!InRegion(C) || !PONum.insert({C, ~0u}).second)
+        continue;
+      Stack.push_back({C, getChildren<false>(C), 0});
+    }
+
+    const unsigned NumNodes = PostOrder.size();
+    const unsigned Undef = ~0u;
+    std::vector<SmallVector<unsigned, 4>> Preds(NumNodes);
+    for (unsigned I = 0; I != NumNodes; ++I)
+      for (NodeT *P : getChildren<true>(PostOrder[I])) {
+        auto It = PONum.find(P);
+        if (It != PONum.end())
+          Preds[I].push_back(It->second);
+      }
+
+    std::vector<unsigned> Doms(NumNodes, Undef);
+    Doms[NumNodes - 1] = NumNodes - 1;
+    auto Intersect = [&](unsigned A, unsigned B) {
+      while (A != B) {
+        while (A < B)
+          A = Doms[A];
+        while (B < A)
+          B = Doms[B];
+      }
+      return A;
+    };
+    bool Changed = true;
+    while (Changed) {
+      Changed = false;
+      for (unsigned I = NumNodes - 1; I-- > 0;) {
+        unsigned NewIDom = Undef;
+        for (unsigned P : Preds[I])
+          if (Doms[P] != Undef)
+            NewIDom = NewIDom == Undef ? P : Intersect(P, NewIDom);
+        if (Doms[I] != NewIDom) {
+          Doms[I] = NewIDom;
+          Changed = true;
+        }
+      }
+    }
+
+    Order.clear();
+    Order.append(PostOrder.rbegin(), PostOrder.rend());
+    IDoms.resize(NumNodes);
+    for (unsigned I = 0; I != NumNodes; ++I)
+      IDoms[NumNodes - 1 - I] = NumNodes - 1 - Doms[I];
+  }
+
+  /// Recompute the subtree of Top, whose own immediate dominator does not
+  /// change. Every block that Top dominates is reachable from it through
+  /// blocks that Top dominates, so it is enough to look at the subtree.
+  void rebuildSubtree(TreeNode *Top) {
+    SmallPtrSet<NodeT *, 32> Region;
+    SmallVector<TreeNode *, 32> WorkList = {Top};
+    while (!WorkList.empty()) {
+      TreeNode *TN = WorkList.pop_back_val();
+      Region.insert(TN->getBlock());
+      WorkList.append(TN->begin(), TN->end());
+    }
+
+    SmallVector<NodeT *, 32> Order;
+    SmallVector<unsigned, 32> IDoms;
+    computeIDoms(Top->getBlock(),
+                 [&](NodeT *N) { return Region.count(N) != 0; }, Order,
+                 IDoms);
+    assert(Order.size() == Region.size() && "Subtree lost a block");
+
+    SmallVector<TreeNode *, 32> Nodes;
+    for (NodeT *N : Order) {
+      TreeNode *TN = DT.getNode(N);
+      TN->Children.clear();
+      Nodes.push_back(TN);
+    }
+    for (unsigned I = 1, E = Nodes.size(); I != E; ++I) {
+      TreeNode *TN = Nodes[I];
+      TN->IDom = Nodes[IDoms[I]];
+      TN->IDom->Children.push_back(TN);
+      TN->Level = TN->IDom->Level + 1;
+    }
+  }
+
+  /// Update the tree for the new edge From -> To between two blocks that are
+  /// both in it. Only blocks deeper than one below the nearest common
+  /// dominator D of From and To can change, and every block that does gets D
+  /// as its new immediate dominator: those that can be reached from To
+  /// without passing through a block that is less deep than themselves.
+  /// Visiting candidates from deepest to shallowest finds them all while
+  /// looking at each block once.
+  void insertReachable(TreeNode *FromTN, TreeNode *ToTN) {
+    TreeNode *NCD = findNCA(FromTN, ToTN);
+    const unsigned NCDLevel = NCD->getLevel();
+    if (NCDLevel + 1 >= ToTN->getLevel())
+      return;
+
+    std::priority_queue<std::pair<unsigned, TreeNode *>> Bucket;
+    SmallPtrSet<TreeNode *, 16> Visited;
+    SmallVector<TreeNode *, 16> Affected, Stack;
+    Bucket.push({ToTN->getLevel(), ToTN});
+    Visited.insert(ToTN);
+    while (!Bucket.empty()) {
+      TreeNode *TN = Bucket.top().second;
+      Bucket.pop();
+      Affected.push_back(TN);
+
+      const unsigned CurrentLevel = TN->getLevel();
+      Stack.push_back(TN);
+      while (!Stack.empty()) {
+        TreeNode *N = Stack.pop_back_val();
+        for (NodeT *Succ : getChildren<false>(N->getBlock())) {
+          TreeNode *SuccTN = DT.getNode(Succ);
+          if (!SuccTN)
+            continue;
+          const unsigned SuccLevel = SuccTN->getLevel();
+          if (SuccLevel <= NCDLevel + 1 || !Visited.insert(SuccTN).second)
+            continue;
+          // Deeper blocks only lead to affected ones, shallower ones may be
+          // affected themselves.
+          if (SuccLevel > CurrentLevel)
+            Stack.push_back(SuccTN);
+          else
+            Bucket.push({SuccLevel, SuccTN});
+        }
+      }
+    }
+
+    for (TreeNode *TN : Affected)
+      TN->setIDom(NCD);
+  }
+
+  /// Update the tree for the new edge From -> To where To was not reachable
+  /// before. The blocks that become reachable are only entered through To, so
+  /// their subtree is computed on its own. Their edges to blocks that were
+  /// reachable already are then handled as insertions.
+  bool insertUnreachable(TreeNode *FromTN, NodeT *To) {
+    // Post dominator trees add a virtual root depending on whether every
+    // block reaches an exit.
+    if (IsPostDom)
+      return recalculate(To);
+
+    auto IsNew = [&](NodeT *N) { return !DT.getNode(N); };
+    SmallVector<NodeT *, 32> Order;
+    SmallVector<unsigned, 32> IDoms;
+    computeIDoms(To, IsNew, Order, IDoms);
+
+    // Hide the edges to reachable blocks until they are inserted, so that
+    // each insertion starts from a tree that is correct without it.
+    SmallVector<std::pair<NodeT *, NodeT *>, 8> EdgesToReachable;
+    DenseSet<std::pair<NodeT *, NodeT *>> Seen;
+    for (NodeT *N : Order)
+      for (NodeT *Succ : getChildren<false>(N))
+        if (!IsNew(Succ) && Seen.insert({N, Succ}).second)
+          EdgesToReachable.push_back({N, Succ});
+    for (const auto &Edge : EdgesToReachable)
+      addEdge(HiddenSuccs, HiddenPreds, Edge.first, Edge.second);
+
+    SmallVector<TreeNode *, 32> Nodes;
+    for (unsigned I = 0, E = Order.size(); I != E; ++I) {
+      TreeNode *IDomNode = I == 0 ? FromTN : Nodes[IDoms[I]];
+      Nodes.push_back((DT.DomTreeNodes[Order[I]] = IDomNode->addChild(
+                           llvm::make_unique<TreeNode>(Order[I], IDomNode)))
+                          .get());
+    }
+
+    for (const auto &Edge : EdgesToReachable) {
+      removeEdge(HiddenSuccs, HiddenPreds, Edge.first, Edge.second);
+      insertReachable(DT.getNode(Edge.first), DT.getNode(Edge.second));
+    }
+    return false;
+  }
+
+  /// Update the tree after the edge From -> To was added to the CFG. Return
+  /// true if the tree was recalculated.
+  bool insertEdge(NodeT *From, NodeT *To) {
+    // From stops being an exit.
+    if (IsPostDom && is_contained(DT.getRoots(), From))
+      return recalculate(From);
+
+    if (IsPostDom)
+      std::swap(From, To);
+    TreeNode *FromTN = DT.getNode(From);
+    // Nothing changes for an edge from a block that is not reachable.
+    if (!FromTN)
+      return false;
+
+    DT.DFSInfoValid = false;
+    if (TreeNode *ToTN = DT.getNode(To)) {
+      insertReachable(FromTN, ToTN);
+      return false;
+    }
+    return insertUnreachable(FromTN, To);
+  }
+
+  /// Return true if To stays reachable after losing an edge from its
+  /// immediate dominator, i.e. if it has a reachable predecessor that it
+  /// does not dominate.
+  bool hasProperSupport(TreeNode *ToTN) const {
+    for (NodeT *Pred : getChildren<true>(ToTN->getBlock())) {
+      TreeNode *PredTN = DT.getNode(Pred);
+      if (PredTN && findNCA(ToTN, PredTN) != ToTN)
+        return true;
+    }
+    return false;
+  }
+
+  /// Update the tree for a deleted edge From -> To after which To is still
+  /// reachable. Only the subtree of the nearest common dominator of From and
+  /// To can change.
+  bool deleteReachable(TreeNode *FromTN, TreeNode *ToTN) {
+    TreeNode *Top = findNCA(FromTN, ToTN);
+    if (!Top->getIDom())
+      return recalculate(ToTN->getBlock());
+    rebuildSubtree(Top);
+    return false;
+  }
+
+  /// Update the tree for a deleted edge From -> To that made To, and with it
+  /// its whole subtree, unreachable. The blocks left behind that the subtree
+  /// had edges to are all in the subtree of the shallowest nearest common
+  /// dominator of the two ends of those edges, which is rebuilt.
+  bool deleteUnreachable(TreeNode *ToTN) {
+    if (IsPostDom)
+      return recalculate(ToTN->getBlock());
+
+    SmallPtrSet<NodeT *, 32> Removed;
+    SmallVector<TreeNode *, 32> WorkList = {ToTN};
+    while (!WorkList.empty()) {
+      TreeNode *TN = WorkList.pop_back_val();
+      Removed.insert(TN->getBlock());
+      WorkList.append(TN->begin(), TN->end());
+    }
+
+    TreeNode *Top = nullptr;
+    for (NodeT *N : Removed)
+      for (NodeT *Succ : getChildren<false>(N)) {
+        if (Removed.count(Succ))
+          continue;
+        TreeNode *SuccTN = DT.getNode(Succ);
+        if (!SuccTN)
+          continue;
+        TreeNode *NCA = findNCA(DT.getNode(N), SuccTN);
+        if (!Top || NCA->getLevel() < Top->getLevel())
+          Top = NCA;
+      }
+
+    TreeNode *IDom = ToTN->getIDom();
+    IDom->Children.erase(find(IDom->Children, ToTN));
+    for (NodeT *N : Removed)
+      DT.DomTreeNodes.erase(N);
+
+    if (!Top)
+      return false;
+    if (!Top->getIDom())
+      return recalculate(IDom->getBlock());
+    rebuildSubtree(Top);
+    return false;
+  }
+
+  /// Update the tree after the edge From -> To was removed from the CFG.
+  /// Return true if the tree was recalculated.
+  bool deleteEdge(NodeT *From, NodeT *To) {
+    // From becomes an exit.
+    if (IsPostDom && getChildren<true>(From).empty())
+      return recalculate(From);
+
+    if (IsPostDom)
+      std::swap(From, To);
+    TreeNode *FromTN = DT.getNode(From);
+    TreeNode *ToTN = DT.getNode(To);
+    if (!FromTN || !ToTN)
+      return false;
+    // Another edge between the same blocks is still there.
+    if (is_contained(getChildren<false>(From), To))
+      return false;
+
+    DT.DFSInfoValid = false;
+    // Deleting an edge to a dominator of From changes nothing.
+    if (findNCA(FromTN, ToTN) == ToTN)
+      return false;
+
+    // If From is not the immediate dominator of To, there is another way to
+    // To.
+    if (ToTN->getIDom() != FromTN || hasProperSupport(ToTN))
+      return deleteReachable(FromTN, ToTN);
+    return deleteUnreachable(ToTN);
+  }
+
+  bool applyUpdate(const UpdateType &U) {
+    return U.Kind == DomTreeT::Insert ? insertEdge(U.From, U.To)
+                                      : deleteEdge(U.From, U.To);
+  }
+
+  void applyUpdates(ArrayRef<UpdateType> Updates) {
+    // Updates of the same edge cancel out, only the net change is applied.
+    MapVector<std::pair<NodeT *, NodeT *>, int> Net;
+    for (const UpdateType &U : Updates)
+      Net[{U.From, U.To}] += U.Kind == DomTreeT::Insert ? 1 : -1;
+    SmallVector<UpdateType, 8> Legal;
+    for (const auto &E : Net)
+      if (E.second != 0)
+        Legal.push_back({E.second > 0 ? DomTreeT::Insert : DomTreeT::Delete,
+                         E.first.first, E.first.second});
+    if (Legal.empty())
+      return;
+
+    // With many changes at once, recalculating is cheaper.
+    if (Legal.size() > 32 && Legal.size() > DT.DomTreeNodes.size() / 8) {
+      recalculate(Legal.front().From);
+      return;
+    }
+
+    for (const UpdateType &U : Legal) {
+      NodeT *From = IsPostDom ? U.To : U.From;
+      NodeT *To = IsPostDom ? U.From : U.To;
+      if (U.Kind == DomTreeT::Insert)
+        addEdge(HiddenSuccs, HiddenPreds, From, To);
+      else
+        addEdge(ExtraSuccs, ExtraPreds, From, To);
+    }
+    for (const UpdateType &U : Legal) {
+      NodeT *From = IsPostDom ? U.To : U.From;
+      NodeT *To = IsPostDom ? U.From : U.To;
+      if (U.Kind == DomTreeT::Insert)
+        removeEdge(HiddenSuccs, HiddenPreds, From, To);
+      else
+        removeEdge(ExtraSuccs, ExtraPreds, From, To);
+      if (applyUpdate(U))
+        return;
+    }
+  }
+
+  static bool verify(const DomTreeT &DT) {
+    // Check that the levels are consistent.
+    if (const TreeNode *Root = DT.getRootNode()) {
+      if (Root->getLevel() != 0)
+        return false;
+      SmallVector<const TreeNode *, 32> WorkList = {Root};
+      while (!WorkList.empty()) {
+        const TreeNode *TN = WorkList.pop_back_val();
+        for (const TreeNode *C : *TN) {
+          if (C->getIDom() != TN || C->getLevel() != TN->getLevel() + 1)
+            return false;
+          WorkList.push_back(C);
+        }
+      }
+    }
+
+    NodeT *BB = nullptr;
+    for (const auto &Entry : DT.DomTreeNodes)
+      if ((BB = Entry.first))
+        break;
+    if (!BB)
+      return true;
+
+    DomTreeT Other(DT.isPostDominator());
+    Other.recalculate(*BB->getParent());
+    const TreeNode *R = DT.getRootNode();
+    const TreeNode *OtherR = Other.getRootNode();
+    if (!R || !OtherR || R->getBlock() != OtherR->getBlock())
+      return false;
+    return !DT.compare(Other);
+  }
+
+  // Check the tree after an update if asked to.
+  void verifyIfRequested() const {
+    if (!DT.VerifyUpdates || verify(DT))
+      return;
+    errs() << "Incrementally updated dominator tree:\n";
+    DT.print(errs());
+    DomTreeT Other(DT.isPostDominator());
+    for (const auto &Entry : DT.DomTreeNodes)
+      if (Entry.first) {
+        Other.recalculate(*Entry.first->getParent());
+        break;
+      }
+    errs() << "\nRecalculated:\n";
+    Other.print(errs());
+    report_fatal_error("Incremental dominator tree update is wrong");
+  }
+};
+
+template <class NodeT>
+void InsertEdge(DominatorTreeBase<NodeT> &DT, NodeT *From, NodeT *To) {
+  if (DT.isPostDominator()) {
+    DomTreeIncrementalUpdater<NodeT, true> Updater(DT);
+    Updater.insertEdge(From, To);
+    Updater.verifyIfRequested();
+  } else {
+    DomTreeIncrementalUpdater<NodeT, false> Updater(DT);
+    Updater.insertEdge(From, To);
+    Updater.verifyIfRequested();
+  }
+}
+
+template <class NodeT>
+void DeleteEdge(DominatorTreeBase<NodeT> &DT, NodeT *From, NodeT *To) {
+  if (DT.isPostDominator()) {
+    DomTreeIncrementalUpdater<NodeT, true> Updater(DT);
+    Updater.deleteEdge(From, To);
+    Updater.verifyIfRequested();
+  } else {
+    DomTreeIncrementalUpdater<NodeT, false> Updater(DT);
+    Updater.deleteEdge(From, To);
+    Updater.verifyIfRequested();
+  }
+}
+
+template <class NodeT>
+void ApplyUpdates(
+    DominatorTreeBase<NodeT> &DT,
+    ArrayRef<typename DominatorTreeBase<NodeT>::UpdateType> Updates) {
+  if (DT.isPostDominator()) {
+    DomTreeIncrementalUpdater<NodeT, true> Updater(DT);
+    Updater.applyUpdates(Updates);
+    Updater.verifyIfRequested();
+  } else {
+    DomTreeIncrementalUpdater<NodeT, false> Updater(DT);
+    Updater.applyUpdates(Updates);
+    Updater.verifyIfRequested();
+  }
+}
+
+template <class NodeT> bool Verify(const DominatorTreeBase<NodeT> &DT) {
+  return DomTreeIncrementalUpdater<NodeT, false>::verify(DT);
+}
 }
 
 #endif
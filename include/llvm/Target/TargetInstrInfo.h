@@ -589,6 +589,11 @@ public:
   /// Analyze the loop code, return true if it cannot be understoo. Upon
   /// success, this function returns false and returns information about the
   /// induction variable and compare instruction used at the end.
+  /// A null induction variable means the loop is controlled by a hardware
+  /// loop instruction. Otherwise, the value defined by the induction variable
+  /// may only be used by the compare and the loop Phi, possibly through
+  /// copies, and the compare is either the loop branch or sets the condition
+  /// used by the loop branch.
   virtual bool analyzeLoop(MachineLoop &L, MachineInstr *&IndVarInst,
                            MachineInstr *&CmpInst) const {
     return true;
@@ -1058,6 +1063,21 @@ public:
     return false;
   }
 
+  /// Return true if the instruction subtracts one from a register, as
+  /// reported by getIncrementValue().
+  bool isDecrementByOne(const MachineInstr &MI) const {
+    int Value;
+    return getIncrementValue(MI, Value) && Value == -1;
+  }
+
+  /// Return true if the value in \p Reg is only used by \p Cmp or flows into
+  /// the loop Phi \p Phi, possibly through copies in the block of the Phi.
+  /// Used by analyzeLoop() to check that a trip count register does nothing
+  /// but control the loop.
+  static bool onlyControlsLoop(const MachineRegisterInfo &MRI, unsigned Reg,
+                               const MachineInstr *Phi,
+                               const MachineInstr *Cmp);
+
   /// Returns true if the two given memory operations should be scheduled
   /// adjacent. Note that you have to add:
   ///   DAG->addMutation(createLoadClusterDAGMutation(DAG->TII, DAG->TRI));
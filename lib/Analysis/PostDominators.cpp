@@ -33,6 +33,7 @@ INITIALIZE_PASS(PostDominatorTreeWrapperPass, "postdomtree",
 
 bool PostDominatorTreeWrapperPass::runOnFunction(Function &F) {
   DT.recalculate(F);
+  DT.setVerifyUpdates(VerifyDomInfo);
   return false;
 }
 
@@ -50,6 +51,7 @@ PostDominatorTree PostDominatorTreeAnalysis::run(Function &F,
                                                  FunctionAnalysisManager &) {
   PostDominatorTree PDT;
   PDT.recalculate(F);
+  PDT.setVerifyUpdates(VerifyDomInfo);
   return PDT;
 }
 
@@ -20,6 +20,7 @@
 #include "llvm/IR/Instruction.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/SourceMgr.h"
+#include <algorithm>
 #include <cassert>
 #include <cctype>
 #include <cstdio>
@@ -240,6 +241,72 @@ lltok::Kind LLLexer::LexToken() {
   }
 }
 
+bool LLLexer::skipBracedBlock() {
+  const char *End = CurBuf.end();
+  unsigned Depth = 1;
+  while (CurPtr != End) {
+    switch (*CurPtr++) {
+    case '"':
+      // Neither strings nor quoted names can contain a quote character, so
+      // the next one ends them.
+      CurPtr = std::find(CurPtr, End, '"');
+      if (CurPtr == End)
+        return true;
+      ++CurPtr;
+      break;
+    case ';':
+      while (CurPtr != End && *CurPtr != '\n' && *CurPtr != '\r')
+        ++CurPtr;
+      break;
+    case '{':
+      ++Depth;
+      break;
+    case '}':
+      if (--Depth == 0)
+        return false;
+      break;
+    }
+  }
+  return true;
+}
+
+bool LLLexer::hasUseListOrderDirective(StringRef Buffer) {
+  const char *CurPtr = Buffer.begin(), *End = Buffer.end();
+  while (CurPtr != End) {
+    switch (*CurPtr) {
+    case '"':
+      CurPtr = std::find(CurPtr + 1, End, '"');
+      if (CurPtr == End)
+        return false;
+      ++CurPtr;
+      continue;
+    case ';':
+      while (CurPtr != End && *CurPtr != '\n' && *CurPtr != '\r')
+        ++CurPtr;
+      continue;
+    case '%': case '@': case '!': case '#': case '$':
+      // The name or number after a sigil is never a keyword.
+      ++CurPtr;
+      while (CurPtr != End && isLabelChar(*CurPtr))
+        ++CurPtr;
+      continue;
+    }
+    if (!isLabelChar(*CurPtr)) {
+      ++CurPtr;
+      continue;
+    }
+    const char *Start = CurPtr;
+    while (CurPtr != End && isLabelChar(*CurPtr))
+      ++CurPtr;
+    StringRef Word(Start, CurPtr - Start);
+    // A word followed by a colon is a label.
+    if ((Word == "uselistorder" || Word == "uselistorder_bb") &&
+        (CurPtr == End || *CurPtr != ':'))
+      return true;
+  }
+  return false;
+}
+
 void LLLexer::SkipLineComment() {
   while (true) {
     if (CurPtr[0] == '\n' || CurPtr[0] == '\r' || getNextChar() == EOF)
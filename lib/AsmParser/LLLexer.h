@@ -60,6 +60,19 @@ namespace llvm {
     const APFloat &getAPFloatVal() const { return APFloatVal; }
 
 
+    /// Move the lexer to \p Ptr, which must point into the buffer. The next
+    /// call to Lex returns the token starting there.
+    void setPosition(const char *Ptr) { CurPtr = Ptr; }
+
+    /// Skip past the '}' matching the '{' that was just lexed without lexing
+    /// the tokens in between. Returns true if the buffer ends first.
+    bool skipBracedBlock();
+
+    /// Return true if \p Buffer contains a uselistorder or uselistorder_bb
+    /// directive. Comments, strings and names that merely contain the word
+    /// are not directives.
+    static bool hasUseListOrderDirective(StringRef Buffer);
+
     bool Error(LocTy L, const Twine &Msg) const;
     bool Error(const Twine &Msg) const { return Error(getLoc(), Msg); }
 
@@ -21,9 +21,11 @@
 #include "llvm/IR/Argument.h"
 #include "llvm/IR/AutoUpgrade.h"
 #include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/CallSite.h"
 #include "llvm/IR/CallingConv.h"
 #include "llvm/IR/Comdat.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/DebugInfo.h"
 #include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Function.h"
@@ -61,6 +63,24 @@ static std::string getTypeString(Type *T) {
   return Tmp.str();
 }
 
+/// Return the basic block of \p F that the printer numbers \p Number, or null
+/// if that slot is not a basic block.
+static BasicBlock *getNumberedBlock(Function &F, unsigned Number) {
+  unsigned Slot = 0;
+  for (Argument &A : F.args())
+    if (!A.hasName())
+      ++Slot;
+  for (BasicBlock &BB : F) {
+    if (!BB.hasName() && Slot++ == Number)
+      return &BB;
+    for (Instruction &I : BB)
+      if (!I.hasName() && !I.getType()->isVoidTy())
+        if (Slot++ == Number)
+          return nullptr;
+  }
+  return nullptr;
+}
+
 /// Run: module ::= toplevelentity*
 bool LLParser::Run() {
   // Prime the lexer.
@@ -117,10 +137,9 @@ void LLParser::restoreParsingState(const SlotMapping *Slots) {
         std::make_pair(I.first, std::make_pair(I.second, LocTy())));
 }
 
-/// ValidateEndOfModule - Do final validity and sanity checks at the end of the
-/// module.
-bool LLParser::ValidateEndOfModule() {
-  // Handle any function attribute group forward references.
+/// resolveForwardRefAttrGroups - Apply the attribute groups that functions
+/// and calls referred to by number.
+void LLParser::resolveForwardRefAttrGroups() {
   for (std::map<Value*, std::vector<unsigned> >::iterator
          I = ForwardRefAttrGroups.begin(), E = ForwardRefAttrGroups.end();
          I != E; ++I) {
@@ -178,10 +197,19 @@ bool LLParser::ValidateEndOfModule() {
       llvm_unreachable("invalid object with forward attribute group reference");
     }
   }
+  ForwardRefAttrGroups.clear();
+}
+
+/// ValidateEndOfModule - Do final validity and sanity checks at the end of the
+/// module.
+bool LLParser::ValidateEndOfModule() {
+  // Handle any function attribute group forward references.
+  resolveForwardRefAttrGroups();
 
   // If there are entries in ForwardRefBlockAddresses at this point, the
-  // function was never defined.
-  if (!ForwardRefBlockAddresses.empty())
+  // function was never defined. In a lazy parse, its body may also just not
+  // have been parsed yet; that is dealt with below.
+  if (!LazyBodies && !ForwardRefBlockAddresses.empty())
     return Error(ForwardRefBlockAddresses.begin()->first.Loc,
                  "expected function name in blockaddress");
 
@@ -201,20 +229,8 @@ bool LLParser::ValidateEndOfModule() {
                  "use of undefined comdat '$" +
                      ForwardRefComdats.begin()->first + "'");
 
-  if (!ForwardRefVals.empty())
-    return Error(ForwardRefVals.begin()->second.second,
-                 "use of undefined value '@" + ForwardRefVals.begin()->first +
-                 "'");
-
-  if (!ForwardRefValIDs.empty())
-    return Error(ForwardRefValIDs.begin()->second.second,
-                 "use of undefined value '@" +
-                 Twine(ForwardRefValIDs.begin()->first) + "'");
-
-  if (!ForwardRefMDNodes.empty())
-    return Error(ForwardRefMDNodes.begin()->second.second,
-                 "use of undefined metadata '!" +
-                 Twine(ForwardRefMDNodes.begin()->first) + "'");
+  if (ValidateForwardRefs())
+    return true;
 
   // Resolve metadata cycles.
   for (auto &N : NumberedMetadata) {
@@ -222,12 +238,35 @@ bool LLParser::ValidateEndOfModule() {
       N.second->resolveCycles();
   }
 
-  for (auto *Inst : InstsWithTBAATag) {
-    MDNode *MD = Inst->getMetadata(LLVMContext::MD_tbaa);
-    assert(MD && "UpgradeInstWithTBAATag should have a TBAA tag");
-    auto *UpgradedMD = UpgradeTBAANode(*MD);
-    if (MD != UpgradedMD)
-      Inst->setMetadata(LLVMContext::MD_tbaa, UpgradedMD);
+  upgradeTBAATags();
+
+  if (LazyBodies) {
+    // Calls to intrinsics are upgraded as the bodies containing them are
+    // parsed, like the bitcode reader does.
+    for (Function &F : *M) {
+      Function *NewFn;
+      std::string Name = F.getName();
+      if (UpgradeIntrinsicFunction(&F, NewFn)) {
+        UpgradedIntrinsics[&F] = NewFn;
+        if (F.getName() != Name)
+          RenamedIntrinsics[Name] = &F;
+      } else if (auto Remangled = Intrinsic::remangleIntrinsicFunction(&F))
+        RemangledIntrinsics[&F] = Remangled.getValue();
+    }
+
+    // Debug info of an outdated version is stripped from the module now and
+    // from each body as it is parsed.
+    if (getDebugMetadataVersionFromModule(*M) != DEBUG_METADATA_VERSION) {
+      UpgradeDebugInfo(*M);
+      StripDebugInfo = true;
+    }
+
+    UpgradeModuleFlags(*M);
+
+    // Every global value is known now, so blockaddress constants can refer to
+    // skipped bodies by parsing them.
+    AllGlobalsParsed = true;
+    return materializeForwardRefBlockAddresses();
   }
 
   // Look for intrinsic functions and CallInst that need to be upgraded
@@ -264,6 +303,164 @@ bool LLParser::ValidateEndOfModule() {
   return false;
 }
 
+/// ValidateForwardRefs - Check that every global value and metadata node that
+/// was referred to has been defined.
+bool LLParser::ValidateForwardRefs() {
+  if (!ForwardRefVals.empty())
+    return Error(ForwardRefVals.begin()->second.second,
+                 "use of undefined value '@" + ForwardRefVals.begin()->first +
+                 "'");
+
+  if (!ForwardRefValIDs.empty())
+    return Error(ForwardRefValIDs.begin()->second.second,
+                 "use of undefined value '@" +
+                 Twine(ForwardRefValIDs.begin()->first) + "'");
+
+  if (!ForwardRefMDNodes.empty())
+    return Error(ForwardRefMDNodes.begin()->second.second,
+                 "use of undefined metadata '!" +
+                 Twine(ForwardRefMDNodes.begin()->first) + "'");
+  return false;
+}
+
+/// upgradeTBAATags - Upgrade the old-style TBAA tags of the instructions
+/// parsed so far.
+void LLParser::upgradeTBAATags() {
+  for (auto *Inst : InstsWithTBAATag) {
+    MDNode *MD = Inst->getMetadata(LLVMContext::MD_tbaa);
+    assert(MD && "UpgradeInstWithTBAATag should have a TBAA tag");
+    auto *UpgradedMD = UpgradeTBAANode(*MD);
+    if (MD != UpgradedMD)
+      Inst->setMetadata(LLVMContext::MD_tbaa, UpgradedMD);
+  }
+  InstsWithTBAATag.clear();
+}
+
+//===----------------------------------------------------------------------===//
+// Lazy Function Bodies
+//===----------------------------------------------------------------------===//
+
+/// materializeFunction - Parse the body of F if it was skipped.
+bool LLParser::materializeFunction(Function &F) {
+  auto I = DeferredFunctionBodies.find(&F);
+  if (I == DeferredFunctionBodies.end())
+    return false;
+  DeferredBody Body = I->second;
+  DeferredFunctionBodies.erase(I);
+  // The body was dropped, e.g. by deleteBody(), before it was ever parsed.
+  if (!F.isMaterializable())
+    return false;
+  F.setIsMaterializable(false);
+
+  // This can be reached in the middle of another body through a blockaddress,
+  // so lex the current token again once done.
+  const char *Resume = Lex.getLoc().getPointer();
+  Lex.setPosition(Body.Start);
+  Lex.Lex();
+  if (ParseFunctionBody(F, Body.FunctionNumber) || finishFunctionBody(F))
+    return true;
+  Lex.setPosition(Resume);
+  Lex.Lex();
+  return false;
+}
+
+/// finishFunctionBody - Check and upgrade a body that was parsed after the
+/// rest of the module.
+bool LLParser::finishFunctionBody(Function &F) {
+  // Everything at the top level is known by now, so any forward reference
+  // left is to something that does not exist.
+  if (ValidateForwardRefs())
+    return true;
+
+  resolveForwardRefAttrGroups();
+  upgradeTBAATags();
+
+  if (StripDebugInfo)
+    stripDebugInfo(F);
+
+  // Upgrade any old intrinsic calls in the function.
+  for (auto &I : UpgradedIntrinsics) {
+    for (auto UI = I.first->materialized_user_begin(), UE = I.first->user_end();
+         UI != UE;) {
+      User *U = *UI;
+      ++UI;
+      if (CallInst *CI = dyn_cast<CallInst>(U))
+        UpgradeIntrinsicCall(CI, I.second);
+    }
+  }
+
+  // Update calls to the remangled intrinsics
+  for (auto &I : RemangledIntrinsics)
+    for (auto UI = I.first->materialized_user_begin(), UE = I.first->user_end();
+         UI != UE;)
+      // Don't expect any other users than call sites
+      CallSite(*UI++).setCalledFunction(I.second);
+
+  return materializeForwardRefBlockAddresses();
+}
+
+/// materializeForwardRefBlockAddresses - Parse the skipped bodies of the
+/// functions that blockaddress placeholders refer to, which resolves them.
+bool LLParser::materializeForwardRefBlockAddresses() {
+  while (!ForwardRefBlockAddresses.empty()) {
+    const ValID &Fn = ForwardRefBlockAddresses.begin()->first;
+    GlobalValue *GV = nullptr;
+    if (Fn.Kind == ValID::t_GlobalID) {
+      if (Fn.UIntVal < NumberedVals.size())
+        GV = NumberedVals[Fn.UIntVal];
+    } else {
+      GV = M->getNamedValue(Fn.StrVal);
+    }
+    // If there is no skipped body to parse, the function was never defined.
+    auto *F = dyn_cast_or_null<Function>(GV);
+    if (!F || !F->isMaterializable() || !DeferredFunctionBodies.count(F))
+      return Error(Fn.Loc, "expected function name in blockaddress");
+    if (materializeFunction(*F))
+      return true;
+  }
+  return false;
+}
+
+/// materializeModule - Parse the remaining skipped bodies, then drop the
+/// intrinsics whose calls were upgraded.
+bool LLParser::materializeModule() {
+  for (Function &F : *M)
+    if (materializeFunction(F))
+      return true;
+
+  for (auto &I : UpgradedIntrinsics) {
+    for (auto *U : I.first->users()) {
+      if (CallInst *CI = dyn_cast<CallInst>(U))
+        UpgradeIntrinsicCall(CI, I.second);
+    }
+    if (!I.first->use_empty())
+      I.first->replaceAllUsesWith(I.second);
+    I.first->eraseFromParent();
+  }
+  UpgradedIntrinsics.clear();
+  RenamedIntrinsics.clear();
+
+  for (auto &I : RemangledIntrinsics) {
+    I.first->replaceAllUsesWith(I.second);
+    I.first->eraseFromParent();
+  }
+  RemangledIntrinsics.clear();
+  return false;
+}
+
+std::vector<StructType *> LLParser::getIdentifiedStructTypes() const {
+  std::vector<StructType *> Types;
+  for (const auto &I : NamedTypes)
+    if (auto *STy = dyn_cast_or_null<StructType>(I.second.first))
+      if (!STy->isLiteral())
+        Types.push_back(STy);
+  for (const auto &I : NumberedTypes)
+    if (auto *STy = dyn_cast_or_null<StructType>(I.second.first))
+      if (!STy->isLiteral())
+        Types.push_back(STy);
+  return Types;
+}
+
 //===----------------------------------------------------------------------===//
 // Top-Level Entities
 //===----------------------------------------------------------------------===//
@@ -455,9 +652,15 @@ bool LLParser::ParseDefine() {
   Lex.Lex();
 
   Function *F;
-  return ParseFunctionHeader(F, true) ||
-         ParseOptionalFunctionMetadata(*F) ||
-         ParseFunctionBody(*F);
+  if (ParseFunctionHeader(F, true) || ParseOptionalFunctionMetadata(*F))
+    return true;
+
+  int FunctionNumber = -1;
+  if (!F->hasName()) FunctionNumber = NumberedVals.size()-1;
+
+  if (LazyBodies)
+    return deferFunctionBody(*F, FunctionNumber);
+  return ParseFunctionBody(*F, FunctionNumber);
 }
 
 /// ParseGlobalType
@@ -1180,6 +1383,11 @@ GlobalValue *LLParser::GetGlobalVal(const std::string &Name, Type *Ty,
   // Look this name up in the normal function symbol table.
   GlobalValue *Val =
     cast_or_null<GlobalValue>(M->getValueSymbolTable().lookup(Name));
+  if (!RenamedIntrinsics.empty()) {
+    auto I = RenamedIntrinsics.find(Name);
+    if (I != RenamedIntrinsics.end())
+      Val = I->second;
+  }
 
   // If this is a forward reference for the value, see if we already created a
   // forward ref record.
@@ -2890,6 +3098,16 @@ bool LLParser::ParseValID(ValID &ID, PerFunctionState *PFS) {
       F = cast<Function>(GV);
       if (F->isDeclaration())
         return Error(Fn.Loc, "cannot take blockaddress inside a declaration");
+
+      // If the body was skipped by a lazy parse, parse it now so its blocks
+      // can be found. Until every global is known it cannot be parsed yet, so
+      // use a placeholder like for a function that is defined later.
+      if (DeferredFunctionBodies.count(F)) {
+        if (!AllGlobalsParsed)
+          F = nullptr;
+        else if (materializeFunction(*F))
+          return true;
+      }
     }
 
     if (!F) {
@@ -2918,6 +3136,12 @@ bool LLParser::ParseValID(ValID &ID, PerFunctionState *PFS) {
         BB = BlockAddressPFS->GetBB(Label.StrVal, Label.Loc);
       if (!BB)
         return Error(Label.Loc, "referenced value is not a basic block");
+    } else if (Label.Kind == ValID::t_LocalID && LazyBodies) {
+      // In a lazy parse the body may only just have been parsed for this
+      // reference, so find the block by its number.
+      BB = getNumberedBlock(*F, Label.UIntVal);
+      if (!BB)
+        return Error(Label.Loc, "referenced value is not a basic block");
     } else {
       if (Label.Kind == ValID::t_LocalID)
         return Error(Label.Loc, "cannot take address of numeric label after "
@@ -4868,14 +5092,11 @@ bool LLParser::PerFunctionState::resolveForwardRefBlockAddresses() {
 
 /// ParseFunctionBody
 ///   ::= '{' BasicBlock+ UseListOrderDirective* '}'
-bool LLParser::ParseFunctionBody(Function &Fn) {
+bool LLParser::ParseFunctionBody(Function &Fn, int FunctionNumber) {
   if (Lex.getKind() != lltok::lbrace)
     return TokError("expected '{' in function body");
   Lex.Lex();  // eat the {.
 
-  int FunctionNumber = -1;
-  if (!Fn.hasName()) FunctionNumber = NumberedVals.size()-1;
-
   PerFunctionState PFS(*this, Fn, FunctionNumber);
 
   // Resolve block addresses and allow basic blocks to be forward-declared
@@ -4903,6 +5124,21 @@ bool LLParser::ParseFunctionBody(Function &Fn) {
   return PFS.FinishFunction();
 }
 
+/// deferFunctionBody - Skip a function body without parsing it, remembering
+/// where it is so that it can be parsed when the function is materialized.
+bool LLParser::deferFunctionBody(Function &Fn, int FunctionNumber) {
+  if (Lex.getKind() != lltok::lbrace)
+    return TokError("expected '{' in function body");
+  LocTy Start = Lex.getLoc();
+  if (Lex.skipBracedBlock())
+    return Error(Start, "expected '}' at end of function body");
+  Lex.Lex();  // eat the }.
+
+  DeferredFunctionBodies[&Fn] = {Start.getPointer(), FunctionNumber};
+  Fn.setIsMaterializable(true);
+  return false;
+}
+
 /// ParseBasicBlock
 ///   ::= LabelStr? Instruction*
 bool LLParser::ParseBasicBlock(PerFunctionState &PFS) {
@@ -6487,6 +6723,12 @@ bool LLParser::ParseUseListOrder(PerFunctionState *PFS) {
       ParseUseListOrderIndexes(Indexes))
     return true;
 
+  // In a lazy parse the use lists of constants are incomplete until every
+  // body is parsed, so their order cannot be restored. parseLazyAssembly
+  // parses files with uselistorder directives eagerly.
+  if (LazyBodies && isa<Constant>(V))
+    return Error(Loc, "uselistorder of a constant in a lazily parsed module");
+
   return sortUseListOrder(V, Indexes, Loc);
 }
 
@@ -6521,6 +6763,9 @@ bool LLParser::ParseUseListOrderBB() {
     return Error(Fn.Loc, "expected function name in uselistorder_bb");
   if (F->isDeclaration())
     return Error(Fn.Loc, "invalid declaration in uselistorder_bb");
+  // Likewise for the blocks of a body that a lazy parse skipped.
+  if (DeferredFunctionBodies.count(F))
+    return Error(Fn.Loc, "uselistorder_bb of a body that was not parsed");
 
   // Check the basic block.
   if (Label.Kind == ValID::t_LocalID)
@@ -15,6 +15,7 @@
 #define LLVM_LIB_ASMPARSER_LLPARSER_H
 
 #include "LLLexer.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/IR/Attributes.h"
@@ -139,13 +140,53 @@ namespace llvm {
     std::map<Value*, std::vector<unsigned> > ForwardRefAttrGroups;
     std::map<unsigned, AttrBuilder> NumberedAttrBuilders;
 
+    // Lazy function bodies. When LazyBodies is set, the bodies of function
+    // definitions are skipped and parsed only when the function is
+    // materialized. Each skipped body is recorded with the location of its
+    // '{' and the number of the function if it is unnamed.
+    struct DeferredBody {
+      const char *Start;
+      int FunctionNumber;
+    };
+    bool LazyBodies;
+    DenseMap<Function *, DeferredBody> DeferredFunctionBodies;
+    /// Set once every top-level entity is parsed. From then on, skipped
+    /// bodies are parsed as soon as a blockaddress refers to them.
+    bool AllGlobalsParsed = false;
+    bool StripDebugInfo = false;
+
+    // Intrinsics whose calls must be upgraded as the bodies containing them
+    // are parsed.
+    DenseMap<Function *, Function *> UpgradedIntrinsics;
+    DenseMap<Function *, Function *> RemangledIntrinsics;
+    /// Upgrading an intrinsic can rename it, but the bodies still refer to it
+    /// by its name in the file.
+    StringMap<Function *> RenamedIntrinsics;
+
   public:
     LLParser(StringRef F, SourceMgr &SM, SMDiagnostic &Err, Module *M,
-             SlotMapping *Slots = nullptr)
+             SlotMapping *Slots = nullptr, bool LazyBodies = false)
         : Context(M->getContext()), Lex(F, SM, Err, M->getContext()), M(M),
-          Slots(Slots), BlockAddressPFS(nullptr) {}
+          Slots(Slots), BlockAddressPFS(nullptr), LazyBodies(LazyBodies) {
+      assert(!(Slots && LazyBodies) &&
+             "Slot mappings are not supported when parsing lazily");
+    }
     bool Run();
 
+    /// Parse the body of \p F if it was skipped by a lazy parse. Returns true
+    /// on error.
+    bool materializeFunction(Function &F);
+
+    /// Parse every skipped function body and finish the upgrades that need
+    /// the whole module. Returns true on error.
+    bool materializeModule();
+
+    /// Strip the debug info of function bodies parsed from now on.
+    void setStripDebugInfo() { StripDebugInfo = true; }
+
+    /// Return the identified struct types defined or referenced so far.
+    std::vector<StructType *> getIdentifiedStructTypes() const;
+
     bool parseStandaloneConstantValue(Constant *&C, const SlotMapping *Slots);
 
     bool parseTypeAtBeginning(Type *&Ty, unsigned &Read,
@@ -258,6 +299,9 @@ namespace llvm {
     // Top-Level Entities
     bool ParseTopLevelEntities();
     bool ValidateEndOfModule();
+    void resolveForwardRefAttrGroups();
+    bool ValidateForwardRefs();
+    void upgradeTBAATags();
     bool ParseTargetDefinition();
     bool ParseModuleAsm();
     bool ParseSourceFileName();
@@ -451,7 +495,10 @@ namespace llvm {
     };
     bool ParseArgumentList(SmallVectorImpl<ArgInfo> &ArgList, bool &isVarArg);
     bool ParseFunctionHeader(Function *&Fn, bool isDefine);
-    bool ParseFunctionBody(Function &Fn);
+    bool ParseFunctionBody(Function &Fn, int FunctionNumber);
+    bool deferFunctionBody(Function &Fn, int FunctionNumber);
+    bool finishFunctionBody(Function &Fn);
+    bool materializeForwardRefBlockAddresses();
     bool ParseBasicBlock(PerFunctionState &PFS);
 
     enum TailCallType { TCT_None, TCT_Tail, TCT_MustTail };
@@ -14,7 +14,9 @@
 #include "llvm/AsmParser/Parser.h"
 #include "LLParser.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/IR/GVMaterializer.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/Error.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_ostream.h"
@@ -59,6 +61,100 @@ std::unique_ptr<Module> llvm::parseAssemblyFile(StringRef Filename,
   return parseAssembly(FileOrErr.get()->getMemBufferRef(), Err, Context, Slots);
 }
 
+namespace {
+/// Parses the function bodies that a lazy parse of an assembly file skipped
+/// as they are materialized. It keeps the parser, and with it the buffer and
+/// all the names it has seen, alive for as long as the module.
+class LazyAssemblyMaterializer : public GVMaterializer {
+  SourceMgr SM;
+  SMDiagnostic Err;
+  LLParser P;
+
+  static StringRef addBuffer(SourceMgr &SM,
+                             std::unique_ptr<MemoryBuffer> Buffer) {
+    StringRef Contents = Buffer->getBuffer();
+    SM.AddNewSourceBuffer(std::move(Buffer), SMLoc());
+    return Contents;
+  }
+
+  Error makeError() {
+    std::string Msg;
+    raw_string_ostream OS(Msg);
+    Err.print(nullptr, OS);
+    return make_error<StringError>(StringRef(OS.str()).rtrim(),
+                                   inconvertibleErrorCode());
+  }
+
+public:
+  LazyAssemblyMaterializer(std::unique_ptr<MemoryBuffer> Buffer, Module &M)
+      : P(addBuffer(SM, std::move(Buffer)), SM, Err, &M, nullptr,
+          /*LazyBodies=*/true) {}
+
+  bool run(SMDiagnostic &Error) {
+    if (!P.Run())
+      return false;
+    Error = Err;
+    return true;
+  }
+
+  Error materialize(GlobalValue *GV) override {
+    if (auto *F = dyn_cast<Function>(GV))
+      if (P.materializeFunction(*F))
+        return makeError();
+    return Error::success();
+  }
+
+  Error materializeModule() override {
+    if (P.materializeModule())
+      return makeError();
+    return Error::success();
+  }
+
+  Error materializeMetadata() override { return Error::success(); }
+  void setStripDebugInfo() override { P.setStripDebugInfo(); }
+
+  std::vector<StructType *> getIdentifiedStructTypes() const override {
+    return P.getIdentifiedStructTypes();
+  }
+};
+} // end anonymous namespace
+
+std::unique_ptr<Module>
+llvm::parseLazyAssembly(std::unique_ptr<MemoryBuffer> Buffer, SMDiagnostic &Err,
+                        LLVMContext &Context) {
+  // The order of a use list can only be restored once all of its uses exist,
+  // which for constants and blocks means once every body is parsed. Files
+  // with uselistorder directives are therefore parsed eagerly. This has to be
+  // decided up front: types and globals that a lazy parse has created cannot
+  // be taken back to start over.
+  if (LLLexer::hasUseListOrderDirective(Buffer->getBuffer()))
+    return parseAssembly(Buffer->getMemBufferRef(), Err, Context);
+
+  std::unique_ptr<Module> M =
+      make_unique<Module>(Buffer->getBufferIdentifier(), Context);
+  auto Materializer =
+      make_unique<LazyAssemblyMaterializer>(std::move(Buffer), *M);
+  if (Materializer->run(Err))
+    return nullptr;
+
+  M->setMaterializer(Materializer.release());
+  return M;
+}
+
+std::unique_ptr<Module> llvm::parseLazyAssemblyFile(StringRef Filename,
+                                                    SMDiagnostic &Err,
+                                                    LLVMContext &Context) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> FileOrErr =
+      MemoryBuffer::getFileOrSTDIN(Filename);
+  if (std::error_code EC = FileOrErr.getError()) {
+    Err = SMDiagnostic(Filename, SourceMgr::DK_Error,
+                       "Could not open input file: " + EC.message());
+    return nullptr;
+  }
+
+  return parseLazyAssembly(std::move(FileOrErr.get()), Err, Context);
+}
+
 std::unique_ptr<Module> llvm::parseAssemblyString(StringRef AsmString,
                                                   SMDiagnostic &Err,
                                                   LLVMContext &Context,
@@ -36,8 +36,6 @@ class Type;
 class MetadataLoader {
   class MetadataLoaderImpl;
   std::unique_ptr<MetadataLoaderImpl> Pimpl;
-  /// True if metadata is being parsed for a module being ThinLTO imported.
-  bool IsImporting = false;
   Error parseMetadata(bool ModuleLevel);
 
 public:
@@ -64,7 +62,7 @@ public:
   bool hasFwdRefs() const;
 
   /// Return the given metadata, creating a replaceable forward reference if
-  /// necessary.
+  /// necessary. Module-level metadata that was lazily left out is loaded.
   Metadata *getMetadataFwdRef(unsigned Idx);
 
   MDNode *getMDNodeFwdRefOrNull(unsigned Idx);
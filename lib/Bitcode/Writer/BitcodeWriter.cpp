@@ -28,6 +28,7 @@
 #include "llvm/IR/Operator.h"
 #include "llvm/IR/UseListOrder.h"
 #include "llvm/IR/ValueSymbolTable.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/Program.h"
@@ -37,6 +38,11 @@
 #include <map>
 using namespace llvm;
 
+static cl::opt<unsigned>
+    IndexThreshold("bitcode-mdindex-threshold", cl::Hidden, cl::init(25),
+                   cl::desc("Number of metadatas above which we emit an index "
+                            "to enable lazy-loading"));
+
 namespace {
 /// These are manifest constants used by the bitcode writer. They do not need to
 /// be kept in sync with the reader, but need to be consistent within this file.
@@ -224,8 +230,12 @@ private:
   void writeMetadataStrings(ArrayRef<const Metadata *> Strings,
                             SmallVectorImpl<uint64_t> &Record);
   void writeMetadataRecords(ArrayRef<const Metadata *> MDs,
-                            SmallVectorImpl<uint64_t> &Record);
+                            SmallVectorImpl<uint64_t> &Record,
+                            unsigned LocationAbbrev = 0,
+                            unsigned GenericNodeAbbrev = 0,
+                            std::vector<uint64_t> *IndexPos = nullptr);
   void writeModuleMetadata();
+  void writeGlobalDeclAttachments();
   void writeFunctionMetadata(const Function &F);
   void writeFunctionMetadataAttachment(const Function &F);
   void writeGlobalVariableMetadataAttachment(const GlobalVariable &GV);
@@ -1852,16 +1862,25 @@ void ModuleBitcodeWriter::writeMetadataStrings(
   Record.clear();
 }
 
+/// Write out the records for \p MDs. Abbreviations that are not passed in
+/// are created on first use. If \p IndexPos is given, the bit position of
+/// each record is appended to it.
 void ModuleBitcodeWriter::writeMetadataRecords(
-    ArrayRef<const Metadata *> MDs, SmallVectorImpl<uint64_t> &Record) {
+    ArrayRef<const Metadata *> MDs, SmallVectorImpl<uint64_t> &Record,
+    unsigned LocationAbbrev, unsigned GenericNodeAbbrev,
+    std::vector<uint64_t> *IndexPos) {
   if (MDs.empty())
     return;
 
   // Initialize MDNode abbreviations.
 #define HANDLE_MDNODE_LEAF(CLASS) unsigned CLASS##Abbrev = 0;
 #include "llvm/IR/Metadata.def"
+  DILocationAbbrev = LocationAbbrev;
+  GenericDINodeAbbrev = GenericNodeAbbrev;
 
   for (const Metadata *MD : MDs) {
+    if (IndexPos)
+      IndexPos->push_back(Stream.GetCurrentBitNo());
     if (const MDNode *N = dyn_cast<MDNode>(MD)) {
       assert(N->isResolved() && "Expected forward references to be resolved");
 
@@ -1883,12 +1902,81 @@ void ModuleBitcodeWriter::writeModuleMetadata() {
   if (!VE.hasMDs() && M.named_metadata_empty())
     return;
 
-  Stream.EnterSubblock(bitc::METADATA_BLOCK_ID, 3);
+  // We only emit an index for the metadata records if there are more than a
+  // given (naive) threshold of them, otherwise it is not worth it.
+  ArrayRef<const Metadata *> NonMDStrings = VE.getNonMDStrings();
+  bool EmitIndex = NonMDStrings.size() > IndexThreshold;
+  if (!EmitIndex) {
+    Stream.EnterSubblock(bitc::METADATA_BLOCK_ID, 3);
+    SmallVector<uint64_t, 64> Record;
+    writeMetadataStrings(VE.getMDStrings(), Record);
+    writeMetadataRecords(NonMDStrings, Record);
+    writeNamedMetadata(Record);
+    writeGlobalDeclAttachments();
+    Stream.ExitBlock();
+    return;
+  }
+
+  Stream.EnterSubblock(bitc::METADATA_BLOCK_ID, 4);
   SmallVector<uint64_t, 64> Record;
+
+  // A reader may jump straight to any record through the index, so all the
+  // abbreviations the records use are emitted before the first of them.
+  unsigned LocationAbbrev = createDILocationAbbrev();
+  unsigned GenericNodeAbbrev = createGenericDINodeAbbrev();
+
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::METADATA_INDEX_OFFSET));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32));
+  unsigned OffsetAbbrev = Stream.EmitAbbrev(Abbv);
+
+  Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::METADATA_INDEX));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6));
+  unsigned IndexAbbrev = Stream.EmitAbbrev(Abbv);
+
+  // Emit MDStrings together upfront.
   writeMetadataStrings(VE.getMDStrings(), Record);
-  writeMetadataRecords(VE.getNonMDStrings(), Record);
+
+  // Write a placeholder for the offset of the index, which is written after
+  // the records so that it can hold the position of each of them. The two
+  // 32-bit halves of the offset are patched once the records are emitted.
+  uint64_t Vals[] = {0, 0};
+  Stream.EmitRecord(bitc::METADATA_INDEX_OFFSET, Vals, OffsetAbbrev);
+  uint64_t IndexOffsetRecordBitPos = Stream.GetCurrentBitNo();
+
+  std::vector<uint64_t> IndexPos;
+  IndexPos.reserve(NonMDStrings.size());
+  writeMetadataRecords(NonMDStrings, Record, LocationAbbrev, GenericNodeAbbrev,
+                       &IndexPos);
+
+  // Now that all the records are out, patch the offset of the index relative
+  // to the end of the offset record, so a reader can skip over the records.
+  uint64_t IndexOffset = Stream.GetCurrentBitNo() - IndexOffsetRecordBitPos;
+  Stream.BackpatchWord(IndexOffsetRecordBitPos - 64, uint32_t(IndexOffset));
+  Stream.BackpatchWord(IndexOffsetRecordBitPos - 32,
+                       uint32_t(IndexOffset >> 32));
+
+  // Delta encode the index, starting from the end of the offset record.
+  uint64_t PreviousValue = IndexOffsetRecordBitPos;
+  for (uint64_t &Elt : IndexPos) {
+    uint64_t EltDelta = Elt - PreviousValue;
+    PreviousValue = Elt;
+    Elt = EltDelta;
+  }
+  Stream.EmitRecord(bitc::METADATA_INDEX, IndexPos, IndexAbbrev);
+  IndexPos.clear();
+
+  // Named metadata and global attachments are the roots a lazy reader starts
+  // from, so they come after the index and are always read.
   writeNamedMetadata(Record);
+  writeGlobalDeclAttachments();
+  Stream.ExitBlock();
+}
 
+void ModuleBitcodeWriter::writeGlobalDeclAttachments() {
   auto AddDeclAttachedMetadata = [&](const GlobalObject &GO) {
     SmallVector<uint64_t, 4> Record;
     Record.push_back(VE.getValueID(&GO));
@@ -1903,8 +1991,6 @@ void ModuleBitcodeWriter::writeModuleMetadata() {
   for (const GlobalVariable &GV : M.globals())
     if (GV.hasMetadata())
       AddDeclAttachedMetadata(GV);
-
-  Stream.ExitBlock();
 }
 
 void ModuleBitcodeWriter::writeFunctionMetadata(const Function &F) {
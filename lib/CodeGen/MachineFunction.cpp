@@ -100,7 +100,7 @@ static inline unsigned getFnStackAlignment(const TargetSubtargetInfo *STI,
 MachineFunction::MachineFunction(const Function *F, const TargetMachine &TM,
                                  unsigned FunctionNum, MachineModuleInfo &mmi)
     : Fn(F), Target(TM), STI(TM.getSubtargetImpl(*F)), Ctx(mmi.getContext()),
-      MMI(mmi) {
+      MMI(mmi), Arena(mmi.takeFunctionArena()), Allocator(*Arena) {
   FunctionNumber = FunctionNum;
   init();
 }
@@ -155,6 +155,7 @@ void MachineFunction::init() {
 
 MachineFunction::~MachineFunction() {
   clear();
+  MMI.recycleFunctionArena(std::move(Arena));
 }
 
 void MachineFunction::clear() {
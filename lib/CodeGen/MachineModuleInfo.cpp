@@ -10,6 +10,7 @@
 #include "llvm/CodeGen/MachineModuleInfo.h"
 #include "llvm/ADT/PointerUnion.h"
 #include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/TinyPtrVector.h"
 #include "llvm/Analysis/EHPersonalities.h"
 #include "llvm/Analysis/ValueTracking.h"
@@ -31,6 +32,22 @@
 using namespace llvm;
 using namespace llvm::dwarf;
 
+#define DEBUG_TYPE "machinemoduleinfo"
+
+STATISTIC(NumFunctionArenasCreated,
+          "Number of MachineFunction arenas allocated");
+STATISTIC(NumFunctionArenasReused,
+          "Number of MachineFunction arenas reused from the pool");
+STATISTIC(FunctionArenaBytes,
+          "Number of bytes allocated from MachineFunction arenas");
+STATISTIC(MaxFunctionArenaMemory,
+          "Largest memory footprint of a single MachineFunction arena");
+
+/// Upper bound on the number of idle arenas kept for reuse. In the usual
+/// pipeline only one MachineFunction is alive at a time, so a small pool is
+/// enough; anything beyond it is simply freed.
+static const unsigned MaxPooledFunctionArenas = 4;
+
 // Handle the Pass registration stuff necessary to use DataLayout's.
 INITIALIZE_TM_PASS(MachineModuleInfo, "machinemoduleinfo",
                    "Machine Module Information", false, false)
@@ -289,6 +306,32 @@ void MachineModuleInfo::deleteMachineFunctionFor(Function &F) {
   LastResult = nullptr;
 }
 
+std::unique_ptr<BumpPtrAllocator> MachineModuleInfo::takeFunctionArena() {
+  if (FunctionArenas.empty()) {
+    ++NumFunctionArenasCreated;
+    return make_unique<BumpPtrAllocator>();
+  }
+
+  ++NumFunctionArenasReused;
+  std::unique_ptr<BumpPtrAllocator> Arena = std::move(FunctionArenas.back());
+  FunctionArenas.pop_back();
+  return Arena;
+}
+
+void MachineModuleInfo::recycleFunctionArena(
+    std::unique_ptr<BumpPtrAllocator> Arena) {
+  FunctionArenaBytes += Arena->getBytesAllocated();
+  if (Arena->getTotalMemory() > MaxFunctionArenaMemory)
+    MaxFunctionArenaMemory = Arena->getTotalMemory();
+
+  if (FunctionArenas.size() >= MaxPooledFunctionArenas)
+    return;
+
+  // Reset keeps the first slab around, which is all most functions need.
+  Arena->Reset();
+  FunctionArenas.push_back(std::move(Arena));
+}
+
 namespace {
 /// This pass frees the MachineFunction object associated with a Function.
 class FreeMachineFunction : public FunctionPass {
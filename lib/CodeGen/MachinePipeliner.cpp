@@ -50,7 +50,9 @@
 // nodes. We also perform several passes over the DAG to eliminate unnecessary
 // edges that inhibit the ability to pipeline. The implementation uses the
 // DFAPacketizer class to compute the minimum initiation interval and the check
-// where an instruction may be inserted in the pipelined schedule.
+// where an instruction may be inserted in the pipelined schedule. Targets
+// without a DFA fall back on the processor resources described by the machine
+// scheduling model.
 //
 // In order for the SMS pass to work, several target specific hooks need to be
 // implemented to get information about the loop structure and to rewrite
@@ -89,6 +91,7 @@
 #include "llvm/CodeGen/RegisterPressure.h"
 #include "llvm/CodeGen/ScheduleDAG.h"
 #include "llvm/CodeGen/ScheduleDAGInstrs.h"
+#include "llvm/CodeGen/TargetSchedule.h"
 #include "llvm/IR/Attributes.h"
 #include "llvm/IR/DebugLoc.h"
 #include "llvm/MC/MCInstrItineraries.h"
@@ -160,6 +163,13 @@ static cl::opt<bool>
 static cl::opt<int> SwpLoopLimit("pipeliner-max", cl::Hidden, cl::init(-1));
 #endif
 
+/// A command line option to reject schedules whose modulo register pressure
+/// exceeds the number of allocatable registers, and try a larger II instead.
+static cl::opt<bool>
+    SwpCheckRegPressure("pipeliner-register-pressure", cl::Hidden,
+                        cl::init(true),
+                        cl::desc("Limit register pressure of the schedule."));
+
 static cl::opt<bool> SwpIgnoreRecMII("pipeliner-ignore-recmii",
                                      cl::ReallyHidden, cl::init(false),
                                      cl::ZeroOrMore, cl::desc("Ignore RecMII"));
@@ -375,6 +385,7 @@ private:
   void updatePhiDependences();
   void changeDependences();
   unsigned calculateResMII();
+  unsigned calculateResMIIFromSchedModel();
   unsigned calculateRecMII(NodeSetType &RecNodeSets);
   void findCircuits(NodeSetType &NodeSets);
   void fuseRecs(NodeSetType &NodeSets);
@@ -388,6 +399,9 @@ private:
                          SetVector<SUnit *> &NodesAdded);
   void computeNodeOrder(NodeSetType &NodeSets);
   bool schedulePipeline(SMSchedule &Schedule);
+  void getLoopControlInstrs(SmallVectorImpl<MachineInstr *> &Instrs);
+  bool isLoopControlInFirstStage(SMSchedule &Schedule);
+  bool exceedsRegisterPressure(SMSchedule &Schedule);
   void generatePipelinedLoop(SMSchedule &Schedule);
   void generateProlog(SMSchedule &Schedule, unsigned LastStage,
                       MachineBasicBlock *KernelBB, ValueMapTy *VRMap,
@@ -544,6 +558,93 @@ public:
   void dump() const { print(dbgs()); }
 };
 
+/// This class tracks the resources that are reserved by the instructions
+/// scheduled in a single cycle of the kernel. If the target provides a DFA,
+/// it is used directly. Otherwise, the processor resources and the issue
+/// width from the machine scheduling model are counted. The model is
+/// conservative in that each write resource is held for one cycle only.
+class ResourceManager {
+  const MCSchedModel &SM;
+  TargetSchedModel SchedModel;
+  std::unique_ptr<DFAPacketizer> DFAResources;
+  /// The number of units of each processor resource reserved in the cycle.
+  SmallVector<unsigned, 16> ProcResourceCount;
+  /// The number of instructions issued in the cycle.
+  unsigned IssueCount;
+
+  /// Return the scheduling class for the instruction, or null if the
+  /// machine model does not describe it.
+  const MCSchedClassDesc *getSchedClass(const MachineInstr &MI) const {
+    if (!SchedModel.hasInstrSchedModel())
+      return nullptr;
+    const MCSchedClassDesc *SCDesc = SchedModel.resolveSchedClass(&MI);
+    if (!SCDesc || !SCDesc->isValid())
+      return nullptr;
+    return SCDesc;
+  }
+
+public:
+  ResourceManager(const TargetSubtargetInfo &ST)
+      : SM(ST.getSchedModel()),
+        DFAResources(ST.getInstrInfo()->CreateTargetScheduleState(ST)),
+        ProcResourceCount(SM.getNumProcResourceKinds(), 0), IssueCount(0) {
+    SchedModel.init(SM, &ST, ST.getInstrInfo());
+  }
+
+  /// Return true if the resources needed by the instruction are available
+  /// in the current cycle.
+  bool canReserveResources(MachineInstr &MI) const {
+    if (DFAResources)
+      return DFAResources->canReserveResources(MI);
+    if (IssueCount + 1 > std::max(1U, SM.IssueWidth))
+      return false;
+    const MCSchedClassDesc *SCDesc = getSchedClass(MI);
+    if (!SCDesc)
+      return true;
+    for (TargetSchedModel::ProcResIter
+             I = SchedModel.getWriteProcResBegin(SCDesc),
+             E = SchedModel.getWriteProcResEnd(SCDesc);
+         I != E; ++I) {
+      const MCProcResourceDesc *PRDesc =
+          SchedModel.getProcResource(I->ProcResourceIdx);
+      // Resources with no units, such as the invalid resource, do not
+      // constrain the schedule.
+      if (PRDesc->NumUnits == 0)
+        continue;
+      if (ProcResourceCount[I->ProcResourceIdx] + 1 > PRDesc->NumUnits)
+        return false;
+    }
+    return true;
+  }
+
+  /// Reserve the resources needed by the instruction in the current cycle.
+  void reserveResources(MachineInstr &MI) {
+    if (DFAResources) {
+      DFAResources->reserveResources(MI);
+      return;
+    }
+    ++IssueCount;
+    const MCSchedClassDesc *SCDesc = getSchedClass(MI);
+    if (!SCDesc)
+      return;
+    for (TargetSchedModel::ProcResIter
+             I = SchedModel.getWriteProcResBegin(SCDesc),
+             E = SchedModel.getWriteProcResEnd(SCDesc);
+         I != E; ++I)
+      ++ProcResourceCount[I->ProcResourceIdx];
+  }
+
+  /// Release all the reserved resources.
+  void clearResources() {
+    if (DFAResources) {
+      DFAResources->clearResources();
+      return;
+    }
+    IssueCount = 0;
+    std::fill(ProcResourceCount.begin(), ProcResourceCount.end(), 0);
+  }
+};
+
 /// This class repesents the scheduled code.  The main data structure is a
 /// map from scheduled cycle to instructions.  During scheduling, the
 /// data structure explicitly represents all stages/iterations.   When
@@ -582,12 +683,11 @@ private:
   /// Virtual register information.
   MachineRegisterInfo &MRI;
 
-  DFAPacketizer *Resources;
+  ResourceManager Resources;
 
 public:
   SMSchedule(MachineFunction *mf)
-      : ST(mf->getSubtarget()), MRI(mf->getRegInfo()),
-        Resources(ST.getInstrInfo()->CreateTargetScheduleState(ST)) {
+      : ST(mf->getSubtarget()), MRI(mf->getRegInfo()), Resources(ST) {
     FirstCycle = 0;
     LastCycle = 0;
     InitiationInterval = 0;
@@ -597,7 +697,6 @@ public:
     ScheduledInstrs.clear();
     InstrToCycle.clear();
     RegToStageDiff.clear();
-    delete Resources;
   }
 
   void reset() {
@@ -612,6 +711,9 @@ public:
   /// Set the initiation interval for this schedule.
   void setInitiationInterval(int ii) { InitiationInterval = ii; }
 
+  /// Return the initiation interval for this schedule.
+  int getInitiationInterval() const { return InitiationInterval; }
+
   /// Return the first cycle in the completed schedule.  This
   /// can be a negative value.
   int getFirstCycle() const { return FirstCycle; }
@@ -844,6 +946,15 @@ bool MachinePipeliner::swingModuloScheduler(MachineLoop &L) {
 void SwingSchedulerDAG::schedule() {
   AliasAnalysis *AA = &Pass.getAnalysis<AAResultsWrapperPass>().getAAResults();
   buildSchedGraph(AA);
+  // A loop without a hardware loop instruction is controlled by instructions
+  // in the body, and the branch that uses them is not part of the schedule.
+  // Drop their dependences to the region boundary so that the loop control
+  // can be scheduled in the first stage.
+  if (Pass.LI.LoopInductionVar) {
+    SmallVector<SDep, 4> ExitPreds(ExitSU.Preds.begin(), ExitSU.Preds.end());
+    for (SDep &Dep : ExitPreds)
+      ExitSU.removePred(Dep);
+  }
   addLoopCarriedDependences(AA);
   updatePhiDependences();
   Topo.InitDAGTopologicalSorting();
@@ -1255,6 +1366,8 @@ struct FuncUnitSorter {
   unsigned minFuncUnits(const MachineInstr *Inst, unsigned &F) const {
     unsigned schedClass = Inst->getDesc().getSchedClass();
     unsigned min = UINT_MAX;
+    if (!InstrItins || InstrItins->isEmpty())
+      return min;
     for (const InstrStage *IS = InstrItins->beginStage(schedClass),
                           *IE = InstrItins->endStage(schedClass);
          IS != IE; ++IS) {
@@ -1274,6 +1387,8 @@ struct FuncUnitSorter {
   // for computing the resource MII. The instrutions that require
   // the same, highly used, functional unit have high priority.
   void calcCriticalResources(MachineInstr &MI) {
+    if (!InstrItins || InstrItins->isEmpty())
+      return;
     unsigned SchedClass = MI.getDesc().getSchedClass();
     for (const InstrStage *IS = InstrItins->beginStage(SchedClass),
                           *IE = InstrItins->endStage(SchedClass);
@@ -1299,15 +1414,21 @@ struct FuncUnitSorter {
 } // end anonymous namespace
 
 /// Calculate the resource constrained minimum initiation interval for the
-/// specified loop. We use the DFA to model the resources needed for
-/// each instruction, and we ignore dependences. A different DFA is created
-/// for each cycle that is required. When adding a new instruction, we attempt
-/// to add it to each existing DFA, until a legal space is found. If the
-/// instruction cannot be reserved in an existing DFA, we create a new one.
+/// specified loop. We use the DFA, or the machine model when there is no DFA,
+/// to model the resources needed for each instruction, and we ignore
+/// dependences. A different resource state is created for each cycle that is
+/// required. When adding a new instruction, we attempt to add it to each
+/// existing state, until a legal space is found. If the instruction cannot be
+/// reserved in an existing state, we create a new one.
 unsigned SwingSchedulerDAG::calculateResMII() {
-  SmallVector<DFAPacketizer *, 8> Resources;
+  std::unique_ptr<DFAPacketizer> DFA(
+      TII->CreateTargetScheduleState(MF.getSubtarget()));
+  if (!DFA)
+    return calculateResMIIFromSchedModel();
+
+  SmallVector<ResourceManager *, 8> Resources;
   MachineBasicBlock *MBB = Loop.getHeader();
-  Resources.push_back(TII->CreateTargetScheduleState(MF.getSubtarget()));
+  Resources.push_back(new ResourceManager(MF.getSubtarget()));
 
   // Sort the instructions by the number of available choices for scheduling,
   // least to most. Use the number of critical resources as the tie breaker.
@@ -1334,8 +1455,8 @@ unsigned SwingSchedulerDAG::calculateResMII() {
     // DFA is needed for each cycle.
     unsigned NumCycles = getSUnit(MI)->Latency;
     unsigned ReservedCycles = 0;
-    SmallVectorImpl<DFAPacketizer *>::iterator RI = Resources.begin();
-    SmallVectorImpl<DFAPacketizer *>::iterator RE = Resources.end();
+    SmallVectorImpl<ResourceManager *>::iterator RI = Resources.begin();
+    SmallVectorImpl<ResourceManager *>::iterator RE = Resources.end();
     for (unsigned C = 0; C < NumCycles; ++C)
       while (RI != RE) {
         if ((*RI++)->canReserveResources(*MI)) {
@@ -1350,8 +1471,7 @@ unsigned SwingSchedulerDAG::calculateResMII() {
     }
     // Add new DFAs, if needed, to reserve resources.
     for (unsigned C = ReservedCycles; C < NumCycles; ++C) {
-      DFAPacketizer *NewResource =
-          TII->CreateTargetScheduleState(MF.getSubtarget());
+      ResourceManager *NewResource = new ResourceManager(MF.getSubtarget());
       assert(NewResource->canReserveResources(*MI) && "Reserve error.");
       NewResource->reserveResources(*MI);
       Resources.push_back(NewResource);
@@ -1359,14 +1479,55 @@ unsigned SwingSchedulerDAG::calculateResMII() {
   }
   int Resmii = Resources.size();
   // Delete the memory for each of the DFAs that were created earlier.
-  for (DFAPacketizer *RI : Resources) {
-    DFAPacketizer *D = RI;
+  for (ResourceManager *RI : Resources) {
+    ResourceManager *D = RI;
     delete D;
   }
   Resources.clear();
   return Resmii;
 }
 
+/// Calculate the resource constrained minimum initiation interval using the
+/// machine scheduling model. This matches the ResourceManager, which holds each
+/// resource for a single cycle, so the bound is the number of uses of each
+/// resource divided by its units, or the number of instructions divided by
+/// the issue width.
+unsigned SwingSchedulerDAG::calculateResMIIFromSchedModel() {
+  const MCSchedModel &SM = MF.getSubtarget().getSchedModel();
+  SmallVector<unsigned, 16> ResourceUses(SM.getNumProcResourceKinds(), 0);
+  unsigned NumInstrs = 0;
+  MachineBasicBlock *MBB = Loop.getHeader();
+  for (MachineBasicBlock::iterator I = MBB->getFirstNonPHI(),
+                                   E = MBB->getFirstTerminator();
+       I != E; ++I) {
+    if (TII->isZeroCost(I->getOpcode()))
+      continue;
+    ++NumInstrs;
+    if (!SchedModel.hasInstrSchedModel())
+      continue;
+    const MCSchedClassDesc *SCDesc = SchedModel.resolveSchedClass(&*I);
+    if (!SCDesc || !SCDesc->isValid())
+      continue;
+    for (TargetSchedModel::ProcResIter
+             PI = SchedModel.getWriteProcResBegin(SCDesc),
+             PE = SchedModel.getWriteProcResEnd(SCDesc);
+         PI != PE; ++PI)
+      ++ResourceUses[PI->ProcResourceIdx];
+  }
+
+  unsigned IssueWidth = std::max(1U, SM.IssueWidth);
+  unsigned ResMII = (NumInstrs + IssueWidth - 1) / IssueWidth;
+  if (!SchedModel.hasInstrSchedModel())
+    return ResMII;
+  for (unsigned Idx = 1, E = ResourceUses.size(); Idx != E; ++Idx) {
+    unsigned NumUnits = SM.getProcResource(Idx)->NumUnits;
+    if (NumUnits == 0)
+      continue;
+    ResMII = std::max(ResMII, (ResourceUses[Idx] + NumUnits - 1) / NumUnits);
+  }
+  return ResMII;
+}
+
 /// Calculate the recurrence-constrainted minimum initiation interval.
 /// Iterate over each circuit.  Compute the delay(c) and distance(c)
 /// for each circuit. The II needs to satisfy the inequality
@@ -2216,6 +2377,14 @@ bool SwingSchedulerDAG::schedulePipeline(SMSchedule &Schedule) {
     // If a schedule is found, check if it is a valid schedule too.
     if (scheduleFound)
       scheduleFound = Schedule.isValidSchedule(this);
+
+    if (scheduleFound)
+      scheduleFound = isLoopControlInFirstStage(Schedule);
+
+    // A schedule that needs more registers than are available just trades
+    // the latency for spill code, so keep increasing II instead.
+    if (scheduleFound && SwpCheckRegPressure)
+      scheduleFound = !exceedsRegisterPressure(Schedule);
   }
 
   DEBUG(dbgs() << "Schedule Found? " << scheduleFound << "\n");
@@ -2228,6 +2397,98 @@ bool SwingSchedulerDAG::schedulePipeline(SMSchedule &Schedule) {
   return scheduleFound && Schedule.getMaxStageCount() > 0;
 }
 
+/// Collect the instructions that control a loop without a hardware loop
+/// instruction, in program order. These are the induction variable update,
+/// the copies that carry its value to the loop Phi, and the compare, unless
+/// the compare is the loop branch.
+void SwingSchedulerDAG::getLoopControlInstrs(
+    SmallVectorImpl<MachineInstr *> &Instrs) {
+  MachineInstr *IndVar = Pass.LI.LoopInductionVar;
+  MachineInstr *Cmp = Pass.LI.LoopCompare;
+  if (!IndVar)
+    return;
+  SmallSet<unsigned, 4> ControlRegs;
+  for (MachineInstr &MI : make_range(BB->getFirstNonPHI(),
+                                     BB->getFirstTerminator())) {
+    if (&MI == IndVar) {
+      ControlRegs.insert(MI.getOperand(0).getReg());
+      Instrs.push_back(&MI);
+    } else if (&MI == Cmp) {
+      Instrs.push_back(&MI);
+    } else if (MI.isCopy() && ControlRegs.count(MI.getOperand(1).getReg())) {
+      ControlRegs.insert(MI.getOperand(0).getReg());
+      Instrs.push_back(&MI);
+    }
+  }
+}
+
+/// Return true if the instructions that control the loop are scheduled in
+/// the first stage. Hardware loops don't have an induction variable, and the
+/// trip count is adjusted separately. Otherwise, the induction variable
+/// update and compare in the kernel must belong to the newest iteration so
+/// that the kernel exits once the last iteration has been started.
+bool SwingSchedulerDAG::isLoopControlInFirstStage(SMSchedule &Schedule) {
+  SmallVector<MachineInstr *, 4> ControlInstrs;
+  getLoopControlInstrs(ControlInstrs);
+  for (MachineInstr *MI : ControlInstrs)
+    if (Schedule.stageScheduled(getSUnit(MI)) != 0)
+      return false;
+  return true;
+}
+
+/// Return true if the number of values that are simultaneously live in the
+/// kernel exceeds the number of allocatable registers in any register class.
+/// A value defined in cycle D and last used in cycle U is live in the kernel
+/// slots (D..U) modulo II, so values with long lifetimes occupy several
+/// registers at once.
+bool SwingSchedulerDAG::exceedsRegisterPressure(SMSchedule &Schedule) {
+  int II = Schedule.getInitiationInterval();
+  MachineRegisterInfo &MRI = MF.getRegInfo();
+  DenseMap<const TargetRegisterClass *, SmallVector<unsigned, 8>> Pressure;
+  for (SUnit &SU : SUnits) {
+    MachineInstr *MI = SU.getInstr();
+    int DefCycle = Schedule.stageScheduled(&SU) * II +
+                   (int)Schedule.cycleScheduled(&SU);
+    for (const MachineOperand &MO : MI->defs()) {
+      if (!MO.isReg() || !TargetRegisterInfo::isVirtualRegister(MO.getReg()))
+        continue;
+      unsigned Reg = MO.getReg();
+      int LastUse = DefCycle;
+      for (MachineInstr &UseMI : MRI.use_instructions(Reg)) {
+        if (UseMI.getParent() != BB)
+          continue;
+        SUnit *UseSU = getSUnit(&UseMI);
+        if (!UseSU)
+          continue;
+        int UseCycle = Schedule.stageScheduled(UseSU) * II +
+                       (int)Schedule.cycleScheduled(UseSU);
+        // A use by a Phi occurs in the next iteration.
+        if (UseMI.isPHI())
+          UseCycle += II;
+        LastUse = std::max(LastUse, UseCycle);
+      }
+      const TargetRegisterClass *RC = MRI.getRegClass(Reg);
+      SmallVector<unsigned, 8> &Slots = Pressure[RC];
+      if (Slots.empty())
+        Slots.resize(II, 0);
+      for (int Cycle = DefCycle; Cycle <= LastUse; ++Cycle)
+        ++Slots[Cycle % II];
+    }
+  }
+  for (auto &RCPressure : Pressure) {
+    unsigned MaxLive =
+        *std::max_element(RCPressure.second.begin(), RCPressure.second.end());
+    unsigned NumRegs = RegClassInfo.getNumAllocatableRegs(RCPressure.first);
+    if (NumRegs != 0 && MaxLive > NumRegs) {
+      DEBUG(dbgs() << "Excess register pressure in "
+                   << TRI->getRegClassName(RCPressure.first) << ": "
+                   << MaxLive << " > " << NumRegs << "\n");
+      return true;
+    }
+  }
+  return false;
+}
+
 /// Given a schedule for the loop, generate a new version of the loop,
 /// and replace the old version.  This function generates a prolog
 /// that contains the initial iterations in the pipeline, and kernel
@@ -2280,6 +2541,19 @@ void SwingSchedulerDAG::generatePipelinedLoop(SMSchedule &Schedule) {
     InstrMap[NewMI] = &*I;
   }
 
+  // The kernel of a loop without a hardware loop instruction may branch on the
+  // flags set by the compare, so move the instructions that control the loop
+  // down to the terminators where no other instruction can clobber them. The
+  // target guarantees their values are only used by each other, the loop
+  // branch and the Phi.
+  SmallVector<MachineInstr *, 4> ControlInstrs;
+  getLoopControlInstrs(ControlInstrs);
+  for (MachineInstr *MI : ControlInstrs)
+    for (auto &NewAndOld : InstrMap)
+      if (NewAndOld.second == MI)
+        KernelBB->splice(KernelBB->getFirstTerminator(), KernelBB,
+                         NewAndOld.first);
+
   KernelBB->transferSuccessors(BB);
   KernelBB->replaceSuccessor(BB, KernelBB);
 
@@ -3490,7 +3764,7 @@ bool SMSchedule::insert(SUnit *SU, int StartCycle, int EndCycle, int II) {
        forward ? ++curCycle : --curCycle) {
 
     // Add the already scheduled instructions at the specified cycle to the DFA.
-    Resources->clearResources();
+    Resources.clearResources();
     for (int checkCycle = FirstCycle + ((curCycle - FirstCycle) % II);
          checkCycle <= LastCycle; checkCycle += II) {
       std::deque<SUnit *> &cycleInstrs = ScheduledInstrs[checkCycle];
@@ -3500,13 +3774,13 @@ bool SMSchedule::insert(SUnit *SU, int StartCycle, int EndCycle, int II) {
            I != E; ++I) {
         if (ST.getInstrInfo()->isZeroCost((*I)->getInstr()->getOpcode()))
           continue;
-        assert(Resources->canReserveResources(*(*I)->getInstr()) &&
+        assert(Resources.canReserveResources(*(*I)->getInstr()) &&
                "These instructions have already been scheduled.");
-        Resources->reserveResources(*(*I)->getInstr());
+        Resources.reserveResources(*(*I)->getInstr());
       }
     }
     if (ST.getInstrInfo()->isZeroCost(SU->getInstr()->getOpcode()) ||
-        Resources->canReserveResources(*SU->getInstr())) {
+        Resources.canReserveResources(*SU->getInstr())) {
       DEBUG({
         dbgs() << "\tinsert at cycle " << curCycle << " ";
         SU->getInstr()->dump();
@@ -975,6 +975,20 @@ bool TargetInstrInfo::isSchedulingBoundary(const MachineInstr &MI,
   return MI.modifiesRegister(TLI.getStackPointerRegisterToSaveRestore(), TRI);
 }
 
+bool TargetInstrInfo::onlyControlsLoop(const MachineRegisterInfo &MRI,
+                                       unsigned Reg, const MachineInstr *Phi,
+                                       const MachineInstr *Cmp) {
+  for (const MachineInstr &UseMI : MRI.use_nodbg_instructions(Reg)) {
+    if (&UseMI == Phi || &UseMI == Cmp)
+      continue;
+    if (!UseMI.isCopy() || UseMI.getParent() != Phi->getParent() ||
+        !TargetRegisterInfo::isVirtualRegister(UseMI.getOperand(0).getReg()) ||
+        !onlyControlsLoop(MRI, UseMI.getOperand(0).getReg(), Phi, nullptr))
+      return false;
+  }
+  return true;
+}
+
 // Provide a global flag for disabling the PreRA hazard recognizer that targets
 // may choose to honor.
 bool TargetInstrInfo::usePreRAHazardRecognizer() const {
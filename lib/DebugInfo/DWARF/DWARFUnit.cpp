@@ -319,6 +319,8 @@ bool DWARFUnit::parseDWO() {
 }
 
 void DWARFUnit::clearDIEs(bool KeepCUDie) {
+  SubprogramRanges.clear();
+  SubprogramRangesBuilt = false;
   if (DieArray.size() > (unsigned)KeepCUDie) {
     // std::vectors never get any smaller when resized to a smaller size,
     // or when clear() or erase() are called, the size will report that it
@@ -368,17 +370,54 @@ void DWARFUnit::collectAddressRanges(DWARFAddressRangesVector &CURanges) {
     clearDIEs(true);
 }
 
+void DWARFUnit::buildSubprogramRanges() {
+  SubprogramRanges.clear();
+  for (uint32_t I = 0, E = DieArray.size(); I != E; ++I) {
+    DWARFDie DIE(this, &DieArray[I]);
+    if (!DIE.isSubprogramDIE())
+      continue;
+    for (const auto &R : DIE.getAddressRanges())
+      if (R.first < R.second)
+        SubprogramRanges.push_back({R.first, R.second, 0, I});
+  }
+  std::stable_sort(SubprogramRanges.begin(), SubprogramRanges.end(),
+                   [](const SubprogramRange &LHS, const SubprogramRange &RHS) {
+                     return LHS.LowPC < RHS.LowPC;
+                   });
+  uint64_t MaxHighPC = 0;
+  for (SubprogramRange &R : SubprogramRanges) {
+    MaxHighPC = std::max(MaxHighPC, R.HighPC);
+    R.MaxHighPC = MaxHighPC;
+  }
+  SubprogramRangesBuilt = true;
+}
+
 DWARFDie
 DWARFUnit::getSubprogramForAddress(uint64_t Address) {
   extractDIEsIfNeeded(false);
-  for (const DWARFDebugInfoEntry &D : DieArray) {
-    DWARFDie DIE(this, &D);
-    if (DIE.isSubprogramDIE() &&
-        DIE.addressRangeContainsAddress(Address)) {
-      return DIE;
-    }
+  if (!SubprogramRangesBuilt)
+    buildSubprogramRanges();
+
+  // Walk back from the last range starting at or before the address, until no
+  // earlier range reaches it. Subprograms do not overlap in well-formed DWARF,
+  // so this usually looks at a single range. If they do, return the first
+  // subprogram in DIE order, as a scan of the DIEs would.
+  auto It = std::upper_bound(SubprogramRanges.begin(), SubprogramRanges.end(),
+                             Address,
+                             [](uint64_t Address, const SubprogramRange &R) {
+                               return Address < R.LowPC;
+                             });
+  uint32_t DIEIndex = UINT32_MAX;
+  while (It != SubprogramRanges.begin()) {
+    --It;
+    if (It->MaxHighPC <= Address)
+      break;
+    if (Address < It->HighPC)
+      DIEIndex = std::min(DIEIndex, It->DIEIndex);
   }
-  return DWARFDie();
+  if (DIEIndex == UINT32_MAX)
+    return DWARFDie();
+  return DWARFDie(this, &DieArray[DIEIndex]);
 }
 
 void
@@ -16,6 +16,7 @@
 #include "SymbolizableObjectFile.h"
 
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Config/config.h"
 #include "llvm/DebugInfo/DWARF/DWARFContext.h"
 #include "llvm/DebugInfo/PDB/PDB.h"
@@ -36,6 +37,7 @@
 #include <cassert>
 #include <cstdlib>
 #include <cstring>
+#include <set>
 
 #if defined(_MSC_VER)
 #include <Windows.h>
@@ -58,7 +60,80 @@ Expected<DILineInfo> LLVMSymbolizer::symbolizeCode(const std::string &ModuleName
     Info = InfoOrErr.get();
   else
     return InfoOrErr.takeError();
+  return symbolizeCode(Info, ModuleOffset);
+}
+
+Expected<DIInliningInfo>
+LLVMSymbolizer::symbolizeInlinedCode(const std::string &ModuleName,
+                                     uint64_t ModuleOffset) {
+  SymbolizableModule *Info;
+  if (auto InfoOrErr = getOrCreateModuleInfo(ModuleName))
+    Info = InfoOrErr.get();
+  else
+    return InfoOrErr.takeError();
+  return symbolizeInlinedCode(Info, ModuleOffset);
+}
+
+Expected<DIGlobal> LLVMSymbolizer::symbolizeData(const std::string &ModuleName,
+                                                 uint64_t ModuleOffset) {
+  SymbolizableModule *Info;
+  if (auto InfoOrErr = getOrCreateModuleInfo(ModuleName))
+    Info = InfoOrErr.get();
+  else
+    return InfoOrErr.takeError();
+  return symbolizeData(Info, ModuleOffset);
+}
 
+Expected<std::vector<DILineInfo>>
+LLVMSymbolizer::symbolizeCodeBatch(const std::string &ModuleName,
+                                   ArrayRef<uint64_t> ModuleOffsets) {
+  SymbolizableModule *Info;
+  if (auto InfoOrErr = getOrCreateModuleInfo(ModuleName))
+    Info = InfoOrErr.get();
+  else
+    return InfoOrErr.takeError();
+
+  std::vector<DILineInfo> Result;
+  Result.reserve(ModuleOffsets.size());
+  for (uint64_t ModuleOffset : ModuleOffsets)
+    Result.push_back(symbolizeCode(Info, ModuleOffset));
+  return std::move(Result);
+}
+
+Expected<std::vector<DIInliningInfo>>
+LLVMSymbolizer::symbolizeInlinedCodeBatch(const std::string &ModuleName,
+                                          ArrayRef<uint64_t> ModuleOffsets) {
+  SymbolizableModule *Info;
+  if (auto InfoOrErr = getOrCreateModuleInfo(ModuleName))
+    Info = InfoOrErr.get();
+  else
+    return InfoOrErr.takeError();
+
+  std::vector<DIInliningInfo> Result;
+  Result.reserve(ModuleOffsets.size());
+  for (uint64_t ModuleOffset : ModuleOffsets)
+    Result.push_back(symbolizeInlinedCode(Info, ModuleOffset));
+  return std::move(Result);
+}
+
+Expected<std::vector<DIGlobal>>
+LLVMSymbolizer::symbolizeDataBatch(const std::string &ModuleName,
+                                   ArrayRef<uint64_t> ModuleOffsets) {
+  SymbolizableModule *Info;
+  if (auto InfoOrErr = getOrCreateModuleInfo(ModuleName))
+    Info = InfoOrErr.get();
+  else
+    return InfoOrErr.takeError();
+
+  std::vector<DIGlobal> Result;
+  Result.reserve(ModuleOffsets.size());
+  for (uint64_t ModuleOffset : ModuleOffsets)
+    Result.push_back(symbolizeData(Info, ModuleOffset));
+  return std::move(Result);
+}
+
+DILineInfo LLVMSymbolizer::symbolizeCode(SymbolizableModule *Info,
+                                         uint64_t ModuleOffset) {
   // A null module means an error has already been reported. Return an empty
   // result.
   if (!Info)
@@ -76,15 +151,8 @@ Expected<DILineInfo> LLVMSymbolizer::symbolizeCode(const std::string &ModuleName
   return LineInfo;
 }
 
-Expected<DIInliningInfo>
-LLVMSymbolizer::symbolizeInlinedCode(const std::string &ModuleName,
-                                     uint64_t ModuleOffset) {
-  SymbolizableModule *Info;
-  if (auto InfoOrErr = getOrCreateModuleInfo(ModuleName))
-    Info = InfoOrErr.get();
-  else
-    return InfoOrErr.takeError();
-
+DIInliningInfo LLVMSymbolizer::symbolizeInlinedCode(SymbolizableModule *Info,
+                                                    uint64_t ModuleOffset) {
   // A null module means an error has already been reported. Return an empty
   // result.
   if (!Info)
@@ -106,14 +174,8 @@ LLVMSymbolizer::symbolizeInlinedCode(const std::string &ModuleName,
   return InlinedContext;
 }
 
-Expected<DIGlobal> LLVMSymbolizer::symbolizeData(const std::string &ModuleName,
-                                                 uint64_t ModuleOffset) {
-  SymbolizableModule *Info;
-  if (auto InfoOrErr = getOrCreateModuleInfo(ModuleName))
-    Info = InfoOrErr.get();
-  else
-    return InfoOrErr.takeError();
-
+DIGlobal LLVMSymbolizer::symbolizeData(SymbolizableModule *Info,
+                                       uint64_t ModuleOffset) {
   // A null module means an error has already been reported. Return an empty
   // result.
   if (!Info)
@@ -136,6 +198,83 @@ void LLVMSymbolizer::flush() {
   BinaryForPath.clear();
   ObjectPairForPathArch.clear();
   Modules.clear();
+  ModuleLRU.clear();
+  CacheSize = 0;
+}
+
+SymbolizableModule *
+LLVMSymbolizer::addModule(const std::string &ModuleName,
+                          std::unique_ptr<SymbolizableModule> Module,
+                          ObjectPair Objects) {
+  CachedModule Entry;
+  Entry.Module = std::move(Module);
+  Entry.Objects = Objects;
+  Entry.Size = 0;
+  if (Objects.first)
+    Entry.Size += Objects.first->getData().size();
+  if (Objects.second && Objects.second != Objects.first)
+    Entry.Size += Objects.second->getData().size();
+  Entry.LRUPos = ModuleLRU.insert(ModuleLRU.begin(), ModuleName);
+
+  auto InsertResult = Modules.insert(std::make_pair(ModuleName,
+                                                    std::move(Entry)));
+  assert(InsertResult.second);
+  (void)InsertResult;
+  SymbolizableModule *Res = InsertResult.first->second.Module.get();
+  CacheSize += InsertResult.first->second.Size;
+
+  // Never drop the module we are about to return.
+  while (Opts.MaxCacheSize && CacheSize > Opts.MaxCacheSize &&
+         Modules.size() > 1)
+    evictModule();
+  return Res;
+}
+
+void LLVMSymbolizer::evictModule() {
+  auto I = Modules.find(ModuleLRU.back());
+  assert(I != Modules.end() && "LRU list out of sync with the cache");
+  CacheSize -= I->second.Size;
+  ModuleLRU.pop_back();
+  // The module refers into the objects, so it must go first.
+  Modules.erase(I);
+
+  // Objects and binaries are shared between modules (for example a universal
+  // binary and its slices, or an executable and its separate debug info), so
+  // rather than tracking what the module used, keep whatever the remaining
+  // modules use and drop everything else, including binaries that were only
+  // opened while looking for debug info.
+  SmallPtrSet<const Binary *, 16> Live;
+  for (const auto &M : Modules) {
+    Live.insert(M.second.Objects.first);
+    Live.insert(M.second.Objects.second);
+  }
+
+  for (auto PI = ObjectPairForPathArch.begin();
+       PI != ObjectPairForPathArch.end();) {
+    if (Live.count(PI->second.first))
+      ++PI;
+    else
+      PI = ObjectPairForPathArch.erase(PI);
+  }
+
+  std::set<std::string> LiveUniversalPaths;
+  for (auto OI = ObjectForUBPathAndArch.begin();
+       OI != ObjectForUBPathAndArch.end();) {
+    if (Live.count(OI->second.get())) {
+      LiveUniversalPaths.insert(OI->first.first);
+      ++OI;
+    } else {
+      OI = ObjectForUBPathAndArch.erase(OI);
+    }
+  }
+
+  for (auto BI = BinaryForPath.begin(); BI != BinaryForPath.end();) {
+    if (Live.count(BI->second.getBinary()) ||
+        LiveUniversalPaths.count(BI->first))
+      ++BI;
+    else
+      BI = BinaryForPath.erase(BI);
+  }
 }
 
 namespace {
@@ -365,7 +504,9 @@ Expected<SymbolizableModule *>
 LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
   const auto &I = Modules.find(ModuleName);
   if (I != Modules.end()) {
-    return I->second.get();
+    // Move the module to the front of the LRU list.
+    ModuleLRU.splice(ModuleLRU.begin(), ModuleLRU, I->second.LRUPos);
+    return I->second.Module.get();
   }
   std::string BinaryName = ModuleName;
   std::string ArchName = Opts.DefaultArch;
@@ -381,8 +522,7 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
   auto ObjectsOrErr = getOrCreateObjectPair(BinaryName, ArchName);
   if (!ObjectsOrErr) {
     // Failed to find valid object file.
-    Modules.insert(
-        std::make_pair(ModuleName, std::unique_ptr<SymbolizableModule>()));
+    addModule(ModuleName, nullptr, ObjectPair(nullptr, nullptr));
     return ObjectsOrErr.takeError();
   }
   ObjectPair Objects = ObjectsOrErr.get();
@@ -399,8 +539,7 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
       std::unique_ptr<IPDBSession> Session;
       if (auto Err = loadDataForEXE(PDB_ReaderType::DIA,
                                     Objects.first->getFileName(), Session)) {
-        Modules.insert(
-            std::make_pair(ModuleName, std::unique_ptr<SymbolizableModule>()));
+        addModule(ModuleName, nullptr, Objects);
         return std::move(Err);
       }
       Context.reset(new PDBContext(*CoffObject, std::move(Session)));
@@ -414,12 +553,10 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
   std::unique_ptr<SymbolizableModule> SymMod;
   if (InfoOrErr)
     SymMod = std::move(InfoOrErr.get());
-  auto InsertResult =
-      Modules.insert(std::make_pair(ModuleName, std::move(SymMod)));
-  assert(InsertResult.second);
+  SymbolizableModule *Res = addModule(ModuleName, std::move(SymMod), Objects);
   if (auto EC = InfoOrErr.getError())
     return errorCodeToError(EC);
-  return InsertResult.first->second.get();
+  return Res;
 }
 
 namespace {
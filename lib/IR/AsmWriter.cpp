@@ -43,6 +43,7 @@
 #include "llvm/Support/Format.h"
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cctype>
@@ -606,6 +607,10 @@ private:
   /// asMap - The slot map for attribute sets.
   DenseMap<AttributeSet, unsigned> asMap;
   unsigned asNext;
+
+  /// ModuleSlots - If set, the tracker that module level slots are looked up
+  /// in; this one only numbers the values local to TheFunction.
+  SlotTracker *ModuleSlots = nullptr;
 public:
   /// Construct from a module.
   ///
@@ -621,6 +626,15 @@ public:
   /// within a function (even if no functions have been initialized).
   explicit SlotTracker(const Function *F,
                        bool ShouldInitializeAllMetadata = false);
+  /// Construct a tracker for the values local to the functions incorporated
+  /// into it that takes all other slots from \p ModuleSlots. ModuleSlots must
+  /// have been set up with initializeAllFunctions, after which any number of
+  /// these trackers can use it at once. The printer still computes function
+  /// attribute sets with getFnAttributes(), which looks them up in the
+  /// context and would insert a missing one without any locking. This is
+  /// only safe because initializeAllFunctions already created every one of
+  /// them; getAttributeGroupSlot asserts that they were all numbered.
+  explicit SlotTracker(SlotTracker &ModuleSlots);
 
   /// Return the slot number of the specified value in it's type
   /// plane.  If something is not in the SlotTracker, return -1.
@@ -660,6 +674,14 @@ public:
   /// This function does the actual initialization.
   inline void initialize();
 
+  /// Initialize the module level slots, then number the metadata and
+  /// attribute sets used in every function, in the order that printing the
+  /// functions one after another would number them. Numbering the function
+  /// attributes of every function and call creates them in the context, so
+  /// that trackers built on this one can compute them again on other threads
+  /// without modifying the context.
+  void initializeAllFunctions(const Module &M);
+
   // Implementation Details
 private:
   /// CreateModuleSlot - Insert the specified GlobalValue* into the slot table.
@@ -690,6 +712,9 @@ private:
   /// Add all of the metadata from an instruction.
   void processInstructionMetadata(const Instruction &I);
 
+  /// Add the function attributes of a call or invoke.
+  void processCallAttributes(const Instruction &I);
+
   SlotTracker(const SlotTracker &) = delete;
   void operator=(const SlotTracker &) = delete;
 };
@@ -783,6 +808,11 @@ SlotTracker::SlotTracker(const Function *F, bool ShouldInitializeAllMetadata)
       ShouldInitializeAllMetadata(ShouldInitializeAllMetadata), mNext(0),
       fNext(0), mdnNext(0), asNext(0) {}
 
+SlotTracker::SlotTracker(SlotTracker &ModuleSlots)
+    : TheModule(nullptr), TheFunction(nullptr), FunctionProcessed(false),
+      ShouldInitializeAllMetadata(false), mNext(0), fNext(0), mdnNext(0),
+      asNext(0), ModuleSlots(&ModuleSlots) {}
+
 inline void SlotTracker::initialize() {
   if (TheModule) {
     processModule();
@@ -839,13 +869,26 @@ void SlotTracker::processModule() {
   ST_DEBUG("end processModule!\n");
 }
 
+void SlotTracker::initializeAllFunctions(const Module &M) {
+  assert(!TheFunction && !ModuleSlots && "Not a module level tracker");
+  initialize();
+  for (const Function &F : M) {
+    if (!ShouldInitializeAllMetadata)
+      processFunctionMetadata(F);
+    for (const BasicBlock &BB : F)
+      for (const Instruction &I : BB)
+        processCallAttributes(I);
+  }
+}
+
 // Process the arguments, basic blocks, and instructions  of a function.
 void SlotTracker::processFunction() {
   ST_DEBUG("begin processFunction!\n");
   fNext = 0;
 
-  // Process function metadata if it wasn't hit at the module-level.
-  if (!ShouldInitializeAllMetadata)
+  // Process function metadata if it wasn't hit at the module-level, or by
+  // the tracker that owns the module level slots.
+  if (!ShouldInitializeAllMetadata && !ModuleSlots)
     processFunctionMetadata(*TheFunction);
 
   // Add all the function arguments with no names.
@@ -865,19 +908,8 @@ void SlotTracker::processFunction() {
       if (!I.getType()->isVoidTy() && !I.hasName())
         CreateFunctionSlot(&I);
 
-      // We allow direct calls to any llvm.foo function here, because the
-      // target may not be linked into the optimizer.
-      if (const CallInst *CI = dyn_cast<CallInst>(&I)) {
-        // Add all the call attributes to the table.
-        AttributeSet Attrs = CI->getAttributes().getFnAttributes();
-        if (Attrs.hasAttributes(AttributeSet::FunctionIndex))
-          CreateAttributeSetSlot(Attrs);
-      } else if (const InvokeInst *II = dyn_cast<InvokeInst>(&I)) {
-        // Add all the call attributes to the table.
-        AttributeSet Attrs = II->getAttributes().getFnAttributes();
-        if (Attrs.hasAttributes(AttributeSet::FunctionIndex))
-          CreateAttributeSetSlot(Attrs);
-      }
+      if (!ModuleSlots)
+        processCallAttributes(I);
     }
   }
 
@@ -886,6 +918,22 @@ void SlotTracker::processFunction() {
   ST_DEBUG("end processFunction!\n");
 }
 
+void SlotTracker::processCallAttributes(const Instruction &I) {
+  // We allow direct calls to any llvm.foo function here, because the
+  // target may not be linked into the optimizer.
+  if (const CallInst *CI = dyn_cast<CallInst>(&I)) {
+    // Add all the call attributes to the table.
+    AttributeSet Attrs = CI->getAttributes().getFnAttributes();
+    if (Attrs.hasAttributes(AttributeSet::FunctionIndex))
+      CreateAttributeSetSlot(Attrs);
+  } else if (const InvokeInst *II = dyn_cast<InvokeInst>(&I)) {
+    // Add all the call attributes to the table.
+    AttributeSet Attrs = II->getAttributes().getFnAttributes();
+    if (Attrs.hasAttributes(AttributeSet::FunctionIndex))
+      CreateAttributeSetSlot(Attrs);
+  }
+}
+
 void SlotTracker::processGlobalObjectMetadata(const GlobalObject &GO) {
   SmallVector<std::pair<unsigned, MDNode *>, 4> MDs;
   GO.getAllMetadata(MDs);
@@ -931,6 +979,9 @@ void SlotTracker::purgeFunction() {
 
 /// getGlobalSlot - Get the slot number of a global value.
 int SlotTracker::getGlobalSlot(const GlobalValue *V) {
+  if (ModuleSlots)
+    return ModuleSlots->getGlobalSlot(V);
+
   // Check for uninitialized state and do lazy initialization.
   initialize();
 
@@ -941,6 +992,9 @@ int SlotTracker::getGlobalSlot(const GlobalValue *V) {
 
 /// getMetadataSlot - Get the slot number of a MDNode.
 int SlotTracker::getMetadataSlot(const MDNode *N) {
+  if (ModuleSlots)
+    return ModuleSlots->getMetadataSlot(N);
+
   // Check for uninitialized state and do lazy initialization.
   initialize();
 
@@ -962,6 +1016,14 @@ int SlotTracker::getLocalSlot(const Value *V) {
 }
 
 int SlotTracker::getAttributeGroupSlot(AttributeSet AS) {
+  if (ModuleSlots) {
+    // A set that the module tracker did not number was created in the
+    // context while other threads may have been using it.
+    int Slot = ModuleSlots->getAttributeGroupSlot(AS);
+    assert(Slot != -1 && "Attribute set was not numbered up front");
+    return Slot;
+  }
+
   // Check for uninitialized state and do lazy initialization.
   initialize();
 
@@ -2053,7 +2115,8 @@ class AssemblyWriter {
   const Module *TheModule;
   std::unique_ptr<SlotTracker> SlotTrackerStorage;
   SlotTracker &Machine;
-  TypePrinting TypePrinter;
+  TypePrinting TypePrinterStorage;
+  TypePrinting &TypePrinter;
   AssemblyAnnotationWriter *AnnotationWriter;
   SetVector<const Comdat *> Comdats;
   bool IsForDebug;
@@ -2067,10 +2130,15 @@ public:
                  AssemblyAnnotationWriter *AAW, bool IsForDebug,
                  bool ShouldPreserveUseListOrder = false);
 
+  /// Construct an AssemblyWriter for printing functions of \p M that uses the
+  /// type numbering of \p TP, which must outlive it.
+  AssemblyWriter(formatted_raw_ostream &o, SlotTracker &Mac, const Module *M,
+                 TypePrinting &TP, bool IsForDebug);
+
   void printMDNodeBody(const MDNode *MD);
   void printNamedMDNode(const NamedMDNode *NMD);
 
-  void printModule(const Module *M);
+  void printModule(const Module *M, unsigned Threads = 1);
 
   void writeOperand(const Value *Op, bool PrintType);
   void writeParamOperand(const Value *Operand, AttributeSet Attrs,unsigned Idx);
@@ -2089,6 +2157,7 @@ public:
   void printIndirectSymbol(const GlobalIndirectSymbol *GIS);
   void printComdat(const Comdat *C);
   void printFunction(const Function *F);
+  void printFunctionsConcurrently(const Module &M, unsigned Threads);
   void printArgument(const Argument *FA, AttributeSet Attrs, unsigned Idx);
   void printBasicBlock(const BasicBlock *BB);
   void printInstructionLine(const Instruction &I);
@@ -2116,8 +2185,8 @@ private:
 AssemblyWriter::AssemblyWriter(formatted_raw_ostream &o, SlotTracker &Mac,
                                const Module *M, AssemblyAnnotationWriter *AAW,
                                bool IsForDebug, bool ShouldPreserveUseListOrder)
-    : Out(o), TheModule(M), Machine(Mac), AnnotationWriter(AAW),
-      IsForDebug(IsForDebug),
+    : Out(o), TheModule(M), Machine(Mac), TypePrinter(TypePrinterStorage),
+      AnnotationWriter(AAW), IsForDebug(IsForDebug),
       ShouldPreserveUseListOrder(ShouldPreserveUseListOrder) {
   if (!TheModule)
     return;
@@ -2127,6 +2196,13 @@ AssemblyWriter::AssemblyWriter(formatted_raw_ostream &o, SlotTracker &Mac,
       Comdats.insert(C);
 }
 
+AssemblyWriter::AssemblyWriter(formatted_raw_ostream &o, SlotTracker &Mac,
+                               const Module *M, TypePrinting &TP,
+                               bool IsForDebug)
+    : Out(o), TheModule(M), Machine(Mac), TypePrinter(TP),
+      AnnotationWriter(nullptr), IsForDebug(IsForDebug),
+      ShouldPreserveUseListOrder(false) {}
+
 void AssemblyWriter::writeOperand(const Value *Operand, bool PrintType) {
   if (!Operand) {
     Out << "<null operand!>";
@@ -2221,7 +2297,7 @@ void AssemblyWriter::writeOperandBundles(ImmutableCallSite CS) {
   Out << " ]";
 }
 
-void AssemblyWriter::printModule(const Module *M) {
+void AssemblyWriter::printModule(const Module *M, unsigned Threads) {
   Machine.initialize();
 
   if (ShouldPreserveUseListOrder)
@@ -2292,9 +2368,15 @@ void AssemblyWriter::printModule(const Module *M) {
   // Output global use-lists.
   printUseLists(nullptr);
 
-  // Output all of the functions.
-  for (const Function &F : *M)
-    printFunction(&F);
+  // Output all of the functions. Annotation writers need not be thread-safe,
+  // and use-list orders are handed out in function order, so print those
+  // modules one function at a time.
+  if (Threads > 1 && M->size() > 1 && !AnnotationWriter &&
+      !ShouldPreserveUseListOrder)
+    printFunctionsConcurrently(*M, Threads);
+  else
+    for (const Function &F : *M)
+      printFunction(&F);
   assert(UseListOrders.empty() && "All use-lists should have been consumed");
 
   // Output all attribute groups.
@@ -2717,6 +2799,64 @@ void AssemblyWriter::printFunction(const Function *F) {
   Machine.purgeFunction();
 }
 
+/// Print the functions of \p M on \p Threads threads. Each thread prints runs
+/// of consecutive functions into a buffer of its own, numbering their local
+/// values itself, and the buffers are written out in module order, so the
+/// output is the same as printing the functions one after another.
+void AssemblyWriter::printFunctionsConcurrently(const Module &M,
+                                                unsigned Threads) {
+  // The bodies refer to metadata and attribute groups by number, so number
+  // all of them now, in the order that printing them one by one would.
+  Machine.initializeAllFunctions(M);
+
+  // Cut the module into runs of about ChunkSize instructions. A few runs per
+  // thread are printed at a time so that only part of the output is held in
+  // memory.
+  const unsigned ChunkSize = 1 << 14;
+  struct Chunk {
+    Module::const_iterator Begin, End;
+    std::string Text;
+  };
+  std::vector<Chunk> Chunks;
+  unsigned CurSize = 0;
+  for (auto I = M.begin(), E = M.end(); I != E; ++I) {
+    if (Chunks.empty() || CurSize >= ChunkSize) {
+      Chunks.emplace_back();
+      Chunks.back().Begin = I;
+      CurSize = 0;
+    }
+    Chunks.back().End = std::next(I);
+    ++CurSize;
+    for (const BasicBlock &BB : *I)
+      CurSize += BB.size();
+  }
+
+  ThreadPool Pool(std::min<size_t>(Threads, Chunks.size()));
+  size_t Window = Threads * 4;
+  for (size_t Begin = 0, E = Chunks.size(); Begin < E; Begin += Window) {
+    size_t End = std::min(Begin + Window, E);
+    for (size_t I = Begin; I != End; ++I) {
+      Chunk &C = Chunks[I];
+      Pool.async([this, &C] {
+        raw_string_ostream OS(C.Text);
+        formatted_raw_ostream FOS(OS);
+        SlotTracker FunctionSlots(Machine);
+        AssemblyWriter W(FOS, FunctionSlots, TheModule, TypePrinter,
+                         IsForDebug);
+        for (const Function &F : make_range(C.Begin, C.End))
+          W.printFunction(&F);
+        FOS.flush();
+      });
+    }
+    Pool.wait();
+
+    for (size_t I = Begin; I != End; ++I) {
+      Out << Chunks[I].Text;
+      std::string().swap(Chunks[I].Text);
+    }
+  }
+}
+
 /// printArgument - This member is called for every argument that is passed into
 /// the function.  Simply print it out
 ///
@@ -3299,12 +3439,13 @@ void Function::print(raw_ostream &ROS, AssemblyAnnotationWriter *AAW,
 }
 
 void Module::print(raw_ostream &ROS, AssemblyAnnotationWriter *AAW,
-                   bool ShouldPreserveUseListOrder, bool IsForDebug) const {
+                   bool ShouldPreserveUseListOrder, bool IsForDebug,
+                   unsigned Threads) const {
   SlotTracker SlotTable(this);
   formatted_raw_ostream OS(ROS);
   AssemblyWriter W(OS, SlotTable, this, AAW, IsForDebug,
                    ShouldPreserveUseListOrder);
-  W.printModule(this);
+  W.printModule(this, Threads);
 }
 
 void NamedMDNode::print(raw_ostream &ROS, bool IsForDebug) const {
@@ -152,28 +152,52 @@ typedef std::pair<unsigned, AttributeSetNode *> IndexAttrPair;
 /// return type, and parameters.
 class AttributeSetImpl final
     : public FoldingSetNode,
-      private TrailingObjects<AttributeSetImpl, IndexAttrPair> {
+      private TrailingObjects<AttributeSetImpl, IndexAttrPair, unsigned> {
   friend class AttributeSet;
   friend TrailingObjects;
 
+public:
+  /// The largest number of return/parameter indices covered by the direct
+  /// index-to-slot table. Lists with attributes on higher parameter indices
+  /// fall back to a binary search over the slots.
+  static const unsigned MaxDirectIndices = 64;
+
 private:
   LLVMContext &Context;
   unsigned NumSlots; ///< Number of entries in this set.
+  /// Number of entries in the index-to-slot table that follows the slots.
+  unsigned NumDirectIndices;
+  /// Slot holding the FunctionIndex attributes, or NumSlots if there is none.
+  unsigned FnSlot;
   /// Bitset with a bit for each available attribute Attribute::AttrKind.
   uint64_t AvailableFunctionAttrs;
+  /// Bitset with a bit for each Attribute::AttrKind present on any index.
+  uint64_t AvailableSomewhereAttrs;
 
   // Helper fn for TrailingObjects class.
-  size_t numTrailingObjects(OverloadToken<IndexAttrPair>) { return NumSlots; }
+  size_t numTrailingObjects(OverloadToken<IndexAttrPair>) const {
+    return NumSlots;
+  }
 
   /// \brief Return a pointer to the IndexAttrPair for the specified slot.
   const IndexAttrPair *getNode(unsigned Slot) const {
     return getTrailingObjects<IndexAttrPair>() + Slot;
   }
 
+  static uint64_t getEnumAttrMask(const AttributeSetNode *Node) {
+    uint64_t Mask = 0;
+    for (Attribute I : *Node)
+      if (!I.isStringAttribute())
+        Mask |= ((uint64_t)1) << I.getKindAsEnum();
+    return Mask;
+  }
+
 public:
   AttributeSetImpl(LLVMContext &C,
                    ArrayRef<std::pair<unsigned, AttributeSetNode *>> Slots)
-      : Context(C), NumSlots(Slots.size()), AvailableFunctionAttrs(0) {
+      : Context(C), NumSlots(Slots.size()),
+        NumDirectIndices(getNumDirectIndices(Slots)), FnSlot(NumSlots),
+        AvailableFunctionAttrs(0), AvailableSomewhereAttrs(0) {
     static_assert(Attribute::EndAttrKinds <=
                       sizeof(AvailableFunctionAttrs) * CHAR_BIT,
                   "Too many attributes");
@@ -190,21 +214,43 @@ public:
     // There's memory after the node where we can store the entries in.
     std::copy(Slots.begin(), Slots.end(), getTrailingObjects<IndexAttrPair>());
 
-    // Initialize AvailableFunctionAttrs summary bitset.
+    // Fill in the index-to-slot table. Entries hold the slot number plus one,
+    // so that zero means the index has no attributes. If an index appears in
+    // more than one slot, queries see the first one.
+    unsigned *Direct = getTrailingObjects<unsigned>();
+    std::fill(Direct, Direct + NumDirectIndices, 0);
+    for (unsigned I = NumSlots; I != 0; --I) {
+      unsigned Index = Slots[I - 1].first;
+      if (Index < NumDirectIndices)
+        Direct[Index] = I;
+      else if (Index == AttributeSet::FunctionIndex)
+        FnSlot = I - 1;
+    }
+
+    // Initialize the summary bitsets.
+    for (const auto &Slot : Slots)
+      AvailableSomewhereAttrs |= getEnumAttrMask(Slot.second);
     if (NumSlots > 0) {
       static_assert(AttributeSet::FunctionIndex == ~0u,
                     "FunctionIndex should be biggest possible index");
       const std::pair<unsigned, AttributeSetNode *> &Last = Slots.back();
-      if (Last.first == AttributeSet::FunctionIndex) {
-        const AttributeSetNode *Node = Last.second;
-        for (Attribute I : *Node) {
-          if (!I.isStringAttribute())
-            AvailableFunctionAttrs |= ((uint64_t)1) << I.getKindAsEnum();
-        }
-      }
+      if (Last.first == AttributeSet::FunctionIndex)
+        AvailableFunctionAttrs = getEnumAttrMask(Last.second);
     }
   }
 
+  /// \brief Return the size of the index-to-slot table for \p Slots: one past
+  /// the highest return/parameter index, or zero if that exceeds
+  /// MaxDirectIndices.
+  static unsigned
+  getNumDirectIndices(ArrayRef<std::pair<unsigned, AttributeSetNode *>> Slots) {
+    unsigned NumIndices = 0;
+    for (const auto &Slot : Slots)
+      if (Slot.first != AttributeSet::FunctionIndex)
+        NumIndices = std::max(NumIndices, Slot.first + 1);
+    return NumIndices <= MaxDirectIndices ? NumIndices : 0;
+  }
+
   // AttributesSetImpt is uniqued, these should not be available.
   AttributeSetImpl(const AttributeSetImpl &) = delete;
   AttributeSetImpl &operator=(const AttributeSetImpl &) = delete;
@@ -246,6 +292,33 @@ public:
     return AvailableFunctionAttrs & ((uint64_t)1) << Kind;
   }
 
+  /// \brief Return true if the AttributeSetNode for any index has an enum
+  /// attribute of the given kind.
+  bool hasAttrSomewhere(Attribute::AttrKind Kind) const {
+    return AvailableSomewhereAttrs & ((uint64_t)1) << Kind;
+  }
+
+  /// \brief Return the AttributeSetNode for the return, parameter or function
+  /// index \p Index, or null if there are no attributes at that index.
+  AttributeSetNode *getNodeForIndex(unsigned Index) const {
+    if (Index == AttributeSet::FunctionIndex)
+      return FnSlot != NumSlots ? getSlotNode(FnSlot) : nullptr;
+    if (Index < NumDirectIndices) {
+      unsigned Slot = getTrailingObjects<unsigned>()[Index];
+      return Slot ? getSlotNode(Slot - 1) : nullptr;
+    }
+    if (NumDirectIndices != 0)
+      return nullptr;
+    // There is no table, either because the list has no return or parameter
+    // attributes or because they go past MaxDirectIndices; binary search.
+    const IndexAttrPair *Begin = getNode(0), *End = getNode(NumSlots);
+    const IndexAttrPair *I = std::lower_bound(
+        Begin, End, Index, [](const IndexAttrPair &LHS, unsigned RHS) {
+          return LHS.first < RHS;
+        });
+    return I != End && I->first == Index ? I->second : nullptr;
+  }
+
   typedef AttributeSetNode::iterator iterator;
   iterator begin(unsigned Slot) const { return getSlotNode(Slot)->begin(); }
   iterator end(unsigned Slot) const { return getSlotNode(Slot)->end(); }
@@ -64,6 +64,7 @@ public:
   void operator delete(void *p) { ::operator delete(p); }
 
   static AttributeSetNode *get(LLVMContext &C, ArrayRef<Attribute> Attrs);
+  static AttributeSetNode *get(LLVMContext &C, const AttrBuilder &B);
 
   static AttributeSetNode *get(AttributeSet AS, unsigned Index) {
     return AS.getAttributes(Index);
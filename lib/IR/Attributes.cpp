@@ -508,6 +508,51 @@ AttributeSetNode *AttributeSetNode::get(LLVMContext &C,
   return PA;
 }
 
+AttributeSetNode *AttributeSetNode::get(LLVMContext &C, const AttrBuilder &B) {
+  if (!B.hasAttributes())
+    return nullptr;
+
+  // Add target-independent attributes.
+  SmallVector<Attribute, 8> Attrs;
+  for (Attribute::AttrKind Kind = Attribute::None;
+       Kind != Attribute::EndAttrKinds; Kind = Attribute::AttrKind(Kind + 1)) {
+    if (!B.contains(Kind))
+      continue;
+
+    Attribute Attr;
+    switch (Kind) {
+    case Attribute::Alignment:
+      Attr = Attribute::getWithAlignment(C, B.getAlignment());
+      break;
+    case Attribute::StackAlignment:
+      Attr = Attribute::getWithStackAlignment(C, B.getStackAlignment());
+      break;
+    case Attribute::Dereferenceable:
+      Attr = Attribute::getWithDereferenceableBytes(
+          C, B.getDereferenceableBytes());
+      break;
+    case Attribute::DereferenceableOrNull:
+      Attr = Attribute::getWithDereferenceableOrNullBytes(
+          C, B.getDereferenceableOrNullBytes());
+      break;
+    case Attribute::AllocSize: {
+      auto A = B.getAllocSizeArgs();
+      Attr = Attribute::getWithAllocSizeArgs(C, A.first, A.second);
+      break;
+    }
+    default:
+      Attr = Attribute::get(C, Kind);
+    }
+    Attrs.push_back(Attr);
+  }
+
+  // Add target-dependent (string) attributes.
+  for (const auto &TDA : B.td_attrs())
+    Attrs.push_back(Attribute::get(C, TDA.first, TDA.second));
+
+  return get(C, Attrs);
+}
+
 bool AttributeSetNode::hasAttribute(StringRef Kind) const {
   for (Attribute I : *this)
     if (I.hasAttribute(Kind))
@@ -604,7 +649,8 @@ AttributeSet::getImpl(LLVMContext &C,
   if (!PA) {
     // Coallocate entries after the AttributeSetImpl itself.
     void *Mem = ::operator new(
-        AttributeSetImpl::totalSizeToAlloc<IndexAttrPair>(Attrs.size()));
+        AttributeSetImpl::totalSizeToAlloc<IndexAttrPair, unsigned>(
+            Attrs.size(), AttributeSetImpl::getNumDirectIndices(Attrs)));
     PA = new (Mem) AttributeSetImpl(C, Attrs);
     pImpl->AttrsLists.InsertNode(PA, InsertPoint);
   }
@@ -660,48 +706,10 @@ AttributeSet AttributeSet::get(LLVMContext &C,
 
 AttributeSet AttributeSet::get(LLVMContext &C, unsigned Index,
                                const AttrBuilder &B) {
-  if (!B.hasAttributes())
+  AttributeSetNode *ASN = AttributeSetNode::get(C, B);
+  if (!ASN)
     return AttributeSet();
-
-  // Add target-independent attributes.
-  SmallVector<std::pair<unsigned, Attribute>, 8> Attrs;
-  for (Attribute::AttrKind Kind = Attribute::None;
-       Kind != Attribute::EndAttrKinds; Kind = Attribute::AttrKind(Kind + 1)) {
-    if (!B.contains(Kind))
-      continue;
-
-    Attribute Attr;
-    switch (Kind) {
-    case Attribute::Alignment:
-      Attr = Attribute::getWithAlignment(C, B.getAlignment());
-      break;
-    case Attribute::StackAlignment:
-      Attr = Attribute::getWithStackAlignment(C, B.getStackAlignment());
-      break;
-    case Attribute::Dereferenceable:
-      Attr = Attribute::getWithDereferenceableBytes(
-          C, B.getDereferenceableBytes());
-      break;
-    case Attribute::DereferenceableOrNull:
-      Attr = Attribute::getWithDereferenceableOrNullBytes(
-          C, B.getDereferenceableOrNullBytes());
-      break;
-    case Attribute::AllocSize: {
-      auto A = B.getAllocSizeArgs();
-      Attr = Attribute::getWithAllocSizeArgs(C, A.first, A.second);
-      break;
-    }
-    default:
-      Attr = Attribute::get(C, Kind);
-    }
-    Attrs.emplace_back(Index, Attr);
-  }
-
-  // Add target-dependent (string) attributes.
-  for (const auto &TDA : B.td_attrs())
-    Attrs.emplace_back(Index, Attribute::get(C, TDA.first, TDA.second));
-
-  return get(C, Attrs);
+  return getImpl(C, std::make_pair(Index, ASN));
 }
 
 AttributeSet AttributeSet::get(LLVMContext &C, unsigned Index,
@@ -724,27 +732,33 @@ AttributeSet AttributeSet::get(LLVMContext &C, ArrayRef<AttributeSet> Attrs) {
   if (Attrs.empty()) return AttributeSet();
   if (Attrs.size() == 1) return Attrs[0];
 
-  SmallVector<std::pair<unsigned, AttributeSetNode*>, 8> AttrNodeVec;
-  AttributeSetImpl *A0 = Attrs[0].pImpl;
-  if (A0)
-    AttrNodeVec.append(A0->getNode(0), A0->getNode(A0->getNumSlots()));
-  // Copy all attributes from Attrs into AttrNodeVec while keeping AttrNodeVec
-  // ordered by index.  Because we know that each list in Attrs is ordered by
-  // index we only need to merge each successive list in rather than doing a
-  // full sort.
-  for (unsigned I = 1, E = Attrs.size(); I != E; ++I) {
-    AttributeSetImpl *AS = Attrs[I].pImpl;
-    if (!AS) continue;
-    SmallVector<std::pair<unsigned, AttributeSetNode *>, 8>::iterator
-      ANVI = AttrNodeVec.begin(), ANVE;
-    for (const IndexAttrPair *AI = AS->getNode(0),
-                             *AE = AS->getNode(AS->getNumSlots());
-         AI != AE; ++AI) {
-      ANVE = AttrNodeVec.end();
-      while (ANVI != ANVE && ANVI->first <= AI->first)
-        ++ANVI;
-      ANVI = AttrNodeVec.insert(ANVI, *AI) + 1;
+  unsigned NumSlots = 0;
+  for (AttributeSet AS : Attrs)
+    NumSlots += AS.getNumSlots();
+
+  // Merge each list in turn into the slots collected so far. Because we know
+  // that each list in Attrs is ordered by index we only need to merge rather
+  // than sort, and the merge is stable so that the slots of earlier lists come
+  // first. Both buffers are sized up front so merging never reallocates.
+  SmallVector<IndexAttrPair, 8> AttrNodeVec, Merged;
+  AttrNodeVec.reserve(NumSlots);
+  Merged.reserve(NumSlots);
+  auto IndexLess = [](const IndexAttrPair &LHS, const IndexAttrPair &RHS) {
+    return LHS.first < RHS.first;
+  };
+  for (AttributeSet AS : Attrs) {
+    AttributeSetImpl *Impl = AS.pImpl;
+    if (!Impl) continue;
+    const IndexAttrPair *AI = Impl->getNode(0),
+                        *AE = Impl->getNode(Impl->getNumSlots());
+    if (AttrNodeVec.empty() || !IndexLess(*AI, AttrNodeVec.back())) {
+      AttrNodeVec.append(AI, AE);
+      continue;
     }
+    Merged.resize(AttrNodeVec.size() + Impl->getNumSlots());
+    std::merge(AttrNodeVec.begin(), AttrNodeVec.end(), AI, AE, Merged.begin(),
+               IndexLess);
+    std::swap(AttrNodeVec, Merged);
   }
 
   return getImpl(C, AttrNodeVec);
@@ -768,29 +782,31 @@ AttributeSet AttributeSet::addAttribute(LLVMContext &C,
                                         Attribute A) const {
   unsigned I = 0, E = pImpl ? pImpl->getNumSlots() : 0;
   auto IdxI = Indices.begin(), IdxE = Indices.end();
-  SmallVector<AttributeSet, 4> AttrSet;
+  SmallVector<IndexAttrPair, 8> AttrNodeVec;
+  AttrNodeVec.reserve(E + Indices.size());
+  AttributeSetNode *ANode = AttributeSetNode::get(C, ArrayRef<Attribute>(A));
 
   while (I != E && IdxI != IdxE) {
     if (getSlotIndex(I) < *IdxI)
-      AttrSet.emplace_back(getSlotAttributes(I++));
+      AttrNodeVec.push_back(*pImpl->getNode(I++));
     else if (getSlotIndex(I) > *IdxI)
-      AttrSet.emplace_back(AttributeSet::get(C, std::make_pair(*IdxI++, A)));
+      AttrNodeVec.emplace_back(*IdxI++, ANode);
     else {
-      AttrBuilder B(getSlotAttributes(I), *IdxI);
+      AttrBuilder B(pImpl->getSlotNode(I));
       B.addAttribute(A);
-      AttrSet.emplace_back(AttributeSet::get(C, *IdxI, B));
+      AttrNodeVec.emplace_back(*IdxI, AttributeSetNode::get(C, B));
       ++I;
       ++IdxI;
     }
   }
 
   while (I != E)
-    AttrSet.emplace_back(getSlotAttributes(I++));
+    AttrNodeVec.push_back(*pImpl->getNode(I++));
 
   while (IdxI != IdxE)
-    AttrSet.emplace_back(AttributeSet::get(C, std::make_pair(*IdxI++, A)));
+    AttrNodeVec.emplace_back(*IdxI++, ANode);
 
-  return get(C, AttrSet);
+  return get(C, AttrNodeVec);
 }
 
 AttributeSet AttributeSet::addAttributes(LLVMContext &C, unsigned Index,
@@ -807,39 +823,13 @@ AttributeSet AttributeSet::addAttributes(LLVMContext &C, unsigned Index,
          "Attempt to change alignment!");
 #endif
 
-  // Add the attribute slots before the one we're trying to add.
-  SmallVector<AttributeSet, 4> AttrSet;
-  uint64_t NumAttrs = pImpl->getNumSlots();
-  AttributeSet AS;
-  uint64_t LastIndex = 0;
-  for (unsigned I = 0, E = NumAttrs; I != E; ++I) {
-    if (getSlotIndex(I) >= Index) {
-      if (getSlotIndex(I) == Index) AS = getSlotAttributes(LastIndex++);
-      break;
-    }
-    LastIndex = I + 1;
-    AttrSet.push_back(getSlotAttributes(I));
-  }
-
-  // Now add the attribute into the correct slot. There may already be an
-  // AttributeSet there.
-  AttrBuilder B(AS, Index);
-
-  for (unsigned I = 0, E = Attrs.pImpl->getNumSlots(); I != E; ++I)
-    if (Attrs.getSlotIndex(I) == Index) {
-      for (AttributeSetImpl::iterator II = Attrs.pImpl->begin(I),
-             IE = Attrs.pImpl->end(I); II != IE; ++II)
-        B.addAttribute(*II);
-      break;
-    }
-
-  AttrSet.push_back(AttributeSet::get(C, Index, B));
-
-  // Add the remaining attribute slots.
-  for (unsigned I = LastIndex, E = NumAttrs; I < E; ++I)
-    AttrSet.push_back(getSlotAttributes(I));
+  // Add the new attributes to the ones already at Index, if any.
+  AttrBuilder B(getAttributes(Index));
+  if (AttributeSetNode *ASN = Attrs.getAttributes(Index))
+    for (Attribute Attr : *ASN)
+      B.addAttribute(Attr);
 
-  return get(C, AttrSet);
+  return setAttributes(C, Index, AttributeSetNode::get(C, B));
 }
 
 AttributeSet AttributeSet::removeAttribute(LLVMContext &C, unsigned Index,
@@ -864,37 +854,12 @@ AttributeSet AttributeSet::removeAttributes(LLVMContext &C, unsigned Index,
   assert(!Attrs.hasAttribute(Index, Attribute::Alignment) &&
          "Attempt to change alignment!");
 
-  // Add the attribute slots before the one we're trying to add.
-  SmallVector<AttributeSet, 4> AttrSet;
-  uint64_t NumAttrs = pImpl->getNumSlots();
-  AttributeSet AS;
-  uint64_t LastIndex = 0;
-  for (unsigned I = 0, E = NumAttrs; I != E; ++I) {
-    if (getSlotIndex(I) >= Index) {
-      if (getSlotIndex(I) == Index) AS = getSlotAttributes(LastIndex++);
-      break;
-    }
-    LastIndex = I + 1;
-    AttrSet.push_back(getSlotAttributes(I));
-  }
-
-  // Now remove the attribute from the correct slot. There may already be an
-  // AttributeSet there.
-  AttrBuilder B(AS, Index);
+  // Remove the attributes from the ones already at Index, if any.
+  AttrBuilder B(getAttributes(Index));
+  if (Attrs.getAttributes(Index))
+    B.removeAttributes(Attrs, Index);
 
-  for (unsigned I = 0, E = Attrs.pImpl->getNumSlots(); I != E; ++I)
-    if (Attrs.getSlotIndex(I) == Index) {
-      B.removeAttributes(Attrs.pImpl->getSlotAttributes(I), Index);
-      break;
-    }
-
-  AttrSet.push_back(AttributeSet::get(C, Index, B));
-
-  // Add the remaining attribute slots.
-  for (unsigned I = LastIndex, E = NumAttrs; I < E; ++I)
-    AttrSet.push_back(getSlotAttributes(I));
-
-  return get(C, AttrSet);
+  return setAttributes(C, Index, AttributeSetNode::get(C, B));
 }
 
 AttributeSet AttributeSet::removeAttributes(LLVMContext &C, unsigned Index,
@@ -905,32 +870,34 @@ AttributeSet AttributeSet::removeAttributes(LLVMContext &C, unsigned Index,
   // For now, say we can't pass in alignment, which no current use does.
   assert(!Attrs.hasAlignmentAttr() && "Attempt to change alignment!");
 
-  // Add the attribute slots before the one we're trying to add.
-  SmallVector<AttributeSet, 4> AttrSet;
-  uint64_t NumAttrs = pImpl->getNumSlots();
-  AttributeSet AS;
-  uint64_t LastIndex = 0;
-  for (unsigned I = 0, E = NumAttrs; I != E; ++I) {
-    if (getSlotIndex(I) >= Index) {
-      if (getSlotIndex(I) == Index) AS = getSlotAttributes(LastIndex++);
-      break;
-    }
-    LastIndex = I + 1;
-    AttrSet.push_back(getSlotAttributes(I));
-  }
-
-  // Now remove the attribute from the correct slot. There may already be an
-  // AttributeSet there.
-  AttrBuilder B(AS, Index);
+  // Remove the attributes from the ones already at Index, if any.
+  AttrBuilder B(getAttributes(Index));
   B.remove(Attrs);
 
-  AttrSet.push_back(AttributeSet::get(C, Index, B));
+  return setAttributes(C, Index, AttributeSetNode::get(C, B));
+}
 
-  // Add the remaining attribute slots.
-  for (unsigned I = LastIndex, E = NumAttrs; I < E; ++I)
-    AttrSet.push_back(getSlotAttributes(I));
+AttributeSet AttributeSet::setAttributes(LLVMContext &C, unsigned Index,
+                                         AttributeSetNode *Node) const {
+  if (getAttributes(Index) == Node)
+    return *this;
+  unsigned NumSlots = pImpl->getNumSlots();
 
-  return get(C, AttrSet);
+  // Copy the slots, putting Node where the first slot for Index is (or would
+  // be) in index order.
+  SmallVector<IndexAttrPair, 8> AttrNodeVec;
+  AttrNodeVec.reserve(NumSlots + 1);
+  unsigned I = 0;
+  while (I != NumSlots && getSlotIndex(I) < Index)
+    AttrNodeVec.push_back(*pImpl->getNode(I++));
+  if (Node)
+    AttrNodeVec.emplace_back(Index, Node);
+  if (I != NumSlots && getSlotIndex(I) == Index)
+    ++I;
+  while (I != NumSlots)
+    AttrNodeVec.push_back(*pImpl->getNode(I++));
+
+  return get(C, AttrNodeVec);
 }
 
 AttributeSet AttributeSet::addDereferenceableAttr(LLVMContext &C, unsigned Index,
@@ -1016,7 +983,7 @@ bool AttributeSet::hasFnAttribute(StringRef Kind) const {
 
 bool AttributeSet::hasAttrSomewhere(Attribute::AttrKind Attr,
                                     unsigned *Index) const {
-  if (!pImpl) return false;
+  if (!pImpl || !pImpl->hasAttrSomewhere(Attr)) return false;
 
   for (unsigned I = 0, E = pImpl->getNumSlots(); I != E; ++I)
     for (AttributeSetImpl::iterator II = pImpl->begin(I),
@@ -1073,14 +1040,7 @@ std::string AttributeSet::getAsString(unsigned Index, bool InAttrGrp) const {
 }
 
 AttributeSetNode *AttributeSet::getAttributes(unsigned Index) const {
-  if (!pImpl) return nullptr;
-
-  // Loop through to find the attribute node we want.
-  for (unsigned I = 0, E = pImpl->getNumSlots(); I != E; ++I)
-    if (pImpl->getSlotIndex(I) == Index)
-      return pImpl->getSlotNode(I);
-
-  return nullptr;
+  return pImpl ? pImpl->getNodeForIndex(Index) : nullptr;
 }
 
 AttributeSet::iterator AttributeSet::begin(unsigned Slot) const {
@@ -1136,20 +1096,15 @@ LLVM_DUMP_METHOD void AttributeSet::dump() const {
 //===----------------------------------------------------------------------===//
 
 AttrBuilder::AttrBuilder(AttributeSet AS, unsigned Index)
+    : AttrBuilder(AS.getAttributes(Index)) {}
+
+AttrBuilder::AttrBuilder(const AttributeSetNode *ASN)
     : Attrs(0), Alignment(0), StackAlignment(0), DerefBytes(0),
       DerefOrNullBytes(0), AllocSizeArgs(0) {
-  AttributeSetImpl *pImpl = AS.pImpl;
-  if (!pImpl) return;
+  if (!ASN) return;
 
-  for (unsigned I = 0, E = pImpl->getNumSlots(); I != E; ++I) {
-    if (pImpl->getSlotIndex(I) != Index) continue;
-
-    for (AttributeSetImpl::iterator II = pImpl->begin(I),
-           IE = pImpl->end(I); II != IE; ++II)
-      addAttribute(*II);
-
-    break;
-  }
+  for (Attribute Attr : *ASN)
+    addAttribute(Attr);
 }
 
 void AttrBuilder::clear() {
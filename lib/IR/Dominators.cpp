@@ -29,9 +29,9 @@ using namespace llvm;
 
 // Always verify dominfo if expensive checking is enabled.
 #ifdef EXPENSIVE_CHECKS
-static bool VerifyDomInfo = true;
+bool llvm::VerifyDomInfo = true;
 #else
-static bool VerifyDomInfo = false;
+bool llvm::VerifyDomInfo = false;
 #endif
 static cl::opt<bool,true>
 VerifyDomInfoX("verify-dom-info", cl::location(VerifyDomInfo),
@@ -72,6 +72,14 @@ template void llvm::Calculate<Function, Inverse<BasicBlock *>>(
     DominatorTreeBase<typename std::remove_pointer<
         GraphTraits<Inverse<BasicBlock *>>::NodeRef>::type> &DT,
     Function &F);
+template void llvm::InsertEdge<BasicBlock>(DominatorTreeBase<BasicBlock> &DT,
+                                          BasicBlock *From, BasicBlock *To);
+template void llvm::DeleteEdge<BasicBlock>(DominatorTreeBase<BasicBlock> &DT,
+                                          BasicBlock *From, BasicBlock *To);
+template void llvm::ApplyUpdates<BasicBlock>(
+    DominatorTreeBase<BasicBlock> &DT,
+    ArrayRef<DominatorTreeBase<BasicBlock>::UpdateType> Updates);
+template bool llvm::Verify<BasicBlock>(const DominatorTreeBase<BasicBlock> &DT);
 
 // dominates - Return true if Def dominates a use in User. This performs
 // the special checks necessary if Def and User are in the same basic block.
@@ -308,6 +316,7 @@ DominatorTree DominatorTreeAnalysis::run(Function &F,
                                          FunctionAnalysisManager &) {
   DominatorTree DT;
   DT.recalculate(F);
+  DT.setVerifyUpdates(VerifyDomInfo);
   return DT;
 }
 
@@ -345,6 +354,7 @@ INITIALIZE_PASS(DominatorTreeWrapperPass, "domtree",
 
 bool DominatorTreeWrapperPass::runOnFunction(Function &F) {
   DT.recalculate(F);
+  DT.setVerifyUpdates(VerifyDomInfo);
   return false;
 }
 
@@ -38,6 +38,11 @@ void Use::swap(Use &RHS) {
   }
 }
 
+// For a User with a fixed number of operands, the operands sit right before
+// the User itself, and the last 20 of them carry a fixed run of tags, so
+// getImpliedUser() only reads the tags of a handful of neighbouring Uses. A
+// faster lookup would need another word in every Use, or knowledge of the
+// opcode that a Use cannot get at without finding its User first.
 User *Use::getUser() const {
   const Use *End = getImpliedUser();
   const UserRef *ref = reinterpret_cast<const UserRef *>(End);
@@ -380,6 +380,14 @@ void Value::doRAUW(Value *New, bool NoMetadata) {
   if (!NoMetadata && isUsedByMetadata())
     ValueAsMetadata::handleRAUW(this, New);
 
+  // Only constants, and basic blocks through blockaddress, can be used by
+  // other constants. Everything else can hand its whole use list over without
+  // finding the User of each Use.
+  if (!isa<Constant>(this) && !isa<BasicBlock>(this)) {
+    transferUseListTo(New);
+    return;
+  }
+
   while (!use_empty()) {
     Use &U = *UseList;
     // Must handle Constants specially, we cannot call replaceUsesOfWith on a
@@ -398,6 +406,30 @@ void Value::doRAUW(Value *New, bool NoMetadata) {
     BB->replaceSuccessorsPhiUsesWith(cast<BasicBlock>(New));
 }
 
+/// Point every use of this value at \p New and move them all to the front of
+/// New's use list in one pass. The resulting order is the same as setting
+/// each use in turn would give: this value's uses, reversed, followed by the
+/// uses New already had.
+void Value::transferUseListTo(Value *New) {
+  Use *Head = New->UseList;
+  Use *Current = UseList;
+  UseList = nullptr;
+  while (Current) {
+    assert(!isa<Constant>(Current->getUser()) &&
+           "Constant users must go through handleOperandChange");
+    Use *Next = Current->Next;
+    Current->Val = New;
+    Current->Next = Head;
+    if (Head)
+      Head->setPrev(&Current->Next);
+    Head = Current;
+    Current = Next;
+  }
+  New->UseList = Head;
+  if (Head)
+    Head->setPrev(&New->UseList);
+}
+
 void Value::replaceAllUsesWith(Value *New) {
   doRAUW(New, false /* NoMetadata */);
 }
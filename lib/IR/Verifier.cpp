@@ -45,6 +45,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/IR/Verifier.h"
+#include "LLVMContextImpl.h"
 #include "llvm/ADT/APFloat.h"
 #include "llvm/ADT/APInt.h"
 #include "llvm/ADT/ArrayRef.h"
@@ -105,6 +106,7 @@
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cassert>
@@ -112,11 +114,17 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 using namespace llvm;
 
 static cl::opt<bool> VerifyDebugInfo("verify-debug-info", cl::init(true));
 
+static cl::opt<unsigned> VerifyThreads(
+    "verify-threads", cl::init(1), cl::Hidden,
+    cl::desc("Number of threads the verifier analysis uses to check function "
+             "bodies"));
+
 namespace llvm {
 
 struct VerifierSupport {
@@ -311,6 +319,19 @@ public:
 
   bool hasBrokenDebugInfo() const { return BrokenDebugInfo; }
 
+  /// Take over what \p Other learned while verifying function bodies that
+  /// the module-level checks need: the metadata already verified, the compile
+  /// units seen and the uses of llvm.localescape and llvm.localrecover.
+  void mergeFunctionState(const Verifier &Other) {
+    MDNodes.insert(Other.MDNodes.begin(), Other.MDNodes.end());
+    CUVisited.insert(Other.CUVisited.begin(), Other.CUVisited.end());
+    for (const auto &Counts : Other.FrameEscapeInfo) {
+      auto &Entry = FrameEscapeInfo[Counts.first];
+      Entry.first = std::max(Entry.first, Counts.second.first);
+      Entry.second = std::max(Entry.second, Counts.second.second);
+    }
+  }
+
   bool verify(const Function &F) {
     assert(F.getParent() == &M &&
            "An instance of this class only works with a specific module!");
@@ -1457,11 +1478,15 @@ void Verifier::verifyParameterAttrs(AttributeSet Attrs, unsigned Idx, Type *Ty,
          "'noinline and alwaysinline' are incompatible!",
          V);
 
+  // Only build the attribute set for the message when it is printed: that
+  // creates it in the context, which concurrent verification must not do.
   Assert(
       !AttrBuilder(Attrs, Idx).overlaps(AttributeFuncs::typeIncompatible(Ty)),
       "Wrong types for attribute: " +
-          AttributeSet::get(Context, Idx, AttributeFuncs::typeIncompatible(Ty))
-              .getAsString(Idx),
+          (OS ? AttributeSet::get(Context, Idx,
+                                  AttributeFuncs::typeIncompatible(Ty))
+                    .getAsString(Idx)
+              : std::string()),
       V);
 
   if (PointerType *PTy = dyn_cast<PointerType>(Ty)) {
@@ -4409,14 +4434,107 @@ bool llvm::verifyFunction(const Function &f, raw_ostream *OS) {
   return !V.verify(F);
 }
 
+/// Create up front everything that verifying a function body may otherwise
+/// create lazily in the context, so that function bodies can be verified
+/// concurrently: the none token, the sizedness of struct types, and the types
+/// that matching intrinsic signatures builds.
+static void prepareContextForConcurrentVerification(const Module &M) {
+  LLVMContext &Context = M.getContext();
+  ConstantTokenNone::get(Context);
+  for (StructType *STy : Context.pImpl->AnonStructTypes)
+    STy->isSized();
+  for (const auto &Entry : Context.pImpl->NamedStructTypes)
+    Entry.getValue()->isSized();
+
+  for (const Function &F : M) {
+    Intrinsic::ID ID = F.getIntrinsicID();
+    if (ID == Intrinsic::not_intrinsic)
+      continue;
+    // Mirror the prototype check in Verifier::visitIntrinsicCallSite.
+    SmallVector<Intrinsic::IITDescriptor, 8> Table;
+    getIntrinsicInfoTableEntries(ID, Table);
+    ArrayRef<Intrinsic::IITDescriptor> TableRef = Table;
+    SmallVector<Type *, 4> ArgTys;
+    FunctionType *FTy = F.getFunctionType();
+    if (Intrinsic::matchIntrinsicType(FTy->getReturnType(), TableRef, ArgTys))
+      continue;
+    for (Type *ParamTy : FTy->params())
+      if (Intrinsic::matchIntrinsicType(ParamTy, TableRef, ArgTys))
+        break;
+  }
+}
+
+/// Verify the functions of \p M on \p Threads threads and hand what the
+/// module-level checks need over to \p V. The workers print nothing; if any
+/// of them finds a problem this returns false and leaves \p V alone, so that
+/// the caller can verify sequentially and report exactly what a sequential
+/// run would have.
+static bool verifyFunctionsConcurrently(Verifier &V, const Module &M,
+                                        bool TreatBrokenDebugInfoAsError,
+                                        unsigned Threads) {
+  // Split the functions into contiguous chunks of similar size, a few per
+  // thread to even out the load. Each chunk gets its own verifier, so
+  // metadata shared between chunks is checked once per chunk.
+  std::vector<std::pair<const Function *, unsigned>> Sizes;
+  uint64_t TotalSize = 0;
+  for (const Function &F : M) {
+    unsigned Size = 1;
+    for (const BasicBlock &BB : F)
+      Size += BB.size();
+    Sizes.push_back(std::make_pair(&F, Size));
+    TotalSize += Size;
+  }
+
+  struct Chunk {
+    Module::const_iterator Begin, End;
+    std::unique_ptr<Verifier> V;
+    bool Broken = false;
+  };
+  std::vector<Chunk> Chunks;
+  uint64_t ChunkSize = TotalSize / (Threads * 4) + 1;
+  uint64_t CurSize = 0;
+  for (auto &FS : Sizes) {
+    if (Chunks.empty() || CurSize >= ChunkSize) {
+      Chunks.emplace_back();
+      Chunks.back().Begin = FS.first->getIterator();
+      CurSize = 0;
+    }
+    Chunks.back().End = std::next(FS.first->getIterator());
+    CurSize += FS.second;
+  }
+
+  prepareContextForConcurrentVerification(M);
+  for (Chunk &C : Chunks)
+    C.V = llvm::make_unique<Verifier>(nullptr, TreatBrokenDebugInfoAsError, M);
+
+  {
+    ThreadPool Pool(std::min<size_t>(Threads, Chunks.size()));
+    for (Chunk &C : Chunks)
+      Pool.async([&C] {
+        for (const Function &F : make_range(C.Begin, C.End))
+          C.Broken |= !C.V->verify(F);
+        C.Broken |= C.V->hasBrokenDebugInfo();
+      });
+  }
+
+  for (const Chunk &C : Chunks)
+    if (C.Broken)
+      return false;
+  for (const Chunk &C : Chunks)
+    V.mergeFunctionState(*C.V);
+  return true;
+}
+
 bool llvm::verifyModule(const Module &M, raw_ostream *OS,
-                        bool *BrokenDebugInfo) {
+                        bool *BrokenDebugInfo, unsigned Threads) {
   // Don't use a raw_null_ostream.  Printing IR is expensive.
   Verifier V(OS, /*ShouldTreatBrokenDebugInfoAsError=*/!BrokenDebugInfo, M);
 
   bool Broken = false;
-  for (const Function &F : M)
-    Broken |= !V.verify(F);
+  if (Threads <= 1 || M.size() < 2 ||
+      !verifyFunctionsConcurrently(V, M, !BrokenDebugInfo, Threads))
+    for (const Function &F : M)
+      Broken |= !V.verify(F);
 
   Broken |= !V.verify();
   if (BrokenDebugInfo)
@@ -4761,7 +4879,8 @@ AnalysisKey VerifierAnalysis::Key;
 VerifierAnalysis::Result VerifierAnalysis::run(Module &M,
                                                ModuleAnalysisManager &) {
   Result Res;
-  Res.IRBroken = llvm::verifyModule(M, &dbgs(), &Res.DebugInfoBroken);
+  Res.IRBroken =
+      llvm::verifyModule(M, &dbgs(), &Res.DebugInfoBroken, VerifyThreads);
   return Res;
 }
 
@@ -28,12 +28,14 @@
 #include "llvm/MC/MCSymbolELF.h"
 #include "llvm/MC/MCValue.h"
 #include "llvm/MC/StringTableBuilder.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Compression.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ELF.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/StringSaver.h"
+#include "llvm/Support/ThreadPool.h"
 #include <vector>
 
 using namespace llvm;
@@ -41,6 +43,10 @@ using namespace llvm;
 #undef  DEBUG_TYPE
 #define DEBUG_TYPE "reloc-info"
 
+static cl::opt<unsigned> RelocationThreads(
+    "elf-relocation-threads", cl::Hidden, cl::init(1),
+    cl::desc("Number of threads used to encode ELF relocation sections"));
+
 namespace {
 typedef DenseMap<const MCSectionELF *, uint32_t> SectionIndexMapTy;
 
@@ -161,11 +167,13 @@ public:
       write32(W);
   }
 
-  template <typename T> void write(T Val) {
+  template <typename T> void write(T Val) { write(getStream(), Val); }
+
+  template <typename T> void write(raw_ostream &OS, T Val) const {
     if (IsLittleEndian)
-      support::endian::Writer<support::little>(getStream()).write(Val);
+      support::endian::Writer<support::little>(OS).write(Val);
     else
-      support::endian::Writer<support::big>(getStream()).write(Val);
+      support::endian::Writer<support::big>(OS).write(Val);
   }
 
   void writeHeader(const MCAssembler &Asm);
@@ -220,7 +228,11 @@ public:
                         uint32_t Link, uint32_t Info, uint64_t Alignment,
                         uint64_t EntrySize);
 
-  void writeRelocations(const MCAssembler &Asm, const MCSectionELF &Sec);
+  void writeRelocations(const MCAssembler &Asm, const MCSectionELF &Sec,
+                        raw_ostream &OS);
+  void writeRelocationSections(const MCAssembler &Asm,
+                               ArrayRef<MCSectionELF *> RelSections,
+                               SectionOffsetsTy &SectionOffsets);
 
   bool isSymbolRefDifferenceFullyResolvedImpl(const MCAssembler &Asm,
                                               const MCSymbol &SymA,
@@ -1082,7 +1094,8 @@ void ELFObjectWriter::WriteSecHdrEntry(uint32_t Name, uint32_t Type,
 }
 
 void ELFObjectWriter::writeRelocations(const MCAssembler &Asm,
-                                       const MCSectionELF &Sec) {
+                                       const MCSectionELF &Sec,
+                                       raw_ostream &OS) {
   std::vector<ELFRelocationEntry> &Relocs = Relocations[&Sec];
 
   // We record relocations by pushing to the end of a vector. Reverse the vector
@@ -1099,31 +1112,78 @@ void ELFObjectWriter::writeRelocations(const MCAssembler &Asm,
     unsigned Index = Entry.Symbol ? Entry.Symbol->getIndex() : 0;
 
     if (is64Bit()) {
-      write(Entry.Offset);
+      write(OS, Entry.Offset);
       if (TargetObjectWriter->isN64()) {
-        write(uint32_t(Index));
+        write(OS, uint32_t(Index));
 
-        write(TargetObjectWriter->getRSsym(Entry.Type));
-        write(TargetObjectWriter->getRType3(Entry.Type));
-        write(TargetObjectWriter->getRType2(Entry.Type));
-        write(TargetObjectWriter->getRType(Entry.Type));
+        write(OS, TargetObjectWriter->getRSsym(Entry.Type));
+        write(OS, TargetObjectWriter->getRType3(Entry.Type));
+        write(OS, TargetObjectWriter->getRType2(Entry.Type));
+        write(OS, TargetObjectWriter->getRType(Entry.Type));
       } else {
         struct ELF::Elf64_Rela ERE64;
         ERE64.setSymbolAndType(Index, Entry.Type);
-        write(ERE64.r_info);
+        write(OS, ERE64.r_info);
       }
       if (hasRelocationAddend())
-        write(Entry.Addend);
+        write(OS, Entry.Addend);
     } else {
-      write(uint32_t(Entry.Offset));
+      write(OS, uint32_t(Entry.Offset));
 
       struct ELF::Elf32_Rela ERE32;
       ERE32.setSymbolAndType(Index, Entry.Type);
-      write(ERE32.r_info);
+      write(OS, ERE32.r_info);
 
       if (hasRelocationAddend())
-        write(uint32_t(Entry.Addend));
+        write(OS, uint32_t(Entry.Addend));
+    }
+  }
+
+  // The entries are no longer needed once they are encoded.
+  std::vector<ELFRelocationEntry>().swap(Relocs);
+}
+
+void ELFObjectWriter::writeRelocationSections(
+    const MCAssembler &Asm, ArrayRef<MCSectionELF *> RelSections,
+    SectionOffsetsTy &SectionOffsets) {
+  if (RelocationThreads <= 1 || RelSections.size() <= 1) {
+    for (MCSectionELF *RelSection : RelSections) {
+      align(RelSection->getAlignment());
+
+      // Remember the offset into the file for this section.
+      uint64_t SecStart = getStream().tell();
+      writeRelocations(Asm, *RelSection->getAssociatedSection(), getStream());
+      uint64_t SecEnd = getStream().tell();
+      SectionOffsets[RelSection] = std::make_pair(SecStart, SecEnd);
     }
+    return;
+  }
+
+  // The symbol indices are final at this point, so each relocation section
+  // can be encoded independently. Look up the relocation vectors up front so
+  // that the map is not modified concurrently, then write the encoded
+  // sections in order so that the output does not depend on the scheduling.
+  std::vector<SmallString<0>> Contents(RelSections.size());
+  for (MCSectionELF *RelSection : RelSections)
+    (void)Relocations[RelSection->getAssociatedSection()];
+  {
+    ThreadPool Pool(std::min<unsigned>(RelocationThreads, RelSections.size()));
+    for (unsigned I = 0, E = RelSections.size(); I != E; ++I)
+      Pool.async([&, I] {
+        raw_svector_ostream OS(Contents[I]);
+        writeRelocations(Asm, *RelSections[I]->getAssociatedSection(), OS);
+      });
+    Pool.wait();
+  }
+
+  for (unsigned I = 0, E = RelSections.size(); I != E; ++I) {
+    align(RelSections[I]->getAlignment());
+
+    uint64_t SecStart = getStream().tell();
+    getStream() << Contents[I];
+    uint64_t SecEnd = getStream().tell();
+    SectionOffsets[RelSections[I]] = std::make_pair(SecStart, SecEnd);
+    SmallString<0>().swap(Contents[I]);
   }
 }
 
@@ -1292,17 +1352,7 @@ void ELFObjectWriter::writeObject(MCAssembler &Asm,
   // Compute symbol table information.
   computeSymbolTable(Asm, Layout, SectionIndexMap, RevGroupMap, SectionOffsets);
 
-  for (MCSectionELF *RelSection : Relocations) {
-    align(RelSection->getAlignment());
-
-    // Remember the offset into the file for this section.
-    uint64_t SecStart = getStream().tell();
-
-    writeRelocations(Asm, *RelSection->getAssociatedSection());
-
-    uint64_t SecEnd = getStream().tell();
-    SectionOffsets[RelSection] = std::make_pair(SecStart, SecEnd);
-  }
+  writeRelocationSections(Asm, Relocations, SectionOffsets);
 
   {
     uint64_t SecStart = getStream().tell();
@@ -970,6 +970,32 @@ Expected<Optional<Archive::Child>> Archive::findSym(StringRef name) const {
   return Optional<Child>();
 }
 
+Expected<Optional<Archive::Child>>
+Archive::findMember(StringRef Name) const {
+  if (!HasMemberIndex) {
+    Error Err = Error::success();
+    for (auto &C : children(Err)) {
+      Expected<StringRef> NameOrErr = C.getName();
+      if (!NameOrErr) {
+        consumeError(std::move(Err));
+        MemberIndex.clear();
+        return NameOrErr.takeError();
+      }
+      MemberIndex.try_emplace(*NameOrErr, C);
+    }
+    if (Err) {
+      MemberIndex.clear();
+      return std::move(Err);
+    }
+    HasMemberIndex = true;
+  }
+
+  auto I = MemberIndex.find(Name);
+  if (I == MemberIndex.end())
+    return Optional<Child>();
+  return I->second;
+}
+
 // Returns true if archive file contains no member file.
 bool Archive::isEmpty() const { return Data.getBufferSize() == 8; }
 
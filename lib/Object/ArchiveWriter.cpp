@@ -23,8 +23,10 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 
 #if !defined(_MSC_VER) && !defined(__MINGW32__)
 #include <unistd.h>
@@ -106,6 +108,35 @@ Expected<NewArchiveMember> NewArchiveMember::getFile(StringRef FileName,
   return std::move(M);
 }
 
+Expected<NewArchiveMember> NewArchiveMember::getLazyFile(StringRef FileName,
+                                                         bool Deterministic) {
+  sys::fs::file_status Status;
+  if (auto EC = sys::fs::status(FileName, Status))
+    return errorCodeToError(EC);
+
+  if (Status.type() == sys::fs::file_type::directory_file)
+    return errorCodeToError(make_error_code(errc::is_a_directory));
+
+  NewArchiveMember M;
+  M.IsNew = true;
+  M.LazyPath = FileName;
+  M.LazySize = Status.getSize();
+  if (!Deterministic) {
+    M.ModTime = std::chrono::time_point_cast<std::chrono::seconds>(
+        Status.getLastModificationTime());
+    M.UID = Status.getUser();
+    M.GID = Status.getGroup();
+    M.Perms = Status.permissions();
+  }
+  return std::move(M);
+}
+
+static ErrorOr<std::unique_ptr<MemoryBuffer>>
+loadLazyMember(const NewArchiveMember &M) {
+  return MemoryBuffer::getFile(M.LazyPath, /*FileSize=*/-1,
+                               /*RequiresNullTerminator=*/false);
+}
+
 template <typename T>
 static void printWithSpacePadding(raw_fd_ostream &OS, T Data, unsigned Size,
                                   bool MayTruncate = false) {
@@ -222,7 +253,7 @@ static void writeStringTable(raw_fd_ostream &Out, StringRef ArcName,
                              bool Thin) {
   unsigned StartOffset = 0;
   for (const NewArchiveMember &M : Members) {
-    StringRef Path = M.Buf->getBufferIdentifier();
+    StringRef Path = M.getPath();
     StringRef Name = sys::path::filename(Path);
     if (!useStringTable(Thin, Name))
       continue;
@@ -237,7 +268,7 @@ static void writeStringTable(raw_fd_ostream &Out, StringRef ArcName,
       if (M.IsNew)
         Out << computeRelativePath(ArcName, Path);
       else
-        Out << M.Buf->getBufferIdentifier();
+        Out << Path;
     } else
       Out << Name;
 
@@ -261,27 +292,80 @@ static sys::TimePoint<std::chrono::seconds> now(bool Deterministic) {
   return sys::TimePoint<seconds>();
 }
 
+namespace {
+/// The symbols that one member adds to the symbol table.
+struct MemberSymbols {
+  /// Whether the member is an object file at all.
+  bool IsSymbolic = false;
+  /// The names of the symbols, each followed by a null byte.
+  std::string Names;
+  std::error_code EC;
+};
+}
+
+static void computeMemberSymbols(const NewArchiveMember &M,
+                                 MemberSymbols &Syms) {
+  std::unique_ptr<MemoryBuffer> LazyBuf;
+  MemoryBufferRef MemberBuffer;
+  if (M.Buf) {
+    MemberBuffer = M.Buf->getMemBufferRef();
+  } else {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> BufOrErr = loadLazyMember(M);
+    if (!BufOrErr) {
+      Syms.EC = BufOrErr.getError();
+      return;
+    }
+    LazyBuf = std::move(*BufOrErr);
+    MemberBuffer = LazyBuf->getMemBufferRef();
+  }
+
+  // Every member gets a context of its own so that members can be read on
+  // different threads.
+  LLVMContext Context;
+  Expected<std::unique_ptr<object::SymbolicFile>> ObjOrErr =
+      object::SymbolicFile::createSymbolicFile(
+          MemberBuffer, sys::fs::file_magic::unknown, &Context);
+  if (!ObjOrErr) {
+    // FIXME: check only for "not an object file" errors.
+    consumeError(ObjOrErr.takeError());
+    return;
+  }
+  object::SymbolicFile &Obj = *ObjOrErr.get();
+  Syms.IsSymbolic = true;
+
+  raw_string_ostream NameOS(Syms.Names);
+  for (const object::BasicSymbolRef &S : Obj.symbols()) {
+    uint32_t Symflags = S.getFlags();
+    if (Symflags & object::SymbolRef::SF_FormatSpecific)
+      continue;
+    if (!(Symflags & object::SymbolRef::SF_Global))
+      continue;
+    if (Symflags & object::SymbolRef::SF_Undefined)
+      continue;
+
+    if (auto EC = S.printName(NameOS)) {
+      Syms.EC = EC;
+      return;
+    }
+    NameOS << '\0';
+  }
+  NameOS.flush();
+}
+
 // Returns the offset of the first reference to a member offset.
-static ErrorOr<unsigned>
-writeSymbolTable(raw_fd_ostream &Out, object::Archive::Kind Kind,
-                 ArrayRef<NewArchiveMember> Members,
-                 std::vector<unsigned> &MemberOffsetRefs, bool Deterministic) {
+static unsigned writeSymbolTable(raw_fd_ostream &Out,
+                                 object::Archive::Kind Kind,
+                                 ArrayRef<MemberSymbols> Symbols,
+                                 std::vector<unsigned> &MemberOffsetRefs,
+                                 bool Deterministic) {
   unsigned HeaderStartOffset = 0;
   unsigned BodyStartOffset = 0;
   SmallString<128> NameBuf;
   raw_svector_ostream NameOS(NameBuf);
-  LLVMContext Context;
-  for (unsigned MemberNum = 0, N = Members.size(); MemberNum < N; ++MemberNum) {
-    MemoryBufferRef MemberBuffer = Members[MemberNum].Buf->getMemBufferRef();
-    Expected<std::unique_ptr<object::SymbolicFile>> ObjOrErr =
-        object::SymbolicFile::createSymbolicFile(
-            MemberBuffer, sys::fs::file_magic::unknown, &Context);
-    if (!ObjOrErr) {
-      // FIXME: check only for "not an object file" errors.
-      consumeError(ObjOrErr.takeError());
+  for (unsigned MemberNum = 0, N = Symbols.size(); MemberNum < N; ++MemberNum) {
+    const MemberSymbols &Syms = Symbols[MemberNum];
+    if (!Syms.IsSymbolic)
       continue;
-    }
-    object::SymbolicFile &Obj = *ObjOrErr.get();
 
     if (!HeaderStartOffset) {
       HeaderStartOffset = Out.tell();
@@ -293,24 +377,16 @@ writeSymbolTable(raw_fd_ostream &Out, object::Archive::Kind Kind,
       print32(Out, Kind, 0); // number of entries or bytes
     }
 
-    for (const object::BasicSymbolRef &S : Obj.symbols()) {
-      uint32_t Symflags = S.getFlags();
-      if (Symflags & object::SymbolRef::SF_FormatSpecific)
-        continue;
-      if (!(Symflags & object::SymbolRef::SF_Global))
-        continue;
-      if (Symflags & object::SymbolRef::SF_Undefined)
-        continue;
-
-      unsigned NameOffset = NameOS.tell();
-      if (auto EC = S.printName(NameOS))
-        return EC;
-      NameOS << '\0';
+    StringRef Names = Syms.Names;
+    unsigned NamesOffset = NameOS.tell();
+    for (size_t Pos = 0; Pos != Names.size();
+         Pos = Names.find('\0', Pos) + 1) {
       MemberOffsetRefs.push_back(MemberNum);
       if (Kind == object::Archive::K_BSD)
-        print32(Out, Kind, NameOffset);
+        print32(Out, Kind, NamesOffset + Pos);
       print32(Out, Kind, 0); // member offset
     }
+    NameOS << Names;
   }
 
   if (HeaderStartOffset == 0)
@@ -350,9 +426,31 @@ llvm::writeArchive(StringRef ArcName,
                    std::vector<NewArchiveMember> &NewMembers,
                    bool WriteSymtab, object::Archive::Kind Kind,
                    bool Deterministic, bool Thin,
-                   std::unique_ptr<MemoryBuffer> OldArchiveBuf) {
+                   std::unique_ptr<MemoryBuffer> OldArchiveBuf,
+                   unsigned NumThreads) {
   assert((!Thin || Kind == object::Archive::K_GNU) &&
          "Only the gnu format has a thin mode");
+
+  // Read the symbols of the members up front, in parallel. This is the only
+  // time the contents of lazily loaded members are needed in a thin archive.
+  std::vector<MemberSymbols> Symbols;
+  if (WriteSymtab) {
+    Symbols.resize(NewMembers.size());
+    if (NumThreads <= 1 || NewMembers.size() <= 1) {
+      for (unsigned I = 0, E = NewMembers.size(); I != E; ++I)
+        computeMemberSymbols(NewMembers[I], Symbols[I]);
+    } else {
+      ThreadPool Pool(std::min<size_t>(NumThreads, NewMembers.size()));
+      for (unsigned I = 0, E = NewMembers.size(); I != E; ++I)
+        Pool.async(computeMemberSymbols, std::cref(NewMembers[I]),
+                   std::ref(Symbols[I]));
+      Pool.wait();
+    }
+    for (unsigned I = 0, E = NewMembers.size(); I != E; ++I)
+      if (Symbols[I].EC)
+        return std::make_pair(NewMembers[I].getPath(), Symbols[I].EC);
+  }
+
   SmallString<128> TmpArchive;
   int TmpArchiveFD;
   if (auto EC = sys::fs::createUniqueFile(ArcName + ".temp-archive-%%%%%%%.a",
@@ -373,13 +471,9 @@ llvm::writeArchive(StringRef ArcName,
   std::vector<sys::fs::file_status> NewMemberStatus;
 
   unsigned MemberReferenceOffset = 0;
-  if (WriteSymtab) {
-    ErrorOr<unsigned> MemberReferenceOffsetOrErr = writeSymbolTable(
-        Out, Kind, NewMembers, MemberOffsetRefs, Deterministic);
-    if (auto EC = MemberReferenceOffsetOrErr.getError())
-      return std::make_pair(ArcName, EC);
-    MemberReferenceOffset = MemberReferenceOffsetOrErr.get();
-  }
+  if (WriteSymtab)
+    MemberReferenceOffset =
+        writeSymbolTable(Out, Kind, Symbols, MemberOffsetRefs, Deterministic);
 
   std::vector<unsigned> StringMapIndexes;
   if (Kind != object::Archive::K_BSD)
@@ -388,18 +482,26 @@ llvm::writeArchive(StringRef ArcName,
   std::vector<unsigned>::iterator StringMapIndexIter = StringMapIndexes.begin();
   std::vector<unsigned> MemberOffset;
   for (const NewArchiveMember &M : NewMembers) {
-    MemoryBufferRef File = M.Buf->getMemBufferRef();
+    // A lazily loaded member is read just for the time it takes to copy it
+    // into the archive.
+    std::unique_ptr<MemoryBuffer> LazyBuf;
+    if (!M.Buf && !Thin) {
+      ErrorOr<std::unique_ptr<MemoryBuffer>> BufOrErr = loadLazyMember(M);
+      if (!BufOrErr)
+        return std::make_pair(M.getPath(), BufOrErr.getError());
+      LazyBuf = std::move(*BufOrErr);
+    }
+    const MemoryBuffer *File = LazyBuf ? LazyBuf.get() : M.Buf.get();
 
     unsigned Pos = Out.tell();
     MemberOffset.push_back(Pos);
 
-    printMemberHeader(Out, Kind, Thin,
-                      sys::path::filename(M.Buf->getBufferIdentifier()),
+    printMemberHeader(Out, Kind, Thin, sys::path::filename(M.getPath()),
                       StringMapIndexIter, M.ModTime, M.UID, M.GID, M.Perms,
-                      M.Buf->getBufferSize());
+                      File ? File->getBufferSize() : M.getSize());
 
     if (!Thin)
-      Out << File.getBuffer();
+      Out << File->getBuffer();
 
     if (Out.tell() % 2)
       Out << '\n';
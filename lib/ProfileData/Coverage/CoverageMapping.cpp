@@ -23,7 +23,9 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
+#include <thread>
 
 using namespace llvm;
 using namespace coverage;
@@ -256,28 +258,136 @@ Expected<std::unique_ptr<CoverageMapping>> CoverageMapping::load(
   return std::move(Coverage);
 }
 
+namespace {
+/// \brief The coverage mapping records of one object file, decoded ahead of
+/// being matched up with the profile.
+struct DecodedObject {
+  /// \brief A CoverageMappingRecord that owns its arrays, as the reader
+  /// reuses its storage for every record.
+  struct Record {
+    StringRef FunctionName;
+    uint64_t FunctionHash;
+    std::vector<StringRef> Filenames;
+    std::vector<CounterExpression> Expressions;
+    std::vector<CounterMappingRegion> MappingRegions;
+  };
+
+  StringRef ObjectFilename;
+  std::unique_ptr<MemoryBuffer> Buffer;
+  std::unique_ptr<BinaryCoverageReader> Reader;
+  std::vector<Record> Records;
+  Error Err;
+
+  DecodedObject(StringRef ObjectFilename)
+      : ObjectFilename(ObjectFilename), Err(Error::success()) {
+    consumeError(std::move(Err));
+  }
+};
+} // end anonymous namespace
+
+/// \brief Read \p Obj's object file and decode all of its coverage mapping
+/// records. This only touches \p Obj, so it can run on any thread.
+static void decodeObject(DecodedObject &Obj, StringRef Arch) {
+  auto CovMappingBufOrErr = MemoryBuffer::getFileOrSTDIN(Obj.ObjectFilename);
+  if (std::error_code EC = CovMappingBufOrErr.getError()) {
+    Obj.Err = errorCodeToError(EC);
+    return;
+  }
+  Obj.Buffer = std::move(CovMappingBufOrErr.get());
+  auto CoverageReaderOrErr = BinaryCoverageReader::create(Obj.Buffer, Arch);
+  if (Error E = CoverageReaderOrErr.takeError()) {
+    Obj.Err = std::move(E);
+    return;
+  }
+  Obj.Reader = std::move(CoverageReaderOrErr.get());
+
+  CoverageMappingRecord Record;
+  while (true) {
+    if (Error E = Obj.Reader->readNextRecord(Record)) {
+      Obj.Err = handleErrors(
+          std::move(E), [](const CoverageMapError &CME) -> Error {
+            if (CME.get() == coveragemap_error::eof)
+              return Error::success();
+            return make_error<CoverageMapError>(CME.get());
+          });
+      return;
+    }
+    Obj.Records.push_back({Record.FunctionName, Record.FunctionHash,
+                           Record.Filenames.vec(), Record.Expressions.vec(),
+                           Record.MappingRegions.vec()});
+  }
+}
+
 Expected<std::unique_ptr<CoverageMapping>>
 CoverageMapping::load(ArrayRef<StringRef> ObjectFilenames,
-                      StringRef ProfileFilename, StringRef Arch) {
+                      StringRef ProfileFilename, StringRef Arch,
+                      unsigned NumThreads) {
   auto ProfileReaderOrErr = IndexedInstrProfReader::create(ProfileFilename);
   if (Error E = ProfileReaderOrErr.takeError())
     return std::move(E);
   auto ProfileReader = std::move(ProfileReaderOrErr.get());
 
-  SmallVector<std::unique_ptr<CoverageMappingReader>, 4> Readers;
-  SmallVector<std::unique_ptr<MemoryBuffer>, 4> Buffers;
-  for (StringRef ObjectFilename : ObjectFilenames) {
-    auto CovMappingBufOrErr = MemoryBuffer::getFileOrSTDIN(ObjectFilename);
-    if (std::error_code EC = CovMappingBufOrErr.getError())
-      return errorCodeToError(EC);
-    auto CoverageReaderOrErr =
-        BinaryCoverageReader::create(CovMappingBufOrErr.get(), Arch);
-    if (Error E = CoverageReaderOrErr.takeError())
-      return std::move(E);
-    Readers.push_back(std::move(CoverageReaderOrErr.get()));
-    Buffers.push_back(std::move(CovMappingBufOrErr.get()));
+  auto Coverage = std::unique_ptr<CoverageMapping>(new CoverageMapping());
+  std::vector<std::unique_ptr<DecodedObject>> Objects;
+  for (StringRef ObjectFilename : ObjectFilenames)
+    Objects.push_back(llvm::make_unique<DecodedObject>(ObjectFilename));
+
+  // Match the decoded records of each object up with the profile, then drop
+  // the object: everything kept in the CoverageMapping is a copy.
+  auto LoadObject = [&](DecodedObject &Obj) -> Error {
+    if (Obj.Err)
+      return std::move(Obj.Err);
+    for (const DecodedObject::Record &R : Obj.Records) {
+      CoverageMappingRecord Record;
+      Record.FunctionName = R.FunctionName;
+      Record.FunctionHash = R.FunctionHash;
+      Record.Filenames = R.Filenames;
+      Record.Expressions = R.Expressions;
+      Record.MappingRegions = R.MappingRegions;
+      if (Error E = Coverage->loadFunctionRecord(Record, *ProfileReader))
+        return E;
+    }
+    return Error::success();
+  };
+
+  if (NumThreads == 0)
+    NumThreads = std::thread::hardware_concurrency();
+  if (NumThreads <= 1 || Objects.size() <= 1) {
+    for (auto &Obj : Objects) {
+      decodeObject(*Obj, Arch);
+      if (Error E = LoadObject(*Obj))
+        return std::move(E);
+      Obj.reset();
+    }
+    return std::move(Coverage);
+  }
+
+  // Decoding an object's coverage mapping depends on nothing but the object,
+  // so the pool decodes the objects that come next while the records of the
+  // current one are looked up in the profile. The lookups still run here,
+  // in the order of the objects, so the same function records are kept as
+  // when loading on one thread. At most NumThreads objects are decoded ahead
+  // to bound memory use.
+  ThreadPool Pool(NumThreads);
+  std::vector<std::shared_future<ThreadPool::VoidTy>> Decoded;
+  Decoded.reserve(Objects.size());
+  for (unsigned I = 0, E = Objects.size(); I != E; ++I) {
+    while (Decoded.size() < E && Decoded.size() <= I + NumThreads) {
+      DecodedObject *Next = Objects[Decoded.size()].get();
+      Decoded.push_back(
+          Pool.async([Next, Arch]() { decodeObject(*Next, Arch); }));
+    }
+    Decoded[I].wait();
+    if (Error Err = LoadObject(*Objects[I])) {
+      // Let the decoding tasks finish before their objects go away.
+      Pool.wait();
+      for (unsigned J = I + 1; J < Decoded.size(); ++J)
+        consumeError(std::move(Objects[J]->Err));
+      return std::move(Err);
+    }
+    Objects[I].reset();
   }
-  return load(Readers, *ProfileReader);
+  return std::move(Coverage);
 }
 
 namespace {
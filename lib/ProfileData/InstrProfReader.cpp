@@ -19,9 +19,10 @@
 using namespace llvm;
 
 static Expected<std::unique_ptr<MemoryBuffer>>
-setupMemoryBuffer(const Twine &Path) {
+setupMemoryBuffer(const Twine &Path, bool RequiresNullTerminator = true) {
   ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
-      MemoryBuffer::getFileOrSTDIN(Path);
+      MemoryBuffer::getFileOrSTDIN(Path, /*FileSize=*/-1,
+                                   RequiresNullTerminator);
   if (std::error_code EC = BufferOrErr.getError())
     return errorCodeToError(EC);
   return std::move(BufferOrErr.get());
@@ -71,8 +72,13 @@ InstrProfReader::create(std::unique_ptr<MemoryBuffer> Buffer) {
 
 Expected<std::unique_ptr<IndexedInstrProfReader>>
 IndexedInstrProfReader::create(const Twine &Path) {
-  // Set up the buffer to read.
-  auto BufferOrError = setupMemoryBuffer(Path);
+  // Set up the buffer to read. The indexed format is looked up in place and
+  // never needs a null terminator. Not asking for one lets the file be mapped
+  // even when its size is a multiple of the page size, so the profile is
+  // never copied onto the heap and its pages are shared with every other
+  // process reading it.
+  auto BufferOrError =
+      setupMemoryBuffer(Path, /*RequiresNullTerminator=*/false);
   if (Error E = BufferOrError.takeError())
     return std::move(E);
   return IndexedInstrProfReader::create(std::move(BufferOrError.get()));
@@ -657,6 +663,11 @@ Error IndexedInstrProfReader::readHeader() {
     return error(instrprof_error::unsupported_hash_type);
 
   uint64_t HashOffset = endian::byte_swap<uint64_t, little>(Header->HashOffset);
+  // The hash table starts with its bucket and entry counts.
+  uint64_t BufferSize = DataBuffer->getBufferSize();
+  if (HashOffset > BufferSize ||
+      BufferSize - HashOffset < 2 * sizeof(uint64_t))
+    return error(instrprof_error::truncated);
 
   // The rest of the file is an on disk hash table.
   InstrProfReaderIndexBase *IndexPtr = nullptr;
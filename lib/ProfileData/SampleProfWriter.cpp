@@ -8,10 +8,12 @@
 //===----------------------------------------------------------------------===//
 //
 // This file implements the class that writes LLVM sample profiles. It
-// supports two file formats: text and binary. The textual representation
-// is useful for debugging and testing purposes. The binary representation
-// is more compact, resulting in smaller file sizes. However, they can
-// both be used interchangeably.
+// supports three file formats: text, binary and compact binary. The textual
+// representation is useful for debugging and testing purposes. The binary
+// representation is more compact, resulting in smaller file sizes. The
+// compact binary representation adds an index of the functions, so that a
+// reader can load only the profiles it needs. They can all be used
+// interchangeably.
 //
 // See lib/ProfileData/SampleProfReader.cpp for documentation on each of the
 // supported formats.
@@ -109,13 +111,27 @@ void SampleProfileWriterBinary::addNames(const FunctionSamples &S) {
   }
 }
 
+std::error_code SampleProfileWriterBinary::writeMagicIdent() {
+  auto &OS = *OutputStream;
+  encodeULEB128(SPMagic(), OS);
+  encodeULEB128(SPVersion(), OS);
+  return sampleprof_error::success;
+}
+
+std::error_code SampleProfileWriterCompactBinary::writeMagicIdent() {
+  auto &OS = *OutputStream;
+  encodeULEB128(SPMagic(SPF_Compact_Binary), OS);
+  encodeULEB128(SPVersion(), OS);
+  return sampleprof_error::success;
+}
+
 std::error_code SampleProfileWriterBinary::writeHeader(
     const StringMap<FunctionSamples> &ProfileMap) {
   auto &OS = *OutputStream;
 
   // Write file magic identifier.
-  encodeULEB128(SPMagic(), OS);
-  encodeULEB128(SPVersion(), OS);
+  if (std::error_code EC = writeMagicIdent())
+    return EC;
 
   computeSummary(ProfileMap);
   if (auto EC = writeSummary())
@@ -200,6 +216,42 @@ std::error_code SampleProfileWriterBinary::write(const FunctionSamples &S) {
   return writeBody(S);
 }
 
+/// \brief Write all the profiles in \p ProfileMap to a compact binary file.
+///
+/// The function bodies are written to a buffer first, to find out where each
+/// one starts, and then put out after the function offset table.
+std::error_code SampleProfileWriterCompactBinary::write(
+    const StringMap<FunctionSamples> &ProfileMap) {
+  if (std::error_code EC = writeHeader(ProfileMap))
+    return EC;
+
+  std::string Bodies;
+  std::vector<std::pair<StringRef, uint64_t>> FuncOffsets;
+  FuncOffsets.reserve(ProfileMap.size());
+  {
+    std::unique_ptr<raw_ostream> BodiesOS(new raw_string_ostream(Bodies));
+    std::swap(OutputStream, BodiesOS);
+    for (const auto &I : ProfileMap) {
+      FuncOffsets.push_back(std::make_pair(I.first(), OutputStream->tell()));
+      if (std::error_code EC = SampleProfileWriterBinary::write(I.second)) {
+        std::swap(OutputStream, BodiesOS);
+        return EC;
+      }
+    }
+    std::swap(OutputStream, BodiesOS);
+  }
+
+  auto &OS = *OutputStream;
+  encodeULEB128(FuncOffsets.size(), OS);
+  for (const auto &Entry : FuncOffsets) {
+    if (std::error_code EC = writeNameIdx(Entry.first))
+      return EC;
+    encodeULEB128(Entry.second, OS);
+  }
+  OS << Bodies;
+  return sampleprof_error::success;
+}
+
 /// \brief Create a sample profile file writer based on the specified format.
 ///
 /// \param Filename The file to create.
@@ -213,7 +265,7 @@ ErrorOr<std::unique_ptr<SampleProfileWriter>>
 SampleProfileWriter::create(StringRef Filename, SampleProfileFormat Format) {
   std::error_code EC;
   std::unique_ptr<raw_ostream> OS;
-  if (Format == SPF_Binary)
+  if (Format == SPF_Binary || Format == SPF_Compact_Binary)
     OS.reset(new raw_fd_ostream(Filename, EC, sys::fs::F_None));
   else
     OS.reset(new raw_fd_ostream(Filename, EC, sys::fs::F_Text));
@@ -240,6 +292,8 @@ SampleProfileWriter::create(std::unique_ptr<raw_ostream> &OS,
 
   if (Format == SPF_Binary)
     Writer.reset(new SampleProfileWriterBinary(OS));
+  else if (Format == SPF_Compact_Binary)
+    Writer.reset(new SampleProfileWriterCompactBinary(OS));
   else if (Format == SPF_Text)
     Writer.reset(new SampleProfileWriterText(OS));
   else if (Format == SPF_GCC)
@@ -0,0 +1,208 @@
+//===--- FlatStringMap.cpp - Group probed string map ----------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the FlatStringMap class.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/FlatStringMap.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/xxhash.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+using namespace llvm;
+
+typedef detail::FlatHashMapGroup Group;
+
+/// Returns the number of buckets needed to hold \p NumEntries entries while
+/// staying at or below the maximum load factor of 7/8.
+static unsigned getMinBucketToReserveForEntries(unsigned NumEntries) {
+  if (NumEntries == 0)
+    return 0;
+  return std::max<unsigned>(Group::Width,
+                            NextPowerOf2((uint64_t)NumEntries * 8 / 7));
+}
+
+/// The top 7 bits of the hash are stored in the control byte, the low bits
+/// select the first group to probe.
+static int8_t tagOf(uint64_t Hash) { return int8_t(Hash >> 57); }
+
+FlatStringMapImpl::FlatStringMapImpl(unsigned InitSize, unsigned ItemSize)
+    : ItemSize(ItemSize) {
+  if (InitSize)
+    init(getMinBucketToReserveForEntries(InitSize));
+}
+
+FlatStringMapImpl::~FlatStringMapImpl() { free(TheTable); }
+
+void FlatStringMapImpl::init(unsigned Size) {
+  assert(isPowerOf2_32(Size) && Size >= Group::Width &&
+         "Size must be a power of two of at least one group");
+  NumBuckets = Size;
+  NumItems = 0;
+  NumDeleted = 0;
+
+  // Lay out the entry pointers (with one extra non-empty sentinel so the
+  // iterators stop at end), then the hashes, then the control bytes.
+  size_t PtrBytes = (Size + 1) * sizeof(StringMapEntryBase *);
+  PtrBytes = alignTo(PtrBytes, alignof(uint64_t));
+  size_t Bytes = PtrBytes + Size * sizeof(uint64_t) + Size;
+  char *Mem = static_cast<char *>(malloc(Bytes));
+
+  TheTable = reinterpret_cast<StringMapEntryBase **>(Mem);
+  Hashes = reinterpret_cast<uint64_t *>(Mem + PtrBytes);
+  Ctrl = reinterpret_cast<int8_t *>(Hashes + Size);
+  resetBuckets();
+  TheTable[Size] = (StringMapEntryBase *)2;
+}
+
+void FlatStringMapImpl::resetBuckets() {
+  std::memset(TheTable, 0, NumBuckets * sizeof(StringMapEntryBase *));
+  std::memset(Ctrl, Group::Empty, NumBuckets);
+  NumItems = 0;
+  NumDeleted = 0;
+}
+
+/// Return the index of the first bucket along the probe sequence of \p Hash
+/// that can receive a new entry. Groups are visited using triangular numbers,
+/// which covers every group of a power-of-two table exactly once.
+unsigned FlatStringMapImpl::findInsertSlot(uint64_t Hash) const {
+  unsigned GroupMask = NumBuckets / Group::Width - 1;
+  unsigned G = unsigned(Hash) & GroupMask;
+  unsigned Step = 0;
+  while (true) {
+    auto M = Group(Ctrl + G * Group::Width).matchEmptyOrDeleted();
+    if (!M.empty())
+      return G * Group::Width + M.first();
+    G = (G + ++Step) & GroupMask;
+  }
+}
+
+int FlatStringMapImpl::FindKey(StringRef Key) const {
+  if (NumBuckets == 0)
+    return -1;
+  return findKey(Key, xxHash64(Key));
+}
+
+int FlatStringMapImpl::findKey(StringRef Key, uint64_t Hash) const {
+  int8_t Tag = tagOf(Hash);
+  unsigned GroupMask = NumBuckets / Group::Width - 1;
+  unsigned G = unsigned(Hash) & GroupMask;
+  unsigned Step = 0;
+  while (true) {
+    unsigned Base = G * Group::Width;
+    Group Grp(Ctrl + Base);
+    for (auto M = Grp.match(Tag); !M.empty(); M.dropFirst()) {
+      // The tag already rules out all but about one in a hundred
+      // non-matching buckets, so go straight to the key rather than also
+      // loading the cached hash from a third array.
+      unsigned Bucket = Base + M.first();
+      StringMapEntryBase *Item = TheTable[Bucket];
+      // Do the comparison like this because Key isn't necessarily
+      // null-terminated!
+      const char *ItemStr = (const char *)Item + ItemSize;
+      if (Key == StringRef(ItemStr, Item->getKeyLength()))
+        return Bucket;
+    }
+    // No key was ever placed beyond a group that still has an empty bucket.
+    if (LLVM_LIKELY(!Grp.matchEmpty().empty()))
+      return -1;
+    G = (G + ++Step) & GroupMask;
+  }
+}
+
+unsigned FlatStringMapImpl::LookupBucketFor(StringRef Name) {
+  uint64_t Hash = xxHash64(Name);
+  if (NumBuckets) {
+    int Existing = findKey(Name, Hash);
+    if (Existing != -1)
+      return Existing;
+  }
+
+  // Deleted buckets lengthen probe sequences like live ones, so they count
+  // against the load factor. When they make up much of it, rehash in place
+  // instead of growing.
+  if (LLVM_UNLIKELY((uint64_t)(NumItems + NumDeleted + 1) * 8 >
+                    (uint64_t)NumBuckets * 7)) {
+    if (NumBuckets == 0)
+      init(Group::Width);
+    else if (NumDeleted > NumBuckets / 4)
+      rehash(NumBuckets);
+    else
+      rehash(NumBuckets * 2);
+  }
+
+  unsigned Bucket = findInsertSlot(Hash);
+  if (Ctrl[Bucket] == Group::Deleted)
+    --NumDeleted;
+  Ctrl[Bucket] = tagOf(Hash);
+  Hashes[Bucket] = Hash;
+  ++NumItems;
+  return Bucket;
+}
+
+void FlatStringMapImpl::eraseBucket(unsigned Bucket) {
+  TheTable[Bucket] = nullptr;
+  // If this group still has an empty bucket, no probe sequence ever went past
+  // it, so the bucket can go back to empty. Otherwise lookups must keep
+  // probing through it.
+  unsigned Base = Bucket - Bucket % Group::Width;
+  if (!Group(Ctrl + Base).matchEmpty().empty()) {
+    Ctrl[Bucket] = Group::Empty;
+  } else {
+    Ctrl[Bucket] = Group::Deleted;
+    ++NumDeleted;
+  }
+  --NumItems;
+}
+
+void FlatStringMapImpl::RemoveKey(StringMapEntryBase *V) {
+  const char *VStr = (char *)V + ItemSize;
+  StringMapEntryBase *V2 = RemoveKey(StringRef(VStr, V->getKeyLength()));
+  (void)V2;
+  assert(V == V2 && "Didn't find key?");
+}
+
+StringMapEntryBase *FlatStringMapImpl::RemoveKey(StringRef Key) {
+  int Bucket = FindKey(Key);
+  if (Bucket == -1)
+    return nullptr;
+
+  StringMapEntryBase *Result = TheTable[Bucket];
+  eraseBucket(Bucket);
+  return Result;
+}
+
+/// Move every entry into a fresh table of \p NewSize buckets, dropping all
+/// deleted markers. The cached hashes mean no key is hashed again.
+void FlatStringMapImpl::rehash(unsigned NewSize) {
+  StringMapEntryBase **OldTable = TheTable;
+  uint64_t *OldHashes = Hashes;
+  int8_t *OldCtrl = Ctrl;
+  unsigned OldNumBuckets = NumBuckets;
+  unsigned OldNumItems = NumItems;
+
+  init(NewSize);
+  for (unsigned I = 0; I != OldNumBuckets; ++I) {
+    if (OldCtrl[I] < 0)
+      continue;
+    uint64_t Hash = OldHashes[I];
+    unsigned Bucket = findInsertSlot(Hash);
+    Ctrl[Bucket] = tagOf(Hash);
+    Hashes[Bucket] = Hash;
+    TheTable[Bucket] = OldTable[I];
+  }
+  NumItems = OldNumItems;
+
+  free(OldTable);
+}
@@ -386,6 +386,120 @@ unsigned AArch64InstrInfo::insertBranch(MachineBasicBlock &MBB,
   return 2;
 }
 
+/// Analyze a loop that is controlled by a trip count register. The count is
+/// decremented by one, and the loop exits once it reaches zero, either by a
+/// compare and branch on zero or by a conditional branch on the flags set by
+/// the decrement. In the latter case, the decrement must be the only
+/// instruction in the loop that sets the flags.
+bool AArch64InstrInfo::analyzeLoop(MachineLoop &L, MachineInstr *&IndVarInst,
+                                   MachineInstr *&CmpInst) const {
+  MachineBasicBlock *LoopBB = L.getBottomBlock();
+  MachineBasicBlock::iterator I = LoopBB->getFirstTerminator();
+  if (I == LoopBB->end())
+    return true;
+  const MachineRegisterInfo &MRI = LoopBB->getParent()->getRegInfo();
+  MachineInstr *IndVar = nullptr;
+  switch (I->getOpcode()) {
+  default:
+    return true;
+  case AArch64::Bcc: {
+    AArch64CC::CondCode CC = (AArch64CC::CondCode)I->getOperand(0).getImm();
+    bool BranchesToLoop = I->getOperand(1).getMBB() == L.getHeader();
+    if (!(CC == AArch64CC::NE && BranchesToLoop) &&
+        !(CC == AArch64CC::EQ && !BranchesToLoop))
+      return true;
+    for (MachineInstr &MI : make_range(LoopBB->begin(), I))
+      if (MI.modifiesRegister(AArch64::NZCV, &RI)) {
+        if (IndVar)
+          return true;
+        IndVar = &MI;
+      }
+    if (!IndVar || (IndVar->getOpcode() != AArch64::SUBSWri &&
+                    IndVar->getOpcode() != AArch64::SUBSXri))
+      return true;
+    break;
+  }
+  case AArch64::CBZW:
+  case AArch64::CBZX:
+  case AArch64::CBNZW:
+  case AArch64::CBNZX: {
+    bool IsCBNZ =
+        I->getOpcode() == AArch64::CBNZW || I->getOpcode() == AArch64::CBNZX;
+    bool BranchesToLoop = I->getOperand(1).getMBB() == L.getHeader();
+    if (IsCBNZ != BranchesToLoop)
+      return true;
+    unsigned Reg = I->getOperand(0).getReg();
+    if (!TargetRegisterInfo::isVirtualRegister(Reg))
+      return true;
+    IndVar = MRI.getVRegDef(Reg);
+    if (!IndVar || IndVar->getParent() != LoopBB)
+      return true;
+    break;
+  }
+  }
+  if (!isDecrementByOne(*IndVar))
+    return true;
+  MachineInstr *Cmp = I->getOpcode() == AArch64::Bcc ? IndVar : &*I;
+
+  // The count must not be used for anything else than controlling the loop.
+  unsigned Count = IndVar->getOperand(0).getReg();
+  unsigned PhiReg = IndVar->getOperand(1).getReg();
+  if (!TargetRegisterInfo::isVirtualRegister(Count) ||
+      !TargetRegisterInfo::isVirtualRegister(PhiReg))
+    return true;
+  MachineInstr *Phi = MRI.getVRegDef(PhiReg);
+  if (!Phi || !Phi->isPHI() || Phi->getParent() != L.getHeader() ||
+      !MRI.hasOneNonDBGUse(PhiReg))
+    return true;
+  if (!onlyControlsLoop(MRI, Count, Phi, Cmp))
+    return true;
+
+  IndVarInst = IndVar;
+  CmpInst = Cmp;
+  return false;
+}
+
+/// Generate a check whether the loop finishes in the prolog block that starts
+/// iteration \p Iter. The loop counts down from the trip count, so the loop
+/// is done if the trip count equals the number of iterations started so far.
+/// Return the trip count register.
+unsigned AArch64InstrInfo::reduceLoopCount(
+    MachineBasicBlock &MBB, MachineInstr *IndVar, MachineInstr &Cmp,
+    SmallVectorImpl<MachineOperand> &Cond,
+    SmallVectorImpl<MachineInstr *> &PrevInsts, unsigned Iter,
+    unsigned MaxIter) const {
+  assert(IndVar && isDecrementByOne(*IndVar) && "Expecting a counted loop");
+  MachineRegisterInfo &MRI = MBB.getParent()->getRegInfo();
+  unsigned PhiReg = IndVar->getOperand(1).getReg();
+  MachineInstr *Phi = MRI.getVRegDef(PhiReg);
+  unsigned TripCount = 0;
+  for (unsigned i = 1, e = Phi->getNumOperands(); i != e; i += 2)
+    if (Phi->getOperand(i + 1).getMBB() != IndVar->getParent())
+      TripCount = Phi->getOperand(i).getReg();
+  assert(TripCount && "Expecting an initial value for the trip count");
+
+  bool Is64Bit = IndVar->getOpcode() == AArch64::SUBXri ||
+                 IndVar->getOpcode() == AArch64::SUBSXri;
+  const TargetRegisterClass *RC =
+      Is64Bit ? &AArch64::GPR64spRegClass : &AArch64::GPR32spRegClass;
+  if (!MRI.constrainRegClass(TripCount, RC)) {
+    unsigned Copy = MRI.createVirtualRegister(RC);
+    BuildMI(&MBB, Cmp.getDebugLoc(), get(TargetOpcode::COPY), Copy)
+        .addReg(TripCount);
+    TripCount = Copy;
+  }
+  unsigned Dead = MRI.createVirtualRegister(Is64Bit ? &AArch64::GPR64RegClass
+                                                    : &AArch64::GPR32RegClass);
+  BuildMI(&MBB, Cmp.getDebugLoc(),
+          get(Is64Bit ? AArch64::SUBSXri : AArch64::SUBSWri))
+      .addReg(Dead, RegState::Define | RegState::Dead)
+      .addReg(TripCount)
+      .addImm(Iter + 1)
+      .addImm(0);
+  Cond.push_back(MachineOperand::CreateImm(AArch64CC::EQ));
+  return TripCount;
+}
+
 // Find the original register that VReg is copied from.
 static unsigned removeCopies(const MachineRegisterInfo &MRI, unsigned VReg) {
   while (TargetRegisterInfo::isVirtualRegister(VReg)) {
@@ -1642,6 +1756,44 @@ bool AArch64InstrInfo::isCandidateToMergeOrPair(MachineInstr &MI) const {
   return true;
 }
 
+/// Return the position of the base and offset operands of a load or store
+/// with a base register and an immediate offset. The pipeliner adds byte
+/// deltas to the offset, so only the unscaled forms qualify; the offset of
+/// the scaled forms counts in units of the access size.
+bool AArch64InstrInfo::getBaseAndOffsetPosition(const MachineInstr &MI,
+                                                unsigned &BasePos,
+                                                unsigned &OffsetPos) const {
+  if (!isUnscaledLdSt(MI.getOpcode()) || MI.getNumExplicitOperands() != 3)
+    return false;
+  if (!MI.getOperand(1).isReg() || !MI.getOperand(2).isImm())
+    return false;
+  BasePos = 1;
+  OffsetPos = 2;
+  return true;
+}
+
+/// If the instruction is an increment of a constant value, return the amount.
+bool AArch64InstrInfo::getIncrementValue(const MachineInstr &MI,
+                                         int &Value) const {
+  switch (MI.getOpcode()) {
+  default:
+    return false;
+  case AArch64::ADDWri:
+  case AArch64::ADDXri:
+  case AArch64::SUBWri:
+  case AArch64::SUBXri:
+  case AArch64::SUBSWri:
+  case AArch64::SUBSXri:
+    break;
+  }
+  if (!MI.getOperand(2).isImm() || MI.getOperand(3).getImm() != 0)
+    return false;
+  Value = MI.getOperand(2).getImm();
+  if (MI.getOpcode() != AArch64::ADDWri && MI.getOpcode() != AArch64::ADDXri)
+    Value = -Value;
+  return true;
+}
+
 bool AArch64InstrInfo::getMemOpBaseRegImmOfs(
     MachineInstr &LdSt, unsigned &BaseReg, int64_t &Offset,
     const TargetRegisterInfo *TRI) const {
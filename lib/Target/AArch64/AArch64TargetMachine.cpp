@@ -125,6 +125,11 @@ static cl::opt<bool>
                            cl::desc("Enable the loop data prefetch pass"),
                            cl::init(true));
 
+static cl::opt<bool>
+    EnableMachinePipeliner("aarch64-enable-pipeliner", cl::Hidden,
+                           cl::desc("Enable the machine pipeliner pass"),
+                           cl::init(false));
+
 extern "C" void LLVMInitializeAArch64Target() {
   // Register the target.
   RegisterTargetMachine<AArch64leTargetMachine> X(getTheAArch64leTarget());
@@ -444,6 +449,10 @@ bool AArch64PassConfig::addILPOpts() {
 }
 
 void AArch64PassConfig::addPreRegAlloc() {
+  // Software pipeline single block loops that count down to zero.
+  if (TM->getOptLevel() != CodeGenOpt::None && EnableMachinePipeliner)
+    addPass(&MachinePipelinerID);
+
   // Change dead register definitions to refer to the zero register.
   if (TM->getOptLevel() != CodeGenOpt::None && EnableDeadRegisterElimination)
     addPass(createAArch64DeadRegisterDefinitions());
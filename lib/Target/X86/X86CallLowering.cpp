@@ -14,12 +14,20 @@
 //===----------------------------------------------------------------------===//
 
 #include "X86CallLowering.h"
+#include "X86CallingConv.h"
 #include "X86ISelLowering.h"
 #include "X86InstrInfo.h"
+#include "X86Subtarget.h"
 #include "llvm/CodeGen/GlobalISel/MachineIRBuilder.h"
+#include "llvm/CodeGen/MachineFrameInfo.h"
+#include "llvm/CodeGen/MachineRegisterInfo.h"
+#include "llvm/IR/Function.h"
+#include "llvm/Target/TargetRegisterInfo.h"
 
 using namespace llvm;
 
+#include "X86GenCallingConv.inc"
+
 #ifndef LLVM_BUILD_GLOBAL_ISEL
 #error "This shouldn't be built without GISel"
 #endif
@@ -27,20 +35,305 @@ using namespace llvm;
 X86CallLowering::X86CallLowering(const X86TargetLowering &TLI)
     : CallLowering(&TLI) {}
 
+bool X86CallLowering::splitToValueTypes(const ArgInfo &OrigArg,
+                                        SmallVectorImpl<ArgInfo> &SplitArgs,
+                                        const DataLayout &DL) const {
+  const X86TargetLowering &TLI = *getTLI<X86TargetLowering>();
+  LLVMContext &Ctx = OrigArg.Ty->getContext();
+
+  // Only values that fit in a single register or stack slot are lowered
+  // here. Aggregates, vectors and wider values fall back to SelectionDAG.
+  if (OrigArg.Flags.isByVal() || OrigArg.Flags.isInAlloca() ||
+      OrigArg.Flags.isSRet() || OrigArg.Flags.isNest() ||
+      OrigArg.Flags.isSwiftError())
+    return false;
+
+  EVT VT = TLI.getValueType(DL, OrigArg.Ty, /*AllowUnknown=*/true);
+  if (!VT.isSimple() || VT.isVector() || VT.getSizeInBits() > 64 ||
+      TLI.getNumRegisters(Ctx, VT) != 1)
+    return false;
+
+  if (VT.isFloatingPoint() && VT != MVT::f32 && VT != MVT::f64)
+    return false;
+
+  // No splitting to do, but we want to replace the original type (e.g.
+  // pointers become pointer-sized integers).
+  SplitArgs.emplace_back(OrigArg.Reg, VT.getTypeForEVT(Ctx), OrigArg.Flags);
+  return true;
+}
+
+namespace {
+struct IncomingValueHandler : public CallLowering::ValueHandler {
+  IncomingValueHandler(MachineIRBuilder &MIRBuilder, MachineRegisterInfo &MRI,
+                       const DataLayout &DL)
+      : ValueHandler(MIRBuilder, MRI), DL(DL) {}
+
+  unsigned getStackAddress(uint64_t Size, int64_t Offset,
+                           MachinePointerInfo &MPO) override {
+    auto &MFI = MIRBuilder.getMF().getFrameInfo();
+    int FI = MFI.CreateFixedObject(Size, Offset, true);
+    MPO = MachinePointerInfo::getFixedStack(MIRBuilder.getMF(), FI);
+    unsigned AddrReg = MRI.createGenericVirtualRegister(
+        LLT::pointer(0, DL.getPointerSizeInBits(0)));
+    MIRBuilder.buildFrameIndex(AddrReg, FI);
+    return AddrReg;
+  }
+
+  void assignValueToReg(unsigned ValVReg, unsigned PhysReg,
+                        CCValAssign &VA) override {
+    markPhysRegUsed(PhysReg);
+
+    // The value was extended to the size of its location by the other side;
+    // copy the whole register and only keep the meaningful low part.
+    unsigned LocSize = VA.getLocVT().getSizeInBits();
+    if (VA.getLocInfo() != CCValAssign::Full &&
+        VA.getLocInfo() != CCValAssign::BCvt &&
+        LocSize > VA.getValVT().getSizeInBits()) {
+      unsigned LocReg = MRI.createGenericVirtualRegister(LLT::scalar(LocSize));
+      MIRBuilder.buildCopy(LocReg, PhysReg);
+      MIRBuilder.buildTrunc(ValVReg, LocReg);
+      return;
+    }
+
+    MIRBuilder.buildCopy(ValVReg, PhysReg);
+  }
+
+  void assignValueToAddress(unsigned ValVReg, unsigned Addr, uint64_t Size,
+                            MachinePointerInfo &MPO, CCValAssign &VA) override {
+    auto MMO = MIRBuilder.getMF().getMachineMemOperand(
+        MPO, MachineMemOperand::MOLoad | MachineMemOperand::MOInvariant, Size,
+        0);
+    MIRBuilder.buildLoad(ValVReg, Addr, *MMO);
+  }
+
+  /// How the physical register gets marked varies between formal
+  /// parameters (it's a basic-block live-in), and a call instruction
+  /// (it's an implicit-def of the CALL).
+  virtual void markPhysRegUsed(unsigned PhysReg) = 0;
+
+  const DataLayout &DL;
+};
+
+struct FormalArgHandler : public IncomingValueHandler {
+  FormalArgHandler(MachineIRBuilder &MIRBuilder, MachineRegisterInfo &MRI,
+                   const DataLayout &DL)
+      : IncomingValueHandler(MIRBuilder, MRI, DL) {}
+
+  void markPhysRegUsed(unsigned PhysReg) override {
+    MIRBuilder.getMBB().addLiveIn(PhysReg);
+  }
+};
+
+struct CallReturnHandler : public IncomingValueHandler {
+  CallReturnHandler(MachineIRBuilder &MIRBuilder, MachineRegisterInfo &MRI,
+                    const DataLayout &DL, MachineInstrBuilder MIB)
+      : IncomingValueHandler(MIRBuilder, MRI, DL), MIB(MIB) {}
+
+  void markPhysRegUsed(unsigned PhysReg) override {
+    MIB.addDef(PhysReg, RegState::Implicit);
+  }
+
+  MachineInstrBuilder MIB;
+};
+
+struct OutgoingValueHandler : public CallLowering::ValueHandler {
+  OutgoingValueHandler(MachineIRBuilder &MIRBuilder, MachineRegisterInfo &MRI,
+                       const DataLayout &DL, MachineInstrBuilder MIB)
+      : ValueHandler(MIRBuilder, MRI), DL(DL), MIB(MIB), StackSize(0) {}
+
+  unsigned getStackAddress(uint64_t Size, int64_t Offset,
+                           MachinePointerInfo &MPO) override {
+    LLT p0 = LLT::pointer(0, DL.getPointerSizeInBits(0));
+    LLT SType = LLT::scalar(DL.getPointerSizeInBits(0));
+    unsigned SPReg = MRI.createGenericVirtualRegister(p0);
+    MIRBuilder.buildCopy(SPReg, X86::RSP);
+
+    unsigned OffsetReg = MRI.createGenericVirtualRegister(SType);
+    MIRBuilder.buildConstant(OffsetReg, Offset);
+
+    unsigned AddrReg = MRI.createGenericVirtualRegister(p0);
+    MIRBuilder.buildGEP(AddrReg, SPReg, OffsetReg);
+
+    MPO = MachinePointerInfo::getStack(MIRBuilder.getMF(), Offset);
+    StackSize = std::max<uint64_t>(StackSize, Offset + Size);
+    return AddrReg;
+  }
+
+  void assignValueToReg(unsigned ValVReg, unsigned PhysReg,
+                        CCValAssign &VA) override {
+    MIB.addUse(PhysReg, RegState::Implicit);
+
+    // The physical register is wider than the value: any-extend it so that
+    // the copy does not mix register sizes.
+    unsigned ExtReg;
+    unsigned LocSize = VA.getLocVT().getSizeInBits();
+    if (VA.getLocInfo() == CCValAssign::AExt &&
+        LocSize > VA.getValVT().getSizeInBits()) {
+      ExtReg = MRI.createGenericVirtualRegister(LLT::scalar(LocSize));
+      MIRBuilder.buildAnyExt(ExtReg, ValVReg);
+    } else
+      ExtReg = extendRegister(ValVReg, VA);
+
+    MIRBuilder.buildCopy(PhysReg, ExtReg);
+  }
+
+  void assignValueToAddress(unsigned ValVReg, unsigned Addr, uint64_t Size,
+                            MachinePointerInfo &MPO, CCValAssign &VA) override {
+    auto MMO = MIRBuilder.getMF().getMachineMemOperand(
+        MPO, MachineMemOperand::MOStore, Size, 0);
+    MIRBuilder.buildStore(ValVReg, Addr, *MMO);
+  }
+
+  const DataLayout &DL;
+  MachineInstrBuilder MIB;
+  /// Number of bytes of outgoing arguments stored on the stack.
+  uint64_t StackSize;
+};
+} // End anonymous namespace.
+
 bool X86CallLowering::lowerReturn(MachineIRBuilder &MIRBuilder,
                                   const Value *Val, unsigned VReg) const {
-  // TODO: handle functions returning non-void values.
-  if (Val)
-    return false;
+  assert(((Val && VReg) || (!Val && !VReg)) && "Return value without a vreg");
 
-  MIRBuilder.buildInstr(X86::RET).addImm(0);
+  auto MIB = MIRBuilder.buildInstrNoInsert(X86::RET).addImm(0);
 
+  if (VReg) {
+    MachineFunction &MF = MIRBuilder.getMF();
+    MachineRegisterInfo &MRI = MF.getRegInfo();
+    const Function &F = *MF.getFunction();
+    auto &DL = MF.getDataLayout();
+
+    // 32-bit targets return floating-point values on the x87 stack, which
+    // is not modelled here; fall back to SelectionDAG.
+    if (!MF.getSubtarget<X86Subtarget>().is64Bit() &&
+        Val->getType()->isFloatingPointTy())
+      return false;
+
+    ArgInfo OrigArg{VReg, Val->getType()};
+    setArgFlags(OrigArg, AttributeSet::ReturnIndex, DL, F);
+
+    SmallVector<ArgInfo, 8> SplitArgs;
+    if (!splitToValueTypes(OrigArg, SplitArgs, DL))
+      return false;
+
+    OutgoingValueHandler Handler(MIRBuilder, MRI, DL, MIB);
+    if (!handleAssignments(MIRBuilder, RetCC_X86, SplitArgs, Handler))
+      return false;
+  }
+
+  MIRBuilder.insertInstr(MIB);
   return true;
 }
 
 bool X86CallLowering::lowerFormalArguments(MachineIRBuilder &MIRBuilder,
                                            const Function &F,
                                            ArrayRef<unsigned> VRegs) const {
-  // TODO: handle functions with one or more arguments.
-  return F.arg_empty();
+  if (F.arg_empty())
+    return true;
+
+  // Variadic functions need a register save area; fall back to SelectionDAG.
+  if (F.isVarArg())
+    return false;
+
+  MachineFunction &MF = MIRBuilder.getMF();
+  MachineRegisterInfo &MRI = MF.getRegInfo();
+  auto &DL = MF.getDataLayout();
+
+  SmallVector<ArgInfo, 8> SplitArgs;
+  unsigned Idx = 0;
+  for (auto &Arg : F.getArgumentList()) {
+    ArgInfo OrigArg(VRegs[Idx], Arg.getType());
+    setArgFlags(OrigArg, Idx + 1, DL, F);
+    if (!splitToValueTypes(OrigArg, SplitArgs, DL))
+      return false;
+    Idx++;
+  }
+
+  MachineBasicBlock &MBB = MIRBuilder.getMBB();
+  if (!MBB.empty())
+    MIRBuilder.setInstr(*MBB.begin());
+
+  FormalArgHandler Handler(MIRBuilder, MRI, DL);
+  if (!handleAssignments(MIRBuilder, CC_X86, SplitArgs, Handler))
+    return false;
+
+  // Move back to the end of the basic block.
+  MIRBuilder.setMBB(MBB);
+
+  return true;
+}
+
+bool X86CallLowering::lowerCall(MachineIRBuilder &MIRBuilder,
+                                const MachineOperand &Callee,
+                                const ArgInfo &OrigRet,
+                                ArrayRef<ArgInfo> OrigArgs) const {
+  MachineFunction &MF = MIRBuilder.getMF();
+  const Function &F = *MF.getFunction();
+  MachineRegisterInfo &MRI = MF.getRegInfo();
+  auto &DL = F.getParent()->getDataLayout();
+  const X86Subtarget &STI = MF.getSubtarget<X86Subtarget>();
+  const TargetInstrInfo &TII = *STI.getInstrInfo();
+  const TargetRegisterInfo *TRI = STI.getRegisterInfo();
+
+  // Only calls following the 64-bit SysV convention are lowered here; the
+  // others fall back to SelectionDAG.
+  if (!STI.isTarget64BitLP64() || STI.isCallingConvWin64(F.getCallingConv()))
+    return false;
+
+  // The locations are assigned with the calling convention and variadic-ness
+  // of the caller, so only accept direct calls where they match the callee.
+  if (!Callee.isGlobal() || F.isVarArg())
+    return false;
+  const Function *CalleeF = dyn_cast<Function>(Callee.getGlobal());
+  if (!CalleeF || CalleeF->isVarArg() ||
+      CalleeF->getCallingConv() != F.getCallingConv())
+    return false;
+
+  SmallVector<ArgInfo, 8> SplitArgs;
+  for (const auto &OrigArg : OrigArgs)
+    if (!splitToValueTypes(OrigArg, SplitArgs, DL))
+      return false;
+
+  // The size of the outgoing argument area is only known once every argument
+  // has been assigned; it is patched into the call frame setup afterwards.
+  auto CallSeqStart =
+      MIRBuilder.buildInstr(TII.getCallFrameSetupOpcode()).addImm(0).addImm(0);
+
+  // Create a temporarily-floating call instruction so we can add the implicit
+  // uses of arg registers.
+  auto MIB = MIRBuilder.buildInstrNoInsert(X86::CALL64pcrel32);
+  MIB.addOperand(Callee);
+
+  // Tell the call which registers are clobbered.
+  MIB.addRegMask(TRI->getCallPreservedMask(MF, F.getCallingConv()));
+
+  // Do the actual argument marshalling.
+  OutgoingValueHandler Handler(MIRBuilder, MRI, DL, MIB);
+  if (!handleAssignments(MIRBuilder, CC_X86, SplitArgs, Handler))
+    return false;
+
+  uint64_t NumBytes = alignTo(Handler.StackSize, 8);
+  CallSeqStart->getOperand(0).setImm(NumBytes);
+
+  // Now we can add the actual call instruction to the correct basic block.
+  MIRBuilder.insertInstr(MIB);
+  MIRBuilder.buildInstr(TII.getCallFrameDestroyOpcode())
+      .addImm(NumBytes)
+      .addImm(0);
+  MF.getFrameInfo().setHasCalls(true);
+
+  // Finally we can copy the returned value back into its virtual-register. In
+  // symmetry with the arguments, the physical register must be an
+  // implicit-define of the call instruction.
+  if (OrigRet.Reg) {
+    SplitArgs.clear();
+    if (!splitToValueTypes(OrigRet, SplitArgs, DL))
+      return false;
+
+    CallReturnHandler Handler(MIRBuilder, MRI, DL, MIB);
+    if (!handleAssignments(MIRBuilder, RetCC_X86, SplitArgs, Handler))
+      return false;
+  }
+
+  return true;
 }
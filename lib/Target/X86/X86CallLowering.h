@@ -20,6 +20,7 @@
 
 namespace llvm {
 
+class DataLayout;
 class Function;
 class MachineIRBuilder;
 class X86TargetLowering;
@@ -34,6 +35,20 @@ public:
 
   bool lowerFormalArguments(MachineIRBuilder &MIRBuilder, const Function &F,
                             ArrayRef<unsigned> VRegs) const override;
+
+  bool lowerCall(MachineIRBuilder &MIRBuilder, const MachineOperand &Callee,
+                 const ArgInfo &OrigRet,
+                 ArrayRef<ArgInfo> OrigArgs) const override;
+
+private:
+  /// Rewrite \p OrigArg into the type the calling convention functions
+  /// expect and append it to \p SplitArgs.
+  ///
+  /// \return False if the value would need to be split over several
+  /// locations or is passed in a way that is not supported yet.
+  bool splitToValueTypes(const ArgInfo &OrigArg,
+                         SmallVectorImpl<ArgInfo> &SplitArgs,
+                         const DataLayout &DL) const;
 };
 } // End of namespace llvm;
 #endif
@@ -5505,6 +5505,83 @@ unsigned X86InstrInfo::insertBranch(MachineBasicBlock &MBB,
   return Count;
 }
 
+/// Analyze a loop that is controlled by a trip count register. The count is
+/// decremented by one and the loop exits once it reaches zero. The decrement
+/// is both the induction variable and the compare, and it must be the last
+/// instruction that sets EFLAGS before the loop branch.
+bool X86InstrInfo::analyzeLoop(MachineLoop &L, MachineInstr *&IndVarInst,
+                               MachineInstr *&CmpInst) const {
+  MachineBasicBlock *LoopBB = L.getBottomBlock();
+  MachineBasicBlock::iterator I = LoopBB->getFirstTerminator();
+  if (I == LoopBB->end())
+    return true;
+  bool BranchesToLoop = I->getOperand(0).isMBB() &&
+                        I->getOperand(0).getMBB() == L.getHeader();
+  if (!(I->getOpcode() == X86::JNE_1 && BranchesToLoop) &&
+      !(I->getOpcode() == X86::JE_1 && !BranchesToLoop))
+    return true;
+
+  MachineInstr *Cmp = nullptr;
+  for (MachineBasicBlock::iterator MII = I; MII != LoopBB->begin();) {
+    --MII;
+    if (MII->modifiesRegister(X86::EFLAGS, &RI)) {
+      Cmp = &*MII;
+      break;
+    }
+  }
+  if (!Cmp || !isDecrementByOne(*Cmp))
+    return true;
+
+  // The count must not be used for anything else than controlling the loop.
+  const MachineRegisterInfo &MRI = LoopBB->getParent()->getRegInfo();
+  unsigned Count = Cmp->getOperand(0).getReg();
+  unsigned PhiReg = Cmp->getOperand(1).getReg();
+  if (!TargetRegisterInfo::isVirtualRegister(Count) ||
+      !TargetRegisterInfo::isVirtualRegister(PhiReg))
+    return true;
+  MachineInstr *Phi = MRI.getVRegDef(PhiReg);
+  if (!Phi || !Phi->isPHI() || Phi->getParent() != L.getHeader() ||
+      !MRI.hasOneNonDBGUse(PhiReg))
+    return true;
+  if (!onlyControlsLoop(MRI, Count, Phi, Cmp))
+    return true;
+
+  IndVarInst = Cmp;
+  CmpInst = Cmp;
+  return false;
+}
+
+/// Generate a check whether the loop finishes in the prolog block that starts
+/// iteration \p Iter. The loop counts down from the trip count, so the loop
+/// is done if the trip count equals the number of iterations started so far.
+/// Return the trip count register.
+unsigned X86InstrInfo::reduceLoopCount(MachineBasicBlock &MBB,
+                                       MachineInstr *IndVar, MachineInstr &Cmp,
+                                       SmallVectorImpl<MachineOperand> &Cond,
+                                       SmallVectorImpl<MachineInstr *> &PrevInsts,
+                                       unsigned Iter, unsigned MaxIter) const {
+  assert(IndVar == &Cmp && "Expecting a counted loop");
+  MachineRegisterInfo &MRI = MBB.getParent()->getRegInfo();
+  MachineInstr *Phi = MRI.getVRegDef(Cmp.getOperand(1).getReg());
+  unsigned TripCount = 0;
+  for (unsigned i = 1, e = Phi->getNumOperands(); i != e; i += 2)
+    if (Phi->getOperand(i + 1).getMBB() != Cmp.getParent())
+      TripCount = Phi->getOperand(i).getReg();
+  assert(TripCount && "Expecting an initial value for the trip count");
+
+  bool Is64Bit = MRI.getRegClass(TripCount)->getSize() == 8;
+  unsigned Opc;
+  if (isInt<8>(Iter + 1))
+    Opc = Is64Bit ? X86::CMP64ri8 : X86::CMP32ri8;
+  else
+    Opc = Is64Bit ? X86::CMP64ri32 : X86::CMP32ri;
+  BuildMI(&MBB, Cmp.getDebugLoc(), get(Opc))
+      .addReg(TripCount)
+      .addImm(Iter + 1);
+  Cond.push_back(MachineOperand::CreateImm(X86::COND_E));
+  return TripCount;
+}
+
 bool X86InstrInfo::
 canInsertSelect(const MachineBasicBlock &MBB,
                 ArrayRef<MachineOperand> Cond,
@@ -5972,6 +6049,60 @@ bool X86InstrInfo::getMemOpBaseRegImmOfs(MachineInstr &MemOp, unsigned &BaseReg,
   return true;
 }
 
+/// Return the position of the base and offset operands of an instruction
+/// with a base register plus displacement memory reference.
+bool X86InstrInfo::getBaseAndOffsetPosition(const MachineInstr &MI,
+                                            unsigned &BasePos,
+                                            unsigned &OffsetPos) const {
+  const MCInstrDesc &Desc = MI.getDesc();
+  int MemRefBegin = X86II::getMemoryOperandNo(Desc.TSFlags);
+  if (MemRefBegin < 0)
+    return false;
+
+  MemRefBegin += X86II::getOperandBias(Desc);
+
+  if (!MI.getOperand(MemRefBegin + X86::AddrBaseReg).isReg() ||
+      MI.getOperand(MemRefBegin + X86::AddrScaleAmt).getImm() != 1 ||
+      MI.getOperand(MemRefBegin + X86::AddrIndexReg).getReg() !=
+          X86::NoRegister ||
+      !MI.getOperand(MemRefBegin + X86::AddrDisp).isImm() ||
+      MI.getOperand(MemRefBegin + X86::AddrSegmentReg).getReg() !=
+          X86::NoRegister)
+    return false;
+
+  BasePos = MemRefBegin + X86::AddrBaseReg;
+  OffsetPos = MemRefBegin + X86::AddrDisp;
+  return true;
+}
+
+/// If the instruction is an increment of a constant value, return the amount.
+bool X86InstrInfo::getIncrementValue(const MachineInstr &MI, int &Value) const {
+  switch (MI.getOpcode()) {
+  default:
+    return false;
+  case X86::DEC32r:
+  case X86::DEC64r:
+    Value = -1;
+    return true;
+  case X86::ADD32ri:
+  case X86::ADD32ri8:
+  case X86::ADD64ri8:
+  case X86::ADD64ri32:
+    if (!MI.getOperand(2).isImm())
+      return false;
+    Value = MI.getOperand(2).getImm();
+    return true;
+  case X86::SUB32ri:
+  case X86::SUB32ri8:
+  case X86::SUB64ri8:
+  case X86::SUB64ri32:
+    if (!MI.getOperand(2).isImm())
+      return false;
+    Value = -MI.getOperand(2).getImm();
+    return true;
+  }
+}
+
 static unsigned getStoreRegOpcode(unsigned SrcReg,
                                   const TargetRegisterClass *RC,
                                   bool isStackAligned,
@@ -0,0 +1,822 @@
+//===- X86InstructionSelector.cpp --------------------------------*- C++ -*-==//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+/// This file implements the targeting of the InstructionSelector class for
+/// X86.
+/// \todo This should be generated by TableGen.
+//===----------------------------------------------------------------------===//
+
+#include "X86InstructionSelector.h"
+#include "X86InstrBuilder.h"
+#include "X86InstrInfo.h"
+#include "X86RegisterBankInfo.h"
+#include "X86RegisterInfo.h"
+#include "X86Subtarget.h"
+#include "X86TargetMachine.h"
+#include "llvm/CodeGen/GlobalISel/RegisterBank.h"
+#include "llvm/CodeGen/MachineBasicBlock.h"
+#include "llvm/CodeGen/MachineFunction.h"
+#include "llvm/CodeGen/MachineInstr.h"
+#include "llvm/CodeGen/MachineInstrBuilder.h"
+#include "llvm/CodeGen/MachineRegisterInfo.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/GlobalValue.h"
+#include "llvm/IR/InstrTypes.h"
+#include "llvm/IR/Type.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+
+#define DEBUG_TYPE "X86-isel"
+
+using namespace llvm;
+
+#ifndef LLVM_BUILD_GLOBAL_ISEL
+#error "You shouldn't build this"
+#endif
+
+X86InstructionSelector::X86InstructionSelector(const X86TargetMachine &TM,
+                                               const X86Subtarget &STI,
+                                               const X86RegisterBankInfo &RBI)
+    : InstructionSelector(), TM(TM), STI(STI), TII(*STI.getInstrInfo()),
+      TRI(*STI.getRegisterInfo()), RBI(RBI) {}
+
+// FIXME: This should be target-independent, inferred from the types declared
+// for each class in the bank.
+const TargetRegisterClass *
+X86InstructionSelector::getRegClass(LLT Ty, const RegisterBank &RB) const {
+  if (RB.getID() == X86::GPRRegBankID) {
+    if (Ty.getSizeInBits() <= 8)
+      return &X86::GR8RegClass;
+    if (Ty.getSizeInBits() == 16)
+      return &X86::GR16RegClass;
+    if (Ty.getSizeInBits() == 32)
+      return &X86::GR32RegClass;
+    if (Ty.getSizeInBits() == 64)
+      return &X86::GR64RegClass;
+    return nullptr;
+  }
+
+  if (RB.getID() == X86::VECRRegBankID) {
+    bool HasAVX512 = STI.hasAVX512();
+    if (Ty.getSizeInBits() == 32)
+      return HasAVX512 ? &X86::FR32XRegClass : &X86::FR32RegClass;
+    if (Ty.getSizeInBits() == 64)
+      return HasAVX512 ? &X86::FR64XRegClass : &X86::FR64RegClass;
+    if (Ty.getSizeInBits() == 128)
+      return HasAVX512 ? &X86::VR128XRegClass : &X86::VR128RegClass;
+    if (Ty.getSizeInBits() == 256)
+      return HasAVX512 ? &X86::VR256XRegClass : &X86::VR256RegClass;
+    if (Ty.getSizeInBits() == 512)
+      return &X86::VR512RegClass;
+  }
+
+  return nullptr;
+}
+
+const TargetRegisterClass *
+X86InstructionSelector::getRegClass(LLT Ty, unsigned Reg,
+                                    MachineRegisterInfo &MRI) const {
+  const RegisterBank &RegBank = *RBI.getRegBank(Reg, MRI, TRI);
+  return getRegClass(Ty, RegBank);
+}
+
+/// Map a generic integer predicate onto the X86 condition code that holds
+/// after a CMP of its two operands.
+static X86::CondCode getX86ConditionCode(CmpInst::Predicate P) {
+  switch (P) {
+  default:
+    llvm_unreachable("Unknown condition code!");
+  case CmpInst::ICMP_EQ:
+    return X86::COND_E;
+  case CmpInst::ICMP_NE:
+    return X86::COND_NE;
+  case CmpInst::ICMP_UGT:
+    return X86::COND_A;
+  case CmpInst::ICMP_UGE:
+    return X86::COND_AE;
+  case CmpInst::ICMP_ULT:
+    return X86::COND_B;
+  case CmpInst::ICMP_ULE:
+    return X86::COND_BE;
+  case CmpInst::ICMP_SGT:
+    return X86::COND_G;
+  case CmpInst::ICMP_SGE:
+    return X86::COND_GE;
+  case CmpInst::ICMP_SLT:
+    return X86::COND_L;
+  case CmpInst::ICMP_SLE:
+    return X86::COND_LE;
+  }
+}
+
+/// Returns true if \p I computes a value without side effects that nobody
+/// uses anymore. This happens to address computations once they have been
+/// folded into the memory operands of their users.
+static bool isTriviallyDead(const MachineInstr &I,
+                            const MachineRegisterInfo &MRI) {
+  switch (I.getOpcode()) {
+  case TargetOpcode::G_CONSTANT:
+  case TargetOpcode::G_FRAME_INDEX:
+  case TargetOpcode::G_GEP:
+  case TargetOpcode::G_GLOBAL_VALUE:
+    return MRI.use_empty(I.getOperand(0).getReg());
+  default:
+    return false;
+  }
+}
+
+bool X86InstructionSelector::selectCopy(MachineInstr &I,
+                                        MachineRegisterInfo &MRI) const {
+
+  unsigned DstReg = I.getOperand(0).getReg();
+  if (TargetRegisterInfo::isPhysicalRegister(DstReg)) {
+    assert(I.isCopy() && "Generic operators do not allow physical registers");
+    return true;
+  }
+
+  // The destination may already have been constrained by one of its users.
+  if (MRI.getRegClassOrNull(DstReg)) {
+    I.setDesc(TII.get(X86::COPY));
+    return true;
+  }
+
+  const RegisterBank &RegBank = *RBI.getRegBank(DstReg, MRI, TRI);
+  const unsigned DstSize = MRI.getType(DstReg).getSizeInBits();
+  unsigned SrcReg = I.getOperand(1).getReg();
+  const unsigned SrcSize = RBI.getSizeInBits(SrcReg, MRI, TRI);
+  (void)SrcSize;
+  assert((!TargetRegisterInfo::isPhysicalRegister(SrcReg) || I.isCopy()) &&
+         "No phys reg on generic operators");
+  assert((DstSize == SrcSize ||
+          // Copies are a mean to setup initial types, the number of
+          // bits may not exactly match.
+          (TargetRegisterInfo::isPhysicalRegister(SrcReg) &&
+           DstSize <= RBI.getSizeInBits(SrcReg, MRI, TRI))) &&
+         "Copy with different width?!");
+
+  const TargetRegisterClass *RC = getRegClass(MRI.getType(DstReg), RegBank);
+  if (!RC) {
+    DEBUG(dbgs() << "Unexpected copy size " << DstSize << '\n');
+    return false;
+  }
+
+  // No need to constrain SrcReg. It will get constrained when
+  // we hit another of its use or its defs.
+  // Copies do not have constraints.
+  if (!RBI.constrainGenericRegister(DstReg, *RC, MRI)) {
+    DEBUG(dbgs() << "Failed to constrain " << TII.getName(I.getOpcode())
+                 << " operand\n");
+    return false;
+  }
+  I.setDesc(TII.get(X86::COPY));
+  return true;
+}
+
+bool X86InstructionSelector::selectDefToRegClass(
+    MachineInstr &I, MachineRegisterInfo &MRI) const {
+  const unsigned DefReg = I.getOperand(0).getReg();
+  if (TargetRegisterInfo::isPhysicalRegister(DefReg) ||
+      MRI.getRegClassOrNull(DefReg))
+    return true;
+
+  const LLT DefTy = MRI.getType(DefReg);
+  if (!DefTy.isValid()) {
+    DEBUG(dbgs() << "Operand has no type, not a gvreg?\n");
+    return false;
+  }
+
+  const TargetRegisterClass *DefRC = getRegClass(DefTy, DefReg, MRI);
+  if (!DefRC) {
+    DEBUG(dbgs() << "Operand has unexpected size/bank\n");
+    return false;
+  }
+  return RBI.constrainGenericRegister(DefReg, *DefRC, MRI);
+}
+
+bool X86InstructionSelector::select(MachineInstr &I) const {
+  assert(I.getParent() && "Instruction should be in a basic block!");
+  assert(I.getParent()->getParent() && "Instruction should be in a function!");
+
+  MachineBasicBlock &MBB = *I.getParent();
+  MachineFunction &MF = *MBB.getParent();
+  MachineRegisterInfo &MRI = MF.getRegInfo();
+
+  unsigned Opcode = I.getOpcode();
+  if (!isPreISelGenericOpcode(Opcode)) {
+    // Certain non-generic instructions also need some special handling.
+
+    if (I.isCopy())
+      return selectCopy(I, MRI);
+
+    if (Opcode == TargetOpcode::PHI || Opcode == TargetOpcode::IMPLICIT_DEF)
+      return selectDefToRegClass(I, MRI);
+
+    return true;
+  }
+
+  if (I.getNumOperands() != I.getNumExplicitOperands()) {
+    DEBUG(dbgs() << "Generic instruction has unexpected implicit operands\n");
+    return false;
+  }
+
+  // Address computations that were folded into all of their users are dropped
+  // instead of being materialized. The value still needs a register class to
+  // keep the post-selection checks happy.
+  if (isTriviallyDead(I, MRI)) {
+    if (!selectDefToRegClass(I, MRI))
+      return false;
+    I.eraseFromParent();
+    return true;
+  }
+
+  switch (Opcode) {
+  case TargetOpcode::G_ADD:
+  case TargetOpcode::G_SUB:
+  case TargetOpcode::G_MUL:
+  case TargetOpcode::G_AND:
+  case TargetOpcode::G_OR:
+  case TargetOpcode::G_XOR:
+    return selectBinaryOp(I, MRI);
+  case TargetOpcode::G_FADD:
+  case TargetOpcode::G_FSUB:
+  case TargetOpcode::G_FMUL:
+  case TargetOpcode::G_FDIV:
+    return selectFPBinaryOp(I, MRI);
+  case TargetOpcode::G_CONSTANT:
+    return selectConstant(I, MRI);
+  case TargetOpcode::G_FRAME_INDEX:
+  case TargetOpcode::G_GEP:
+    return selectFrameIndexOrGep(I, MRI);
+  case TargetOpcode::G_GLOBAL_VALUE:
+    return selectGlobalValue(I, MRI);
+  case TargetOpcode::G_LOAD:
+  case TargetOpcode::G_STORE:
+    return selectLoadStoreOp(I, MRI);
+  case TargetOpcode::G_TRUNC:
+    return selectTrunc(I, MRI);
+  case TargetOpcode::G_ZEXT:
+  case TargetOpcode::G_SEXT:
+  case TargetOpcode::G_ANYEXT:
+    return selectExt(I, MRI);
+  case TargetOpcode::G_PTRTOINT:
+  case TargetOpcode::G_INTTOPTR:
+    // Pointers and integers of the same width share the same registers.
+    return selectCopy(I, MRI);
+  case TargetOpcode::G_ICMP:
+    return selectCmp(I, MRI);
+  case TargetOpcode::G_BRCOND:
+    return selectCondBranch(I, MRI);
+  case TargetOpcode::G_BR:
+    I.setDesc(TII.get(X86::JMP_1));
+    return true;
+  default:
+    return false;
+  }
+}
+
+/// Select the X86 opcode for the generic integer binary operation
+/// \p GenericOpc of \p Size bits, or return \p GenericOpc if there is none.
+static unsigned getBinaryOpcode(unsigned GenericOpc, unsigned Size) {
+  switch (GenericOpc) {
+  case TargetOpcode::G_ADD:
+    switch (Size) {
+    case 8:  return X86::ADD8rr;
+    case 16: return X86::ADD16rr;
+    case 32: return X86::ADD32rr;
+    case 64: return X86::ADD64rr;
+    }
+    break;
+  case TargetOpcode::G_SUB:
+    switch (Size) {
+    case 8:  return X86::SUB8rr;
+    case 16: return X86::SUB16rr;
+    case 32: return X86::SUB32rr;
+    case 64: return X86::SUB64rr;
+    }
+    break;
+  case TargetOpcode::G_MUL:
+    switch (Size) {
+    case 16: return X86::IMUL16rr;
+    case 32: return X86::IMUL32rr;
+    case 64: return X86::IMUL64rr;
+    }
+    break;
+  case TargetOpcode::G_AND:
+    switch (Size) {
+    case 8:  return X86::AND8rr;
+    case 16: return X86::AND16rr;
+    case 32: return X86::AND32rr;
+    case 64: return X86::AND64rr;
+    }
+    break;
+  case TargetOpcode::G_OR:
+    switch (Size) {
+    case 8:  return X86::OR8rr;
+    case 16: return X86::OR16rr;
+    case 32: return X86::OR32rr;
+    case 64: return X86::OR64rr;
+    }
+    break;
+  case TargetOpcode::G_XOR:
+    switch (Size) {
+    case 8:  return X86::XOR8rr;
+    case 16: return X86::XOR16rr;
+    case 32: return X86::XOR32rr;
+    case 64: return X86::XOR64rr;
+    }
+    break;
+  }
+  return GenericOpc;
+}
+
+bool X86InstructionSelector::selectBinaryOp(MachineInstr &I,
+                                            MachineRegisterInfo &MRI) const {
+  const unsigned DefReg = I.getOperand(0).getReg();
+  LLT Ty = MRI.getType(DefReg);
+  const RegisterBank &RB = *RBI.getRegBank(DefReg, MRI, TRI);
+  if (RB.getID() != X86::GPRRegBankID)
+    return false;
+
+  unsigned NewOpc = getBinaryOpcode(I.getOpcode(), Ty.getSizeInBits());
+  if (NewOpc == I.getOpcode())
+    return false;
+
+  // The X86 forms are two-address and clobber EFLAGS: build a fresh
+  // instruction so that the tied operand and the implicit def are added.
+  MachineInstr &NewI = *BuildMI(*I.getParent(), I, I.getDebugLoc(),
+                                TII.get(NewOpc), DefReg)
+                            .addReg(I.getOperand(1).getReg())
+                            .addReg(I.getOperand(2).getReg());
+  I.eraseFromParent();
+  return constrainSelectedInstRegOperands(NewI, TII, TRI, RBI);
+}
+
+/// Select the X86 opcode for the generic floating-point binary operation
+/// \p GenericOpc of \p Size bits, or return \p GenericOpc if there is none.
+static unsigned getFPBinaryOpcode(unsigned GenericOpc, unsigned Size,
+                                  bool HasAVX, bool HasAVX512) {
+  static const unsigned OpcTable[][3][2] = {
+      // SSE             AVX                  AVX-512
+      {{X86::ADDSSrr, X86::ADDSDrr},
+       {X86::VADDSSrr, X86::VADDSDrr},
+       {X86::VADDSSZrr, X86::VADDSDZrr}},
+      {{X86::SUBSSrr, X86::SUBSDrr},
+       {X86::VSUBSSrr, X86::VSUBSDrr},
+       {X86::VSUBSSZrr, X86::VSUBSDZrr}},
+      {{X86::MULSSrr, X86::MULSDrr},
+       {X86::VMULSSrr, X86::VMULSDrr},
+       {X86::VMULSSZrr, X86::VMULSDZrr}},
+      {{X86::DIVSSrr, X86::DIVSDrr},
+       {X86::VDIVSSrr, X86::VDIVSDrr},
+       {X86::VDIVSSZrr, X86::VDIVSDZrr}}};
+
+  unsigned OpIdx;
+  switch (GenericOpc) {
+  case TargetOpcode::G_FADD: OpIdx = 0; break;
+  case TargetOpcode::G_FSUB: OpIdx = 1; break;
+  case TargetOpcode::G_FMUL: OpIdx = 2; break;
+  case TargetOpcode::G_FDIV: OpIdx = 3; break;
+  default:
+    return GenericOpc;
+  }
+
+  if (Size != 32 && Size != 64)
+    return GenericOpc;
+
+  unsigned ISAIdx = HasAVX512 ? 2 : HasAVX ? 1 : 0;
+  return OpcTable[OpIdx][ISAIdx][Size == 64];
+}
+
+bool X86InstructionSelector::selectFPBinaryOp(MachineInstr &I,
+                                              MachineRegisterInfo &MRI) const {
+  const unsigned DefReg = I.getOperand(0).getReg();
+  LLT Ty = MRI.getType(DefReg);
+  const RegisterBank &RB = *RBI.getRegBank(DefReg, MRI, TRI);
+  if (RB.getID() != X86::VECRRegBankID)
+    return false;
+
+  unsigned NewOpc = getFPBinaryOpcode(I.getOpcode(), Ty.getSizeInBits(),
+                                      STI.hasAVX(), STI.hasAVX512());
+  if (NewOpc == I.getOpcode())
+    return false;
+
+  MachineInstr &NewI = *BuildMI(*I.getParent(), I, I.getDebugLoc(),
+                                TII.get(NewOpc), DefReg)
+                            .addReg(I.getOperand(1).getReg())
+                            .addReg(I.getOperand(2).getReg());
+  I.eraseFromParent();
+  return constrainSelectedInstRegOperands(NewI, TII, TRI, RBI);
+}
+
+bool X86InstructionSelector::selectConstant(MachineInstr &I,
+                                            MachineRegisterInfo &MRI) const {
+  const unsigned DefReg = I.getOperand(0).getReg();
+  LLT Ty = MRI.getType(DefReg);
+  if (RBI.getRegBank(DefReg, MRI, TRI)->getID() != X86::GPRRegBankID)
+    return false;
+
+  int64_t Val = 0;
+  if (I.getOperand(1).isCImm()) {
+    Val = I.getOperand(1).getCImm()->getSExtValue();
+    I.getOperand(1).ChangeToImmediate(Val);
+  } else if (I.getOperand(1).isImm()) {
+    Val = I.getOperand(1).getImm();
+  } else
+    return false;
+
+  unsigned NewOpc;
+  switch (Ty.getSizeInBits()) {
+  case 8:
+    NewOpc = X86::MOV8ri;
+    break;
+  case 16:
+    NewOpc = X86::MOV16ri;
+    break;
+  case 32:
+    NewOpc = X86::MOV32ri;
+    break;
+  case 64:
+    // MOV64ri32 sign-extends its immediate; every other value takes the
+    // full ten byte MOV64ri.
+    NewOpc = isInt<32>(Val) ? X86::MOV64ri32 : X86::MOV64ri;
+    break;
+  default:
+    return false;
+  }
+
+  I.setDesc(TII.get(NewOpc));
+  return constrainSelectedInstRegOperands(I, TII, TRI, RBI);
+}
+
+/// Return the LEA opcode computing an address of type \p Ty.
+static unsigned getLeaOP(LLT Ty, const X86Subtarget &STI) {
+  if (Ty == LLT::pointer(0, 64))
+    return X86::LEA64r;
+  if (Ty == LLT::pointer(0, 32))
+    return STI.isTarget64BitILP32() ? X86::LEA64_32r : X86::LEA32r;
+  llvm_unreachable("Can't get LEA opcode. Unsupported type.");
+}
+
+bool X86InstructionSelector::selectFrameIndexOrGep(
+    MachineInstr &I, MachineRegisterInfo &MRI) const {
+  unsigned Opc = I.getOpcode();
+  const unsigned DefReg = I.getOperand(0).getReg();
+  LLT Ty = MRI.getType(DefReg);
+
+  // Use LEA to calculate frame index and GEP
+  unsigned NewOpc = getLeaOP(Ty, STI);
+  I.setDesc(TII.get(NewOpc));
+  MachineInstrBuilder MIB(*I.getParent()->getParent(), I);
+
+  if (Opc == TargetOpcode::G_FRAME_INDEX) {
+    addOffset(MIB, 0);
+  } else {
+    // G_GEP: base, offset -> base, scale 1, index offset, disp 0, no segment.
+    MachineOperand &InxOp = I.getOperand(2);
+    I.addOperand(InxOp);        // set IndexReg
+    InxOp.ChangeToImmediate(1); // set Scale
+    MIB.addImm(0).addReg(0);
+  }
+
+  return constrainSelectedInstRegOperands(I, TII, TRI, RBI);
+}
+
+bool X86InstructionSelector::selectGlobalValue(MachineInstr &I,
+                                               MachineRegisterInfo &MRI) const {
+  const unsigned DefReg = I.getOperand(0).getReg();
+  LLT Ty = MRI.getType(DefReg);
+  const GlobalValue *GV = I.getOperand(1).getGlobal();
+
+  // Thread-local variables need their own access sequences, which are left
+  // to the fallback path.
+  if (GV->isThreadLocal())
+    return false;
+
+  unsigned char OpFlags = STI.classifyGlobalReference(GV);
+  // Only direct references and references through the GOT (%rip relative)
+  // are supported for now; the other flavours need a global base register.
+  if (OpFlags != X86II::MO_NO_FLAG && OpFlags != X86II::MO_GOTPCREL)
+    return false;
+
+  unsigned BaseReg = STI.isPICStyleRIPRel() ? X86::RIP : 0;
+  if (OpFlags == X86II::MO_GOTPCREL && BaseReg != X86::RIP)
+    return false;
+
+  unsigned NewOpc = getLeaOP(Ty, STI);
+  if (OpFlags == X86II::MO_GOTPCREL)
+    NewOpc = Ty.getSizeInBits() == 64 ? X86::MOV64rm : X86::MOV32rm;
+
+  MachineInstrBuilder MIB =
+      BuildMI(*I.getParent(), I, I.getDebugLoc(), TII.get(NewOpc), DefReg)
+          .addReg(BaseReg)
+          .addImm(1)
+          .addReg(0)
+          .addGlobalAddress(GV, 0, OpFlags)
+          .addReg(0);
+  if (OpFlags == X86II::MO_GOTPCREL) {
+    MachineFunction &MF = *I.getParent()->getParent();
+    MIB.addMemOperand(MF.getMachineMemOperand(
+        MachinePointerInfo::getGOT(MF),
+        MachineMemOperand::MOLoad | MachineMemOperand::MOInvariant,
+        Ty.getSizeInBits() / 8, Ty.getSizeInBits() / 8));
+  }
+
+  I.eraseFromParent();
+  return constrainSelectedInstRegOperands(*MIB, TII, TRI, RBI);
+}
+
+unsigned X86InstructionSelector::getLoadStoreOp(LLT &Ty, const RegisterBank &RB,
+                                                unsigned Opc) const {
+  bool Isload = (Opc == TargetOpcode::G_LOAD);
+  bool HasAVX = STI.hasAVX();
+  bool HasAVX512 = STI.hasAVX512();
+
+  if (Ty == LLT::scalar(8)) {
+    if (X86::GPRRegBankID == RB.getID())
+      return Isload ? X86::MOV8rm : X86::MOV8mr;
+  } else if (Ty == LLT::scalar(16)) {
+    if (X86::GPRRegBankID == RB.getID())
+      return Isload ? X86::MOV16rm : X86::MOV16mr;
+  } else if (Ty == LLT::scalar(32) || Ty == LLT::pointer(0, 32)) {
+    if (X86::GPRRegBankID == RB.getID())
+      return Isload ? X86::MOV32rm : X86::MOV32mr;
+    if (X86::VECRRegBankID == RB.getID())
+      return Isload ? (HasAVX512 ? X86::VMOVSSZrm
+                                 : HasAVX ? X86::VMOVSSrm : X86::MOVSSrm)
+                    : (HasAVX512 ? X86::VMOVSSZmr
+                                 : HasAVX ? X86::VMOVSSmr : X86::MOVSSmr);
+  } else if (Ty == LLT::scalar(64) || Ty == LLT::pointer(0, 64)) {
+    if (X86::GPRRegBankID == RB.getID())
+      return Isload ? X86::MOV64rm : X86::MOV64mr;
+    if (X86::VECRRegBankID == RB.getID())
+      return Isload ? (HasAVX512 ? X86::VMOVSDZrm
+                                 : HasAVX ? X86::VMOVSDrm : X86::MOVSDrm)
+                    : (HasAVX512 ? X86::VMOVSDZmr
+                                 : HasAVX ? X86::VMOVSDmr : X86::MOVSDmr);
+  }
+  return Opc;
+}
+
+/// Fill in the address mode for the pointer \p PtrReg. Frame indices and
+/// constant offsets feeding the pointer are folded into the address so that
+/// the instructions computing them are not materialized.
+static void getAddressFromPtr(unsigned PtrReg, const MachineRegisterInfo &MRI,
+                              X86AddressMode &AM) {
+  const MachineInstr *PtrDef = MRI.getVRegDef(PtrReg);
+  if (PtrDef && PtrDef->getOpcode() == TargetOpcode::G_GEP) {
+    const MachineInstr *OffsetDef =
+        MRI.getVRegDef(PtrDef->getOperand(2).getReg());
+    if (OffsetDef && OffsetDef->getOpcode() == TargetOpcode::G_CONSTANT &&
+        OffsetDef->getOperand(1).isCImm()) {
+      int64_t Offset = OffsetDef->getOperand(1).getCImm()->getSExtValue();
+      if (isInt<32>(AM.Disp + Offset)) {
+        AM.Disp += Offset;
+        PtrReg = PtrDef->getOperand(1).getReg();
+        PtrDef = MRI.getVRegDef(PtrReg);
+      }
+    }
+  }
+
+  if (PtrDef && PtrDef->getOpcode() == TargetOpcode::G_FRAME_INDEX) {
+    AM.BaseType = X86AddressMode::FrameIndexBase;
+    AM.Base.FrameIndex = PtrDef->getOperand(1).getIndex();
+    return;
+  }
+
+  AM.Base.Reg = PtrReg;
+}
+
+bool X86InstructionSelector::selectLoadStoreOp(MachineInstr &I,
+                                               MachineRegisterInfo &MRI) const {
+  unsigned Opc = I.getOpcode();
+  const unsigned DefReg = I.getOperand(0).getReg();
+  LLT Ty = MRI.getType(DefReg);
+  const RegisterBank &RB = *RBI.getRegBank(DefReg, MRI, TRI);
+
+  unsigned NewOpc = getLoadStoreOp(Ty, RB, Opc);
+  if (NewOpc == Opc)
+    return false;
+
+  X86AddressMode AM;
+  getAddressFromPtr(I.getOperand(1).getReg(), MRI, AM);
+
+  MachineInstrBuilder MIB =
+      BuildMI(*I.getParent(), I, I.getDebugLoc(), TII.get(NewOpc));
+  if (Opc == TargetOpcode::G_LOAD)
+    MIB.addDef(DefReg);
+  addFullAddress(MIB, AM);
+  if (Opc == TargetOpcode::G_STORE)
+    MIB.addUse(DefReg);
+  MIB.setMemRefs(I.memoperands_begin(), I.memoperands_end());
+
+  I.eraseFromParent();
+  return constrainSelectedInstRegOperands(*MIB, TII, TRI, RBI);
+}
+
+bool X86InstructionSelector::selectTrunc(MachineInstr &I,
+                                         MachineRegisterInfo &MRI) const {
+  const unsigned DstReg = I.getOperand(0).getReg();
+  const unsigned SrcReg = I.getOperand(1).getReg();
+  const LLT DstTy = MRI.getType(DstReg);
+  const LLT SrcTy = MRI.getType(SrcReg);
+
+  const RegisterBank &DstRB = *RBI.getRegBank(DstReg, MRI, TRI);
+  const RegisterBank &SrcRB = *RBI.getRegBank(SrcReg, MRI, TRI);
+  if (DstRB.getID() != SrcRB.getID() || DstRB.getID() != X86::GPRRegBankID) {
+    DEBUG(dbgs() << "G_TRUNC input/output on different banks\n");
+    return false;
+  }
+
+  const TargetRegisterClass *DstRC = getRegClass(DstTy, DstRB);
+  const TargetRegisterClass *SrcRC = getRegClass(SrcTy, SrcRB);
+  if (!DstRC || !SrcRC)
+    return false;
+
+  unsigned SubIdx = 0;
+  if (DstRC != SrcRC) {
+    if (DstRC == &X86::GR8RegClass)
+      SubIdx = X86::sub_8bit;
+    else if (DstRC == &X86::GR16RegClass)
+      SubIdx = X86::sub_16bit;
+    else if (DstRC == &X86::GR32RegClass)
+      SubIdx = X86::sub_32bit;
+    else
+      return false;
+
+    // In 32-bit mode only a few registers have an 8-bit sub-register.
+    SrcRC = TRI.getSubClassWithSubReg(SrcRC, SubIdx);
+    if (!SrcRC)
+      return false;
+  }
+
+  if (!RBI.constrainGenericRegister(SrcReg, *SrcRC, MRI) ||
+      !RBI.constrainGenericRegister(DstReg, *DstRC, MRI)) {
+    DEBUG(dbgs() << "Failed to constrain G_TRUNC\n");
+    return false;
+  }
+
+  I.getOperand(1).setSubReg(SubIdx);
+  I.setDesc(TII.get(X86::COPY));
+  return true;
+}
+
+/// Select the opcode extending a \p SrcSize bit value to \p DstSize bits,
+/// either with zeros or with the sign bit (\p IsSigned).
+static unsigned getExtOpcode(bool IsSigned, unsigned SrcSize,
+                             unsigned DstSize) {
+  if (SrcSize == 8) {
+    switch (DstSize) {
+    case 16: return IsSigned ? X86::MOVSX16rr8 : X86::MOVZX16rr8;
+    case 32: return IsSigned ? X86::MOVSX32rr8 : X86::MOVZX32rr8;
+    case 64: return IsSigned ? X86::MOVSX64rr8 : X86::MOVZX64rr8;
+    }
+  } else if (SrcSize == 16) {
+    switch (DstSize) {
+    case 32: return IsSigned ? X86::MOVSX32rr16 : X86::MOVZX32rr16;
+    case 64: return IsSigned ? X86::MOVSX64rr16 : X86::MOVZX64rr16;
+    }
+  } else if (SrcSize == 32 && DstSize == 64 && IsSigned) {
+    return X86::MOVSX64rr32;
+  }
+  return 0;
+}
+
+bool X86InstructionSelector::selectExt(MachineInstr &I,
+                                       MachineRegisterInfo &MRI) const {
+  const unsigned DstReg = I.getOperand(0).getReg();
+  unsigned SrcReg = I.getOperand(1).getReg();
+  const LLT DstTy = MRI.getType(DstReg);
+  const LLT SrcTy = MRI.getType(SrcReg);
+  MachineBasicBlock &MBB = *I.getParent();
+  const DebugLoc &DL = I.getDebugLoc();
+
+  if (RBI.getRegBank(DstReg, MRI, TRI)->getID() != X86::GPRRegBankID ||
+      RBI.getRegBank(SrcReg, MRI, TRI)->getID() != X86::GPRRegBankID)
+    return false;
+
+  const TargetRegisterClass *DstRC =
+      getRegClass(DstTy, *RBI.getRegBank(DstReg, MRI, TRI));
+  const TargetRegisterClass *SrcRC =
+      getRegClass(SrcTy, *RBI.getRegBank(SrcReg, MRI, TRI));
+  if (!DstRC || !SrcRC || !RBI.constrainGenericRegister(SrcReg, *SrcRC, MRI))
+    return false;
+
+  // Anything will do for the high bits of an any-extension; reuse the
+  // zero-extension which is never more expensive.
+  bool IsSigned = I.getOpcode() == TargetOpcode::G_SEXT;
+  unsigned SrcSize = SrcTy.getSizeInBits();
+  const unsigned DstSize = DstTy.getSizeInBits();
+
+  // An s1 lives in the low bit of a GR8. Clear the garbage above it first
+  // and, for a sign extension, turn the bit into 0 or -1.
+  if (SrcSize == 1) {
+    if (I.getOpcode() != TargetOpcode::G_ANYEXT) {
+      unsigned Masked = MRI.createVirtualRegister(&X86::GR8RegClass);
+      BuildMI(MBB, I, DL, TII.get(X86::AND8ri), Masked)
+          .addReg(SrcReg)
+          .addImm(1);
+      SrcReg = Masked;
+      if (IsSigned) {
+        unsigned Negated = MRI.createVirtualRegister(&X86::GR8RegClass);
+        BuildMI(MBB, I, DL, TII.get(X86::NEG8r), Negated).addReg(SrcReg);
+        SrcReg = Negated;
+      }
+    }
+    SrcSize = 8;
+  }
+
+  if (SrcSize == DstSize) {
+    BuildMI(MBB, I, DL, TII.get(X86::COPY), DstReg).addReg(SrcReg);
+    I.eraseFromParent();
+    return RBI.constrainGenericRegister(DstReg, *DstRC, MRI);
+  }
+
+  // Writing a 32-bit register implicitly zeroes the upper half of its 64-bit
+  // super-register.
+  if (!IsSigned && SrcSize == 32 && DstSize == 64) {
+    unsigned Tmp = MRI.createVirtualRegister(&X86::GR32RegClass);
+    BuildMI(MBB, I, DL, TII.get(X86::MOV32rr), Tmp).addReg(SrcReg);
+    BuildMI(MBB, I, DL, TII.get(X86::SUBREG_TO_REG), DstReg)
+        .addImm(0)
+        .addReg(Tmp)
+        .addImm(X86::sub_32bit);
+    I.eraseFromParent();
+    return RBI.constrainGenericRegister(DstReg, *DstRC, MRI);
+  }
+
+  unsigned NewOpc = getExtOpcode(IsSigned, SrcSize, DstSize);
+  if (!NewOpc)
+    return false;
+
+  MachineInstr &NewI =
+      *BuildMI(MBB, I, DL, TII.get(NewOpc), DstReg).addReg(SrcReg);
+  I.eraseFromParent();
+  return constrainSelectedInstRegOperands(NewI, TII, TRI, RBI);
+}
+
+bool X86InstructionSelector::selectCmp(MachineInstr &I,
+                                       MachineRegisterInfo &MRI) const {
+  const unsigned DstReg = I.getOperand(0).getReg();
+  const unsigned LHSReg = I.getOperand(2).getReg();
+  const unsigned RHSReg = I.getOperand(3).getReg();
+  MachineBasicBlock &MBB = *I.getParent();
+  const DebugLoc &DL = I.getDebugLoc();
+
+  if (RBI.getRegBank(LHSReg, MRI, TRI)->getID() != X86::GPRRegBankID)
+    return false;
+
+  unsigned CmpOpc;
+  switch (MRI.getType(LHSReg).getSizeInBits()) {
+  case 8:
+    CmpOpc = X86::CMP8rr;
+    break;
+  case 16:
+    CmpOpc = X86::CMP16rr;
+    break;
+  case 32:
+    CmpOpc = X86::CMP32rr;
+    break;
+  case 64:
+    CmpOpc = X86::CMP64rr;
+    break;
+  default:
+    return false;
+  }
+
+  X86::CondCode CC = getX86ConditionCode(
+      static_cast<CmpInst::Predicate>(I.getOperand(1).getPredicate()));
+
+  MachineInstr &CmpI =
+      *BuildMI(MBB, I, DL, TII.get(CmpOpc)).addReg(LHSReg).addReg(RHSReg);
+  MachineInstr &SetI =
+      *BuildMI(MBB, I, DL, TII.get(X86::getSETFromCond(CC)), DstReg);
+
+  I.eraseFromParent();
+  return constrainSelectedInstRegOperands(CmpI, TII, TRI, RBI) &&
+         constrainSelectedInstRegOperands(SetI, TII, TRI, RBI);
+}
+
+bool X86InstructionSelector::selectCondBranch(MachineInstr &I,
+                                              MachineRegisterInfo &MRI) const {
+  const unsigned CondReg = I.getOperand(0).getReg();
+  MachineBasicBlock *DestMBB = I.getOperand(1).getMBB();
+  MachineBasicBlock &MBB = *I.getParent();
+  const DebugLoc &DL = I.getDebugLoc();
+
+  if (RBI.getRegBank(CondReg, MRI, TRI)->getID() != X86::GPRRegBankID)
+    return false;
+
+  // Only the low bit of the condition is meaningful.
+  MachineInstr &TestI =
+      *BuildMI(MBB, I, DL, TII.get(X86::TEST8ri)).addReg(CondReg).addImm(1);
+  BuildMI(MBB, I, DL, TII.get(X86::JNE_1)).addMBB(DestMBB);
+
+  I.eraseFromParent();
+  return constrainSelectedInstRegOperands(TestI, TII, TRI, RBI);
+}
@@ -0,0 +1,69 @@
+//===- X86InstructionSelector ------------------------------------*- C++ -*-==//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+/// This file declares the targeting of the InstructionSelector class for X86.
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_LIB_TARGET_X86_X86INSTRUCTIONSELECTOR_H
+#define LLVM_LIB_TARGET_X86_X86INSTRUCTIONSELECTOR_H
+
+#include "llvm/CodeGen/GlobalISel/InstructionSelector.h"
+#include "llvm/Support/DataTypes.h"
+
+namespace llvm {
+
+class X86InstrInfo;
+class X86RegisterBankInfo;
+class X86RegisterInfo;
+class X86Subtarget;
+class X86TargetMachine;
+class LLT;
+class RegisterBank;
+class MachineRegisterInfo;
+class MachineFunction;
+class TargetRegisterClass;
+
+class X86InstructionSelector : public InstructionSelector {
+public:
+  X86InstructionSelector(const X86TargetMachine &TM, const X86Subtarget &STI,
+                         const X86RegisterBankInfo &RBI);
+
+  bool select(MachineInstr &I) const override;
+
+private:
+  /// Return the register class used to hold a value of type \p Ty on
+  /// register bank \p RB, or nullptr if there is none.
+  const TargetRegisterClass *getRegClass(LLT Ty, const RegisterBank &RB) const;
+  const TargetRegisterClass *getRegClass(LLT Ty, unsigned Reg,
+                                         MachineRegisterInfo &MRI) const;
+
+  unsigned getLoadStoreOp(LLT &Ty, const RegisterBank &RB, unsigned Opc) const;
+
+  bool selectCopy(MachineInstr &I, MachineRegisterInfo &MRI) const;
+  bool selectDefToRegClass(MachineInstr &I, MachineRegisterInfo &MRI) const;
+  bool selectBinaryOp(MachineInstr &I, MachineRegisterInfo &MRI) const;
+  bool selectFPBinaryOp(MachineInstr &I, MachineRegisterInfo &MRI) const;
+  bool selectConstant(MachineInstr &I, MachineRegisterInfo &MRI) const;
+  bool selectFrameIndexOrGep(MachineInstr &I, MachineRegisterInfo &MRI) const;
+  bool selectGlobalValue(MachineInstr &I, MachineRegisterInfo &MRI) const;
+  bool selectLoadStoreOp(MachineInstr &I, MachineRegisterInfo &MRI) const;
+  bool selectTrunc(MachineInstr &I, MachineRegisterInfo &MRI) const;
+  bool selectExt(MachineInstr &I, MachineRegisterInfo &MRI) const;
+  bool selectCmp(MachineInstr &I, MachineRegisterInfo &MRI) const;
+  bool selectCondBranch(MachineInstr &I, MachineRegisterInfo &MRI) const;
+
+  const X86TargetMachine &TM;
+  const X86Subtarget &STI;
+  const X86InstrInfo &TII;
+  const X86RegisterInfo &TRI;
+  const X86RegisterBankInfo &RBI;
+};
+
+} // End llvm namespace.
+#endif
@@ -0,0 +1,187 @@
+//===- X86LegalizerInfo.cpp --------------------------------------*- C++ -*-==//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+/// This file implements the targeting of the Machinelegalizer class for X86.
+/// \todo This should be generated by TableGen.
+//===----------------------------------------------------------------------===//
+
+#include "X86LegalizerInfo.h"
+#include "X86Subtarget.h"
+#include "llvm/CodeGen/ValueTypes.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Type.h"
+#include "llvm/Target/TargetOpcodes.h"
+
+using namespace llvm;
+using namespace TargetOpcode;
+
+#ifndef LLVM_BUILD_GLOBAL_ISEL
+#error "You shouldn't build this"
+#endif
+
+X86LegalizerInfo::X86LegalizerInfo(const X86Subtarget &STI)
+    : Subtarget(STI) {
+
+  setLegalizerInfo32bit();
+  setLegalizerInfo64bit();
+  setLegalizerInfoSSE1();
+  setLegalizerInfoSSE2();
+
+  computeTables();
+}
+
+void X86LegalizerInfo::setLegalizerInfo32bit() {
+  const LLT p0 = LLT::pointer(0, Subtarget.isTarget64BitLP64() ? 64 : 32);
+  const LLT s1 = LLT::scalar(1);
+  const LLT s8 = LLT::scalar(8);
+  const LLT s16 = LLT::scalar(16);
+  const LLT s32 = LLT::scalar(32);
+
+  for (auto BinOp : {G_ADD, G_SUB, G_AND, G_OR, G_XOR}) {
+    for (auto Ty : {s8, s16, s32})
+      setAction({BinOp, Ty}, Legal);
+
+    setAction({BinOp, s1}, WidenScalar);
+  }
+
+  // There is no two-address 8-bit multiply, do it on 16 bits.
+  for (auto Ty : {s16, s32})
+    setAction({G_MUL, Ty}, Legal);
+
+  for (auto Ty : {s1, s8})
+    setAction({G_MUL, Ty}, WidenScalar);
+
+  for (auto MemOp : {G_LOAD, G_STORE}) {
+    for (auto Ty : {s8, s16, s32, p0})
+      setAction({MemOp, Ty}, Legal);
+
+    setAction({MemOp, s1}, WidenScalar);
+
+    // And everything's fine in addrspace 0.
+    setAction({MemOp, 1, p0}, Legal);
+  }
+
+  // Pointer-handling
+  setAction({G_FRAME_INDEX, p0}, Legal);
+  setAction({G_GLOBAL_VALUE, p0}, Legal);
+
+  setAction({G_GEP, p0}, Legal);
+  if (!Subtarget.isTarget64BitLP64()) {
+    setAction({G_GEP, 1, s32}, Legal);
+    for (auto Ty : {s1, s8, s16})
+      setAction({G_GEP, 1, Ty}, WidenScalar);
+  }
+
+  // Constants
+  for (auto Ty : {s8, s16, s32, p0})
+    setAction({G_CONSTANT, Ty}, Legal);
+
+  setAction({G_CONSTANT, s1}, WidenScalar);
+
+  // Comparisons
+  setAction({G_ICMP, s1}, Legal);
+  for (auto Ty : {s8, s16, s32, p0})
+    setAction({G_ICMP, 1, Ty}, Legal);
+
+  setAction({G_ICMP, 1, s1}, WidenScalar);
+
+  // Extensions
+  for (auto Ty : {s8, s16, s32}) {
+    setAction({G_ZEXT, Ty}, Legal);
+    setAction({G_SEXT, Ty}, Legal);
+    setAction({G_ANYEXT, Ty}, Legal);
+  }
+
+  for (auto Ty : {s1, s8, s16}) {
+    setAction({G_ZEXT, 1, Ty}, Legal);
+    setAction({G_SEXT, 1, Ty}, Legal);
+    setAction({G_ANYEXT, 1, Ty}, Legal);
+  }
+
+  // Truncations
+  for (auto Ty : {s1, s8, s16})
+    setAction({G_TRUNC, Ty}, Legal);
+
+  for (auto Ty : {s8, s16, s32})
+    setAction({G_TRUNC, 1, Ty}, Legal);
+
+  // Control-flow
+  setAction({G_BRCOND, s1}, Legal);
+}
+
+void X86LegalizerInfo::setLegalizerInfo64bit() {
+
+  if (!Subtarget.is64Bit())
+    return;
+
+  const LLT p0 = LLT::pointer(0, Subtarget.isTarget64BitLP64() ? 64 : 32);
+  const LLT s1 = LLT::scalar(1);
+  const LLT s8 = LLT::scalar(8);
+  const LLT s16 = LLT::scalar(16);
+  const LLT s32 = LLT::scalar(32);
+  const LLT s64 = LLT::scalar(64);
+
+  for (auto BinOp : {G_ADD, G_SUB, G_MUL, G_AND, G_OR, G_XOR})
+    setAction({BinOp, s64}, Legal);
+
+  for (auto MemOp : {G_LOAD, G_STORE})
+    setAction({MemOp, s64}, Legal);
+
+  if (Subtarget.isTarget64BitLP64()) {
+    setAction({G_GEP, 1, s64}, Legal);
+    for (auto Ty : {s1, s8, s16, s32})
+      setAction({G_GEP, 1, Ty}, WidenScalar);
+
+    // Pointers and their integer representation only differ by type.
+    setAction({G_PTRTOINT, s64}, Legal);
+    setAction({G_PTRTOINT, 1, p0}, Legal);
+    setAction({G_INTTOPTR, p0}, Legal);
+    setAction({G_INTTOPTR, 1, s64}, Legal);
+  } else {
+    setAction({G_GEP, 1, s32}, Legal);
+    for (auto Ty : {s1, s8, s16})
+      setAction({G_GEP, 1, Ty}, WidenScalar);
+  }
+
+  // Constants
+  setAction({G_CONSTANT, s64}, Legal);
+
+  // Comparisons
+  setAction({G_ICMP, 1, s64}, Legal);
+
+  // Extensions
+  for (auto ExtOp : {G_ZEXT, G_SEXT, G_ANYEXT}) {
+    setAction({ExtOp, s64}, Legal);
+    setAction({ExtOp, 1, s32}, Legal);
+  }
+
+  // Truncations
+  setAction({G_TRUNC, s32}, Legal);
+  setAction({G_TRUNC, 1, s64}, Legal);
+}
+
+void X86LegalizerInfo::setLegalizerInfoSSE1() {
+  if (!Subtarget.hasSSE1())
+    return;
+
+  const LLT s32 = LLT::scalar(32);
+
+  for (auto BinOp : {G_FADD, G_FSUB, G_FMUL, G_FDIV})
+    setAction({BinOp, s32}, Legal);
+}
+
+void X86LegalizerInfo::setLegalizerInfoSSE2() {
+  if (!Subtarget.hasSSE2())
+    return;
+
+  const LLT s64 = LLT::scalar(64);
+
+  for (auto BinOp : {G_FADD, G_FSUB, G_FMUL, G_FDIV})
+    setAction({BinOp, s64}, Legal);
+}
@@ -0,0 +1,217 @@
+//===- X86RegisterBankInfo.cpp -----------------------------------*- C++ -*-==//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+/// This file implements the targeting of the RegisterBankInfo class for X86.
+/// \todo This should be generated by TableGen.
+//===----------------------------------------------------------------------===//
+
+#include "X86RegisterBankInfo.h"
+#include "X86InstrInfo.h"
+#include "llvm/CodeGen/GlobalISel/RegisterBank.h"
+#include "llvm/CodeGen/GlobalISel/RegisterBankInfo.h"
+#include "llvm/CodeGen/MachineRegisterInfo.h"
+#include "llvm/Target/TargetRegisterInfo.h"
+
+// This file will be TableGen'ed at some point.
+#include "X86GenRegisterBankInfo.def"
+
+using namespace llvm;
+
+#ifndef LLVM_BUILD_GLOBAL_ISEL
+#error "You shouldn't build this"
+#endif
+
+X86RegisterBankInfo::X86RegisterBankInfo(const TargetRegisterInfo &TRI)
+    : RegisterBankInfo(X86::RegBanks, X86::NumRegisterBanks) {
+  static bool AlreadyInit = false;
+  // We have only one set of register banks, whatever the subtarget
+  // is. Therefore, the initialization of the RegBanks table should be
+  // done only once. Indeed the table of all register banks
+  // (X86::RegBanks) is unique in the compiler. At some point, it
+  // will get tablegen'ed and the whole constructor becomes empty.
+  if (AlreadyInit)
+    return;
+  AlreadyInit = true;
+
+  // Initialize the GPR bank.
+  createRegisterBank(X86::GPRRegBankID, "GPR");
+  // The GPR register bank is fully defined by all the registers in
+  // GR64 + its subclasses and sub-register classes.
+  addRegBankCoverage(X86::GPRRegBankID, X86::GR64RegClassID, TRI);
+  const RegisterBank &RBGPR = getRegBank(X86::GPRRegBankID);
+  (void)RBGPR;
+  assert(&X86::GPRRegBank == &RBGPR && "The order in RegBanks is messed up");
+  assert(RBGPR.covers(*TRI.getRegClass(X86::GR32RegClassID)) &&
+         "Subclass not added?");
+  assert(RBGPR.covers(*TRI.getRegClass(X86::GR8RegClassID)) &&
+         "Subclass not added?");
+  assert(RBGPR.getSize() == 64 && "GPRs should hold up to 64-bit");
+
+  // Initialize the VECR bank.
+  createRegisterBank(X86::VECRRegBankID, "VECR");
+  // The VECR register bank is defined by the zmm registers and all the
+  // classes that alias their low lanes, including the scalar FP ones.
+  addRegBankCoverage(X86::VECRRegBankID, X86::VR512RegClassID, TRI);
+  addRegBankCoverage(X86::VECRRegBankID, X86::FR32XRegClassID, TRI);
+  addRegBankCoverage(X86::VECRRegBankID, X86::FR64XRegClassID, TRI);
+  const RegisterBank &RBVECR = getRegBank(X86::VECRRegBankID);
+  (void)RBVECR;
+  assert(&X86::VECRRegBank == &RBVECR && "The order in RegBanks is messed up");
+  assert(RBVECR.covers(*TRI.getRegClass(X86::VR128RegClassID)) &&
+         "Subclass not added?");
+  assert(RBVECR.covers(*TRI.getRegClass(X86::FR32RegClassID)) &&
+         "Subclass not added?");
+  assert(RBVECR.getSize() == 512 && "VECRs should hold up to 512-bit");
+
+  // Check that the TableGen'ed like file is in sync we our expectations.
+#define CHECK_PARTIALMAP(Idx, ValStartIdx, ValLength, RB)                      \
+  do {                                                                         \
+    const PartialMapping &Map = X86::PartMappings[X86::Idx];                   \
+    (void)Map;                                                                 \
+    assert(Map.StartIdx == ValStartIdx && Map.Length == ValLength &&           \
+           Map.RegBank == &RB && #Idx " is incorrectly initialized");          \
+  } while (0)
+
+  CHECK_PARTIALMAP(PMI_GPR8, 0, 8, RBGPR);
+  CHECK_PARTIALMAP(PMI_GPR16, 0, 16, RBGPR);
+  CHECK_PARTIALMAP(PMI_GPR32, 0, 32, RBGPR);
+  CHECK_PARTIALMAP(PMI_GPR64, 0, 64, RBGPR);
+  CHECK_PARTIALMAP(PMI_FP32, 0, 32, RBVECR);
+  CHECK_PARTIALMAP(PMI_FP64, 0, 64, RBVECR);
+  CHECK_PARTIALMAP(PMI_VEC128, 0, 128, RBVECR);
+  CHECK_PARTIALMAP(PMI_VEC256, 0, 256, RBVECR);
+  CHECK_PARTIALMAP(PMI_VEC512, 0, 512, RBVECR);
+#undef CHECK_PARTIALMAP
+}
+
+const RegisterBank &X86RegisterBankInfo::getRegBankFromRegClass(
+    const TargetRegisterClass &RC) const {
+  if (X86::GR8RegClass.hasSubClassEq(&RC) ||
+      X86::GR16RegClass.hasSubClassEq(&RC) ||
+      X86::GR32RegClass.hasSubClassEq(&RC) ||
+      X86::GR64RegClass.hasSubClassEq(&RC) ||
+      X86::LOW32_ADDR_ACCESSRegClass.hasSubClassEq(&RC) ||
+      X86::LOW32_ADDR_ACCESS_RBPRegClass.hasSubClassEq(&RC))
+    return getRegBank(X86::GPRRegBankID);
+
+  if (X86::FR32XRegClass.hasSubClassEq(&RC) ||
+      X86::FR64XRegClass.hasSubClassEq(&RC) ||
+      X86::VR128XRegClass.hasSubClassEq(&RC) ||
+      X86::VR256XRegClass.hasSubClassEq(&RC) ||
+      X86::VR512RegClass.hasSubClassEq(&RC))
+    return getRegBank(X86::VECRRegBankID);
+
+  llvm_unreachable("Register class not supported");
+}
+
+/// Returns whether opcode \p Opc is a pre-isel generic floating-point opcode,
+/// having only floating-point operands.
+static bool isPreISelGenericFloatingPointOpcode(unsigned Opc) {
+  switch (Opc) {
+  case TargetOpcode::G_FADD:
+  case TargetOpcode::G_FSUB:
+  case TargetOpcode::G_FMUL:
+  case TargetOpcode::G_FDIV:
+  case TargetOpcode::G_FCONSTANT:
+  case TargetOpcode::G_FPEXT:
+  case TargetOpcode::G_FPTRUNC:
+    return true;
+  }
+  return false;
+}
+
+RegisterBankInfo::InstructionMapping
+X86RegisterBankInfo::getSameOperandsMapping(const MachineInstr &MI, bool IsFP) {
+  const MachineFunction &MF = *MI.getParent()->getParent();
+  const MachineRegisterInfo &MRI = MF.getRegInfo();
+
+  unsigned NumOperands = MI.getNumOperands();
+  LLT Ty = MRI.getType(MI.getOperand(0).getReg());
+
+  if (NumOperands != 3 || (Ty != MRI.getType(MI.getOperand(1).getReg())) ||
+      (Ty != MRI.getType(MI.getOperand(2).getReg())))
+    llvm_unreachable("Unsupported operand mapping yet.");
+
+  X86::PartialMappingIdx PMI = X86::getPartialMappingIdx(Ty, IsFP);
+  if (PMI == X86::PMI_None)
+    return InstructionMapping();
+
+  return InstructionMapping{DefaultMappingID, 1, X86::getValueMapping(PMI),
+                            NumOperands};
+}
+
+RegisterBankInfo::InstructionMapping
+X86RegisterBankInfo::getInstrMapping(const MachineInstr &MI) const {
+  const unsigned Opc = MI.getOpcode();
+  const MachineFunction &MF = *MI.getParent()->getParent();
+  const MachineRegisterInfo &MRI = MF.getRegInfo();
+  const TargetRegisterInfo &TRI = *MF.getSubtarget().getRegisterInfo();
+
+  // Try the default logic for non-generic instructions that are either copies
+  // or already have some operands assigned to banks.
+  if (!isPreISelGenericOpcode(Opc)) {
+    RegisterBankInfo::InstructionMapping Mapping = getInstrMappingImpl(MI);
+    if (Mapping.isValid())
+      return Mapping;
+  }
+
+  switch (Opc) {
+  case TargetOpcode::G_ADD:
+  case TargetOpcode::G_SUB:
+  case TargetOpcode::G_MUL:
+  case TargetOpcode::G_AND:
+  case TargetOpcode::G_OR:
+  case TargetOpcode::G_XOR:
+    return getSameOperandsMapping(MI, /*IsFP*/ false);
+  case TargetOpcode::G_FADD:
+  case TargetOpcode::G_FSUB:
+  case TargetOpcode::G_FMUL:
+  case TargetOpcode::G_FDIV:
+    return getSameOperandsMapping(MI, /*IsFP*/ true);
+  default:
+    break;
+  }
+
+  // Scalar loads and stores default to GPRs. When the value is produced or
+  // consumed by floating-point code, keep it in the xmm registers instead so
+  // that we do not pay for a cross-bank copy on every access.
+  bool IsFP = isPreISelGenericFloatingPointOpcode(Opc);
+  if (Opc == TargetOpcode::G_STORE) {
+    unsigned ValReg = MI.getOperand(0).getReg();
+    const RegisterBank *ValRB = getRegBank(ValReg, MRI, TRI);
+    const MachineInstr *DefMI = MRI.getVRegDef(ValReg);
+    IsFP = ValRB == &X86::VECRRegBank ||
+           (DefMI && isPreISelGenericFloatingPointOpcode(DefMI->getOpcode()));
+  } else if (Opc == TargetOpcode::G_LOAD) {
+    unsigned ValReg = MI.getOperand(0).getReg();
+    IsFP = !MRI.use_empty(ValReg) &&
+           all_of(MRI.use_instructions(ValReg), [](const MachineInstr &UseMI) {
+             return isPreISelGenericFloatingPointOpcode(UseMI.getOpcode());
+           });
+  }
+
+  unsigned NumOperands = MI.getNumOperands();
+  SmallVector<const ValueMapping *, 8> OpdsMapping(NumOperands);
+  for (unsigned Idx = 0; Idx < NumOperands; ++Idx) {
+    auto &MO = MI.getOperand(Idx);
+    if (!MO.isReg())
+      continue;
+
+    LLT Ty = MRI.getType(MO.getReg());
+    // The address of a memory access always goes in a GPR.
+    bool OpIsFP = IsFP && !Ty.isPointer();
+    X86::PartialMappingIdx PMI = X86::getPartialMappingIdx(Ty, OpIsFP);
+    if (PMI == X86::PMI_None)
+      return InstructionMapping();
+    OpdsMapping[Idx] = X86::getValueMapping(PMI);
+  }
+
+  return InstructionMapping{DefaultMappingID, 1,
+                            getOperandsMapping(OpdsMapping), NumOperands};
+}
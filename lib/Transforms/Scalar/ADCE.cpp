@@ -27,6 +27,7 @@
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/CFG.h"
 #include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/Dominators.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Instructions.h"
@@ -90,6 +91,11 @@ struct BlockInfoType {
 class AggressiveDeadCodeElimination {
   Function &F;
   PostDominatorTree &PDT;
+  /// The dominator tree to keep up to date, if there is one.
+  DominatorTree *DT;
+
+  /// The CFG edges removed along with dead branches.
+  SmallVector<DominatorTree::UpdateType, 8> DomTreeUpdates;
 
   /// Mapping of blocks to associated information, an element in BlockInfoVec.
   DenseMap<BasicBlock *, BlockInfoType> BlockInfo;
@@ -157,8 +163,9 @@ class AggressiveDeadCodeElimination {
   void makeUnconditional(BasicBlock *BB, BasicBlock *Target);
 
 public:
-  AggressiveDeadCodeElimination(Function &F, PostDominatorTree &PDT)
-      : F(F), PDT(PDT) {}
+  AggressiveDeadCodeElimination(Function &F, PostDominatorTree &PDT,
+                                DominatorTree *DT)
+      : F(F), PDT(PDT), DT(DT) {}
   bool performDeadCodeElimination();
 };
 }
@@ -166,7 +173,16 @@ public:
 bool AggressiveDeadCodeElimination::performDeadCodeElimination() {
   initialize();
   markLiveInstructions();
-  return removeDeadInstructions();
+  bool Changed = removeDeadInstructions();
+
+  // Only a few edges went away with the dead branches, so bring the
+  // dominator trees up to date rather than have them recomputed.
+  if (!DomTreeUpdates.empty()) {
+    PDT.applyUpdates(DomTreeUpdates);
+    if (DT)
+      DT->applyUpdates(DomTreeUpdates);
+  }
+  return Changed;
 }
 
 static bool isUnconditionalBranch(TerminatorInst *Term) {
@@ -581,11 +597,14 @@ void AggressiveDeadCodeElimination::updateDeadRegions() {
     assert((PreferredSucc && PreferredSucc->PostOrder > 0) &&
            "Failed to find safe successor for dead branc");
     bool First = true;
+    SmallPtrSet<BasicBlock *, 4> RemovedSuccessors;
     for (auto *Succ : successors(BB)) {
       if (!First || Succ != PreferredSucc->BB)
         Succ->removePredecessor(BB);
       else
         First = false;
+      if (Succ != PreferredSucc->BB && RemovedSuccessors.insert(Succ).second)
+        DomTreeUpdates.push_back({DominatorTree::Delete, BB, Succ});
     }
     makeUnconditional(BB, PreferredSucc->BB);
     NumBranchesRemoved += 1;
@@ -641,12 +660,15 @@ void AggressiveDeadCodeElimination::makeUnconditional(BasicBlock *BB,
 //===----------------------------------------------------------------------===//
 PreservedAnalyses ADCEPass::run(Function &F, FunctionAnalysisManager &FAM) {
   auto &PDT = FAM.getResult<PostDominatorTreeAnalysis>(F);
-  if (!AggressiveDeadCodeElimination(F, PDT).performDeadCodeElimination())
+  auto *DT = FAM.getCachedResult<DominatorTreeAnalysis>(F);
+  if (!AggressiveDeadCodeElimination(F, PDT, DT).performDeadCodeElimination())
     return PreservedAnalyses::all();
 
   // FIXME: This should also 'preserve the CFG'.
   auto PA = PreservedAnalyses();
   PA.preserve<GlobalsAA>();
+  PA.preserve<DominatorTreeAnalysis>();
+  PA.preserve<PostDominatorTreeAnalysis>();
   return PA;
 }
 
@@ -661,13 +683,18 @@ struct ADCELegacyPass : public FunctionPass {
     if (skipFunction(F))
       return false;
     auto &PDT = getAnalysis<PostDominatorTreeWrapperPass>().getPostDomTree();
-    return AggressiveDeadCodeElimination(F, PDT).performDeadCodeElimination();
+    auto *DTWP = getAnalysisIfAvailable<DominatorTreeWrapperPass>();
+    DominatorTree *DT = DTWP ? &DTWP->getDomTree() : nullptr;
+    return AggressiveDeadCodeElimination(F, PDT, DT)
+        .performDeadCodeElimination();
   }
 
   void getAnalysisUsage(AnalysisUsage &AU) const override {
     AU.addRequired<PostDominatorTreeWrapperPass>();
     if (!RemoveControlFlowFlag)
       AU.setPreservesCFG();
+    AU.addPreserved<DominatorTreeWrapperPass>();
+    AU.addPreserved<PostDominatorTreeWrapperPass>();
     AU.addPreserved<GlobalsAAWrapperPass>();
   }
 };
@@ -0,0 +1,34 @@
+; RUN: llvm-as < %s | llvm-dis > %t.serial
+; RUN: llvm-as < %s | llvm-dis -j4 > %t.threads
+; RUN: diff %t.serial %t.threads
+; RUN: FileCheck %s < %t.threads
+
+; Metadata and attribute groups used only in function bodies are numbered in
+; function order, whichever thread prints the function.
+
+; CHECK: define i32 @f(i32) {
+; CHECK:   %2 = add i32 %0, 1, !md !0
+; CHECK:   call void @g(i32 %2) #0
+; CHECK: define i32 @h(i32) {
+; CHECK:   %2 = add i32 %0, 2, !md !1
+; CHECK:   call void @g(i32 %2) #1
+; CHECK: attributes #0 = { nounwind }
+; CHECK: attributes #1 = { readnone }
+; CHECK: !0 = !{i32 1}
+; CHECK: !1 = !{i32 2}
+
+declare void @g(i32)
+
+define i32 @f(i32) {
+  %2 = add i32 %0, 1, !md !{i32 1}
+  call void @g(i32 %2) nounwind
+  ret i32 %2
+}
+
+define i32 @h(i32) {
+  %2 = add i32 %0, 2, !md !{i32 2}
+  call void @g(i32 %2) readnone
+  br label %3
+
+  ret i32 %2
+}
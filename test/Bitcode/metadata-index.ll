@@ -0,0 +1,24 @@
+; RUN: llvm-as -bitcode-mdindex-threshold=0 < %s | llvm-bcanalyzer -dump | FileCheck %s
+; RUN: llvm-as -bitcode-mdindex-threshold=0 < %s | llvm-dis | FileCheck %s --check-prefix=DIS
+; Check that the module-level metadata block gets an index of its records
+; when there are more of them than the threshold, and that the named metadata
+; comes after the index.
+
+; CHECK:      <METADATA_BLOCK
+; CHECK:      <STRINGS {{.*}} num-strings = 1 {
+; CHECK-NEXT:   'leaf'
+; CHECK-NEXT: }
+; CHECK-NEXT: <INDEX_OFFSET
+; CHECK-NEXT: <DISTINCT_NODE
+; CHECK-NEXT: <NODE
+; CHECK-NEXT: <INDEX {{.*}}op0={{[0-9]+}} op1={{[0-9]+}}/>
+; CHECK-NEXT: <NAME
+; CHECK-NEXT: <NAMED_NODE
+
+; DIS: !named = !{!0, !1}
+; DIS: !0 = !{!"leaf"}
+; DIS: !1 = distinct !{!1, !0}
+
+!named = !{!0, !1}
+!0 = !{!"leaf"}
+!1 = distinct !{!1, !0}
@@ -0,0 +1,49 @@
+; RUN: llc -mtriple=aarch64-linux-gnu -aarch64-enable-pipeliner -disable-lsr \
+; RUN:     -verify-machineinstrs < %s | FileCheck %s
+
+; Check that a loop controlled by a decrementing counter is pipelined on a
+; target without a DFA packetizer. The loads for the next iteration are
+; issued in the kernel before the counter is updated, and the prolog branches
+; to the epilog when the trip count is one.
+
+; CHECK-LABEL: saxpy:
+; CHECK: ldr [[X0:s[0-9]+]],
+; CHECK: ldr [[Y0:s[0-9]+]],
+; CHECK: cmp x2, #1
+; CHECK: b.eq [[EPILOG:.LBB0_[0-9]+]]
+; CHECK: [[KERNEL:.LBB0_[0-9]+]]:
+; CHECK: fmul
+; CHECK: fadd
+; CHECK: str
+; CHECK: ldr
+; CHECK: ldr
+; CHECK: sub [[CNT:x[0-9]+]], [[CNT]], #1
+; CHECK: cbnz [[CNT]], [[KERNEL]]
+; CHECK: [[EPILOG]]:
+; CHECK: fmul
+; CHECK: fadd
+; CHECK: str
+
+define void @saxpy(float* noalias nocapture readonly %x, float* noalias nocapture %y, float %a, i64 %n) {
+entry:
+  %cmp = icmp eq i64 %n, 0
+  br i1 %cmp, label %exit, label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %cnt = phi i64 [ %n, %entry ], [ %cnt.next, %loop ]
+  %px = getelementptr inbounds float, float* %x, i64 %i
+  %vx = load float, float* %px, align 4
+  %py = getelementptr inbounds float, float* %y, i64 %i
+  %vy = load float, float* %py, align 4
+  %m = fmul float %vx, %a
+  %s = fadd float %m, %vy
+  store float %s, float* %py, align 4
+  %i.next = add nuw i64 %i, 1
+  %cnt.next = add i64 %cnt, -1
+  %done = icmp eq i64 %cnt.next, 0
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
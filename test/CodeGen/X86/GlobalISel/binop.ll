@@ -0,0 +1,177 @@
+; NOTE: Assertions have been autogenerated by utils/update_llc_test_checks.py
+; RUN: llc -mtriple=x86_64-linux-gnu -global-isel -O0 -verify-machineinstrs %s -o - | FileCheck %s --check-prefix=ALL --check-prefix=SSE
+; RUN: llc -mtriple=x86_64-linux-gnu -mattr=+avx -global-isel -O0 -verify-machineinstrs %s -o - | FileCheck %s --check-prefix=ALL --check-prefix=AVX
+; RUN: llc -mtriple=x86_64-linux-gnu -mattr=+avx512f -global-isel -O0 -verify-machineinstrs %s -o - | FileCheck %s --check-prefix=ALL --check-prefix=AVX512
+
+define i64 @test_add_i64(i64 %arg1, i64 %arg2) {
+; ALL-LABEL: test_add_i64:
+; ALL:       # BB#1:
+; ALL-NEXT:    addq %rsi, %rdi
+; ALL-NEXT:    movq %rdi, %rax
+; ALL-NEXT:    retq
+  %ret = add i64 %arg1, %arg2
+  ret i64 %ret
+}
+
+define i32 @test_add_i32(i32 %arg1, i32 %arg2) {
+; ALL-LABEL: test_add_i32:
+; ALL:       # BB#1:
+; ALL-NEXT:    addl %esi, %edi
+; ALL-NEXT:    movl %edi, %eax
+; ALL-NEXT:    retq
+  %ret = add i32 %arg1, %arg2
+  ret i32 %ret
+}
+
+define i16 @test_sub_i16(i16 %arg1, i16 %arg2) {
+; ALL-LABEL: test_sub_i16:
+; ALL:       # BB#1:
+; ALL-NEXT:    movw %di, %ax
+; ALL-NEXT:    movw %si, %cx
+; ALL-NEXT:    subw %cx, %ax
+; ALL-NEXT:    retq
+  %ret = sub i16 %arg1, %arg2
+  ret i16 %ret
+}
+
+define i8 @test_and_i8(i8 %arg1, i8 %arg2) {
+; ALL-LABEL: test_and_i8:
+; ALL:       # BB#1:
+; ALL-NEXT:    movb %dil, %al
+; ALL-NEXT:    movb %sil, %cl
+; ALL-NEXT:    andb %cl, %al
+; ALL-NEXT:    retq
+  %ret = and i8 %arg1, %arg2
+  ret i8 %ret
+}
+
+define i32 @test_or_i32(i32 %arg1, i32 %arg2) {
+; ALL-LABEL: test_or_i32:
+; ALL:       # BB#1:
+; ALL-NEXT:    orl %esi, %edi
+; ALL-NEXT:    movl %edi, %eax
+; ALL-NEXT:    retq
+  %ret = or i32 %arg1, %arg2
+  ret i32 %ret
+}
+
+define i64 @test_xor_i64(i64 %arg1, i64 %arg2) {
+; ALL-LABEL: test_xor_i64:
+; ALL:       # BB#1:
+; ALL-NEXT:    xorq %rsi, %rdi
+; ALL-NEXT:    movq %rdi, %rax
+; ALL-NEXT:    retq
+  %ret = xor i64 %arg1, %arg2
+  ret i64 %ret
+}
+
+define i8 @test_mul_i8(i8 %arg1, i8 %arg2) {
+; ALL-LABEL: test_mul_i8:
+; ALL:       # BB#1:
+; ALL-NEXT:    movb %dil, %al
+; ALL-NEXT:    movb %sil, %cl
+; ALL-NEXT:    movzbw %al, %dx
+; ALL-NEXT:    movzbw %cl, %r8w
+; ALL-NEXT:    imulw %r8w, %dx
+; ALL-NEXT:    movb %dl, %al
+; ALL-NEXT:    retq
+  %ret = mul i8 %arg1, %arg2
+  ret i8 %ret
+}
+
+define i32 @test_mul_i32(i32 %arg1, i32 %arg2) {
+; ALL-LABEL: test_mul_i32:
+; ALL:       # BB#1:
+; ALL-NEXT:    imull %esi, %edi
+; ALL-NEXT:    movl %edi, %eax
+; ALL-NEXT:    retq
+  %ret = mul i32 %arg1, %arg2
+  ret i32 %ret
+}
+
+define i1 @test_add_i1(i1 %arg1, i1 %arg2) {
+; ALL-LABEL: test_add_i1:
+; ALL:       # BB#1:
+; ALL-NEXT:    movb %dil, %al
+; ALL-NEXT:    movb %sil, %cl
+; ALL-NEXT:    addb %cl, %al
+; ALL-NEXT:    retq
+  %ret = add i1 %arg1, %arg2
+  ret i1 %ret
+}
+
+define float @test_fadd_float(float %arg1, float %arg2) {
+; SSE-LABEL: test_fadd_float:
+; SSE:       # BB#1:
+; SSE-NEXT:    addss %xmm1, %xmm0
+; SSE-NEXT:    retq
+;
+; AVX-LABEL: test_fadd_float:
+; AVX:       # BB#1:
+; AVX-NEXT:    vaddss %xmm1, %xmm0, %xmm0
+; AVX-NEXT:    retq
+;
+; AVX512-LABEL: test_fadd_float:
+; AVX512:       # BB#1:
+; AVX512-NEXT:    vaddss %xmm1, %xmm0, %xmm0
+; AVX512-NEXT:    retq
+  %ret = fadd float %arg1, %arg2
+  ret float %ret
+}
+
+define double @test_fsub_double(double %arg1, double %arg2) {
+; SSE-LABEL: test_fsub_double:
+; SSE:       # BB#1:
+; SSE-NEXT:    subsd %xmm1, %xmm0
+; SSE-NEXT:    retq
+;
+; AVX-LABEL: test_fsub_double:
+; AVX:       # BB#1:
+; AVX-NEXT:    vsubsd %xmm1, %xmm0, %xmm0
+; AVX-NEXT:    retq
+;
+; AVX512-LABEL: test_fsub_double:
+; AVX512:       # BB#1:
+; AVX512-NEXT:    vsubsd %xmm1, %xmm0, %xmm0
+; AVX512-NEXT:    retq
+  %ret = fsub double %arg1, %arg2
+  ret double %ret
+}
+
+define float @test_fmul_float(float %arg1, float %arg2) {
+; SSE-LABEL: test_fmul_float:
+; SSE:       # BB#1:
+; SSE-NEXT:    mulss %xmm1, %xmm0
+; SSE-NEXT:    retq
+;
+; AVX-LABEL: test_fmul_float:
+; AVX:       # BB#1:
+; AVX-NEXT:    vmulss %xmm1, %xmm0, %xmm0
+; AVX-NEXT:    retq
+;
+; AVX512-LABEL: test_fmul_float:
+; AVX512:       # BB#1:
+; AVX512-NEXT:    vmulss %xmm1, %xmm0, %xmm0
+; AVX512-NEXT:    retq
+  %ret = fmul float %arg1, %arg2
+  ret float %ret
+}
+
+define double @test_fdiv_double(double %arg1, double %arg2) {
+; SSE-LABEL: test_fdiv_double:
+; SSE:       # BB#1:
+; SSE-NEXT:    divsd %xmm1, %xmm0
+; SSE-NEXT:    retq
+;
+; AVX-LABEL: test_fdiv_double:
+; AVX:       # BB#1:
+; AVX-NEXT:    vdivsd %xmm1, %xmm0, %xmm0
+; AVX-NEXT:    retq
+;
+; AVX512-LABEL: test_fdiv_double:
+; AVX512:       # BB#1:
+; AVX512-NEXT:    vdivsd %xmm1, %xmm0, %xmm0
+; AVX512-NEXT:    retq
+  %ret = fdiv double %arg1, %arg2
+  ret double %ret
+}
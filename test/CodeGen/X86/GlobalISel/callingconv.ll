@@ -0,0 +1,82 @@
+; NOTE: Assertions have been autogenerated by utils/update_llc_test_checks.py
+; RUN: llc -mtriple=x86_64-linux-gnu -global-isel -O0 -verify-machineinstrs %s -o - | FileCheck %s
+
+; The seventh and eighth integer arguments are passed on the stack.
+define i32 @test_stack_args(i32 %a, i32 %b, i32 %c, i32 %d, i32 %e, i32 %f,
+; CHECK-LABEL: test_stack_args:
+; CHECK:       # BB#1:
+; CHECK-NEXT:    movl {{[0-9]+}}(%rsp), %eax
+; CHECK-NEXT:    movl {{[0-9]+}}(%rsp), %r10d
+; CHECK-NEXT:    addl %r10d, %eax
+; CHECK-NEXT:    movl %edi, -{{[0-9]+}}(%rsp) # 4-byte Spill
+; CHECK-NEXT:    movl %esi, -{{[0-9]+}}(%rsp) # 4-byte Spill
+; CHECK-NEXT:    movl %edx, -{{[0-9]+}}(%rsp) # 4-byte Spill
+; CHECK-NEXT:    movl %ecx, -{{[0-9]+}}(%rsp) # 4-byte Spill
+; CHECK-NEXT:    movl %r8d, -{{[0-9]+}}(%rsp) # 4-byte Spill
+; CHECK-NEXT:    movl %r9d, -{{[0-9]+}}(%rsp) # 4-byte Spill
+; CHECK-NEXT:    retq
+                            i32 %g, i32 %h) {
+  %r = add i32 %g, %h
+  ret i32 %r
+}
+
+declare i32 @callee(i32, i64, float, double)
+
+define i32 @test_simple_call(i32 %a, i64 %b, float %c, double %d) {
+; CHECK-LABEL: test_simple_call:
+; CHECK:       # BB#1:
+; CHECK-NEXT:    pushq %rax
+; CHECK-NEXT:  .Lcfi0:
+; CHECK-NEXT:    .cfi_def_cfa_offset 16
+; CHECK-NEXT:    callq callee
+; CHECK-NEXT:    popq %rcx
+; CHECK-NEXT:    retq
+  %r = call i32 @callee(i32 %a, i64 %b, float %c, double %d)
+  ret i32 %r
+}
+
+declare void @callee_stack(i64, i64, i64, i64, i64, i64, i64, i64)
+
+define void @test_call_stack_args(i64 %a) {
+; CHECK-LABEL: test_call_stack_args:
+; CHECK:       # BB#1:
+; CHECK-NEXT:    subq $24, %rsp
+; CHECK-NEXT:  .Lcfi1:
+; CHECK-NEXT:    .cfi_def_cfa_offset 32
+; CHECK-NEXT:    movq %rdi, {{[0-9]+}}(%rsp) # 8-byte Spill
+; CHECK-NEXT:    movq {{[0-9]+}}(%rsp), %rsi # 8-byte Reload
+; CHECK-NEXT:    movq {{[0-9]+}}(%rsp), %rdx # 8-byte Reload
+; CHECK-NEXT:    movq {{[0-9]+}}(%rsp), %rcx # 8-byte Reload
+; CHECK-NEXT:    movq {{[0-9]+}}(%rsp), %r8 # 8-byte Reload
+; CHECK-NEXT:    movq {{[0-9]+}}(%rsp), %r9 # 8-byte Reload
+; CHECK-NEXT:    movq %rsp, %rax
+; CHECK-NEXT:    movq {{[0-9]+}}(%rsp), %r10 # 8-byte Reload
+; CHECK-NEXT:    movq %r10, (%rax)
+; CHECK-NEXT:    movq %rsp, %rax
+; CHECK-NEXT:    movq %r10, 8(%rax)
+; CHECK-NEXT:    callq callee_stack
+; CHECK-NEXT:    addq $24, %rsp
+; CHECK-NEXT:    retq
+  call void @callee_stack(i64 %a, i64 %a, i64 %a, i64 %a, i64 %a, i64 %a,
+                          i64 %a, i64 %a)
+  ret void
+}
+
+declare zeroext i8 @callee_zext(i8 signext)
+
+define i32 @test_call_ext(i8 %a) {
+; CHECK-LABEL: test_call_ext:
+; CHECK:       # BB#1:
+; CHECK-NEXT:    pushq %rax
+; CHECK-NEXT:  .Lcfi2:
+; CHECK-NEXT:    .cfi_def_cfa_offset 16
+; CHECK-NEXT:    movb %dil, %al
+; CHECK-NEXT:    movsbl %al, %edi
+; CHECK-NEXT:    callq callee_zext
+; CHECK-NEXT:    movzbl %al, %eax
+; CHECK-NEXT:    popq %rcx
+; CHECK-NEXT:    retq
+  %r = call zeroext i8 @callee_zext(i8 signext %a)
+  %z = zext i8 %r to i32
+  ret i32 %z
+}
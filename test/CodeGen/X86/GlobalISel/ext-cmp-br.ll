@@ -0,0 +1,120 @@
+; NOTE: Assertions have been autogenerated by utils/update_llc_test_checks.py
+; RUN: llc -mtriple=x86_64-linux-gnu -global-isel -O0 -verify-machineinstrs %s -o - | FileCheck %s
+
+define i64 @test_const_i64() {
+; CHECK-LABEL: test_const_i64:
+; CHECK:       # BB#1:
+; CHECK-NEXT:    movabsq $1234567890123, %rax # imm = 0x11F71FB04CB
+; CHECK-NEXT:    retq
+  ret i64 1234567890123
+}
+
+define i32 @test_const_i32() {
+; CHECK-LABEL: test_const_i32:
+; CHECK:       # BB#1:
+; CHECK-NEXT:    movl $-7, %eax
+; CHECK-NEXT:    retq
+  ret i32 -7
+}
+
+define i32 @test_zext_i8(i8 %v) {
+; CHECK-LABEL: test_zext_i8:
+; CHECK:       # BB#1:
+; CHECK-NEXT:    movb %dil, %al
+; CHECK-NEXT:    movzbl %al, %eax
+; CHECK-NEXT:    retq
+  %r = zext i8 %v to i32
+  ret i32 %r
+}
+
+define i32 @test_sext_i16(i16 %v) {
+; CHECK-LABEL: test_sext_i16:
+; CHECK:       # BB#1:
+; CHECK-NEXT:    movw %di, %ax
+; CHECK-NEXT:    cwtl
+; CHECK-NEXT:    retq
+  %r = sext i16 %v to i32
+  ret i32 %r
+}
+
+define i64 @test_zext_i32(i32 %v) {
+; CHECK-LABEL: test_zext_i32:
+; CHECK:       # BB#1:
+; CHECK-NEXT:    movl %edi, %edi
+; CHECK-NEXT:    movl %edi, %eax
+; CHECK-NEXT:    retq
+  %r = zext i32 %v to i64
+  ret i64 %r
+}
+
+define i64 @test_sext_i32(i32 %v) {
+; CHECK-LABEL: test_sext_i32:
+; CHECK:       # BB#1:
+; CHECK-NEXT:    movslq %edi, %rax
+; CHECK-NEXT:    retq
+  %r = sext i32 %v to i64
+  ret i64 %r
+}
+
+define i8 @test_trunc_i32(i32 %v) {
+; CHECK-LABEL: test_trunc_i32:
+; CHECK:       # BB#1:
+; CHECK-NEXT:    movb %dil, %al
+; CHECK-NEXT:    retq
+  %r = trunc i32 %v to i8
+  ret i8 %r
+}
+
+define i32 @test_icmp_zext(i32 %a, i32 %b) {
+; CHECK-LABEL: test_icmp_zext:
+; CHECK:       # BB#1:
+; CHECK-NEXT:    cmpl %esi, %edi
+; CHECK-NEXT:    setl %al
+; CHECK-NEXT:    andb $1, %al
+; CHECK-NEXT:    movzbl %al, %eax
+; CHECK-NEXT:    retq
+  %c = icmp slt i32 %a, %b
+  %r = zext i1 %c to i32
+  ret i32 %r
+}
+
+define i32 @test_icmp_sext(i64 %a, i64 %b) {
+; CHECK-LABEL: test_icmp_sext:
+; CHECK:       # BB#1:
+; CHECK-NEXT:    cmpq %rsi, %rdi
+; CHECK-NEXT:    setb %al
+; CHECK-NEXT:    andb $1, %al
+; CHECK-NEXT:    negb %al
+; CHECK-NEXT:    movsbl %al, %eax
+; CHECK-NEXT:    retq
+  %c = icmp ult i64 %a, %b
+  %r = sext i1 %c to i32
+  ret i32 %r
+}
+
+define i32 @test_brcond(i32 %a, i32 %b) {
+; CHECK-LABEL: test_brcond:
+; CHECK:       # BB#1:
+; CHECK-NEXT:    cmpl %esi, %edi
+; CHECK-NEXT:    sete %al
+; CHECK-NEXT:    testb $1, %al
+; CHECK-NEXT:    movl %edi, -{{[0-9]+}}(%rsp) # 4-byte Spill
+; CHECK-NEXT:    movl %esi, -{{[0-9]+}}(%rsp) # 4-byte Spill
+; CHECK-NEXT:    jne .LBB9_2
+; CHECK-NEXT:    jmp .LBB9_3
+; CHECK-NEXT:  .LBB9_2:
+; CHECK-NEXT:    movl -{{[0-9]+}}(%rsp), %eax # 4-byte Reload
+; CHECK-NEXT:    retq
+; CHECK-NEXT:  .LBB9_3:
+; CHECK-NEXT:    movl -{{[0-9]+}}(%rsp), %eax # 4-byte Reload
+; CHECK-NEXT:    retq
+entry:
+  %c = icmp eq i32 %a, %b
+  br i1 %c, label %then, label %else
+
+then:
+  ret i32 %a
+
+else:
+  ret i32 %b
+}
@@ -0,0 +1,154 @@
+; NOTE: Assertions have been autogenerated by utils/update_llc_test_checks.py
+; RUN: llc -mtriple=x86_64-linux-gnu -global-isel -O0 -verify-machineinstrs %s -o - | FileCheck %s
+
+define i8 @test_load_i8(i8* %p) {
+; CHECK-LABEL: test_load_i8:
+; CHECK:       # BB#1:
+; CHECK-NEXT:    movb (%rdi), %al
+; CHECK-NEXT:    retq
+  %r = load i8, i8* %p
+  ret i8 %r
+}
+
+define i16 @test_load_i16(i16* %p) {
+; CHECK-LABEL: test_load_i16:
+; CHECK:       # BB#1:
+; CHECK-NEXT:    movw (%rdi), %ax
+; CHECK-NEXT:    retq
+  %r = load i16, i16* %p
+  ret i16 %r
+}
+
+define i32 @test_load_i32(i32* %p) {
+; CHECK-LABEL: test_load_i32:
+; CHECK:       # BB#1:
+; CHECK-NEXT:    movl (%rdi), %eax
+; CHECK-NEXT:    retq
+  %r = load i32, i32* %p
+  ret i32 %r
+}
+
+define i64 @test_load_i64(i64* %p) {
+; CHECK-LABEL: test_load_i64:
+; CHECK:       # BB#1:
+; CHECK-NEXT:    movq (%rdi), %rax
+; CHECK-NEXT:    retq
+  %r = load i64, i64* %p
+  ret i64 %r
+}
+
+define i32* @test_load_ptr(i32** %p) {
+; CHECK-LABEL: test_load_ptr:
+; CHECK:       # BB#1:
+; CHECK-NEXT:    movq (%rdi), %rax
+; CHECK-NEXT:    retq
+  %r = load i32*, i32** %p
+  ret i32* %r
+}
+
+define float @test_load_float(float* %p) {
+; CHECK-LABEL: test_load_float:
+; CHECK:       # BB#1:
+; CHECK-NEXT:    movl (%rdi), %eax
+; CHECK-NEXT:    movd %eax, %xmm0
+; CHECK-NEXT:    retq
+  %r = load float, float* %p
+  ret float %r
+}
+
+define double @test_load_double(double* %p) {
+; CHECK-LABEL: test_load_double:
+; CHECK:       # BB#1:
+; CHECK-NEXT:    movq (%rdi), %rdi
+; CHECK-NEXT:    movd %rdi, %xmm0
+; CHECK-NEXT:    retq
+  %r = load double, double* %p
+  ret double %r
+}
+
+define void @test_store_i32(i32 %v, i32* %p) {
+; CHECK-LABEL: test_store_i32:
+; CHECK:       # BB#1:
+; CHECK-NEXT:    movl %edi, (%rsi)
+; CHECK-NEXT:    retq
+  store i32 %v, i32* %p
+  ret void
+}
+
+define void @test_store_i64(i64 %v, i64* %p) {
+; CHECK-LABEL: test_store_i64:
+; CHECK:       # BB#1:
+; CHECK-NEXT:    movq %rdi, (%rsi)
+; CHECK-NEXT:    retq
+  store i64 %v, i64* %p
+  ret void
+}
+
+define void @test_store_float(float %v, float* %p) {
+; CHECK-LABEL: test_store_float:
+; CHECK:       # BB#1:
+; CHECK-NEXT:    movss %xmm0, (%rdi)
+; CHECK-NEXT:    retq
+  store float %v, float* %p
+  ret void
+}
+
+define void @test_store_double(double %v, double* %p) {
+; CHECK-LABEL: test_store_double:
+; CHECK:       # BB#1:
+; CHECK-NEXT:    movsd %xmm0, (%rdi)
+; CHECK-NEXT:    retq
+  store double %v, double* %p
+  ret void
+}
+
+define float @test_load_fadd_store(float* %p, float* %q) {
+; CHECK-LABEL: test_load_fadd_store:
+; CHECK:       # BB#1:
+; CHECK-NEXT:    movss {{.*#+}} xmm0 = mem[0],zero,zero,zero
+; CHECK-NEXT:    addss %xmm0, %xmm0
+; CHECK-NEXT:    movss %xmm0, (%rsi)
+; CHECK-NEXT:    retq
+  %a = load float, float* %p
+  %b = fadd float %a, %a
+  store float %b, float* %q
+  ret float %b
+}
+
+; The constant offset of a GEP is folded into the addressing mode.
+define i32 @test_gep_folding(i32* %arr, i32 %val) {
+; CHECK-LABEL: test_gep_folding:
+; CHECK:       # BB#1:
+; CHECK-NEXT:    movl %esi, 20(%rdi)
+; CHECK-NEXT:    movl 20(%rdi), %eax
+; CHECK-NEXT:    retq
+  %p = getelementptr i32, i32* %arr, i32 5
+  store i32 %val, i32* %p
+  %r = load i32, i32* %p
+  ret i32 %r
+}
+
+; So is the address of a stack slot.
+define i32 @test_alloca(i32 %val) {
+; CHECK-LABEL: test_alloca:
+; CHECK:       # BB#1:
+; CHECK-NEXT:    movl %edi, -{{[0-9]+}}(%rsp)
+; CHECK-NEXT:    movl -{{[0-9]+}}(%rsp), %eax
+; CHECK-NEXT:    retq
+  %slot = alloca i32
+  store i32 %val, i32* %slot
+  %r = load i32, i32* %slot
+  ret i32 %r
+}
+
+@g = global i32 0
+
+define i32 @test_global() {
+; CHECK-LABEL: test_global:
+; CHECK:       # BB#1:
+; CHECK-NEXT:    leaq g, %rax
+; CHECK-NEXT:    movl (%rax), %eax
+; CHECK-NEXT:    retq
+  %r = load i32, i32* @g
+  ret i32 %r
+}
@@ -0,0 +1,25 @@
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -stats -o /dev/null < %s 2>&1 \
+; RUN:   | FileCheck %s
+; REQUIRES: asserts
+
+; Only one arena should be allocated for the whole module: every function
+; after the first reuses the one released by its predecessor.
+
+; CHECK-DAG: 1 machinemoduleinfo - Number of MachineFunction arenas allocated
+; CHECK-DAG: 2 machinemoduleinfo - Number of MachineFunction arenas reused from the pool
+
+define i32 @f(i32 %a) {
+  %r = add i32 %a, 1
+  ret i32 %r
+}
+
+define i32 @g(i32 %a) {
+  %r = mul i32 %a, 3
+  ret i32 %r
+}
+
+define i32 @h(i32 %a, i32 %b) {
+  %c = call i32 @f(i32 %a)
+  %r = sub i32 %c, %b
+  ret i32 %r
+}
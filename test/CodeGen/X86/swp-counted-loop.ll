@@ -0,0 +1,44 @@
+; RUN: llc -mtriple=x86_64-linux-gnu -x86-enable-pipeliner -disable-lsr \
+; RUN:     -verify-machineinstrs < %s | FileCheck %s
+
+; Check that a loop controlled by a decrementing counter is pipelined on a
+; target without a DFA packetizer. The load for the next iteration is issued
+; in the kernel after the store of the current one, and the prolog branches
+; to the epilog when the trip count is one.
+
+; CHECK-LABEL: saxpy:
+; CHECK: movss (%rdi,{{.*}}), [[V:%xmm[0-9]+]]
+; CHECK: cmpq $1, %rdx
+; CHECK: je [[EPILOG:.LBB0_[0-9]+]]
+; CHECK: [[KERNEL:.LBB0_[0-9]+]]:
+; CHECK: movss [[V]], (%rsi,
+; CHECK: movss (%rdi,{{.*}}), [[V]]
+; CHECK: decq %rdx
+; CHECK-NEXT: movq
+; CHECK-NEXT: jne [[KERNEL]]
+; CHECK: [[EPILOG]]:
+; CHECK: movss [[V]], (%rsi,
+
+define void @saxpy(float* noalias nocapture readonly %x, float* noalias nocapture %y, float %a, i64 %n) {
+entry:
+  %cmp = icmp eq i64 %n, 0
+  br i1 %cmp, label %exit, label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %cnt = phi i64 [ %n, %entry ], [ %cnt.next, %loop ]
+  %px = getelementptr inbounds float, float* %x, i64 %i
+  %vx = load float, float* %px, align 4
+  %py = getelementptr inbounds float, float* %y, i64 %i
+  %vy = load float, float* %py, align 4
+  %m = fmul float %vx, %a
+  %s = fadd float %m, %vy
+  store float %s, float* %py, align 4
+  %i.next = add nuw i64 %i, 1
+  %cnt.next = add i64 %cnt, -1
+  %done = icmp eq i64 %cnt.next, 0
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
@@ -0,0 +1,44 @@
+; REQUIRES: zlib
+
+; RUN: llc -mtriple=x86_64-pc-linux -filetype=obj -compress-debug-sections=zlib \
+; RUN:     < %s | llvm-readobj -s - | FileCheck --check-prefix=ZLIB %s
+; RUN: llc -mtriple=x86_64-pc-linux -filetype=obj \
+; RUN:     -compress-debug-sections=zlib-gnu < %s | llvm-readobj -s - \
+; RUN:   | FileCheck --check-prefix=GNU %s
+; RUN: llc -mtriple=x86_64-pc-linux -filetype=obj < %s | llvm-readobj -s - \
+; RUN:   | FileCheck --check-prefix=NONE %s
+
+; Check that llc forwards -compress-debug-sections to the object writer.
+
+; ZLIB:      Name: .debug_str
+; ZLIB-NEXT: Type: SHT_PROGBITS
+; ZLIB-NEXT: Flags [
+; ZLIB-NEXT:   SHF_COMPRESSED
+; ZLIB-NEXT:   SHF_MERGE
+; ZLIB-NEXT:   SHF_STRINGS
+; ZLIB-NEXT: ]
+
+; GNU:     Name: .zdebug_str
+; GNU-NOT: SHF_COMPRESSED
+
+; NONE-NOT: SHF_COMPRESSED
+; NONE:     Name: .debug_str
+; NONE-NOT: SHF_COMPRESSED
+
+define void @f() !dbg !6 {
+entry:
+  ret void, !dbg !9
+}
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3, !4}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang version 4.0.0 clang version 4.0.0 clang version 4.0.0 clang version 4.0.0 clang version 4.0.0 clang version 4.0.0", isOptimized: false, runtimeVersion: 0, emissionKind: FullDebug, enums: !2)
+!1 = !DIFile(filename: "compress.c", directory: "/tmp")
+!2 = !{}
+!3 = !{i32 2, !"Dwarf Version", i32 4}
+!4 = !{i32 2, !"Debug Info Version", i32 3}
+!6 = distinct !DISubprogram(name: "f", scope: !1, file: !1, line: 1, type: !7, isLocal: false, isDefinition: true, scopeLine: 1, isOptimized: false, unit: !0, variables: !2)
+!7 = !DISubroutineType(types: !8)
+!8 = !{null}
+!9 = !DILocation(line: 1, column: 10, scope: !6)
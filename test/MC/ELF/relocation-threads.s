@@ -0,0 +1,35 @@
+// RUN: llvm-mc -filetype=obj -triple x86_64-pc-linux %s -o %t.serial
+// RUN: llvm-mc -filetype=obj -triple x86_64-pc-linux %s -o %t.parallel \
+// RUN:     -elf-relocation-threads=4
+// RUN: cmp %t.serial %t.parallel
+// RUN: llvm-mc -filetype=obj -triple i386-pc-linux %s -o %t.serial32
+// RUN: llvm-mc -filetype=obj -triple i386-pc-linux %s -o %t.parallel32 \
+// RUN:     -elf-relocation-threads=4
+// RUN: cmp %t.serial32 %t.parallel32
+// RUN: llvm-readobj -r %t.parallel | FileCheck %s
+
+// Test that encoding the relocation sections on several threads produces the
+// same object file as encoding them serially.
+
+// CHECK:      Section (3) .rela.text {
+// CHECK-NEXT:   0x1 R_X86_64_PC32 foo 0xFFFFFFFFFFFFFFFC
+// CHECK-NEXT:   0x6 R_X86_64_PC32 bar 0xFFFFFFFFFFFFFFFC
+// CHECK-NEXT: }
+// CHECK:      Section (5) .rela.data {
+// CHECK-NEXT:   0x0 R_X86_64_32 foo 0x0
+// CHECK-NEXT:   0x4 R_X86_64_32 bar 0x8
+// CHECK-NEXT: }
+// CHECK:      Section (7) .rela.text.baz {
+// CHECK-NEXT:   0x0 R_X86_64_32 .data 0x4
+// CHECK-NEXT: }
+
+	.text
+	call foo
+	call bar
+
+	.data
+	.long foo
+	.long bar + 8
+
+	.section .text.baz,"ax",@progbits
+	.long .data + 4
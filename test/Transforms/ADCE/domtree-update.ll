@@ -0,0 +1,63 @@
+; RUN: opt < %s -domtree -adce -verify-dom-info -S | FileCheck %s
+; RUN: opt < %s -passes='require<domtree>,adce,verify<domtree>' \
+; RUN:   -debug-pass-manager -disable-output 2>&1 | FileCheck %s --check-prefix=NPM
+
+; Removing dead branches updates the dominator trees instead of invalidating
+; them.
+
+; NPM: Running analysis: DominatorTreeAnalysis
+; NPM: Running pass: ADCEPass
+; NPM-NOT: Running analysis: DominatorTreeAnalysis
+; NPM: Running pass: DominatorTreeVerifierPass
+
+; CHECK-LABEL: @dead_diamond(
+; CHECK: entry:
+; CHECK-NEXT: br label %
+define i32 @dead_diamond(i1 %c, i32 %x) {
+entry:
+  br i1 %c, label %left, label %right
+
+left:
+  %a = add i32 %x, 1
+  br label %join
+
+right:
+  %b = add i32 %x, 2
+  br label %join
+
+join:
+  ret i32 %x
+}
+
+; CHECK-LABEL: @dead_switch_in_loop(
+; CHECK: loop:
+; CHECK-NEXT: br label %
+define i32 @dead_switch_in_loop(i32 %n, i32 %x) {
+entry:
+  br label %header
+
+header:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %latch ]
+  br label %loop
+
+loop:
+  switch i32 %x, label %latch [
+    i32 0, label %a
+    i32 1, label %b
+    i32 2, label %a
+  ]
+
+a:
+  br label %latch
+
+b:
+  br label %latch
+
+latch:
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %header
+
+exit:
+  ret i32 %i
+}
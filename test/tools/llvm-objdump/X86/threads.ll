@@ -0,0 +1,77 @@
+; Each function is larger than the amount of code a thread disassembles at
+; once, so the section is split into several pieces. The output must not
+; depend on the number of threads.
+; RUN: llc -o %t.o -filetype=obj -mtriple=x86_64-pc-linux %s
+; RUN: llvm-objdump -d --num-threads=1 %t.o > %t.1
+; RUN: llvm-objdump -d --num-threads=4 %t.o > %t.4
+; RUN: cmp %t.1 %t.4
+; RUN: FileCheck %s < %t.4
+; RUN: llvm-objdump -d -l --num-threads=1 %t.o > %t.l1
+; RUN: llvm-objdump -d -l --num-threads=4 %t.o > %t.l4
+; RUN: cmp %t.l1 %t.l4
+; RUN: FileCheck --check-prefix=LINES %s < %t.l4
+; RUN: llvm-objdump -d -r --num-threads=1 %t.o > %t.r1
+; RUN: llvm-objdump -d -r --num-threads=4 %t.o > %t.r4
+; RUN: cmp %t.r1 %t.r4
+
+; CHECK: Disassembly of section .text:
+; CHECK-NEXT: first:
+; CHECK: second:
+; CHECK: callq {{.*}} <first>
+; CHECK: third:
+; CHECK-NOT: Disassembly of section
+
+; The end of first and the start of second share a line, so its header is
+; only printed once.
+; LINES: first:
+; LINES-NEXT: ; {{.*}}threads.c:1
+; LINES: ; {{.*}}threads.c:3
+; LINES: second:
+; LINES-NEXT: pushq
+; LINES-NOT: threads.c:3
+; LINES: ; {{.*}}threads.c:6
+; LINES-NEXT: callq
+; LINES-NEXT: ; {{.*}}threads.c:7
+; LINES: third:
+; LINES-NEXT: ; {{.*}}threads.c:8
+
+source_filename = "threads.c"
+target triple = "x86_64-unknown-linux-gnu"
+
+define void @first() !dbg !6 {
+entry:
+  call void asm sideeffect ".rept 7000\0Amovabsq $$0x1122334455667788, %rax\0A.endr", "~{rax},~{dirflag},~{fpsr},~{flags}"(), !dbg !9
+  ret void, !dbg !10
+}
+
+define void @second() !dbg !11 {
+entry:
+  call void asm sideeffect ".rept 7000\0Amovabsq $$0x1122334455667788, %rax\0A.endr", "~{rax},~{dirflag},~{fpsr},~{flags}"(), !dbg !12
+  call void @first(), !dbg !13
+  ret void, !dbg !14
+}
+
+define void @third() !dbg !15 {
+entry:
+  ret void, !dbg !16
+}
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3, !4}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: "clang", isOptimized: false, runtimeVersion: 0, emissionKind: FullDebug, enums: !2)
+!1 = !DIFile(filename: "threads.c", directory: "/tmp")
+!2 = !{}
+!3 = !{i32 2, !"Dwarf Version", i32 4}
+!4 = !{i32 2, !"Debug Info Version", i32 3}
+!6 = distinct !DISubprogram(name: "first", scope: !1, file: !1, line: 1, type: !7, isLocal: false, isDefinition: true, scopeLine: 1, isOptimized: false, unit: !0, variables: !2)
+!7 = !DISubroutineType(types: !8)
+!8 = !{null}
+!9 = !DILocation(line: 2, column: 3, scope: !6)
+!10 = !DILocation(line: 3, column: 1, scope: !6)
+!11 = distinct !DISubprogram(name: "second", scope: !1, file: !1, line: 3, type: !7, isLocal: false, isDefinition: true, scopeLine: 3, isOptimized: false, unit: !0, variables: !2)
+!12 = !DILocation(line: 3, column: 3, scope: !11)
+!13 = !DILocation(line: 6, column: 3, scope: !11)
+!14 = !DILocation(line: 7, column: 1, scope: !11)
+!15 = distinct !DISubprogram(name: "third", scope: !1, file: !1, line: 8, type: !7, isLocal: false, isDefinition: true, scopeLine: 8, isOptimized: false, unit: !0, variables: !2)
+!16 = !DILocation(line: 9, column: 1, scope: !15)
@@ -36,6 +36,7 @@
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/LEB128.h"
 #include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Target/TargetOptions.h"
 #include <memory>
@@ -1418,6 +1419,31 @@ private:
                                                  const DebugMap &Map);
   /// @}
 
+  /// An object file of the debug map together with its parsed debug
+  /// information. When linking with more than one thread, these are
+  /// filled in ahead of the link of the object they describe.
+  struct LinkContext {
+    DebugMapObject &DMO;
+    /// The holder of the object file when it was loaded ahead of time.
+    /// Otherwise the object file lives in DwarfLinker::BinHolder.
+    std::unique_ptr<BinaryHolder> Holder;
+    const object::ObjectFile *ObjectFile = nullptr;
+    /// Why loading ahead of time failed, if it did.
+    std::error_code LoadError;
+    std::unique_ptr<DWARFContextInMemory> DwarfContext;
+
+    LinkContext(DebugMapObject &DMO) : DMO(DMO) {}
+  };
+
+  /// \brief Load the object file of \p Context and parse all of its
+  /// debug info. This touches nothing but \p Context, so it can run on
+  /// any thread.
+  void preloadObject(LinkContext &Context, const Triple &TheTriple);
+
+  /// \brief Link the debug information of one object of the debug map.
+  void linkObject(LinkContext &Context, const DebugMap &Map,
+                  DebugMap &ModuleMap);
+
   std::string OutputFilename;
   LinkOptions Options;
   BinaryHolder BinHolder;
@@ -3405,6 +3431,107 @@ void DwarfLinker::DIECloner::cloneAllCompileUnits(
   }
 }
 
+void DwarfLinker::preloadObject(LinkContext &Context,
+                                const Triple &TheTriple) {
+  Context.Holder = llvm::make_unique<BinaryHolder>(Options.Verbose);
+  auto ErrOrObjs = Context.Holder->GetObjectFiles(
+      Context.DMO.getObjectFilename(), Context.DMO.getTimestamp());
+  if (std::error_code EC = ErrOrObjs.getError()) {
+    Context.LoadError = EC;
+    return;
+  }
+  auto ErrOrObj = Context.Holder->Get(TheTriple);
+  if (std::error_code EC = ErrOrObj.getError()) {
+    Context.LoadError = EC;
+    return;
+  }
+  Context.ObjectFile = &*ErrOrObj;
+
+  Context.DwarfContext =
+      llvm::make_unique<DWARFContextInMemory>(*Context.ObjectFile);
+  for (const auto &CU : Context.DwarfContext->compile_units())
+    CU->getUnitDIE(false);
+}
+
+void DwarfLinker::linkObject(LinkContext &Context, const DebugMap &Map,
+                             DebugMap &ModuleMap) {
+  DebugMapObject &Obj = Context.DMO;
+  CurrentDebugObject = &Obj;
+
+  if (Options.Verbose)
+    outs() << "DEBUG MAP OBJECT: " << Obj.getObjectFilename() << "\n";
+  if (Context.Holder) {
+    // Report load errors here rather than on the loading thread so that
+    // they come out in debug map order.
+    if (Context.LoadError) {
+      reportWarning(Twine(Obj.getObjectFilename()) + ": " +
+                    Context.LoadError.message());
+      return;
+    }
+  } else {
+    auto ErrOrObj = loadObject(BinHolder, Obj, Map);
+    if (!ErrOrObj)
+      return;
+    Context.ObjectFile = &*ErrOrObj;
+  }
+
+  // Look for relocations that correspond to debug map entries.
+  RelocationManager RelocMgr(*this);
+  if (!RelocMgr.findValidRelocsInDebugInfo(*Context.ObjectFile, Obj)) {
+    if (Options.Verbose)
+      outs() << "No valid relocations found. Skipping.\n";
+    return;
+  }
+
+  // Setup access to the debug info.
+  if (!Context.DwarfContext)
+    Context.DwarfContext =
+        llvm::make_unique<DWARFContextInMemory>(*Context.ObjectFile);
+  DWARFContextInMemory &DwarfContext = *Context.DwarfContext;
+  startDebugObject(DwarfContext, Obj);
+
+  // In a first phase, just read in the debug info and load all clang modules.
+  for (const auto &CU : DwarfContext.compile_units()) {
+    auto CUDie = CU->getUnitDIE(false);
+    if (Options.Verbose) {
+      outs() << "Input compilation unit:";
+      CUDie.dump(outs(), 0);
+    }
+
+    if (!registerModuleReference(CUDie, *CU, ModuleMap))
+      Units.push_back(llvm::make_unique<CompileUnit>(*CU, UnitID++,
+                                                     !Options.NoODR, ""));
+  }
+
+  // Now build the DIE parent links that we will use during the next phase.
+  for (auto &CurrentUnit : Units)
+    analyzeContextInfo(CurrentUnit->getOrigUnit().getUnitDIE(), 0, *CurrentUnit,
+                       &ODRContexts.getRoot(), StringPool, ODRContexts);
+
+  // Then mark all the DIEs that need to be present in the linked
+  // output and collect some information about them. Note that this
+  // loop can not be merged with the previous one becaue cross-cu
+  // references require the ParentIdx to be setup for every CU in
+  // the object file before calling this.
+  for (auto &CurrentUnit : Units)
+    lookForDIEsToKeep(RelocMgr, CurrentUnit->getOrigUnit().getUnitDIE(), Obj,
+                      *CurrentUnit, 0);
+
+  // The calls to applyValidRelocs inside cloneDIE will walk the
+  // reloc array again (in the same way findValidRelocsInDebugInfo()
+  // did). We need to reset the NextValidReloc index to the beginning.
+  RelocMgr.resetValidRelocs();
+  if (RelocMgr.hasValidRelocs())
+    DIECloner(*this, RelocMgr, DIEAlloc, Units, Options)
+        .cloneAllCompileUnits(DwarfContext);
+  if (!Options.NoOutput && !Units.empty())
+    patchFrameInfoForObject(Obj, DwarfContext,
+                            Units[0]->getOrigUnit().getAddressByteSize());
+
+  // Clean-up before starting working on the next object.
+  endDebugObject();
+}
+
 bool DwarfLinker::link(const DebugMap &Map) {
 
   if (!createStreamer(Map.getTriple(), OutputFilename))
@@ -3416,67 +3543,36 @@ bool DwarfLinker::link(const DebugMap &Map) {
   UnitID = 0;
   DebugMap ModuleMap(Map.getTriple(), Map.getBinaryPath());
 
-  for (const auto &Obj : Map.objects()) {
-    CurrentDebugObject = Obj.get();
-
-    if (Options.Verbose)
-      outs() << "DEBUG MAP OBJECT: " << Obj->getObjectFilename() << "\n";
-    auto ErrOrObj = loadObject(BinHolder, *Obj, Map);
-    if (!ErrOrObj)
-      continue;
+  std::vector<std::unique_ptr<LinkContext>> Contexts;
+  for (const auto &Obj : Map.objects())
+    Contexts.push_back(llvm::make_unique<LinkContext>(*Obj));
 
-    // Look for relocations that correspond to debug map entries.
-    RelocationManager RelocMgr(*this);
-    if (!RelocMgr.findValidRelocsInDebugInfo(*ErrOrObj, *Obj)) {
-      if (Options.Verbose)
-        outs() << "No valid relocations found. Skipping.\n";
-      continue;
+  if (Options.Threads <= 1) {
+    for (auto &Context : Contexts) {
+      linkObject(*Context, Map, ModuleMap);
+      Context.reset();
     }
-
-    // Setup access to the debug info.
-    DWARFContextInMemory DwarfContext(*ErrOrObj);
-    startDebugObject(DwarfContext, *Obj);
-
-    // In a first phase, just read in the debug info and load all clang modules.
-    for (const auto &CU : DwarfContext.compile_units()) {
-      auto CUDie = CU->getUnitDIE(false);
-      if (Options.Verbose) {
-        outs() << "Input compilation unit:";
-        CUDie.dump(outs(), 0);
+  } else {
+    // Loading an object file and parsing its DIEs depend on nothing but
+    // the object itself, so the pool does that for the objects that come
+    // next while the current one is linked. Everything that assigns unit
+    // IDs, uniques types, interns strings or emits output still runs here,
+    // one object at a time in debug map order, which keeps the output
+    // identical to a single threaded link. To bound memory use, at most
+    // Threads objects, the one being linked included, are loaded at once.
+    ThreadPool Pool(Options.Threads);
+    std::vector<std::shared_future<ThreadPool::VoidTy>> Loaded;
+    Loaded.reserve(Contexts.size());
+    for (unsigned I = 0, E = Contexts.size(); I != E; ++I) {
+      while (Loaded.size() < E && Loaded.size() < I + Options.Threads) {
+        LinkContext *Next = Contexts[Loaded.size()].get();
+        Loaded.push_back(Pool.async(
+            [this, Next, &Map]() { preloadObject(*Next, Map.getTriple()); }));
       }
-
-      if (!registerModuleReference(CUDie, *CU, ModuleMap))
-        Units.push_back(llvm::make_unique<CompileUnit>(*CU, UnitID++,
-                                                       !Options.NoODR, ""));
+      Loaded[I].wait();
+      linkObject(*Contexts[I], Map, ModuleMap);
+      Contexts[I].reset();
     }
-
-    // Now build the DIE parent links that we will use during the next phase.
-    for (auto &CurrentUnit : Units)
-      analyzeContextInfo(CurrentUnit->getOrigUnit().getUnitDIE(), 0, *CurrentUnit,
-                         &ODRContexts.getRoot(), StringPool, ODRContexts);
-
-    // Then mark all the DIEs that need to be present in the linked
-    // output and collect some information about them. Note that this
-    // loop can not be merged with the previous one becaue cross-cu
-    // references require the ParentIdx to be setup for every CU in
-    // the object file before calling this.
-    for (auto &CurrentUnit : Units)
-      lookForDIEsToKeep(RelocMgr, CurrentUnit->getOrigUnit().getUnitDIE(), *Obj,
-                        *CurrentUnit, 0);
-
-    // The calls to applyValidRelocs inside cloneDIE will walk the
-    // reloc array again (in the same way findValidRelocsInDebugInfo()
-    // did). We need to reset the NextValidReloc index to the beginning.
-    RelocMgr.resetValidRelocs();
-    if (RelocMgr.hasValidRelocs())
-      DIECloner(*this, RelocMgr, DIEAlloc, Units, Options)
-          .cloneAllCompileUnits(DwarfContext);
-    if (!Options.NoOutput && !Units.empty())
-      patchFrameInfoForObject(*Obj, DwarfContext,
-                              Units[0]->getOrigUnit().getAddressByteSize());
-
-    // Clean-up before starting working on the next object.
-    endDebugObject();
   }
 
   // Emit everything that's global.
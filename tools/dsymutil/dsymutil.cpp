@@ -24,6 +24,7 @@
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Threading.h"
 #include <cstdint>
 #include <string>
 
@@ -82,6 +83,14 @@ static opt<bool>
           desc("Do not use ODR (One Definition Rule) for type uniquing."),
           init(false), cat(DsymCategory));
 
+static opt<unsigned> NumThreads(
+    "num-threads",
+    desc("Specifies the maximum number (n) of simultaneous threads to use\n"
+         "when loading object files. Defaults to the number of cores."),
+    value_desc("n"), init(0), cat(DsymCategory));
+static alias NumThreadsA("j", desc("Alias for --num-threads"),
+                         aliasopt(NumThreads), Prefix);
+
 static opt<bool> DumpDebugMap(
     "dump-debug-map",
     desc("Parse and dump the debug map to standard output. Not DWARF link "
@@ -265,6 +274,13 @@ int main(int argc, char **argv) {
   Options.NoOutput = NoOutput;
   Options.NoODR = NoODR;
   Options.PrependPath = OsoPrependPath;
+  // Verbose output has to come out in debug map order, which only a single
+  // thread guarantees.
+  if (Verbose)
+    Options.Threads = 1;
+  else
+    Options.Threads =
+        NumThreads ? NumThreads : llvm::heavyweight_hardware_concurrency();
 
   llvm::InitializeAllTargetInfos();
   llvm::InitializeAllTargetMCs();
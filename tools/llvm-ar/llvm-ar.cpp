@@ -12,6 +12,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/IR/LLVMContext.h"
@@ -38,6 +39,7 @@
 #include <algorithm>
 #include <cstdlib>
 #include <memory>
+#include <thread>
 
 #if !defined(_MSC_VER) && !defined(__MINGW32__)
 #include <unistd.h>
@@ -96,6 +98,11 @@ static cl::opt<Format>
                          clEnumValN(GNU, "gnu", "gnu"),
                          clEnumValN(BSD, "bsd", "bsd")));
 
+static cl::opt<unsigned>
+    NumThreads("num-threads", cl::init(0),
+               cl::desc("Number of threads to use for building the symbol "
+                        "table (default: autodetect)"));
+
 static std::string Options;
 
 // Provide additional help output explaining the operations and modifiers of
@@ -427,6 +434,11 @@ static void performReadOperation(ArchiveOperation Operation,
     fail("extracting from a thin archive is not supported");
 
   bool Filter = !Members.empty();
+  // How many more members with each name to process, and how many have been
+  // found. A name given N times matches the first N members with that name.
+  StringMap<unsigned> Wanted, Found;
+  for (StringRef Name : Members)
+    ++Wanted[Name];
   {
     Error Err = Error::success();
     for (auto &C : OldArchive->children(Err)) {
@@ -435,10 +447,11 @@ static void performReadOperation(ArchiveOperation Operation,
       StringRef Name = NameOrErr.get();
 
       if (Filter) {
-        auto I = find(Members, Name);
-        if (I == Members.end())
+        auto I = Wanted.find(Name);
+        if (I == Wanted.end() || I->second == 0)
           continue;
-        Members.erase(I);
+        --I->second;
+        ++Found[Name];
       }
 
       switch (Operation) {
@@ -458,17 +471,27 @@ static void performReadOperation(ArchiveOperation Operation,
     failIfError(std::move(Err));
   }
 
-  if (Members.empty())
-    return;
-  for (StringRef Name : Members)
+  bool NotFound = false;
+  for (StringRef Name : Members) {
+    unsigned &Count = Found[Name];
+    if (Count) {
+      --Count;
+      continue;
+    }
     errs() << Name << " was not found\n";
-  std::exit(1);
+    NotFound = true;
+  }
+  if (NotFound)
+    std::exit(1);
 }
 
 static void addMember(std::vector<NewArchiveMember> &Members,
                       StringRef FileName, int Pos = -1) {
+  // The contents of a new thin archive member are only needed for the symbol
+  // table, so don't keep them all in memory until the archive is written.
   Expected<NewArchiveMember> NMOrErr =
-      NewArchiveMember::getFile(FileName, Deterministic);
+      Thin ? NewArchiveMember::getLazyFile(FileName, Deterministic)
+           : NewArchiveMember::getFile(FileName, Deterministic);
   failIfError(NMOrErr.takeError(), FileName);
   if (Pos == -1)
     Members.push_back(std::move(*NMOrErr));
@@ -674,9 +697,13 @@ performWriteOperation(ArchiveOperation Operation,
     break;
   }
 
+  unsigned Threads = NumThreads;
+  if (Threads == 0)
+    Threads = std::max(1U, std::thread::hardware_concurrency());
   std::pair<StringRef, std::error_code> Result =
       writeArchive(ArchiveName, NewMembersP ? *NewMembersP : NewMembers, Symtab,
-                   Kind, Deterministic, Thin, std::move(OldArchiveBuf));
+                   Kind, Deterministic, Thin, std::move(OldArchiveBuf),
+                   Threads);
   failIfError(Result.second, Result.first);
 }
 
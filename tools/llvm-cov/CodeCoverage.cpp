@@ -40,7 +40,11 @@ using namespace llvm;
 using namespace coverage;
 
 void exportCoverageDataToJson(const coverage::CoverageMapping &CoverageMapping,
-                              raw_ostream &OS);
+                              raw_ostream &OS, unsigned NumThreads);
+
+Error exportCoverageDataToJsonFiles(
+    const coverage::CoverageMapping &CoverageMapping, StringRef OutputDir,
+    unsigned NumThreads);
 
 namespace {
 /// \brief The implementation of the coverage tool.
@@ -330,7 +334,8 @@ std::unique_ptr<CoverageMapping> CodeCoverageTool::load() {
       warning("profile data may be out of date - object is newer",
               ObjectFilename);
   auto CoverageOrErr =
-      CoverageMapping::load(ObjectFilenames, PGOFilename, CoverageArch);
+      CoverageMapping::load(ObjectFilenames, PGOFilename, CoverageArch,
+                            ViewOpts.NumThreads);
   if (Error E = CoverageOrErr.takeError()) {
     error("Failed to load coverage: " + toString(std::move(E)),
           join(ObjectFilenames.begin(), ObjectFilenames.end(), ", "));
@@ -568,10 +573,20 @@ int CodeCoverageTool::run(Command Cmd, int argc, const char **argv) {
   cl::list<std::string> DemanglerOpts(
       "Xdemangler", cl::desc("<demangler-path>|<demangler-option>"));
 
+  cl::opt<unsigned> NumThreads(
+      "num-threads", cl::init(0),
+      cl::desc("Number of threads to use for loading coverage data and "
+               "writing reports (default: autodetect)"));
+  cl::alias NumThreadsA("j", cl::desc("Alias for --num-threads"),
+                        cl::aliasopt(NumThreads), cl::Prefix);
+
   auto commandLineParser = [&, this](int argc, const char **argv) -> int {
     cl::ParseCommandLineOptions(argc, argv, "LLVM code coverage tool\n");
     ViewOpts.Debug = DebugDump;
     CompareFilenamesOnly = FilenameEquivalence;
+    ViewOpts.NumThreads = NumThreads;
+    if (ViewOpts.NumThreads == 0)
+      ViewOpts.NumThreads = std::max(1U, std::thread::hardware_concurrency());
 
     if (!CovFilename.empty())
       ObjectFilenames.emplace_back(CovFilename);
@@ -797,15 +812,13 @@ int CodeCoverageTool::show(int argc, const char **argv,
     }
   }
 
-  // FIXME: Sink the hardware_concurrency() == 1 check into ThreadPool.
-  if (!ViewOpts.hasOutputDirectory() ||
-      std::thread::hardware_concurrency() == 1) {
+  if (!ViewOpts.hasOutputDirectory() || ViewOpts.NumThreads == 1) {
     for (const std::string &SourceFile : SourceFiles)
       writeSourceFileView(SourceFile, Coverage.get(), Printer.get(),
                           ShowFilenames);
   } else {
     // In -output-dir mode, it's safe to use multiple threads to print files.
-    ThreadPool Pool;
+    ThreadPool Pool(ViewOpts.NumThreads);
     for (const std::string &SourceFile : SourceFiles)
       Pool.async(&CodeCoverageTool::writeSourceFileView, this, SourceFile,
                  Coverage.get(), Printer.get(), ShowFilenames);
@@ -839,6 +852,13 @@ int CodeCoverageTool::report(int argc, const char **argv,
 int CodeCoverageTool::export_(int argc, const char **argv,
                               CommandLineParserType commandLineParser) {
 
+  cl::opt<std::string> ExportOutputDirectory(
+      "output-dir", cl::init(""),
+      cl::desc("Directory in which to write one JSON document per source "
+               "file, along with an index of them"));
+  cl::alias ExportOutputDirectoryA("o", cl::desc("Alias for --output-dir"),
+                                   cl::aliasopt(ExportOutputDirectory));
+
   auto Err = commandLineParser(argc, argv);
   if (Err)
     return Err;
@@ -849,7 +869,16 @@ int CodeCoverageTool::export_(int argc, const char **argv,
     return 1;
   }
 
-  exportCoverageDataToJson(*Coverage.get(), outs());
+  if (ExportOutputDirectory.empty()) {
+    exportCoverageDataToJson(*Coverage.get(), outs(), ViewOpts.NumThreads);
+    return 0;
+  }
+
+  if (Error E = exportCoverageDataToJsonFiles(
+          *Coverage.get(), ExportOutputDirectory, ViewOpts.NumThreads)) {
+    error("Could not export coverage information", toString(std::move(E)));
+    return 1;
+  }
 
   return 0;
 }
@@ -39,12 +39,27 @@
 // ------ InstantiationCoverage: dict => Object summarizing inst. coverage
 // ------ RegionCoverage: dict => Object summarizing region coverage
 //
+// With -output-dir, every source file gets a document of its own in the
+// format above, holding just that file, the functions with regions in it and
+// the file's summary as the totals. The documents are written to
+// <output-dir>/coverage/<path of the file>.json, next to an index:
+// Root: dict => Root Element containing metadata
+// -- Data: array => Homogeneous array of one index object
+// ---- Index: dict => Json representation of one CoverageMapping
+// ------ Files: array => List of objects describing the files
+// -------- File: dict => The file's name, summary and document path
+// ------ Totals: dict => Object summarizing the coverage for the binary
+//
 //===----------------------------------------------------------------------===//
 
 #include "CoverageReport.h"
 #include "CoverageSummaryInfo.h"
 #include "CoverageViewOptions.h"
 #include "llvm/ProfileData/Coverage/CoverageMapping.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
+#include <mutex>
 #include <stack>
 
 /// \brief The semantic version combined as a string.
@@ -53,6 +68,11 @@
 /// \brief Unique type identifier for JSON coverage export.
 #define LLVM_COVERAGE_EXPORT_JSON_TYPE_STR "llvm.coverage.json.export"
 
+/// \brief Unique type identifier for the index of a JSON coverage export
+/// written to a directory.
+#define LLVM_COVERAGE_EXPORT_JSON_INDEX_TYPE_STR                               \
+  "llvm.coverage.json.export.index"
+
 using namespace llvm;
 using namespace coverage;
 
@@ -63,6 +83,9 @@ class CoverageExporterJson {
   /// \brief The full CoverageMapping object to export.
   const CoverageMapping &Coverage;
 
+  /// \brief The number of threads to summarize the files on.
+  unsigned NumThreads;
+
   /// \brief States that the JSON rendering machine can be in.
   enum JsonState { None, NonEmptyElement, EmptyElement };
 
@@ -152,6 +175,21 @@ class CoverageExporterJson {
 
   /// \brief Render the CoverageMapping object.
   void renderRoot() {
+    FileCoverageSummary Totals = FileCoverageSummary("Totals");
+    std::vector<std::string> SourceFiles;
+    for (StringRef SF : Coverage.getUniqueSourceFiles())
+      SourceFiles.emplace_back(SF);
+    auto FileReports = CoverageReport::prepareFileReports(
+        Coverage, Totals, SourceFiles, NumThreads);
+    renderExport(SourceFiles, FileReports, Coverage.getCoveredFunctions(),
+                 Totals);
+  }
+
+  /// \brief Render a whole document exporting the given files and functions.
+  void renderExport(ArrayRef<std::string> SourceFiles,
+                    ArrayRef<FileCoverageSummary> FileReports,
+                    const iterator_range<FunctionRecordIterator> &Functions,
+                    const FileCoverageSummary &Totals) {
     // Start Root of JSON object.
     emitDictStart();
 
@@ -166,17 +204,10 @@ class CoverageExporterJson {
     emitDictStart();
 
     emitDictKey("files");
-
-    FileCoverageSummary Totals = FileCoverageSummary("Totals");
-    std::vector<std::string> SourceFiles;
-    for (StringRef SF : Coverage.getUniqueSourceFiles())
-      SourceFiles.emplace_back(SF);
-    auto FileReports =
-        CoverageReport::prepareFileReports(Coverage, Totals, SourceFiles);
     renderFiles(SourceFiles, FileReports);
 
     emitDictKey("functions");
-    renderFunctions(Coverage.getCoveredFunctions());
+    renderFunctions(Functions);
 
     emitDictKey("totals");
     renderSummary(Totals);
@@ -403,19 +434,175 @@ class CoverageExporterJson {
   }
 
 public:
-  CoverageExporterJson(const CoverageMapping &CoverageMapping, raw_ostream &OS)
-      : OS(OS), Coverage(CoverageMapping) {
+  CoverageExporterJson(const CoverageMapping &CoverageMapping, raw_ostream &OS,
+                       unsigned NumThreads = 1)
+      : OS(OS), Coverage(CoverageMapping), NumThreads(NumThreads) {
     State.push(JsonState::None);
   }
 
   /// \brief Print the CoverageMapping.
   void print() { renderRoot(); }
+
+  /// \brief Print the document for one source file.
+  void printFile(const std::string &SourceFile,
+                 const FileCoverageSummary &FileReport) {
+    renderExport(SourceFile, FileReport,
+                 Coverage.getCoveredFunctions(SourceFile), FileReport);
+  }
+
+  /// \brief Print the index of the per-file documents, which are at
+  /// \p FilePaths relative to the index.
+  void printIndex(ArrayRef<std::string> SourceFiles,
+                  ArrayRef<FileCoverageSummary> FileReports,
+                  ArrayRef<std::string> FilePaths,
+                  const FileCoverageSummary &Totals) {
+    // Start Root of JSON object.
+    emitDictStart();
+
+    emitDictElement("version", LLVM_COVERAGE_EXPORT_JSON_STR);
+    emitDictElement("type", LLVM_COVERAGE_EXPORT_JSON_INDEX_TYPE_STR);
+    emitDictKey("data");
+
+    // Start List of Indexes.
+    emitArrayStart();
+
+    // Start Index.
+    emitDictStart();
+
+    emitDictKey("files");
+
+    // Start List of Files.
+    emitArrayStart();
+    for (unsigned I = 0, E = SourceFiles.size(); I < E; ++I) {
+      // Start File.
+      emitDictStart();
+      emitDictElement("filename", SourceFiles[I]);
+      emitDictElement("path", FilePaths[I]);
+      emitDictKey("summary");
+      renderSummary(FileReports[I]);
+      // End File.
+      emitDictEnd();
+    }
+    // End List of Files.
+    emitArrayEnd();
+
+    emitDictKey("totals");
+    renderSummary(Totals);
+
+    // End Index.
+    emitDictEnd();
+
+    // End List of Indexes.
+    emitArrayEnd();
+
+    // End Root of JSON Object.
+    emitDictEnd();
+
+    assert((State.top() == JsonState::None) &&
+           "All Elements In JSON were Closed");
+  }
 };
 
 /// \brief Export the given CoverageMapping to a JSON Format.
 void exportCoverageDataToJson(const CoverageMapping &CoverageMapping,
-                              raw_ostream &OS) {
-  auto Exporter = CoverageExporterJson(CoverageMapping, OS);
+                              raw_ostream &OS, unsigned NumThreads) {
+  auto Exporter = CoverageExporterJson(CoverageMapping, OS, NumThreads);
 
   Exporter.print();
 }
+
+/// \brief Get the path of the JSON document for \p SourceFile, relative to
+/// the output directory.
+static std::string getJsonFilePath(StringRef SourceFile) {
+  SmallString<256> Path("coverage");
+  SmallString<256> ParentPath = sys::path::parent_path(SourceFile);
+  sys::path::remove_dots(ParentPath, /*remove_dot_dots=*/true);
+  sys::path::append(Path, sys::path::relative_path(ParentPath));
+  sys::path::append(Path, sys::path::filename(SourceFile) + ".json");
+  return Path.str();
+}
+
+/// \brief Write the JSON document for one source file to \p Path.
+static std::error_code writeJsonFile(const CoverageMapping &CoverageMapping,
+                                     const std::string &SourceFile,
+                                     const FileCoverageSummary &FileReport,
+                                     StringRef Path) {
+  if (std::error_code EC =
+          sys::fs::create_directories(sys::path::parent_path(Path)))
+    return EC;
+  std::error_code EC;
+  raw_fd_ostream OS(Path, EC, sys::fs::F_Text);
+  if (EC)
+    return EC;
+  CoverageExporterJson(CoverageMapping, OS).printFile(SourceFile, FileReport);
+  OS.close();
+  if (OS.has_error()) {
+    OS.clear_error();
+    return std::make_error_code(std::errc::io_error);
+  }
+  return std::error_code();
+}
+
+/// \brief Export the given CoverageMapping to one JSON document per source
+/// file in \p OutputDir, plus an index of them. Each document is written out
+/// as soon as it is rendered, on up to \p NumThreads threads.
+Error exportCoverageDataToJsonFiles(const CoverageMapping &CoverageMapping,
+                                    StringRef OutputDir, unsigned NumThreads) {
+  FileCoverageSummary Totals = FileCoverageSummary("Totals");
+  std::vector<std::string> SourceFiles;
+  for (StringRef SF : CoverageMapping.getUniqueSourceFiles())
+    SourceFiles.emplace_back(SF);
+  auto FileReports = CoverageReport::prepareFileReports(
+      CoverageMapping, Totals, SourceFiles, NumThreads);
+
+  std::vector<std::string> FilePaths;
+  for (const std::string &SourceFile : SourceFiles)
+    FilePaths.push_back(getJsonFilePath(SourceFile));
+
+  // Report the error for the first file, in file order, that failed.
+  std::mutex ErrorLock;
+  unsigned ErrorFile = SourceFiles.size();
+  std::error_code ErrorCode;
+  auto WriteFile = [&](unsigned I) {
+    SmallString<256> Path(OutputDir);
+    sys::path::append(Path, FilePaths[I]);
+    if (std::error_code EC = writeJsonFile(CoverageMapping, SourceFiles[I],
+                                           FileReports[I], Path)) {
+      std::lock_guard<std::mutex> Lock(ErrorLock);
+      if (I < ErrorFile) {
+        ErrorFile = I;
+        ErrorCode = EC;
+      }
+    }
+  };
+  if (NumThreads <= 1 || SourceFiles.size() <= 1) {
+    for (unsigned I = 0, E = SourceFiles.size(); I < E; ++I)
+      WriteFile(I);
+  } else {
+    ThreadPool Pool(std::min<size_t>(NumThreads, SourceFiles.size()));
+    for (unsigned I = 0, E = SourceFiles.size(); I < E; ++I)
+      Pool.async(WriteFile, I);
+    Pool.wait();
+  }
+  if (ErrorCode)
+    return make_error<StringError>(SourceFiles[ErrorFile] + ": " +
+                                       ErrorCode.message(),
+                                   ErrorCode);
+
+  SmallString<256> IndexPath(OutputDir);
+  sys::path::append(IndexPath, "index.json");
+  std::error_code EC;
+  raw_fd_ostream OS(IndexPath, EC, sys::fs::F_Text);
+  if (!EC) {
+    CoverageExporterJson(CoverageMapping, OS)
+        .printIndex(SourceFiles, FileReports, FilePaths, Totals);
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      EC = std::make_error_code(std::errc::io_error);
+    }
+  }
+  if (EC)
+    return make_error<StringError>(IndexPath + ": " + EC.message(), EC);
+  return Error::success();
+}
@@ -17,6 +17,7 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
 #include <numeric>
 
 using namespace llvm;
@@ -272,42 +273,59 @@ void CoverageReport::renderFunctionReports(ArrayRef<std::string> Files,
   }
 }
 
+/// \brief Summarize the coverage of the functions whose first file is
+/// \p Filename into \p Summary.
+static void prepareSingleFileReport(StringRef Filename,
+                                    const coverage::CoverageMapping *Coverage,
+                                    FileCoverageSummary *Summary) {
+  // Map source locations to aggregate function coverage summaries.
+  DenseMap<std::pair<unsigned, unsigned>, FunctionCoverageSummary> Summaries;
+
+  for (const auto &F : Coverage->getCoveredFunctions(Filename)) {
+    FunctionCoverageSummary Function = FunctionCoverageSummary::get(F);
+    auto StartLoc = F.CountedRegions[0].startLoc();
+
+    auto UniquedSummary = Summaries.insert({StartLoc, Function});
+    if (!UniquedSummary.second)
+      UniquedSummary.first->second.update(Function);
+
+    Summary->addInstantiation(Function);
+  }
+
+  for (const auto &UniquedSummary : Summaries)
+    Summary->addFunction(UniquedSummary.second);
+}
+
 std::vector<FileCoverageSummary>
 CoverageReport::prepareFileReports(const coverage::CoverageMapping &Coverage,
                                    FileCoverageSummary &Totals,
-                                   ArrayRef<std::string> Files) {
+                                   ArrayRef<std::string> Files,
+                                   unsigned NumThreads) {
   std::vector<FileCoverageSummary> FileReports;
   unsigned LCP = 0;
   if (Files.size() > 1)
     LCP = getLongestCommonPrefixLen(Files);
 
-  for (StringRef Filename : Files) {
-    FileCoverageSummary Summary(Filename.drop_front(LCP));
-
-    // Map source locations to aggregate function coverage summaries.
-    DenseMap<std::pair<unsigned, unsigned>, FunctionCoverageSummary> Summaries;
-
-    for (const auto &F : Coverage.getCoveredFunctions(Filename)) {
-      FunctionCoverageSummary Function = FunctionCoverageSummary::get(F);
-      auto StartLoc = F.CountedRegions[0].startLoc();
-
-      auto UniquedSummary = Summaries.insert({StartLoc, Function});
-      if (!UniquedSummary.second)
-        UniquedSummary.first->second.update(Function);
-
-      Summary.addInstantiation(Function);
-      Totals.addInstantiation(Function);
-    }
-
-    for (const auto &UniquedSummary : Summaries) {
-      const FunctionCoverageSummary &FCS = UniquedSummary.second;
-      Summary.addFunction(FCS);
-      Totals.addFunction(FCS);
-    }
-
-    FileReports.push_back(Summary);
+  FileReports.reserve(Files.size());
+  for (StringRef Filename : Files)
+    FileReports.emplace_back(Filename.drop_front(LCP));
+
+  // The files are summarized independently of each other, so they can be
+  // spread over a pool. The totals are added up afterwards, in file order.
+  if (NumThreads <= 1 || Files.size() <= 1) {
+    for (unsigned I = 0, E = Files.size(); I < E; ++I)
+      prepareSingleFileReport(Files[I], &Coverage, &FileReports[I]);
+  } else {
+    ThreadPool Pool(std::min<size_t>(NumThreads, Files.size()));
+    for (unsigned I = 0, E = Files.size(); I < E; ++I)
+      Pool.async(prepareSingleFileReport, Files[I], &Coverage,
+                 &FileReports[I]);
+    Pool.wait();
   }
 
+  for (const FileCoverageSummary &Summary : FileReports)
+    Totals += Summary;
+
   return FileReports;
 }
 
@@ -321,7 +339,8 @@ void CoverageReport::renderFileReports(raw_ostream &OS) const {
 void CoverageReport::renderFileReports(raw_ostream &OS,
                                        ArrayRef<std::string> Files) const {
   FileCoverageSummary Totals("TOTAL");
-  auto FileReports = prepareFileReports(Coverage, Totals, Files);
+  auto FileReports =
+      prepareFileReports(Coverage, Totals, Files, Options.NumThreads);
 
   std::vector<StringRef> Filenames;
   for (const FileCoverageSummary &FCS : FileReports)
@@ -34,10 +34,12 @@ public:
 
   void renderFunctionReports(ArrayRef<std::string> Files, raw_ostream &OS);
 
-  /// Prepare file reports for the files specified in \p Files.
+  /// Prepare file reports for the files specified in \p Files, using up to
+  /// \p NumThreads threads.
   static std::vector<FileCoverageSummary>
   prepareFileReports(const coverage::CoverageMapping &Coverage,
-                     FileCoverageSummary &Totals, ArrayRef<std::string> Files);
+                     FileCoverageSummary &Totals, ArrayRef<std::string> Files,
+                     unsigned NumThreads = 1);
 
   /// Render file reports for every unique file in the coverage mapping.
   void renderFileReports(raw_ostream &OS) const;
@@ -391,7 +391,8 @@ Error CoveragePrinterHTML::createIndexFile(
   emitColumnLabelsForIndex(OSRef);
   FileCoverageSummary Totals("TOTALS");
   auto FileReports =
-      CoverageReport::prepareFileReports(Coverage, Totals, SourceFiles);
+      CoverageReport::prepareFileReports(Coverage, Totals, SourceFiles,
+                                         Opts.NumThreads);
   for (unsigned I = 0, E = FileReports.size(); I < E; ++I)
     emitFileSummary(OSRef, SourceFiles[I], FileReports[I]);
   emitFileSummary(OSRef, "Totals", Totals, /*IsTotals=*/true);
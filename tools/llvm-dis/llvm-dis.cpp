@@ -64,6 +64,10 @@ static cl::opt<bool>
                         cl::desc("Load module without materializing metadata, "
                                  "then materialize only the metadata"));
 
+static cl::opt<unsigned>
+    Threads("j", cl::Prefix, cl::init(1),
+            cl::desc("Number of threads to print functions with"));
+
 namespace {
 
 static void printDebugLoc(const DebugLoc &DL, formatted_raw_ostream &OS) {
@@ -196,7 +200,8 @@ int main(int argc, char **argv) {
 
   // All that llvm-dis does is write the assembly to a file.
   if (!DontPrint)
-    M->print(Out->os(), Annotator.get(), PreserveAssemblyUseListOrder);
+    M->print(Out->os(), Annotator.get(), PreserveAssemblyUseListOrder,
+             /*IsForDebug=*/false, Threads);
 
   // Declare success.
   Out->keep();
@@ -1,10 +1,12 @@
 #ifndef TOOLS_LLVM_DWP_DWPSTRINGPOOL
 #define TOOLS_LLVM_DWP_DWPSTRINGPOOL
 
+#include "DWPWriter.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/MC/MCSection.h"
-#include "llvm/MC/MCStreamer.h"
+#include "llvm/Support/Allocator.h"
 #include <cassert>
+#include <cstring>
 
 namespace llvm {
 class DWPStringPool {
@@ -30,25 +32,32 @@ class DWPStringPool {
     }
   };
 
-  MCStreamer &Out;
+  DWPWriter &Out;
   MCSection *Sec;
   DenseMap<const char *, uint32_t, CStrDenseMapInfo> Pool;
+  /// The pool keeps its own copy of each string so that the input files can
+  /// be released once they have been merged.
+  BumpPtrAllocator Alloc;
   uint32_t Offset = 0;
 
 public:
-  DWPStringPool(MCStreamer &Out, MCSection *Sec) : Out(Out), Sec(Sec) {}
+  DWPStringPool(DWPWriter &Out, MCSection *Sec) : Out(Out), Sec(Sec) {}
 
   uint32_t getOffset(const char *Str, unsigned Length) {
     assert(strlen(Str) + 1 == Length && "Ensure length hint is correct");
 
-    auto Pair = Pool.insert(std::make_pair(Str, Offset));
-    if (Pair.second) {
-      Out.SwitchSection(Sec);
-      Out.EmitBytes(StringRef(Str, Length));
-      Offset += Length;
-    }
+    auto I = Pool.find(Str);
+    if (I != Pool.end())
+      return I->second;
 
-    return Pair.first->second;
+    char *Copy = Alloc.Allocate<char>(Length);
+    memcpy(Copy, Str, Length);
+    Pool.insert(std::make_pair(Copy, Offset));
+    Out.switchSection(Sec);
+    Out.emitBytes(StringRef(Str, Length));
+    uint32_t Result = Offset;
+    Offset += Length;
+    return Result;
   }
 };
 }
@@ -0,0 +1,191 @@
+#include "DWPWriter.h"
+#include "DWPError.h"
+#include "llvm/MC/MCSectionELF.h"
+#include "llvm/Support/ELF.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/FileOutputBuffer.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Signals.h"
+#include <cstring>
+
+using namespace llvm;
+
+DWPWriter::~DWPWriter() {}
+
+Error MCDWPWriter::finish() {
+  Out.Finish();
+  return Error::success();
+}
+
+StreamingDWPWriter::~StreamingDWPWriter() {
+  for (SectionFile &S : Sections) {
+    S.OS.reset();
+    sys::fs::remove(S.Path);
+    sys::DontRemoveFileOnSignal(S.Path);
+  }
+}
+
+void StreamingDWPWriter::switchSection(MCSection *Sec) {
+  auto P = SectionIndex.insert(std::make_pair(Sec, Sections.size()));
+  if (P.second) {
+    Sections.emplace_back();
+    SectionFile &S = Sections.back();
+    S.Sec = Sec;
+    int FD;
+    if (std::error_code TmpEC =
+            sys::fs::createTemporaryFile("llvm-dwp", "sec", FD, S.Path)) {
+      if (!EC)
+        EC = TmpEC;
+    } else {
+      sys::RemoveFileOnSignal(S.Path);
+      S.OS = llvm::make_unique<raw_fd_ostream>(FD, /*shouldClose=*/true);
+    }
+  }
+  Cur = &Sections[P.first->second];
+}
+
+void StreamingDWPWriter::emitBytes(StringRef Data) {
+  assert(Cur && "no current section");
+  Cur->Size += Data.size();
+  if (Cur->OS)
+    *Cur->OS << Data;
+}
+
+void StreamingDWPWriter::emitIntValue(uint64_t Value, unsigned Size) {
+  assert(Cur && "no current section");
+  assert((Size == 4 || Size == 8) && "unsupported integer size");
+  Cur->Size += Size;
+  if (!Cur->OS)
+    return;
+  support::endian::Writer<support::little> W(*Cur->OS);
+  if (Size == 4)
+    W.write<uint32_t>(Value);
+  else
+    W.write<uint64_t>(Value);
+}
+
+Error StreamingDWPWriter::finish() {
+  if (EC)
+    return make_error<DWPError>("cannot create temporary file: " +
+                                EC.message());
+  for (SectionFile &S : Sections) {
+    S.OS->close();
+    if (S.OS->has_error())
+      return make_error<DWPError>(
+          (Twine("error writing temporary file '") + S.Path + "'").str());
+  }
+
+  // The package is laid out as the ELF header, the section contents in the
+  // order they were first switched to, the section name table and then the
+  // section headers: a null one, one per section and one for the names.
+  SmallString<256> ShStrTab;
+  ShStrTab.push_back('\0');
+  std::vector<uint32_t> NameOffsets;
+  std::vector<uint64_t> Offsets;
+  uint64_t Offset = sizeof(ELF::Elf64_Ehdr);
+  for (SectionFile &S : Sections) {
+    NameOffsets.push_back(ShStrTab.size());
+    ShStrTab += cast<MCSectionELF>(S.Sec)->getSectionName();
+    ShStrTab.push_back('\0');
+    Offsets.push_back(Offset);
+    Offset += S.Size;
+  }
+  uint32_t ShStrTabName = ShStrTab.size();
+  ShStrTab += ".shstrtab";
+  ShStrTab.push_back('\0');
+  uint64_t ShStrTabOffset = Offset;
+  uint64_t ShOff = alignTo(ShStrTabOffset + ShStrTab.size(), 8);
+  unsigned NumSections = Sections.size() + 2;
+  uint64_t FileSize = ShOff + NumSections * sizeof(ELF::Elf64_Shdr);
+
+  // Build the headers in memory; they are small.
+  SmallString<64> Header;
+  SmallString<1024> SectionHeaders;
+  {
+    raw_svector_ostream OS(Header);
+    support::endian::Writer<support::little> W(OS);
+    OS << ELF::ElfMagic;
+    W.write<uint8_t>(ELF::ELFCLASS64);
+    W.write<uint8_t>(ELF::ELFDATA2LSB);
+    W.write<uint8_t>(ELF::EV_CURRENT);
+    W.write<uint8_t>(ELF::ELFOSABI_NONE);
+    for (unsigned I = ELF::EI_ABIVERSION; I != ELF::EI_NIDENT; ++I)
+      W.write<uint8_t>(0);
+    W.write<uint16_t>(ELF::ET_REL);
+    W.write<uint16_t>(Machine);
+    W.write<uint32_t>(ELF::EV_CURRENT);
+    W.write<uint64_t>(0); // e_entry
+    W.write<uint64_t>(0); // e_phoff
+    W.write<uint64_t>(ShOff);
+    W.write<uint32_t>(0); // e_flags
+    W.write<uint16_t>(sizeof(ELF::Elf64_Ehdr));
+    W.write<uint16_t>(0); // e_phentsize
+    W.write<uint16_t>(0); // e_phnum
+    W.write<uint16_t>(sizeof(ELF::Elf64_Shdr));
+    W.write<uint16_t>(NumSections);
+    W.write<uint16_t>(NumSections - 1); // e_shstrndx
+  }
+  {
+    raw_svector_ostream OS(SectionHeaders);
+    support::endian::Writer<support::little> W(OS);
+    auto WriteHeader = [&](uint32_t Name, uint32_t Type, uint64_t Flags,
+                           uint64_t Offset, uint64_t Size, uint64_t EntSize) {
+      W.write<uint32_t>(Name);
+      W.write<uint32_t>(Type);
+      W.write<uint64_t>(Flags);
+      W.write<uint64_t>(0); // sh_addr
+      W.write<uint64_t>(Offset);
+      W.write<uint64_t>(Size);
+      W.write<uint32_t>(0); // sh_link
+      W.write<uint32_t>(0); // sh_info
+      W.write<uint64_t>(Type == ELF::SHT_NULL ? 0 : 1); // sh_addralign
+      W.write<uint64_t>(EntSize);
+    };
+    WriteHeader(0, ELF::SHT_NULL, 0, 0, 0, 0);
+    for (unsigned I = 0, E = Sections.size(); I != E; ++I) {
+      const auto &Sec = *cast<MCSectionELF>(Sections[I].Sec);
+      WriteHeader(NameOffsets[I], Sec.getType(), Sec.getFlags(), Offsets[I],
+                  Sections[I].Size, Sec.getEntrySize());
+    }
+    WriteHeader(ShStrTabName, ELF::SHT_STRTAB, 0, ShStrTabOffset,
+                ShStrTab.size(), 0);
+  }
+
+  auto BufferOrErr = FileOutputBuffer::create(OutputFilename, FileSize);
+  if (std::error_code EC = BufferOrErr.getError())
+    return make_error<DWPError>(OutputFilename + ": " + EC.message());
+  std::unique_ptr<FileOutputBuffer> &Buffer = *BufferOrErr;
+  uint8_t *Buf = Buffer->getBufferStart();
+  memset(Buf, 0, FileSize);
+
+  memcpy(Buf, Header.data(), Header.size());
+  // Copy each section in from its temporary file, one at a time, and drop
+  // the file as soon as it has been copied.
+  for (unsigned I = 0, E = Sections.size(); I != E; ++I) {
+    SectionFile &S = Sections[I];
+    if (S.Size) {
+      auto MBOrErr = MemoryBuffer::getFile(S.Path, /*FileSize=*/-1,
+                                           /*RequiresNullTerminator=*/false);
+      if (std::error_code EC = MBOrErr.getError())
+        return make_error<DWPError>((Twine("cannot read temporary file '") + S.Path +
+                                     "': " + EC.message())
+                                        .str());
+      if ((*MBOrErr)->getBufferSize() != S.Size)
+        return make_error<DWPError>(
+            (Twine("temporary file '") + S.Path + "' has the wrong size").str());
+      memcpy(Buf + Offsets[I], (*MBOrErr)->getBufferStart(), S.Size);
+    }
+    S.OS.reset();
+    sys::fs::remove(S.Path);
+    sys::DontRemoveFileOnSignal(S.Path);
+  }
+  Sections.clear();
+  memcpy(Buf + ShStrTabOffset, ShStrTab.data(), ShStrTab.size());
+  memcpy(Buf + ShOff, SectionHeaders.data(), SectionHeaders.size());
+
+  if (std::error_code EC = Buffer->commit())
+    return make_error<DWPError>(OutputFilename + ": " + EC.message());
+  return Error::success();
+}
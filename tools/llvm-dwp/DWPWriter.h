@@ -0,0 +1,81 @@
+#ifndef TOOLS_LLVM_DWP_DWPWRITER
+#define TOOLS_LLVM_DWP_DWPWRITER
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/MC/MCSection.h"
+#include "llvm/MC/MCStreamer.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/raw_ostream.h"
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace llvm {
+
+/// The sink for the sections of a DWARF package. Sections are identified by
+/// the MCSection that MCObjectFileInfo has for them.
+class DWPWriter {
+public:
+  virtual ~DWPWriter();
+
+  virtual void switchSection(MCSection *Sec) = 0;
+  virtual void emitBytes(StringRef Data) = 0;
+  virtual void emitIntValue(uint64_t Value, unsigned Size) = 0;
+
+  /// Write out the package. No other method may be called afterwards.
+  virtual Error finish() = 0;
+};
+
+/// Writes the package through an MCStreamer, which holds every section in
+/// memory until the package is finished.
+class MCDWPWriter : public DWPWriter {
+  MCStreamer &Out;
+
+public:
+  MCDWPWriter(MCStreamer &Out) : Out(Out) {}
+
+  void switchSection(MCSection *Sec) override { Out.SwitchSection(Sec); }
+  void emitBytes(StringRef Data) override { Out.EmitBytes(Data); }
+  void emitIntValue(uint64_t Value, unsigned Size) override {
+    Out.EmitIntValue(Value, Size);
+  }
+  Error finish() override;
+};
+
+/// Writes each section to its own temporary file as it is produced and only
+/// puts the ELF object together in finish(), copying the section payloads
+/// into a FileOutputBuffer. Memory use does not grow with the size of the
+/// package. The sections must be ELF sections of a little endian 64 bit
+/// target.
+class StreamingDWPWriter : public DWPWriter {
+  struct SectionFile {
+    MCSection *Sec;
+    SmallString<128> Path;
+    std::unique_ptr<raw_fd_ostream> OS;
+    uint64_t Size = 0;
+  };
+
+  std::string OutputFilename;
+  uint16_t Machine;
+  std::vector<SectionFile> Sections;
+  DenseMap<MCSection *, unsigned> SectionIndex;
+  SectionFile *Cur = nullptr;
+  /// The first error creating a temporary file, reported by finish().
+  std::error_code EC;
+
+public:
+  StreamingDWPWriter(StringRef OutputFilename, uint16_t Machine)
+      : OutputFilename(OutputFilename), Machine(Machine) {}
+  ~StreamingDWPWriter() override;
+
+  void switchSection(MCSection *Sec) override;
+  void emitBytes(StringRef Data) override;
+  void emitIntValue(uint64_t Value, unsigned Size) override;
+  Error finish() override;
+};
+}
+
+#endif
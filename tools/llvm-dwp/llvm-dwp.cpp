@@ -13,6 +13,7 @@
 //===----------------------------------------------------------------------===//
 #include "DWPError.h"
 #include "DWPStringPool.h"
+#include "DWPWriter.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringSet.h"
@@ -30,6 +31,7 @@
 #include "llvm/Object/ObjectFile.h"
 #include "llvm/Support/Compression.h"
 #include "llvm/Support/DataExtractor.h"
+#include "llvm/Support/ELF.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MathExtras.h"
@@ -56,7 +58,13 @@ static opt<std::string> OutputFilename(Required, "o",
                                        value_desc("filename"),
                                        cat(DwpCategory));
 
-static void writeStringsAndOffsets(MCStreamer &Out, DWPStringPool &Strings,
+static opt<bool> Streaming(
+    "streaming",
+    desc("Write the package section by section through temporary files "
+         "instead of building it in memory."),
+    init(false), cat(DwpCategory));
+
+static void writeStringsAndOffsets(DWPWriter &Out, DWPStringPool &Strings,
                                    MCSection *StrOffsetSection,
                                    StringRef CurStrSection,
                                    StringRef CurStrOffsetSection) {
@@ -78,14 +86,14 @@ static void writeStringsAndOffsets(MCStreamer &Out, DWPStringPool &Strings,
 
   Data = DataExtractor(CurStrOffsetSection, true, 0);
 
-  Out.SwitchSection(StrOffsetSection);
+  Out.switchSection(StrOffsetSection);
 
   uint32_t Offset = 0;
   uint64_t Size = CurStrOffsetSection.size();
   while (Offset < Size) {
     auto OldOffset = Data.getU32(&Offset);
     auto NewOffset = OffsetRemapping[OldOffset];
-    Out.EmitIntValue(NewOffset, 4);
+    Out.emitIntValue(NewOffset, 4);
   }
 }
 
@@ -205,10 +213,10 @@ static StringRef getSubsection(StringRef Section,
 }
 
 static void addAllTypesFromDWP(
-    MCStreamer &Out, MapVector<uint64_t, UnitIndexEntry> &TypeIndexEntries,
+    DWPWriter &Out, MapVector<uint64_t, UnitIndexEntry> &TypeIndexEntries,
     const DWARFUnitIndex &TUIndex, MCSection *OutputTypes, StringRef Types,
     const UnitIndexEntry &TUEntry, uint32_t &TypesOffset) {
-  Out.SwitchSection(OutputTypes);
+  Out.switchSection(OutputTypes);
   for (const DWARFUnitIndex::Entry &E : TUIndex.getRows()) {
     auto *I = E.getOffsets();
     if (!I)
@@ -226,7 +234,7 @@ static void addAllTypesFromDWP(
       ++I;
     }
     auto &C = Entry.Contributions[DW_SECT_TYPES - DW_SECT_INFO];
-    Out.EmitBytes(Types.substr(
+    Out.emitBytes(Types.substr(
         C.Offset - TUEntry.Contributions[DW_SECT_TYPES - DW_SECT_INFO].Offset,
         C.Length));
     C.Offset = TypesOffset;
@@ -234,13 +242,13 @@ static void addAllTypesFromDWP(
   }
 }
 
-static void addAllTypes(MCStreamer &Out,
+static void addAllTypes(DWPWriter &Out,
                         MapVector<uint64_t, UnitIndexEntry> &TypeIndexEntries,
                         MCSection *OutputTypes,
                         const std::vector<StringRef> &TypesSections,
                         const UnitIndexEntry &CUEntry, uint32_t &TypesOffset) {
   for (StringRef Types : TypesSections) {
-    Out.SwitchSection(OutputTypes);
+    Out.switchSection(OutputTypes);
     uint32_t Offset = 0;
     DataExtractor Data(Types, true, 0);
     while (Data.isValidOffset(Offset)) {
@@ -263,24 +271,24 @@ static void addAllTypes(MCStreamer &Out,
       if (!P.second)
         continue;
 
-      Out.EmitBytes(Types.substr(PrevOffset, C.Length));
+      Out.emitBytes(Types.substr(PrevOffset, C.Length));
       TypesOffset += C.Length;
     }
   }
 }
 
 static void
-writeIndexTable(MCStreamer &Out, ArrayRef<unsigned> ContributionOffsets,
+writeIndexTable(DWPWriter &Out, ArrayRef<unsigned> ContributionOffsets,
                 const MapVector<uint64_t, UnitIndexEntry> &IndexEntries,
                 uint32_t DWARFUnitIndex::Entry::SectionContribution::*Field) {
   for (const auto &E : IndexEntries)
     for (size_t i = 0; i != array_lengthof(E.second.Contributions); ++i)
       if (ContributionOffsets[i])
-        Out.EmitIntValue(E.second.Contributions[i].*Field, 4);
+        Out.emitIntValue(E.second.Contributions[i].*Field, 4);
 }
 
 static void
-writeIndex(MCStreamer &Out, MCSection *Section,
+writeIndex(DWPWriter &Out, MCSection *Section,
            ArrayRef<unsigned> ContributionOffsets,
            const MapVector<uint64_t, UnitIndexEntry> &IndexEntries) {
   if (IndexEntries.empty())
@@ -307,24 +315,24 @@ writeIndex(MCStreamer &Out, MCSection *Section,
     ++i;
   }
 
-  Out.SwitchSection(Section);
-  Out.EmitIntValue(2, 4);                   // Version
-  Out.EmitIntValue(Columns, 4);             // Columns
-  Out.EmitIntValue(IndexEntries.size(), 4); // Num Units
-  Out.EmitIntValue(Buckets.size(), 4);      // Num Buckets
+  Out.switchSection(Section);
+  Out.emitIntValue(2, 4);                   // Version
+  Out.emitIntValue(Columns, 4);             // Columns
+  Out.emitIntValue(IndexEntries.size(), 4); // Num Units
+  Out.emitIntValue(Buckets.size(), 4);      // Num Buckets
 
   // Write the signatures.
   for (const auto &I : Buckets)
-    Out.EmitIntValue(I ? IndexEntries.begin()[I - 1].first : 0, 8);
+    Out.emitIntValue(I ? IndexEntries.begin()[I - 1].first : 0, 8);
 
   // Write the indexes.
   for (const auto &I : Buckets)
-    Out.EmitIntValue(I, 4);
+    Out.emitIntValue(I, 4);
 
   // Write the column headers (which sections will appear in the table)
   for (size_t i = 0; i != ContributionOffsets.size(); ++i)
     if (ContributionOffsets[i])
-      Out.EmitIntValue(i + DW_SECT_INFO, 4);
+      Out.emitIntValue(i + DW_SECT_INFO, 4);
 
   // Write the offsets.
   writeIndexTable(Out, ContributionOffsets, IndexEntries,
@@ -392,7 +400,7 @@ static Error handleSection(
     const StringMap<std::pair<MCSection *, DWARFSectionKind>> &KnownSections,
     const MCSection *StrSection, const MCSection *StrOffsetSection,
     const MCSection *TypesSection, const MCSection *CUIndexSection,
-    const MCSection *TUIndexSection, const SectionRef &Section, MCStreamer &Out,
+    const MCSection *TUIndexSection, const SectionRef &Section, DWPWriter &Out,
     std::deque<SmallString<32>> &UncompressedSections,
     uint32_t (&ContributionOffsets)[8], UnitIndexEntry &CurEntry,
     StringRef &CurStrSection, StringRef &CurStrOffsetSection,
@@ -454,8 +462,8 @@ static Error handleSection(
   else if (OutSection == TUIndexSection)
     CurTUIndexSection = Contents;
   else {
-    Out.SwitchSection(OutSection);
-    Out.EmitBytes(Contents);
+    Out.switchSection(OutSection);
+    Out.emitBytes(Contents);
   }
   return Error::success();
 }
@@ -470,8 +478,8 @@ buildDuplicateError(const std::pair<uint64_t, UnitIndexEntry> &PrevE,
       " and " + buildDWODescription(ID.Name, DWPName, ID.DWOName));
 }
 
-static Error write(MCStreamer &Out, ArrayRef<std::string> Inputs) {
-  const auto &MCOFI = *Out.getContext().getObjectFileInfo();
+static Error write(DWPWriter &Out, const MCObjectFileInfo &MCOFI,
+                   ArrayRef<std::string> Inputs) {
   MCSection *const StrSection = MCOFI.getDwarfStrDWOSection();
   MCSection *const StrOffsetSection = MCOFI.getDwarfStrOffDWOSection();
   MCSection *const TypesSection = MCOFI.getDwarfTypesDWOSection();
@@ -495,9 +503,9 @@ static Error write(MCStreamer &Out, ArrayRef<std::string> Inputs) {
 
   DWPStringPool Strings(Out, StrSection);
 
-  SmallVector<OwningBinary<object::ObjectFile>, 128> Objects;
-  Objects.reserve(Inputs.size());
-
+  // Everything that outlives an input (index entries, strings) is copied out
+  // of it, so each input and its decompressed sections are released as soon
+  // as they have been merged.
   std::deque<SmallString<32>> UncompressedSections;
 
   for (const auto &Input : Inputs) {
@@ -506,7 +514,7 @@ static Error write(MCStreamer &Out, ArrayRef<std::string> Inputs) {
       return ErrOrObj.takeError();
 
     auto &Obj = *ErrOrObj->getBinary();
-    Objects.push_back(std::move(*ErrOrObj));
+    UncompressedSections.clear();
 
     UnitIndexEntry CurEntry = {};
 
@@ -617,6 +625,17 @@ static int error(const Twine &Error, const Twine &Context) {
   return 1;
 }
 
+static int writePackage(DWPWriter &Out, const MCObjectFileInfo &MOFI) {
+  Error Err = write(Out, MOFI, InputFiles);
+  if (!Err)
+    Err = Out.finish();
+  if (Err) {
+    logAllUnhandledErrors(std::move(Err), errs(), "error: ");
+    return 1;
+  }
+  return 0;
+}
+
 int main(int argc, char **argv) {
 
   ParseCommandLineOptions(argc, argv, "merge split dwarf (.dwo) files");
@@ -651,6 +670,11 @@ int main(int argc, char **argv) {
   MCContext MC(MAI.get(), MRI.get(), &MOFI);
   MOFI.InitMCObjectFileInfo(TheTriple, /*PIC*/ false, CodeModel::Default, MC);
 
+  if (Streaming) {
+    StreamingDWPWriter Out(OutputFilename, ELF::EM_X86_64);
+    return writePackage(Out, MOFI);
+  }
+
   MCTargetOptions Options;
   auto MAB = TheTarget->createMCAsmBackend(*MRI, TripleName, "", Options);
   if (!MAB)
@@ -683,10 +707,6 @@ int main(int argc, char **argv) {
   if (!MS)
     return error("no object streamer for target " + TripleName, Context);
 
-  if (auto Err = write(*MS, InputFiles)) {
-    logAllUnhandledErrors(std::move(Err), errs(), "error: ");
-    return 1;
-  }
-
-  MS->Finish();
+  MCDWPWriter Out(*MS);
+  return writePackage(Out, MOFI);
 }
@@ -300,10 +300,15 @@ static bool linkFiles(const char *argv0, LLVMContext &Context, Linker &L,
 
     // Note that when ODR merging types cannot verify input files in here When
     // doing that debug metadata in the src module might already be pointing to
-    // the destination.
-    if (DisableDITypeMap && verifyModule(*M, &errs())) {
-      errs() << argv0 << ": " << File << ": error: input module is broken!\n";
-      return false;
+    // the destination. Function bodies are loaded lazily, textual IR included,
+    // so materialize them first or the verifier would skip them.
+    if (DisableDITypeMap) {
+      ExitOnErr(M->materializeAll());
+      if (verifyModule(*M, &errs())) {
+        errs() << argv0 << ": " << File
+               << ": error: input module is broken!\n";
+        return false;
+      }
     }
 
     // If a module summary index is supplied, load it so linkInModule can treat
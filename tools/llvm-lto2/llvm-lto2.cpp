@@ -89,6 +89,10 @@ static cl::opt<std::string> DefaultTriple(
     cl::desc(
         "Replace unspecified target triples in input files with this triple"));
 
+static cl::opt<bool>
+    DisableFree("disable-free", cl::init(false),
+                cl::desc("Do not tear down the LTO state before exiting"));
+
 static void check(Error E, std::string Msg) {
   if (!E)
     return;
@@ -203,7 +207,7 @@ int main(int argc, char **argv) {
     Backend = createWriteIndexesThinBackend("", "", true, "");
   else
     Backend = createInProcessThinBackend(Threads);
-  LTO Lto(std::move(Conf), std::move(Backend));
+  auto Lto = llvm::make_unique<LTO>(std::move(Conf), std::move(Backend));
 
   bool HasErrors = false;
   for (std::string F : InputFilenames) {
@@ -230,7 +234,7 @@ int main(int argc, char **argv) {
       continue;
 
     MBs.push_back(std::move(MB));
-    check(Lto.add(std::move(Input), Res), F);
+    check(Lto->add(std::move(Input), Res), F);
   }
 
   if (!CommandLineResolutions.empty()) {
@@ -266,5 +270,11 @@ int main(int argc, char **argv) {
   if (!CacheDir.empty())
     Cache = localCache(CacheDir, AddFile);
 
-  check(Lto.run(AddStream, Cache), "LTO::run failed");
+  check(Lto->run(AddStream, Cache), "LTO::run failed");
+
+  // The outputs are all written by now, so there is no need to give the
+  // memory back piece by piece. Leaking the LTO object also leaks the context
+  // that owns the regular LTO modules.
+  if (DisableFree)
+    Lto.release();
 }
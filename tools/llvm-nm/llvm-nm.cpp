@@ -39,12 +39,15 @@
 #include "llvm/Support/Program.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cctype>
 #include <cerrno>
 #include <cstring>
+#include <deque>
 #include <system_error>
+#include <thread>
 #include <vector>
 
 using namespace llvm;
@@ -168,6 +171,11 @@ cl::opt<bool> FormatMachOasHex("x", cl::desc("Print symbol entry in hex, "
 cl::opt<bool> NoLLVMBitcode("no-llvm-bc",
                             cl::desc("Disable LLVM bitcode reader"));
 
+cl::opt<unsigned>
+    NumThreads("num-threads", cl::init(0),
+               cl::desc("Number of threads to use for the members of "
+                        "archives (default: autodetect)"));
+
 bool PrintAddress = true;
 
 bool MultipleFiles = false;
@@ -177,9 +185,15 @@ bool HadError = false;
 std::string ToolName;
 } // anonymous namespace
 
+// printError() writes an error message to ErrOS without setting HadError, for
+// code that may run on several threads at once. The caller has to set it.
+static void printError(raw_ostream &ErrOS, Twine Message, Twine Path) {
+  ErrOS << ToolName << ": " << Path << ": " << Message << ".\n";
+}
+
 static void error(Twine Message, Twine Path = Twine()) {
   HadError = true;
-  errs() << ToolName << ": " << Path << ": " << Message << ".\n";
+  printError(errs(), Message, Path);
 }
 
 static bool error(std::error_code EC, Twine Path = Twine()) {
@@ -190,13 +204,11 @@ static bool error(std::error_code EC, Twine Path = Twine()) {
   return false;
 }
 
-// This version of error() prints the archive name and member name, for example:
-// "libx.a(foo.o)" after the ToolName before the error message.  It sets
-// HadError but returns allowing the code to move on to other archive members. 
-static void error(llvm::Error E, StringRef FileName, const Archive::Child &C,
-                  StringRef ArchitectureName = StringRef()) {
-  HadError = true;
-  errs() << ToolName << ": " << FileName;
+// This version of printError() prints the archive name and member name, for
+// example: "libx.a(foo.o)" after the ToolName before the error message.
+static void printError(raw_ostream &ErrOS, llvm::Error E, StringRef FileName,
+                       const Archive::Child &C, StringRef ArchitectureName) {
+  ErrOS << ToolName << ": " << FileName;
 
   Expected<StringRef> NameOrErr = C.getName();
   // TODO: if we have a error getting the name then it would be nice to print
@@ -204,18 +216,27 @@ static void error(llvm::Error E, StringRef FileName, const Archive::Child &C,
   // archive instead of "???" as the name.
   if (!NameOrErr) {
     consumeError(NameOrErr.takeError());
-    errs() << "(" << "???" << ")";
+    ErrOS << "(" << "???" << ")";
   } else
-    errs() << "(" << NameOrErr.get() << ")";
+    ErrOS << "(" << NameOrErr.get() << ")";
 
   if (!ArchitectureName.empty())
-    errs() << " (for architecture " << ArchitectureName << ") ";
+    ErrOS << " (for architecture " << ArchitectureName << ") ";
 
   std::string Buf;
   raw_string_ostream OS(Buf);
   logAllUnhandledErrors(std::move(E), OS, "");
   OS.flush();
-  errs() << " " << Buf << "\n";
+  ErrOS << " " << Buf << "\n";
+}
+
+// This version of error() prints the archive name and member name, for example:
+// "libx.a(foo.o)" after the ToolName before the error message.  It sets
+// HadError but returns allowing the code to move on to other archive members. 
+static void error(llvm::Error E, StringRef FileName, const Archive::Child &C,
+                  StringRef ArchitectureName = StringRef()) {
+  HadError = true;
+  printError(errs(), std::move(E), FileName, C, ArchitectureName);
 }
 
 // This version of error() prints the file name and which architecture slice it
@@ -242,14 +263,25 @@ struct NMSymbol {
   uint64_t Address;
   uint64_t Size;
   char TypeChar;
+  uint32_t Flags;
   StringRef Name;
   BasicSymbolRef Sym;
 };
+
+// A symbol as it is sorted: the leading part of the sort order packed into
+// integers and where the symbol is in the list. Sorting these moves far less
+// memory than sorting the symbols, and symbols are only compared in full when
+// the leading parts are equal.
+struct SymbolSortKey {
+  uint32_t High;
+  uint32_t Index;
+  uint64_t Low;
+};
 } // anonymous namespace
 
 static bool compareSymbolAddress(const NMSymbol &A, const NMSymbol &B) {
-  bool ADefined = !(A.Sym.getFlags() & SymbolRef::SF_Undefined);
-  bool BDefined = !(B.Sym.getFlags() & SymbolRef::SF_Undefined);
+  bool ADefined = !(A.Flags & SymbolRef::SF_Undefined);
+  bool BDefined = !(B.Flags & SymbolRef::SF_Undefined);
   return std::make_tuple(ADefined, A.Address, A.Name, A.Size) <
          std::make_tuple(BDefined, B.Address, B.Name, B.Size);
 }
@@ -274,9 +306,7 @@ static char isSymbolList64Bit(SymbolicFile &Obj) {
   return cast<ELFObjectFileBase>(Obj).getBytesInAddress() == 8;
 }
 
-static StringRef CurrentFilename;
 typedef std::vector<NMSymbol> SymbolListT;
-static SymbolListT SymbolList;
 
 static char getSymbolNMTypeChar(IRObjectFile &Obj, basic_symbol_iterator I);
 
@@ -285,9 +315,10 @@ static char getSymbolNMTypeChar(IRObjectFile &Obj, basic_symbol_iterator I);
 // the darwin format it produces the same output as darwin's nm(1) -m output
 // and when printing Mach-O symbols in hex it produces the same output as
 // darwin's nm(1) -x format.
-static void darwinPrintSymbol(SymbolicFile &Obj, SymbolListT::iterator I,
-                              char *SymbolAddrStr, const char *printBlanks,
-                              const char *printDashes, const char *printFormat) {
+static void darwinPrintSymbol(raw_ostream &OS, SymbolicFile &Obj,
+                              SymbolListT::iterator I, char *SymbolAddrStr,
+                              const char *printBlanks, const char *printDashes,
+                              const char *printFormat) {
   MachO::mach_header H;
   MachO::mach_header_64 H_64;
   uint32_t Filetype = MachO::MH_OBJECT;
@@ -299,7 +330,7 @@ static void darwinPrintSymbol(SymbolicFile &Obj, SymbolListT::iterator I,
   uint64_t NValue = 0;
   MachOObjectFile *MachO = dyn_cast<MachOObjectFile>(&Obj);
   if (Obj.isIR()) {
-    uint32_t SymFlags = I->Sym.getFlags();
+    uint32_t SymFlags = I->Flags;
     if (SymFlags & SymbolRef::SF_Global)
       NType |= MachO::N_EXT;
     if (SymFlags & SymbolRef::SF_Hidden)
@@ -349,16 +380,16 @@ static void darwinPrintSymbol(SymbolicFile &Obj, SymbolListT::iterator I,
   if (FormatMachOasHex) {
     char Str[18] = "";
     format(printFormat, NValue).print(Str, sizeof(Str));
-    outs() << Str << ' ';
+    OS << Str << ' ';
     format("%02x", NType).print(Str, sizeof(Str));
-    outs() << Str << ' ';
+    OS << Str << ' ';
     format("%02x", NSect).print(Str, sizeof(Str));
-    outs() << Str << ' ';
+    OS << Str << ' ';
     format("%04x", NDesc).print(Str, sizeof(Str));
-    outs() << Str << ' ';
+    OS << Str << ' ';
     format("%08x", NStrx).print(Str, sizeof(Str));
-    outs() << Str << ' ';
-    outs() << I->Name << "\n";
+    OS << Str << ' ';
+    OS << I->Name << "\n";
     return;
   }
 
@@ -367,58 +398,58 @@ static void darwinPrintSymbol(SymbolicFile &Obj, SymbolListT::iterator I,
       strcpy(SymbolAddrStr, printBlanks);
     if (Obj.isIR() && (NType & MachO::N_TYPE) == MachO::N_TYPE)
       strcpy(SymbolAddrStr, printDashes);
-    outs() << SymbolAddrStr << ' ';
+    OS << SymbolAddrStr << ' ';
   }
 
   switch (NType & MachO::N_TYPE) {
   case MachO::N_UNDF:
     if (NValue != 0) {
-      outs() << "(common) ";
+      OS << "(common) ";
       if (MachO::GET_COMM_ALIGN(NDesc) != 0)
-        outs() << "(alignment 2^" << (int)MachO::GET_COMM_ALIGN(NDesc) << ") ";
+        OS << "(alignment 2^" << (int)MachO::GET_COMM_ALIGN(NDesc) << ") ";
     } else {
       if ((NType & MachO::N_TYPE) == MachO::N_PBUD)
-        outs() << "(prebound ";
+        OS << "(prebound ";
       else
-        outs() << "(";
+        OS << "(";
       if ((NDesc & MachO::REFERENCE_TYPE) ==
           MachO::REFERENCE_FLAG_UNDEFINED_LAZY)
-        outs() << "undefined [lazy bound]) ";
+        OS << "undefined [lazy bound]) ";
       else if ((NDesc & MachO::REFERENCE_TYPE) ==
                MachO::REFERENCE_FLAG_PRIVATE_UNDEFINED_LAZY)
-        outs() << "undefined [private lazy bound]) ";
+        OS << "undefined [private lazy bound]) ";
       else if ((NDesc & MachO::REFERENCE_TYPE) ==
                MachO::REFERENCE_FLAG_PRIVATE_UNDEFINED_NON_LAZY)
-        outs() << "undefined [private]) ";
+        OS << "undefined [private]) ";
       else
-        outs() << "undefined) ";
+        OS << "undefined) ";
     }
     break;
   case MachO::N_ABS:
-    outs() << "(absolute) ";
+    OS << "(absolute) ";
     break;
   case MachO::N_INDR:
-    outs() << "(indirect) ";
+    OS << "(indirect) ";
     break;
   case MachO::N_SECT: {
     if (Obj.isIR()) {
       // For llvm bitcode files print out a fake section name using the values
       // use 1, 2 and 3 for section numbers as set above.
       if (NSect == 1)
-        outs() << "(LTO,CODE) ";
+        OS << "(LTO,CODE) ";
       else if (NSect == 2)
-        outs() << "(LTO,DATA) ";
+        OS << "(LTO,DATA) ";
       else if (NSect == 3)
-        outs() << "(LTO,RODATA) ";
+        OS << "(LTO,RODATA) ";
       else
-        outs() << "(?,?) ";
+        OS << "(?,?) ";
       break;
     }
     Expected<section_iterator> SecOrErr =
       MachO->getSymbolSection(I->Sym.getRawDataRefImpl());
     if (!SecOrErr) {
       consumeError(SecOrErr.takeError());
-      outs() << "(?,?) ";
+      OS << "(?,?) ";
       break;
     }
     section_iterator Sec = *SecOrErr;
@@ -426,67 +457,67 @@ static void darwinPrintSymbol(SymbolicFile &Obj, SymbolListT::iterator I,
     StringRef SectionName;
     MachO->getSectionName(Ref, SectionName);
     StringRef SegmentName = MachO->getSectionFinalSegmentName(Ref);
-    outs() << "(" << SegmentName << "," << SectionName << ") ";
+    OS << "(" << SegmentName << "," << SectionName << ") ";
     break;
   }
   default:
-    outs() << "(?) ";
+    OS << "(?) ";
     break;
   }
 
   if (NType & MachO::N_EXT) {
     if (NDesc & MachO::REFERENCED_DYNAMICALLY)
-      outs() << "[referenced dynamically] ";
+      OS << "[referenced dynamically] ";
     if (NType & MachO::N_PEXT) {
       if ((NDesc & MachO::N_WEAK_DEF) == MachO::N_WEAK_DEF)
-        outs() << "weak private external ";
+        OS << "weak private external ";
       else
-        outs() << "private external ";
+        OS << "private external ";
     } else {
       if ((NDesc & MachO::N_WEAK_REF) == MachO::N_WEAK_REF ||
           (NDesc & MachO::N_WEAK_DEF) == MachO::N_WEAK_DEF) {
         if ((NDesc & (MachO::N_WEAK_REF | MachO::N_WEAK_DEF)) ==
             (MachO::N_WEAK_REF | MachO::N_WEAK_DEF))
-          outs() << "weak external automatically hidden ";
+          OS << "weak external automatically hidden ";
         else
-          outs() << "weak external ";
+          OS << "weak external ";
       } else
-        outs() << "external ";
+        OS << "external ";
     }
   } else {
     if (NType & MachO::N_PEXT)
-      outs() << "non-external (was a private external) ";
+      OS << "non-external (was a private external) ";
     else
-      outs() << "non-external ";
+      OS << "non-external ";
   }
 
   if (Filetype == MachO::MH_OBJECT &&
       (NDesc & MachO::N_NO_DEAD_STRIP) == MachO::N_NO_DEAD_STRIP)
-    outs() << "[no dead strip] ";
+    OS << "[no dead strip] ";
 
   if (Filetype == MachO::MH_OBJECT &&
       ((NType & MachO::N_TYPE) != MachO::N_UNDF) &&
       (NDesc & MachO::N_SYMBOL_RESOLVER) == MachO::N_SYMBOL_RESOLVER)
-    outs() << "[symbol resolver] ";
+    OS << "[symbol resolver] ";
 
   if (Filetype == MachO::MH_OBJECT &&
       ((NType & MachO::N_TYPE) != MachO::N_UNDF) &&
       (NDesc & MachO::N_ALT_ENTRY) == MachO::N_ALT_ENTRY)
-    outs() << "[alt entry] ";
+    OS << "[alt entry] ";
 
   if ((NDesc & MachO::N_ARM_THUMB_DEF) == MachO::N_ARM_THUMB_DEF)
-    outs() << "[Thumb] ";
+    OS << "[Thumb] ";
 
   if ((NType & MachO::N_TYPE) == MachO::N_INDR) {
-    outs() << I->Name << " (for ";
+    OS << I->Name << " (for ";
     StringRef IndirectName;
     if (!MachO ||
         MachO->getIndirectName(I->Sym.getRawDataRefImpl(), IndirectName))
-      outs() << "?)";
+      OS << "?)";
     else
-      outs() << IndirectName << ")";
+      OS << IndirectName << ")";
   } else
-    outs() << I->Name;
+    OS << I->Name;
 
   if ((Flags & MachO::MH_TWOLEVEL) == MachO::MH_TWOLEVEL &&
       (((NType & MachO::N_TYPE) == MachO::N_UNDF && NValue == 0) ||
@@ -494,21 +525,21 @@ static void darwinPrintSymbol(SymbolicFile &Obj, SymbolListT::iterator I,
     uint32_t LibraryOrdinal = MachO::GET_LIBRARY_ORDINAL(NDesc);
     if (LibraryOrdinal != 0) {
       if (LibraryOrdinal == MachO::EXECUTABLE_ORDINAL)
-        outs() << " (from executable)";
+        OS << " (from executable)";
       else if (LibraryOrdinal == MachO::DYNAMIC_LOOKUP_ORDINAL)
-        outs() << " (dynamically looked up)";
+        OS << " (dynamically looked up)";
       else {
         StringRef LibraryName;
         if (!MachO ||
             MachO->getLibraryShortNameByIndex(LibraryOrdinal - 1, LibraryName))
-          outs() << " (from bad library ordinal " << LibraryOrdinal << ")";
+          OS << " (from bad library ordinal " << LibraryOrdinal << ")";
         else
-          outs() << " (from " << LibraryName << ")";
+          OS << " (from " << LibraryName << ")";
       }
     }
   }
 
-  outs() << "\n";
+  OS << "\n";
 }
 
 // Table that maps Darwin's Mach-O stab constants to strings to allow printing.
@@ -560,7 +591,8 @@ static const char *getDarwinStabString(uint8_t NType) {
 
 // darwinPrintStab() prints the n_sect, n_desc along with a symbolic name of
 // a stab n_type value in a Mach-O file.
-static void darwinPrintStab(MachOObjectFile *MachO, SymbolListT::iterator I) {
+static void darwinPrintStab(raw_ostream &OS, MachOObjectFile *MachO,
+                            SymbolListT::iterator I) {
   MachO::nlist_64 STE_64;
   MachO::nlist STE;
   uint8_t NType;
@@ -581,44 +613,95 @@ static void darwinPrintStab(MachOObjectFile *MachO, SymbolListT::iterator I) {
 
   char Str[18] = "";
   format("%02x", NSect).print(Str, sizeof(Str));
-  outs() << ' ' << Str << ' ';
+  OS << ' ' << Str << ' ';
   format("%04x", NDesc).print(Str, sizeof(Str));
-  outs() << Str << ' ';
+  OS << Str << ' ';
   if (const char *stabString = getDarwinStabString(NType))
     format("%5.5s", stabString).print(Str, sizeof(Str));
   else
     format("   %02x", NType).print(Str, sizeof(Str));
-  outs() << Str;
+  OS << Str;
 }
 
 static bool symbolIsDefined(const NMSymbol &Sym) {
   return Sym.TypeChar != 'U' && Sym.TypeChar != 'w' && Sym.TypeChar != 'v';
 }
 
-static void sortAndPrintSymbolList(SymbolicFile &Obj, bool printName,
-                                   const std::string &ArchiveName,
-                                   const std::string &ArchitectureName) {
-  if (!NoSort) {
-    std::function<bool(const NMSymbol &, const NMSymbol &)> Cmp;
-    if (NumericSort)
-      Cmp = compareSymbolAddress;
-    else if (SizeSort)
-      Cmp = compareSymbolSize;
-    else
-      Cmp = compareSymbolName;
+// Returns Bytes bytes of Name starting at Offset, the first one most
+// significant and padded with zeros, so that comparing them compares that
+// part of the names.
+static uint64_t packNameBytes(StringRef Name, size_t Offset, unsigned Bytes) {
+  uint64_t Packed = 0;
+  for (size_t I = Offset, E = Offset + Bytes; I != E; ++I)
+    Packed = (Packed << 8) | (I < Name.size() ? (uint8_t)Name[I] : 0);
+  return Packed;
+}
 
-    if (ReverseSort)
-      Cmp = [=](const NMSymbol &A, const NMSymbol &B) { return Cmp(B, A); };
-    std::sort(SymbolList.begin(), SymbolList.end(), Cmp);
+static void sortSymbolList(SymbolListT &SymbolList) {
+  bool (*Cmp)(const NMSymbol &, const NMSymbol &);
+  if (NumericSort)
+    Cmp = compareSymbolAddress;
+  else if (SizeSort)
+    Cmp = compareSymbolSize;
+  else
+    Cmp = compareSymbolName;
+
+  std::vector<SymbolSortKey> Keys;
+  Keys.reserve(SymbolList.size());
+  for (uint32_t I = 0, E = SymbolList.size(); I != E; ++I) {
+    const NMSymbol &S = SymbolList[I];
+    SymbolSortKey Key;
+    Key.Index = I;
+    if (NumericSort) {
+      Key.High = !(S.Flags & SymbolRef::SF_Undefined);
+      Key.Low = S.Address;
+    } else if (SizeSort) {
+      Key.High = 0;
+      Key.Low = S.Size;
+    } else {
+      Key.High = packNameBytes(S.Name, 0, 4);
+      Key.Low = packNameBytes(S.Name, 4, 8);
+    }
+    Keys.push_back(Key);
   }
 
+  auto Less = [&](const SymbolSortKey &A, const SymbolSortKey &B) {
+    if (A.High != B.High)
+      return A.High < B.High;
+    if (A.Low != B.Low)
+      return A.Low < B.Low;
+    return Cmp(SymbolList[A.Index], SymbolList[B.Index]);
+  };
+  if (ReverseSort)
+    std::sort(Keys.begin(), Keys.end(),
+              [&](const SymbolSortKey &A, const SymbolSortKey &B) {
+                return Less(B, A);
+              });
+  else
+    std::sort(Keys.begin(), Keys.end(), Less);
+
+  SymbolListT Sorted;
+  Sorted.reserve(SymbolList.size());
+  for (const SymbolSortKey &Key : Keys)
+    Sorted.push_back(SymbolList[Key.Index]);
+  SymbolList.swap(Sorted);
+}
+
+static void sortAndPrintSymbolList(raw_ostream &OS, SymbolicFile &Obj,
+                                   SymbolListT &SymbolList,
+                                   StringRef CurrentFilename, bool printName,
+                                   StringRef ArchiveName,
+                                   StringRef ArchitectureName) {
+  if (!NoSort)
+    sortSymbolList(SymbolList);
+
   if (!PrintFileName) {
     if (OutputFormat == posix && MultipleFiles && printName) {
-      outs() << '\n' << CurrentFilename << ":\n";
+      OS << '\n' << CurrentFilename << ":\n";
     } else if (OutputFormat == bsd && MultipleFiles && printName) {
-      outs() << "\n" << CurrentFilename << ":\n";
+      OS << "\n" << CurrentFilename << ":\n";
     } else if (OutputFormat == sysv) {
-      outs() << "\n\nSymbols from " << CurrentFilename << ":\n\n"
+      OS << "\n\nSymbols from " << CurrentFilename << ":\n\n"
              << "Name                  Value   Class        Type"
              << "         Size   Line  Section\n";
     }
@@ -655,7 +738,7 @@ static void sortAndPrintSymbolList(SymbolicFile &Obj, bool printName,
 
   for (SymbolListT::iterator I = SymbolList.begin(), E = SymbolList.end();
        I != E; ++I) {
-    uint32_t SymFlags = I->Sym.getFlags();
+    uint32_t SymFlags = I->Flags;
     bool Undefined = SymFlags & SymbolRef::SF_Undefined;
     bool Global = SymFlags & SymbolRef::SF_Global;
     if ((!Undefined && UndefinedOnly) || (Undefined && DefinedOnly) ||
@@ -663,18 +746,18 @@ static void sortAndPrintSymbolList(SymbolicFile &Obj, bool printName,
       continue;
     if (PrintFileName) {
       if (!ArchitectureName.empty())
-        outs() << "(for architecture " << ArchitectureName << "):";
+        OS << "(for architecture " << ArchitectureName << "):";
       if (OutputFormat == posix && !ArchiveName.empty())
-        outs() << ArchiveName << "[" << CurrentFilename << "]: ";
+        OS << ArchiveName << "[" << CurrentFilename << "]: ";
       else {
         if (!ArchiveName.empty())
-          outs() << ArchiveName << ":";
-        outs() << CurrentFilename << ": ";
+          OS << ArchiveName << ":";
+        OS << CurrentFilename << ": ";
       }
     }
     if ((JustSymbolName || (UndefinedOnly && isa<MachOObjectFile>(Obj) &&
                             OutputFormat != darwin)) && OutputFormat != posix) {
-      outs() << I->Name << "\n";
+      OS << I->Name << "\n";
       continue;
     }
 
@@ -711,35 +794,33 @@ static void sortAndPrintSymbolList(SymbolicFile &Obj, bool printName,
     // OutputFormat bsd (see below).
     MachOObjectFile *MachO = dyn_cast<MachOObjectFile>(&Obj);
     if ((OutputFormat == darwin || FormatMachOasHex) && (MachO || Obj.isIR())) {
-      darwinPrintSymbol(Obj, I, SymbolAddrStr, printBlanks, printDashes,
+      darwinPrintSymbol(OS, Obj, I, SymbolAddrStr, printBlanks, printDashes,
                         printFormat);
     } else if (OutputFormat == posix) {
-      outs() << I->Name << " " << I->TypeChar << " ";
+      OS << I->Name << " " << I->TypeChar << " ";
       if (MachO)
-        outs() << SymbolAddrStr << " " << "0" /* SymbolSizeStr */ << "\n";
+        OS << SymbolAddrStr << " " << "0" /* SymbolSizeStr */ << "\n";
       else
-        outs() << SymbolAddrStr << " " << SymbolSizeStr << "\n";
+        OS << SymbolAddrStr << " " << SymbolSizeStr << "\n";
     } else if (OutputFormat == bsd || (OutputFormat == darwin && !MachO)) {
       if (PrintAddress)
-        outs() << SymbolAddrStr << ' ';
+        OS << SymbolAddrStr << ' ';
       if (PrintSize) {
-        outs() << SymbolSizeStr;
-        outs() << ' ';
+        OS << SymbolSizeStr;
+        OS << ' ';
       }
-      outs() << I->TypeChar;
+      OS << I->TypeChar;
       if (I->TypeChar == '-' && MachO)
-        darwinPrintStab(MachO, I);
-      outs() << " " << I->Name << "\n";
+        darwinPrintStab(OS, MachO, I);
+      OS << " " << I->Name << "\n";
     } else if (OutputFormat == sysv) {
       std::string PaddedName(I->Name);
       while (PaddedName.length() < 20)
         PaddedName += " ";
-      outs() << PaddedName << "|" << SymbolAddrStr << "|   " << I->TypeChar
+      OS << PaddedName << "|" << SymbolAddrStr << "|   " << I->TypeChar
              << "  |                  |" << SymbolSizeStr << "|     |\n";
     }
   }
-
-  SymbolList.clear();
 }
 
 static char getSymbolNMTypeChar(ELFObjectFileBase &Obj,
@@ -967,23 +1048,29 @@ static unsigned getNsectInMachO(MachOObjectFile &Obj, BasicSymbolRef Sym) {
   return (STE.n_type & MachO::N_TYPE) == MachO::N_SECT ? STE.n_sect : 0;
 }
 
-static void
-dumpSymbolNamesFromObject(SymbolicFile &Obj, bool printName,
-                          const std::string &ArchiveName = std::string(),
-                          const std::string &ArchitectureName = std::string()) {
+// printSymbolNamesFromObject() prints the symbols of Obj to OS and errors to
+// ErrOS, and returns true if there was an error. It does not touch any global
+// state, so it can run on several objects at once.
+static bool printSymbolNamesFromObject(raw_ostream &OS, raw_ostream &ErrOS,
+                                       SymbolicFile &Obj, bool printName,
+                                       StringRef ArchiveName,
+                                       StringRef ArchitectureName) {
+  bool HadErr = false;
   auto Symbols = Obj.symbols();
   if (DynamicSyms) {
     const auto *E = dyn_cast<ELFObjectFileBase>(&Obj);
     if (!E) {
-      error("File format has no dynamic symbol table", Obj.getFileName());
-      return;
+      printError(ErrOS, "File format has no dynamic symbol table",
+                 Obj.getFileName());
+      return true;
     }
     auto DynSymbols = E->getDynamicSymbolIterators();
     Symbols =
         make_range<basic_symbol_iterator>(DynSymbols.begin(), DynSymbols.end());
   }
+  SymbolListT SymbolList;
   std::string NameBuffer;
-  raw_string_ostream OS(NameBuffer);
+  raw_string_ostream NameOS(NameBuffer);
   // If a "-s segname sectname" option was specified and this is a Mach-O
   // file get the section number for that section in this object file.
   unsigned int Nsect = 0;
@@ -992,7 +1079,7 @@ dumpSymbolNamesFromObject(SymbolicFile &Obj, bool printName,
     Nsect = getNsectForSegSect(MachO);
     // If this section is not in the object file no symbols are printed.
     if (Nsect == 0)
-      return;
+      return false;
   }
   for (BasicSymbolRef Sym : Symbols) {
     uint32_t SymFlags = Sym.getFlags();
@@ -1022,33 +1109,46 @@ dumpSymbolNamesFromObject(SymbolicFile &Obj, bool printName,
       S.Address = *AddressOrErr;
     }
     S.TypeChar = getNMTypeChar(Obj, Sym);
-    std::error_code EC = Sym.printName(OS);
-    if (EC && MachO)
-      OS << "bad string index";
-    else
-      error(EC);
-    OS << '\0';
+    S.Flags = SymFlags;
+    std::error_code EC = Sym.printName(NameOS);
+    if (EC && MachO) {
+      NameOS << "bad string index";
+    } else if (EC) {
+      printError(ErrOS, EC.message(), Twine());
+      HadErr = true;
+    }
+    NameOS << '\0';
     S.Sym = Sym;
     SymbolList.push_back(S);
   }
 
-  OS.flush();
+  NameOS.flush();
   const char *P = NameBuffer.c_str();
   for (unsigned I = 0; I < SymbolList.size(); ++I) {
     SymbolList[I].Name = P;
     P += strlen(P) + 1;
   }
 
-  CurrentFilename = Obj.getFileName();
-  sortAndPrintSymbolList(Obj, printName, ArchiveName, ArchitectureName);
+  sortAndPrintSymbolList(OS, Obj, SymbolList, Obj.getFileName(), printName,
+                         ArchiveName, ArchitectureName);
+  return HadErr;
 }
 
-// checkMachOAndArchFlags() checks to see if the SymbolicFile is a Mach-O file
+static void
+dumpSymbolNamesFromObject(SymbolicFile &Obj, bool printName,
+                          const std::string &ArchiveName = std::string(),
+                          const std::string &ArchitectureName = std::string()) {
+  if (printSymbolNamesFromObject(outs(), errs(), Obj, printName, ArchiveName,
+                                 ArchitectureName))
+    HadError = true;
+}
+
+// isMachOArchRequested() checks to see if the SymbolicFile is a Mach-O file
 // and if it is and there is a list of architecture flags is specified then
 // check to make sure this Mach-O file is one of those architectures or all
-// architectures was specificed.  If not then an error is generated and this
-// routine returns false.  Else it returns true.
-static bool checkMachOAndArchFlags(SymbolicFile *O, std::string &Filename) {
+// architectures was specificed.  If not it returns false.  Else it returns
+// true.
+static bool isMachOArchRequested(SymbolicFile *O) {
   auto *MachO = dyn_cast<MachOObjectFile>(O);
 
   if (!MachO || ArchAll || ArchFlags.empty())
@@ -1064,11 +1164,131 @@ static bool checkMachOAndArchFlags(SymbolicFile *O, std::string &Filename) {
     H = MachO->MachOObjectFile::getHeader();
     T = MachOObjectFile::getArchTriple(H.cputype, H.cpusubtype);
   }
-  if (none_of(ArchFlags, [&](const std::string &Name) {
-        return Name == T.getArchName();
-      })) {
-    error("No architecture specified", Filename);
-    return false;
+  return any_of(ArchFlags, [&](const std::string &Name) {
+    return Name == T.getArchName();
+  });
+}
+
+// checkMachOAndArchFlags() does the same as isMachOArchRequested() but also
+// generates an error if the Mach-O file is not one of the architectures.
+static bool checkMachOAndArchFlags(SymbolicFile *O, std::string &Filename) {
+  if (isMachOArchRequested(O))
+    return true;
+  error("No architecture specified", Filename);
+  return false;
+}
+
+// dumpArchiveMember() prints the symbols of the member C of the archive
+// Filename to OS and errors to ErrOS, and sets HadErr if there was an error.
+// It returns false if the member is a Mach-O file of an architecture that was
+// not asked for, in which case no more members are printed.
+static bool dumpArchiveMember(raw_ostream &OS, raw_ostream &ErrOS,
+                              const Archive::Child &C, StringRef Filename,
+                              LLVMContext *Context, bool &HadErr) {
+  Expected<std::unique_ptr<Binary>> ChildOrErr = C.getAsBinary(Context);
+  if (!ChildOrErr) {
+    if (auto E = isNotObjectErrorInvalidFileType(ChildOrErr.takeError())) {
+      printError(ErrOS, std::move(E), Filename, C, StringRef());
+      HadErr = true;
+    }
+    return true;
+  }
+  if (SymbolicFile *O = dyn_cast<SymbolicFile>(&*ChildOrErr.get())) {
+    if (!isMachOArchRequested(O)) {
+      printError(ErrOS, "No architecture specified", Filename);
+      HadErr = true;
+      return false;
+    }
+    if (!PrintFileName) {
+      OS << "\n";
+      if (isa<MachOObjectFile>(O)) {
+        OS << Filename << "(" << O->getFileName() << ")";
+      } else
+        OS << O->getFileName();
+      OS << ":\n";
+    }
+    if (printSymbolNamesFromObject(OS, ErrOS, *O, false, Filename,
+                                   StringRef()))
+      HadErr = true;
+  }
+  return true;
+}
+
+namespace {
+// What dumpArchiveMember() produced for a member listed on a worker thread.
+struct MemberOutput {
+  std::string Out;
+  std::string Err;
+  bool HadErr = false;
+  bool Continue = true;
+};
+} // anonymous namespace
+
+// dumpArchiveMembers() prints the symbols of Children, the members of the
+// archive A named Filename. The members are read and listed on several threads
+// and their output is printed in the order of the archive. It returns false if
+// it stopped at a member of an architecture that was not asked for.
+static bool dumpArchiveMembers(const Archive &A,
+                               ArrayRef<Archive::Child> Children,
+                               StringRef Filename, LLVMContext &Context) {
+  unsigned Threads = NumThreads;
+  if (Threads == 0)
+    Threads = std::max(1U, std::thread::hardware_concurrency());
+  // The members of a thin archive are read from their own files, which the
+  // archive keeps open as they are read, so they are listed on this thread.
+  if (Threads == 1 || Children.size() <= 1 || A.isThin()) {
+    for (const Archive::Child &C : Children) {
+      bool HadErr = false;
+      bool Continue =
+          dumpArchiveMember(outs(), errs(), C, Filename, &Context, HadErr);
+      if (HadErr)
+        HadError = true;
+      if (!Continue)
+        return false;
+    }
+    return true;
+  }
+
+  // An LLVMContext can only be used by one thread, so a member that is
+  // bitcode gets one of its own. At most Threads * 4 members are in flight,
+  // which bounds the memory their output uses.
+  Threads = std::min<size_t>(Threads, Children.size());
+  std::deque<std::pair<std::shared_future<ThreadPool::VoidTy>,
+                       std::unique_ptr<MemberOutput>>> InFlight;
+  ThreadPool Pool(Threads);
+  size_t NextChild = 0;
+  while (NextChild != Children.size() || !InFlight.empty()) {
+    while (NextChild != Children.size() && InFlight.size() < Threads * 4) {
+      auto Out = llvm::make_unique<MemberOutput>();
+      MemberOutput *O = Out.get();
+      const Archive::Child *C = &Children[NextChild++];
+      auto Future = Pool.async([O, C, Filename] {
+        std::unique_ptr<LLVMContext> MemberContext;
+        Expected<StringRef> BufferOrErr = C->getBuffer();
+        if (!BufferOrErr)
+          consumeError(BufferOrErr.takeError());
+        else if (sys::fs::identify_magic(*BufferOrErr) ==
+                 sys::fs::file_magic::bitcode)
+          MemberContext = llvm::make_unique<LLVMContext>();
+        raw_string_ostream OS(O->Out);
+        raw_string_ostream ErrOS(O->Err);
+        O->Continue = dumpArchiveMember(OS, ErrOS, *C, Filename,
+                                        MemberContext.get(), O->HadErr);
+      });
+      InFlight.emplace_back(std::move(Future), std::move(Out));
+    }
+
+    InFlight.front().first.wait();
+    std::unique_ptr<MemberOutput> Out = std::move(InFlight.front().second);
+    InFlight.pop_front();
+    outs() << Out->Out;
+    errs() << Out->Err;
+    if (Out->HadErr)
+      HadError = true;
+    if (!Out->Continue) {
+      Pool.wait();
+      return false;
+    }
   }
   return true;
 }
@@ -1112,26 +1332,12 @@ static void dumpSymbolNamesFromFile(std::string &Filename) {
 
     {
       Error Err = Error::success();
-      for (auto &C : A->children(Err)) {
-        Expected<std::unique_ptr<Binary>> ChildOrErr = C.getAsBinary(&Context);
-        if (!ChildOrErr) {
-          if (auto E = isNotObjectErrorInvalidFileType(ChildOrErr.takeError()))
-            error(std::move(E), Filename, C);
-          continue;
-        }
-        if (SymbolicFile *O = dyn_cast<SymbolicFile>(&*ChildOrErr.get())) {
-          if (!checkMachOAndArchFlags(O, Filename))
-            return;
-          if (!PrintFileName) {
-            outs() << "\n";
-            if (isa<MachOObjectFile>(O)) {
-              outs() << Filename << "(" << O->getFileName() << ")";
-            } else
-              outs() << O->getFileName();
-            outs() << ":\n";
-          }
-          dumpSymbolNamesFromObject(*O, false, Filename);
-        }
+      std::vector<Archive::Child> Children;
+      for (auto &C : A->children(Err))
+        Children.push_back(C);
+      if (!dumpArchiveMembers(*A, Children, Filename, Context)) {
+        consumeError(std::move(Err));
+        return;
       }
       if (Err)
         error(std::move(Err), A->getFileName());
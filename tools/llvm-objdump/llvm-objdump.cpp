@@ -20,6 +20,7 @@
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/CodeGen/FaultMaps.h"
 #include "llvm/DebugInfo/DWARF/DWARFContext.h"
@@ -56,11 +57,15 @@
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cctype>
 #include <cstring>
+#include <deque>
+#include <mutex>
 #include <system_error>
+#include <thread>
 #include <utility>
 #include <unordered_map>
 
@@ -211,6 +216,11 @@ cl::opt<unsigned long long>
 cl::opt<unsigned long long>
     StopAddress("stop-address", cl::desc("Stop disassembly at address"),
                 cl::value_desc("address"), cl::init(UINT64_MAX));
+
+cl::opt<unsigned>
+    NumThreads("num-threads", cl::init(0),
+               cl::desc("Number of threads to use for disassembly "
+                        "(default: autodetect)"));
 static StringRef ToolName;
 
 namespace {
@@ -393,23 +403,135 @@ bool llvm::RelocAddressLess(RelocationRef a, RelocationRef b) {
 }
 
 namespace {
+/// Maps addresses to the source lines that -line-numbers and -source print.
+/// It is built once per object by asking the DWARF context about every
+/// address at which a row of a line table starts; the answer holds up to the
+/// next such address. Looking up an instruction is then a binary search that
+/// any number of threads can do at once.
+class LineInfoIndex {
+  struct Entry {
+    uint64_t Address;
+    // Index into Files, or -1U if the address has no line information.
+    unsigned File;
+    uint32_t Line;
+  };
+  std::vector<Entry> Entries;
+  std::vector<std::string> Files;
+
+public:
+  static std::unique_ptr<LineInfoIndex> create(const ObjectFile &Obj);
+  DILineInfo lookup(uint64_t Address) const;
+};
+
+std::unique_ptr<LineInfoIndex> LineInfoIndex::create(const ObjectFile &Obj) {
+  auto Index = llvm::make_unique<LineInfoIndex>();
+  DWARFContextInMemory DICtx(Obj);
+  std::vector<uint64_t> Addresses;
+  for (const auto &CU : DICtx.compile_units())
+    if (const DWARFDebugLine::LineTable *LineTable =
+            DICtx.getLineTableForUnit(CU.get()))
+      for (const DWARFDebugLine::Row &Row : LineTable->Rows)
+        Addresses.push_back(Row.Address);
+  array_pod_sort(Addresses.begin(), Addresses.end());
+  Addresses.erase(std::unique(Addresses.begin(), Addresses.end()),
+                  Addresses.end());
+
+  DILineInfoSpecifier Spec(
+      DILineInfoSpecifier::FileLineInfoKind::AbsoluteFilePath,
+      DILineInfoSpecifier::FunctionNameKind::None);
+  StringMap<unsigned> FileIndices;
+  for (uint64_t Address : Addresses) {
+    DILineInfo LineInfo = DICtx.getLineInfoForAddress(Address, Spec);
+    Entry E = {Address, -1U, 0};
+    if (LineInfo.FileName != "<invalid>" && LineInfo.Line != 0) {
+      auto P = FileIndices.insert(
+          std::make_pair(LineInfo.FileName, Index->Files.size()));
+      if (P.second)
+        Index->Files.push_back(LineInfo.FileName);
+      E.File = P.first->second;
+      E.Line = LineInfo.Line;
+    }
+    // Only keep the addresses at which the answer changes.
+    if (!Index->Entries.empty() && Index->Entries.back().File == E.File &&
+        Index->Entries.back().Line == E.Line)
+      continue;
+    Index->Entries.push_back(E);
+  }
+  return Index;
+}
+
+DILineInfo LineInfoIndex::lookup(uint64_t Address) const {
+  auto I = std::upper_bound(
+      Entries.begin(), Entries.end(), Address,
+      [](uint64_t LHS, const Entry &RHS) { return LHS < RHS.Address; });
+  DILineInfo LineInfo;
+  if (I == Entries.begin() || std::prev(I)->File == -1U)
+    return LineInfo;
+  --I;
+  LineInfo.FileName = Files[I->File];
+  LineInfo.Line = I->Line;
+  return LineInfo;
+}
+
+/// Whether the symbolizer would read the debug information of \p Obj from
+/// another file: a dSYM bundle, the target of a .gnu_debuglink section or a
+/// PDB. The line information of such objects is not indexed.
+static bool hasExternalDebugInfo(const ObjectFile *Obj) {
+  if (isa<MachOObjectFile>(Obj))
+    return true;
+  if (const auto *COFFObj = dyn_cast<COFFObjectFile>(Obj)) {
+    const codeview::DebugInfo *DebugInfo;
+    StringRef PDBFileName;
+    if (!COFFObj->getDebugPDBInfo(DebugInfo, PDBFileName) && DebugInfo &&
+        !PDBFileName.empty())
+      return true;
+  }
+  for (const SectionRef &Section : Obj->sections()) {
+    StringRef Name;
+    if (Section.getName(Name))
+      continue;
+    if (Name.substr(Name.find_first_not_of("._")) == "gnu_debuglink")
+      return true;
+  }
+  return false;
+}
+
 class SourcePrinter {
+public:
+  /// A line header printed while the line printed last before it was not
+  /// known, and where it is in the output.
+  struct PendingLine {
+    uint32_t Line;
+    uint64_t Begin;
+    uint64_t End;
+  };
+
 protected:
   DILineInfo OldLineInfo;
   const ObjectFile *Obj;
+  const LineInfoIndex *Index;
   std::unique_ptr<symbolize::LLVMSymbolizer> Symbolizer;
   // File name to file contents of source
   std::unordered_map<std::string, std::unique_ptr<MemoryBuffer>> SourceCache;
   // Mark the line endings of the cached source
   std::unordered_map<std::string, std::vector<StringRef>> LineCache;
+  // Whether OldLineInfo is the line printed last. After startChunk() it is
+  // not until a line is printed, and every header printed until then is
+  // recorded in PendingLines.
+  bool OldLineKnown = true;
+  std::vector<PendingLine> PendingLines;
 
 private:
   bool cacheSource(std::string File);
 
 public:
   virtual ~SourcePrinter() {}
-  SourcePrinter() : Obj(nullptr), Symbolizer(nullptr) {}
-  SourcePrinter(const ObjectFile *Obj, StringRef DefaultArch) : Obj(Obj) {
+  SourcePrinter() : Obj(nullptr), Index(nullptr), Symbolizer(nullptr) {}
+  SourcePrinter(const ObjectFile *Obj, StringRef DefaultArch,
+                const LineInfoIndex *Index = nullptr)
+      : Obj(Obj), Index(Index) {
+    if (Index)
+      return;
     symbolize::LLVMSymbolizer::Options SymbolizerOpts(
         DILineInfoSpecifier::FunctionNameKind::None, true, false, false,
         DefaultArch);
@@ -417,6 +539,19 @@ public:
   }
   virtual void printSourceLine(raw_ostream &OS, uint64_t Address,
                                StringRef Delimiter = "; ");
+
+  /// Start printing a part of the disassembly that is put together with the
+  /// parts before it later on, so which line was printed last is not known.
+  /// Headers that repeat that line have to be removed from the output once
+  /// it is known: getPendingLines() tells where they are.
+  void startChunk() {
+    OldLineInfo = DILineInfo();
+    OldLineKnown = false;
+    PendingLines.clear();
+  }
+  bool isOldLineKnown() const { return OldLineKnown; }
+  uint32_t getOldLine() const { return OldLineInfo.Line; }
+  ArrayRef<PendingLine> getPendingLines() const { return PendingLines; }
 };
 
 bool SourcePrinter::cacheSource(std::string File) {
@@ -441,36 +576,50 @@ bool SourcePrinter::cacheSource(std::string File) {
 
 void SourcePrinter::printSourceLine(raw_ostream &OS, uint64_t Address,
                                     StringRef Delimiter) {
-  if (!Symbolizer)
-    return;
   DILineInfo LineInfo = DILineInfo();
-  auto ExpectecLineInfo =
-      Symbolizer->symbolizeCode(Obj->getFileName(), Address);
-  if (!ExpectecLineInfo)
-    consumeError(ExpectecLineInfo.takeError());
-  else
-    LineInfo = *ExpectecLineInfo;
+  if (Index) {
+    LineInfo = Index->lookup(Address);
+  } else {
+    if (!Symbolizer)
+      return;
+    auto ExpectecLineInfo =
+        Symbolizer->symbolizeCode(Obj->getFileName(), Address);
+    if (!ExpectecLineInfo)
+      consumeError(ExpectecLineInfo.takeError());
+    else
+      LineInfo = *ExpectecLineInfo;
+  }
 
-  if ((LineInfo.FileName == "<invalid>") || OldLineInfo.Line == LineInfo.Line ||
+  if ((LineInfo.FileName == "<invalid>") ||
+      (OldLineKnown && OldLineInfo.Line == LineInfo.Line) ||
       LineInfo.Line == 0)
     return;
 
+  uint64_t Begin = OldLineKnown ? 0 : OS.tell();
+  bool Printed = true;
   if (PrintLines)
     OS << Delimiter << LineInfo.FileName << ":" << LineInfo.Line << "\n";
   if (PrintSource) {
-    if (SourceCache.find(LineInfo.FileName) == SourceCache.end())
-      if (!cacheSource(LineInfo.FileName))
-        return;
-    auto FileBuffer = SourceCache.find(LineInfo.FileName);
-    if (FileBuffer != SourceCache.end()) {
-      auto LineBuffer = LineCache.find(LineInfo.FileName);
-      if (LineBuffer != LineCache.end())
-        // Vector begins at 0, line numbers are non-zero
-        OS << Delimiter << LineBuffer->second[LineInfo.Line - 1].ltrim()
-           << "\n";
+    if (SourceCache.find(LineInfo.FileName) == SourceCache.end() &&
+        !cacheSource(LineInfo.FileName)) {
+      Printed = false;
+    } else {
+      auto FileBuffer = SourceCache.find(LineInfo.FileName);
+      if (FileBuffer != SourceCache.end()) {
+        auto LineBuffer = LineCache.find(LineInfo.FileName);
+        if (LineBuffer != LineCache.end())
+          // Vector begins at 0, line numbers are non-zero
+          OS << Delimiter << LineBuffer->second[LineInfo.Line - 1].ltrim()
+             << "\n";
+      }
     }
   }
-  OldLineInfo = LineInfo;
+  if (!OldLineKnown)
+    PendingLines.push_back({LineInfo.Line, Begin, OS.tell()});
+  if (Printed) {
+    OldLineInfo = LineInfo;
+    OldLineKnown = true;
+  }
 }
 
 static bool isArmElf(const ObjectFile *Obj) {
@@ -1091,68 +1240,124 @@ static uint8_t getElfSymbolType(const ObjectFile *Obj, const SymbolRef &Sym) {
   llvm_unreachable("Unsupported binary format");
 }
 
-static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
-  if (StartAddress > StopAddress)
-    error("Start address should be less than stop address");
+namespace {
+typedef std::vector<std::tuple<uint64_t, StringRef, uint8_t>> SectionSymbolsTy;
+
+/// A disassembler for an object and what it needs to print instructions.
+/// Each thread that disassembles has an instance of its own.
+struct DisassemblerInstance {
+  std::unique_ptr<const MCRegisterInfo> MRI;
+  std::unique_ptr<const MCAsmInfo> AsmInfo;
+  std::unique_ptr<const MCSubtargetInfo> STI;
+  std::unique_ptr<const MCInstrInfo> MII;
+  MCObjectFileInfo MOFI;
+  std::unique_ptr<MCContext> Ctx;
+  std::unique_ptr<MCDisassembler> DisAsm;
+  std::unique_ptr<const MCInstrAnalysis> MIA;
+  std::unique_ptr<MCInstPrinter> IP;
+  std::unique_ptr<SourcePrinter> SP;
+};
 
-  const Target *TheTarget = getTarget(Obj);
+/// A section to disassemble and what is needed to print it.
+struct SectionJob {
+  SectionRef Section;
+  uint64_t SectionAddr;
+  uint64_t SectSize;
+  StringRef Name;
+  StringRef SegmentName;
+  // The symbols in the section, sorted by address. There is always one at
+  // the start of the section.
+  SectionSymbolsTy Symbols;
+  std::vector<uint64_t> DataMappingSymsAddr;
+  std::vector<uint64_t> TextMappingSymsAddr;
+  std::vector<RelocationRef> Rels;
+  ArrayRef<uint8_t> Bytes;
+  // Whether the contents could not be read. Only the header is printed.
+  bool Unreadable = false;
+};
 
-  // Package up features to be passed to target/subtarget
-  SubtargetFeatures Features = Obj->getFeatures();
-  if (MAttrs.size()) {
-    for (unsigned i = 0; i != MAttrs.size(); ++i)
-      Features.AddFeature(MAttrs[i]);
-  }
+/// A run of consecutive symbols of a section, disassembled in one go.
+struct DisassemblyChunk {
+  unsigned Job;
+  unsigned SymbolBegin;
+  unsigned SymbolEnd;
+};
 
-  std::unique_ptr<const MCRegisterInfo> MRI(
-      TheTarget->createMCRegInfo(TripleName));
-  if (!MRI)
+/// The output of a chunk disassembled on a worker thread.
+struct ChunkOutput {
+  std::string Text;
+  std::error_code EC;
+  std::vector<SourcePrinter::PendingLine> PendingLines;
+  bool OldLineKnown;
+  uint32_t OldLine;
+};
+} // end anonymous namespace
+
+static std::unique_ptr<DisassemblerInstance>
+createDisassemblerInstance(const ObjectFile *Obj, const Target *TheTarget,
+                           const SubtargetFeatures &Features) {
+  auto DI = llvm::make_unique<DisassemblerInstance>();
+  DI->MRI.reset(TheTarget->createMCRegInfo(TripleName));
+  if (!DI->MRI)
     report_error(Obj->getFileName(), "no register info for target " +
                  TripleName);
 
   // Set up disassembler.
-  std::unique_ptr<const MCAsmInfo> AsmInfo(
-      TheTarget->createMCAsmInfo(*MRI, TripleName));
-  if (!AsmInfo)
+  DI->AsmInfo.reset(TheTarget->createMCAsmInfo(*DI->MRI, TripleName));
+  if (!DI->AsmInfo)
     report_error(Obj->getFileName(), "no assembly info for target " +
                  TripleName);
-  std::unique_ptr<const MCSubtargetInfo> STI(
+  DI->STI.reset(
       TheTarget->createMCSubtargetInfo(TripleName, MCPU, Features.getString()));
-  if (!STI)
+  if (!DI->STI)
     report_error(Obj->getFileName(), "no subtarget info for target " +
                  TripleName);
-  std::unique_ptr<const MCInstrInfo> MII(TheTarget->createMCInstrInfo());
-  if (!MII)
+  DI->MII.reset(TheTarget->createMCInstrInfo());
+  if (!DI->MII)
     report_error(Obj->getFileName(), "no instruction info for target " +
                  TripleName);
-  MCObjectFileInfo MOFI;
-  MCContext Ctx(AsmInfo.get(), MRI.get(), &MOFI);
+  DI->Ctx.reset(new MCContext(DI->AsmInfo.get(), DI->MRI.get(), &DI->MOFI));
   // FIXME: for now initialize MCObjectFileInfo with default values
-  MOFI.InitMCObjectFileInfo(Triple(TripleName), false, CodeModel::Default, Ctx);
+  DI->MOFI.InitMCObjectFileInfo(Triple(TripleName), false, CodeModel::Default,
+                                *DI->Ctx);
 
-  std::unique_ptr<MCDisassembler> DisAsm(
-    TheTarget->createMCDisassembler(*STI, Ctx));
-  if (!DisAsm)
+  DI->DisAsm.reset(TheTarget->createMCDisassembler(*DI->STI, *DI->Ctx));
+  if (!DI->DisAsm)
     report_error(Obj->getFileName(), "no disassembler for target " +
                  TripleName);
 
-  std::unique_ptr<const MCInstrAnalysis> MIA(
-      TheTarget->createMCInstrAnalysis(MII.get()));
+  DI->MIA.reset(TheTarget->createMCInstrAnalysis(DI->MII.get()));
 
-  int AsmPrinterVariant = AsmInfo->getAssemblerDialect();
-  std::unique_ptr<MCInstPrinter> IP(TheTarget->createMCInstPrinter(
-      Triple(TripleName), AsmPrinterVariant, *AsmInfo, *MII, *MRI));
-  if (!IP)
+  int AsmPrinterVariant = DI->AsmInfo->getAssemblerDialect();
+  DI->IP.reset(TheTarget->createMCInstPrinter(
+      Triple(TripleName), AsmPrinterVariant, *DI->AsmInfo, *DI->MII, *DI->MRI));
+  if (!DI->IP)
     report_error(Obj->getFileName(), "no instruction printer for target " +
                  TripleName);
-  IP->setPrintImmHex(PrintImmHex);
+  DI->IP->setPrintImmHex(PrintImmHex);
+  return DI;
+}
+
+static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
+  if (StartAddress > StopAddress)
+    error("Start address should be less than stop address");
+
+  const Target *TheTarget = getTarget(Obj);
+
+  // Package up features to be passed to target/subtarget
+  SubtargetFeatures Features = Obj->getFeatures();
+  if (MAttrs.size()) {
+    for (unsigned i = 0; i != MAttrs.size(); ++i)
+      Features.AddFeature(MAttrs[i]);
+  }
+
+  std::vector<std::unique_ptr<DisassemblerInstance>> Instances;
+  Instances.push_back(createDisassemblerInstance(Obj, TheTarget, Features));
   PrettyPrinter &PIP = selectPrettyPrinter(Triple(TripleName));
 
   StringRef Fmt = Obj->getBytesInAddress() > 4 ? "\t\t%016" PRIx64 ":  " :
                                                  "\t\t\t%08" PRIx64 ":  ";
 
-  SourcePrinter SP(Obj, TheTarget->getName());
-
   // Create a mapping, RelocSecs = SectionRelocMap[S], where sections
   // in RelocSecs contain the relocations for section S.
   std::error_code EC;
@@ -1165,7 +1370,6 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
 
   // Create a mapping from virtual address to symbol name.  This is used to
   // pretty print the symbols while disassembling.
-  typedef std::vector<std::tuple<uint64_t, StringRef, uint8_t>> SectionSymbolsTy;
   std::map<SectionRef, SectionSymbolsTy> AllSymbols;
   for (const SymbolRef &Symbol : Obj->symbols()) {
     Expected<uint64_t> AddressOrErr = Symbol.getAddress();
@@ -1232,6 +1436,12 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
   for (std::pair<const SectionRef, SectionSymbolsTy> &SecSyms : AllSymbols)
     array_pod_sort(SecSyms.second.begin(), SecSyms.second.end());
 
+  // Gather the sections to disassemble, in the order they are printed. An
+  // error stops the gathering, and is reported once what comes before it
+  // has been printed.
+  std::vector<SectionJob> Jobs;
+  std::map<SectionRef, unsigned> JobIndices;
+  std::error_code DeferredEC;
   for (const SectionRef &Section : ToolSectionFilter(*Obj)) {
     if (!DisassembleAll && (!Section.isText() || Section.isVirtual()))
       continue;
@@ -1241,92 +1451,183 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
     if (!SectSize)
       continue;
 
+    StringRef Name;
+    if ((DeferredEC = Section.getName(Name)))
+      break;
+
+    Jobs.emplace_back();
+    SectionJob &Job = Jobs.back();
+    Job.Section = Section;
+    Job.Name = Name;
+    Job.SectionAddr = SectionAddr;
+    Job.SectSize = SectSize;
+
     // Get the list of all the symbols in this section.
-    SectionSymbolsTy &Symbols = AllSymbols[Section];
-    std::vector<uint64_t> DataMappingSymsAddr;
-    std::vector<uint64_t> TextMappingSymsAddr;
+    auto SecSyms = AllSymbols.find(Section);
+    if (SecSyms != AllSymbols.end())
+      Job.Symbols = SecSyms->second;
+    SectionSymbolsTy &Symbols = Job.Symbols;
     if (isArmElf(Obj)) {
       for (const auto &Symb : Symbols) {
         uint64_t Address = std::get<0>(Symb);
         StringRef Name = std::get<1>(Symb);
         if (Name.startswith("$d"))
-          DataMappingSymsAddr.push_back(Address - SectionAddr);
+          Job.DataMappingSymsAddr.push_back(Address - SectionAddr);
         if (Name.startswith("$x"))
-          TextMappingSymsAddr.push_back(Address - SectionAddr);
+          Job.TextMappingSymsAddr.push_back(Address - SectionAddr);
         if (Name.startswith("$a"))
-          TextMappingSymsAddr.push_back(Address - SectionAddr);
+          Job.TextMappingSymsAddr.push_back(Address - SectionAddr);
         if (Name.startswith("$t"))
-          TextMappingSymsAddr.push_back(Address - SectionAddr);
+          Job.TextMappingSymsAddr.push_back(Address - SectionAddr);
       }
     }
 
-    std::sort(DataMappingSymsAddr.begin(), DataMappingSymsAddr.end());
-    std::sort(TextMappingSymsAddr.begin(), TextMappingSymsAddr.end());
-
-    if (Obj->isELF() && Obj->getArch() == Triple::amdgcn) {
-      // AMDGPU disassembler uses symbolizer for printing labels
-      std::unique_ptr<MCRelocationInfo> RelInfo(
-        TheTarget->createMCRelocationInfo(TripleName, Ctx));
-      if (RelInfo) {
-        std::unique_ptr<MCSymbolizer> Symbolizer(
-          TheTarget->createMCSymbolizer(
-            TripleName, nullptr, nullptr, &Symbols, &Ctx, std::move(RelInfo)));
-        DisAsm->setSymbolizer(std::move(Symbolizer));
-      }
-    }
+    std::sort(Job.DataMappingSymsAddr.begin(), Job.DataMappingSymsAddr.end());
+    std::sort(Job.TextMappingSymsAddr.begin(), Job.TextMappingSymsAddr.end());
 
     // Make a list of all the relocations for this section.
-    std::vector<RelocationRef> Rels;
     if (InlineRelocs) {
       for (const SectionRef &RelocSec : SectionRelocMap[Section]) {
         for (const RelocationRef &Reloc : RelocSec.relocations()) {
-          Rels.push_back(Reloc);
+          Job.Rels.push_back(Reloc);
         }
       }
     }
 
     // Sort relocations by address.
-    std::sort(Rels.begin(), Rels.end(), RelocAddressLess);
+    std::sort(Job.Rels.begin(), Job.Rels.end(), RelocAddressLess);
 
-    StringRef SegmentName = "";
     if (const MachOObjectFile *MachO = dyn_cast<const MachOObjectFile>(Obj)) {
       DataRefImpl DR = Section.getRawDataRefImpl();
-      SegmentName = MachO->getSectionFinalSegmentName(DR);
-    }
-    StringRef name;
-    error(Section.getName(name));
-
-    if ((SectionAddr <= StopAddress) &&
-        (SectionAddr + SectSize) >= StartAddress) {
-    outs() << "Disassembly of section ";
-    if (!SegmentName.empty())
-      outs() << SegmentName << ",";
-    outs() << name << ':';
+      Job.SegmentName = MachO->getSectionFinalSegmentName(DR);
     }
 
     // If the section has no symbol at the start, just insert a dummy one.
     if (Symbols.empty() || std::get<0>(Symbols[0]) != 0) {
       Symbols.insert(Symbols.begin(),
-                     std::make_tuple(SectionAddr, name, Section.isText()
-                                                            ? ELF::STT_FUNC
-                                                            : ELF::STT_OBJECT));
+                     std::make_tuple(SectionAddr, Job.Name,
+                                     Section.isText() ? ELF::STT_FUNC
+                                                      : ELF::STT_OBJECT));
     }
 
-    SmallString<40> Comments;
-    raw_svector_ostream CommentStream(Comments);
+    JobIndices[Section] = Jobs.size() - 1;
 
+    // The section header is printed before its contents turn out to be
+    // unreadable.
     StringRef BytesStr;
-    error(Section.getContents(BytesStr));
-    ArrayRef<uint8_t> Bytes(reinterpret_cast<const uint8_t *>(BytesStr.data()),
-                            BytesStr.size());
+    if ((DeferredEC = Section.getContents(BytesStr))) {
+      Job.Unreadable = true;
+      break;
+    }
+    Job.Bytes = ArrayRef<uint8_t>(
+        reinterpret_cast<const uint8_t *>(BytesStr.data()), BytesStr.size());
+  }
+
+  // Source lines are looked up in an index that all threads share, unless
+  // the debug information is in another file, which only the symbolizer
+  // finds. The symbolizer is not thread safe, so then there is one thread.
+  std::unique_ptr<LineInfoIndex> LineIndex;
+  if ((PrintSource || PrintLines) && !Jobs.empty() &&
+      !hasExternalDebugInfo(Obj))
+    LineIndex = LineInfoIndex::create(*Obj);
+  unsigned Threads = NumThreads;
+  if (!Threads)
+    Threads = std::max(1U, std::thread::hardware_concurrency());
+  if ((PrintSource || PrintLines) && !LineIndex)
+    Threads = 1;
+  Instances[0]->SP.reset(
+      new SourcePrinter(Obj, TheTarget->getName(), LineIndex.get()));
+
+  // Return the symbols of Sec as they are when the job CurJob is printed:
+  // the sections printed up to then have the symbol that was inserted at
+  // their start.
+  auto getSectionSymbols = [&](const SectionRef &Sec,
+                               unsigned CurJob) -> const SectionSymbolsTy * {
+    auto J = JobIndices.find(Sec);
+    if (J != JobIndices.end() && J->second <= CurJob)
+      return &Jobs[J->second].Symbols;
+    auto I = AllSymbols.find(Sec);
+    if (I == AllSymbols.end())
+      return nullptr;
+    return &I->second;
+  };
+
+  // Split the sections into chunks of about ChunkSize bytes that start at a
+  // symbol. The relocations of a section are printed as the instructions
+  // pass them, so with -r each section is a single chunk.
+  const uint64_t ChunkSize = 1 << 16;
+  std::vector<DisassemblyChunk> Chunks;
+  for (unsigned J = 0, JE = Jobs.size(); J != JE; ++J) {
+    const SectionSymbolsTy &Symbols = Jobs[J].Symbols;
+    unsigned Begin = 0;
+    uint64_t Size = 0;
+    for (unsigned si = 0, se = Symbols.size(); si + 1 < se; ++si) {
+      uint64_t Start = std::get<0>(Symbols[si]);
+      uint64_t End = std::get<0>(Symbols[si + 1]);
+      if (End > Start)
+        Size += End - Start;
+      if (Threads > 1 && !InlineRelocs && Size >= ChunkSize) {
+        Chunks.push_back({J, Begin, si + 1});
+        Begin = si + 1;
+        Size = 0;
+      }
+    }
+    Chunks.push_back({J, Begin, unsigned(Symbols.size())});
+  }
+
+  // Disassemble a chunk into OS. An error stops it and is returned, to be
+  // reported once the output so far has been printed.
+  auto DisassembleChunk = [&](DisassemblerInstance &DI,
+                              const DisassemblyChunk &C,
+                              raw_ostream &OS) -> std::error_code {
+    SectionJob &Job = Jobs[C.Job];
+    const SectionRef &Section = Job.Section;
+    uint64_t SectionAddr = Job.SectionAddr;
+    uint64_t SectSize = Job.SectSize;
+    SectionSymbolsTy &Symbols = Job.Symbols;
+    const std::vector<uint64_t> &DataMappingSymsAddr = Job.DataMappingSymsAddr;
+    const std::vector<uint64_t> &TextMappingSymsAddr = Job.TextMappingSymsAddr;
+    ArrayRef<uint8_t> Bytes = Job.Bytes;
+    MCDisassembler *DisAsm = DI.DisAsm.get();
+    const MCInstrAnalysis *MIA = DI.MIA.get();
+    MCInstPrinter *IP = DI.IP.get();
+    const MCSubtargetInfo *STI = DI.STI.get();
+    SourcePrinter &SP = *DI.SP;
+
+    if (Obj->isELF() && Obj->getArch() == Triple::amdgcn) {
+      // AMDGPU disassembler uses symbolizer for printing labels
+      std::unique_ptr<MCRelocationInfo> RelInfo(
+        TheTarget->createMCRelocationInfo(TripleName, *DI.Ctx));
+      if (RelInfo) {
+        std::unique_ptr<MCSymbolizer> Symbolizer(
+          TheTarget->createMCSymbolizer(
+            TripleName, nullptr, nullptr, &Symbols, DI.Ctx.get(),
+            std::move(RelInfo)));
+        DisAsm->setSymbolizer(std::move(Symbolizer));
+      }
+    }
+
+    if (C.SymbolBegin == 0 && (SectionAddr <= StopAddress) &&
+        (SectionAddr + SectSize) >= StartAddress) {
+    OS << "Disassembly of section ";
+    if (!Job.SegmentName.empty())
+      OS << Job.SegmentName << ",";
+    OS << Job.Name << ':';
+    }
+    if (Job.Unreadable)
+      return std::error_code();
+
+    SmallString<40> Comments;
+    raw_svector_ostream CommentStream(Comments);
 
     uint64_t Size;
     uint64_t Index;
 
-    std::vector<RelocationRef>::const_iterator rel_cur = Rels.begin();
-    std::vector<RelocationRef>::const_iterator rel_end = Rels.end();
+    std::vector<RelocationRef>::const_iterator rel_cur = Job.Rels.begin();
+    std::vector<RelocationRef>::const_iterator rel_end = Job.Rels.end();
     // Disassemble symbol by symbol.
-    for (unsigned si = 0, se = Symbols.size(); si != se; ++si) {
+    for (unsigned si = C.SymbolBegin, se = Symbols.size(); si != C.SymbolEnd;
+         ++si) {
       uint64_t Start = std::get<0>(Symbols[si]) - SectionAddr;
       // The end is either the section end or the beginning of the next
       // symbol.
@@ -1369,7 +1670,7 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
         }
       }
 
-      outs() << '\n' << std::get<1>(Symbols[si]) << ":\n";
+      OS << '\n' << std::get<1>(Symbols[si]) << ":\n";
 
 #ifndef NDEBUG
       raw_ostream &DebugOut = DebugFlag ? dbgs() : nulls();
@@ -1399,12 +1700,12 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
           if (DAI != DataMappingSymsAddr.end() && *DAI == Index) {
             // Switch to data.
             while (Index < End) {
-              outs() << format("%8" PRIx64 ":", SectionAddr + Index);
-              outs() << "\t";
+              OS << format("%8" PRIx64 ":", SectionAddr + Index);
+              OS << "\t";
               if (Index + 4 <= End) {
                 Stride = 4;
-                dumpBytes(Bytes.slice(Index, 4), outs());
-                outs() << "\t.word\t";
+                dumpBytes(Bytes.slice(Index, 4), OS);
+                OS << "\t.word\t";
                 uint32_t Data = 0;
                 if (Obj->isLittleEndian()) {
                   const auto Word =
@@ -1416,11 +1717,11 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
                       Bytes.data() + Index);
                   Data = *Word;
                 }
-                outs() << "0x" << format("%08" PRIx32, Data);
+                OS << "0x" << format("%08" PRIx32, Data);
               } else if (Index + 2 <= End) {
                 Stride = 2;
-                dumpBytes(Bytes.slice(Index, 2), outs());
-                outs() << "\t\t.short\t";
+                dumpBytes(Bytes.slice(Index, 2), OS);
+                OS << "\t\t.short\t";
                 uint16_t Data = 0;
                 if (Obj->isLittleEndian()) {
                   const auto Short =
@@ -1433,15 +1734,15 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
                                                                   Index);
                   Data = *Short;
                 }
-                outs() << "0x" << format("%04" PRIx16, Data);
+                OS << "0x" << format("%04" PRIx16, Data);
               } else {
                 Stride = 1;
-                dumpBytes(Bytes.slice(Index, 1), outs());
-                outs() << "\t\t.byte\t";
-                outs() << "0x" << format("%02" PRIx8, Bytes.slice(Index, 1)[0]);
+                dumpBytes(Bytes.slice(Index, 1), OS);
+                OS << "\t\t.byte\t";
+                OS << "0x" << format("%02" PRIx8, Bytes.slice(Index, 1)[0]);
               }
               Index += Stride;
-              outs() << "\n";
+              OS << "\n";
               auto TAI = std::lower_bound(TextMappingSymsAddr.begin(),
                                           TextMappingSymsAddr.end(), Index);
               if (TAI != TextMappingSymsAddr.end() && *TAI == Index)
@@ -1466,11 +1767,11 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
                 ((SectionAddr + Index) > StopAddress))
               continue;
             if (NumBytes == 0) {
-              outs() << format("%8" PRIx64 ":", SectionAddr + Index);
-              outs() << "\t";
+              OS << format("%8" PRIx64 ":", SectionAddr + Index);
+              OS << "\t";
             }
             Byte = Bytes.slice(Index)[0];
-            outs() << format(" %02x", Byte);
+            OS << format(" %02x", Byte);
             AsciiData[NumBytes] = isprint(Byte) ? Byte : '.';
 
             uint8_t IndentOffset = 0;
@@ -1485,9 +1786,9 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
             }
             if (NumBytes == 8) {
               AsciiData[8] = '\0';
-              outs() << std::string(IndentOffset, ' ') << "         ";
-              outs() << reinterpret_cast<char *>(AsciiData);
-              outs() << '\n';
+              OS << std::string(IndentOffset, ' ') << "         ";
+              OS << reinterpret_cast<char *>(AsciiData);
+              OS << '\n';
               NumBytes = 0;
             }
           }
@@ -1504,9 +1805,9 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
           Size = 1;
 
         PIP.printInst(*IP, Disassembled ? &Inst : nullptr,
-                      Bytes.slice(Index, Size), SectionAddr + Index, outs(), "",
+                      Bytes.slice(Index, Size), SectionAddr + Index, OS, "",
                       *STI, &SP);
-        outs() << CommentStream.str();
+        OS << CommentStream.str();
         Comments.clear();
 
         // Try to resolve the target of a call, tail call, etc. to a specific
@@ -1522,7 +1823,7 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
             // In a non-relocatable object, the target may be in any section.
             //
             // N.B. We don't walk the relocations in the relocatable case yet.
-            auto *TargetSectionSymbols = &Symbols;
+            const SectionSymbolsTy *TargetSectionSymbols = &Symbols;
             if (!Obj->isRelocatableObject()) {
               auto SectionAddress = std::upper_bound(
                   SectionAddresses.begin(), SectionAddresses.end(), Target,
@@ -1532,7 +1833,8 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
                   });
               if (SectionAddress != SectionAddresses.begin()) {
                 --SectionAddress;
-                TargetSectionSymbols = &AllSymbols[SectionAddress->second];
+                TargetSectionSymbols =
+                    getSectionSymbols(SectionAddress->second, C.Job);
               } else {
                 TargetSectionSymbols = nullptr;
               }
@@ -1551,16 +1853,16 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
                 --TargetSym;
                 uint64_t TargetAddress = std::get<0>(*TargetSym);
                 StringRef TargetName = std::get<1>(*TargetSym);
-                outs() << " <" << TargetName;
+                OS << " <" << TargetName;
                 uint64_t Disp = Target - TargetAddress;
                 if (Disp)
-                  outs() << "+0x" << utohexstr(Disp);
-                outs() << '>';
+                  OS << "+0x" << utohexstr(Disp);
+                OS << '>';
               }
             }
           }
         }
-        outs() << "\n";
+        OS << "\n";
 
         // Print relocation for instruction.
         while (rel_cur != rel_end) {
@@ -1578,14 +1880,94 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
           // Stop when rel_cur's address is past the current instruction.
           if (addr >= Index + Size) break;
           rel_cur->getTypeName(name);
-          error(getRelocationValueString(*rel_cur, val));
-          outs() << format(Fmt.data(), SectionAddr + addr) << name
+          if (std::error_code EC = getRelocationValueString(*rel_cur, val))
+            return EC;
+          OS << format(Fmt.data(), SectionAddr + addr) << name
                  << "\t" << val << "\n";
           ++rel_cur;
         }
       }
     }
+    return std::error_code();
+  };
+
+  if (Threads <= 1 || Chunks.size() <= 1) {
+    for (const DisassemblyChunk &C : Chunks)
+      error(DisassembleChunk(*Instances[0], C, outs()));
+    error(DeferredEC);
+    return;
+  }
+
+  // Disassemble the chunks on a thread pool into buffers, and print those in
+  // order as they are done. A few chunks per thread are in flight at a time,
+  // which bounds the memory the buffers use.
+  Threads = std::min<size_t>(Threads, Chunks.size());
+  while (Instances.size() < Threads) {
+    Instances.push_back(createDisassemblerInstance(Obj, TheTarget, Features));
+    Instances.back()->SP.reset(
+        new SourcePrinter(Obj, TheTarget->getName(), LineIndex.get()));
+  }
+  std::vector<DisassemblerInstance *> FreeInstances;
+  for (auto &DI : Instances)
+    FreeInstances.push_back(DI.get());
+  std::mutex FreeInstancesMutex;
+
+  ThreadPool Pool(Threads);
+  std::deque<std::pair<std::shared_future<ThreadPool::VoidTy>,
+                       std::unique_ptr<ChunkOutput>>> InFlight;
+  size_t NextChunk = 0;
+  // The line printed last, in the order of the output.
+  uint32_t OldLine = 0;
+  while (NextChunk != Chunks.size() || !InFlight.empty()) {
+    while (NextChunk != Chunks.size() && InFlight.size() < Threads * 4) {
+      auto Out = llvm::make_unique<ChunkOutput>();
+      ChunkOutput *O = Out.get();
+      const DisassemblyChunk *C = &Chunks[NextChunk++];
+      auto Future = Pool.async([&, O, C] {
+        DisassemblerInstance *DI;
+        {
+          std::lock_guard<std::mutex> Lock(FreeInstancesMutex);
+          DI = FreeInstances.back();
+          FreeInstances.pop_back();
+        }
+        DI->SP->startChunk();
+        {
+          raw_string_ostream OS(O->Text);
+          O->EC = DisassembleChunk(*DI, *C, OS);
+        }
+        ArrayRef<SourcePrinter::PendingLine> PendingLines =
+            DI->SP->getPendingLines();
+        O->PendingLines.assign(PendingLines.begin(), PendingLines.end());
+        O->OldLineKnown = DI->SP->isOldLineKnown();
+        O->OldLine = DI->SP->getOldLine();
+        std::lock_guard<std::mutex> Lock(FreeInstancesMutex);
+        FreeInstances.push_back(DI);
+      });
+      InFlight.emplace_back(std::move(Future), std::move(Out));
+    }
+
+    InFlight.front().first.wait();
+    std::unique_ptr<ChunkOutput> Out = std::move(InFlight.front().second);
+    InFlight.pop_front();
+
+    // Leave out the line headers that repeat the line printed last.
+    StringRef Text = Out->Text;
+    size_t Pos = 0;
+    for (const SourcePrinter::PendingLine &P : Out->PendingLines) {
+      if (P.Line != OldLine)
+        continue;
+      outs() << Text.slice(Pos, P.Begin);
+      Pos = P.End;
+    }
+    outs() << Text.substr(Pos);
+    if (Out->OldLineKnown)
+      OldLine = Out->OldLine;
+    if (Out->EC) {
+      Pool.wait();
+      error(Out->EC);
+    }
   }
+  error(DeferredEC);
 }
 
 void llvm::PrintRelocations(const ObjectFile *Obj) {
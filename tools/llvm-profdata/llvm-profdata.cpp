@@ -35,7 +35,13 @@
 
 using namespace llvm;
 
-enum ProfileFormat { PF_None = 0, PF_Text, PF_Binary, PF_GCC };
+enum ProfileFormat {
+  PF_None = 0,
+  PF_Text,
+  PF_Binary,
+  PF_GCC,
+  PF_Compact_Binary
+};
 
 static void exitWithError(const Twine &Message, StringRef Whence = "",
                           StringRef Hint = "") {
@@ -178,6 +184,56 @@ static void mergeWriterContexts(WriterContext *Dst, WriterContext *Src) {
     Dst->Err = std::move(E);
 }
 
+/// Return the number of threads to merge \p NumInputs inputs with when the
+/// user did not ask for a specific number.
+static unsigned getDefaultNumThreads(size_t NumInputs) {
+  return std::max(1U, std::min(std::thread::hardware_concurrency(),
+                               unsigned(NumInputs / 2)));
+}
+
+/// Load \p Inputs into \p Contexts with \p Load, spreading them over one
+/// thread per context, and then merge all the contexts into the first one
+/// with \p Merge.
+template <typename ContextT>
+static void
+loadAndMergeInputs(const WeightedFileVector &Inputs,
+                   SmallVectorImpl<std::unique_ptr<ContextT>> &Contexts,
+                   void (*Load)(const WeightedFile &, ContextT *),
+                   void (*Merge)(ContextT *, ContextT *)) {
+  unsigned NumThreads = Contexts.size();
+  if (NumThreads == 1) {
+    for (const auto &Input : Inputs)
+      Load(Input, Contexts[0].get());
+    return;
+  }
+
+  ThreadPool Pool(NumThreads);
+
+  // Load the inputs in parallel (N/NumThreads serial steps).
+  unsigned Ctx = 0;
+  for (const auto &Input : Inputs) {
+    Pool.async(Load, Input, Contexts[Ctx].get());
+    Ctx = (Ctx + 1) % NumThreads;
+  }
+  Pool.wait();
+
+  // Merge the contexts together (~ lg(NumThreads) serial steps).
+  unsigned Mid = Contexts.size() / 2;
+  unsigned End = Contexts.size();
+  assert(Mid > 0 && "Expected more than one context");
+  do {
+    for (unsigned I = 0; I < Mid; ++I)
+      Pool.async(Merge, Contexts[I].get(), Contexts[I + Mid].get());
+    Pool.wait();
+    if (End & 1) {
+      Pool.async(Merge, Contexts[0].get(), Contexts[End - 1].get());
+      Pool.wait();
+    }
+    End = Mid;
+    Mid /= 2;
+  } while (Mid > 0);
+}
+
 static void mergeInstrProfile(const WeightedFileVector &Inputs,
                               StringRef OutputFilename,
                               ProfileFormat OutputFormat, bool OutputSparse,
@@ -198,8 +254,7 @@ static void mergeInstrProfile(const WeightedFileVector &Inputs,
 
   // If NumThreads is not specified, auto-detect a good default.
   if (NumThreads == 0)
-    NumThreads = std::max(1U, std::min(std::thread::hardware_concurrency(),
-                                       unsigned(Inputs.size() / 2)));
+    NumThreads = getDefaultNumThreads(Inputs.size());
 
   // Initialize the writer contexts.
   SmallVector<std::unique_ptr<WriterContext>, 4> Contexts;
@@ -207,38 +262,7 @@ static void mergeInstrProfile(const WeightedFileVector &Inputs,
     Contexts.emplace_back(llvm::make_unique<WriterContext>(
         OutputSparse, ErrorLock, WriterErrorCodes));
 
-  if (NumThreads == 1) {
-    for (const auto &Input : Inputs)
-      loadInput(Input, Contexts[0].get());
-  } else {
-    ThreadPool Pool(NumThreads);
-
-    // Load the inputs in parallel (N/NumThreads serial steps).
-    unsigned Ctx = 0;
-    for (const auto &Input : Inputs) {
-      Pool.async(loadInput, Input, Contexts[Ctx].get());
-      Ctx = (Ctx + 1) % NumThreads;
-    }
-    Pool.wait();
-
-    // Merge the writer contexts together (~ lg(NumThreads) serial steps).
-    unsigned Mid = Contexts.size() / 2;
-    unsigned End = Contexts.size();
-    assert(Mid > 0 && "Expected more than one context");
-    do {
-      for (unsigned I = 0; I < Mid; ++I)
-        Pool.async(mergeWriterContexts, Contexts[I].get(),
-                   Contexts[I + Mid].get());
-      Pool.wait();
-      if (End & 1) {
-        Pool.async(mergeWriterContexts, Contexts[0].get(),
-                   Contexts[End - 1].get());
-        Pool.wait();
-      }
-      End = Mid;
-      Mid /= 2;
-    } while (Mid > 0);
-  }
+  loadAndMergeInputs(Inputs, Contexts, loadInput, mergeWriterContexts);
 
   // Handle deferred hard errors encountered during merging.
   for (std::unique_ptr<WriterContext> &WC : Contexts)
@@ -254,49 +278,109 @@ static void mergeInstrProfile(const WeightedFileVector &Inputs,
 
 static sampleprof::SampleProfileFormat FormatMap[] = {
     sampleprof::SPF_None, sampleprof::SPF_Text, sampleprof::SPF_Binary,
-    sampleprof::SPF_GCC};
+    sampleprof::SPF_GCC, sampleprof::SPF_Compact_Binary};
+
+/// Keep track of merged sample profiles and reported errors.
+struct SampleWriterContext {
+  LLVMContext Context;
+  StringMap<sampleprof::FunctionSamples> ProfileMap;
+  // We need to keep the readers around until after all the files are
+  // read so that we do not lose the function names stored in each
+  // reader's memory. The function names are needed to write out the
+  // merged profile map.
+  SmallVector<std::unique_ptr<sampleprof::SampleProfileReader>, 5> Readers;
+  std::error_code Err;
+  std::string ErrWhence;
+  std::mutex &ErrLock;
+
+  SampleWriterContext(std::mutex &ErrLock) : ErrLock(ErrLock) {}
+};
+
+/// Report an error merging the samples of \p FName.
+static void handleSampleMergeError(sampleprof_error Result, std::mutex &ErrLock,
+                                   StringRef WhenceFile, StringRef FName) {
+  std::unique_lock<std::mutex> ErrGuard{ErrLock};
+  handleMergeWriterError(errorCodeToError(make_error_code(Result)),
+                         WhenceFile, FName);
+}
+
+/// Load a sample profile into a writer context.
+static void loadSampleInput(const WeightedFile &Input,
+                            SampleWriterContext *WC) {
+  using namespace sampleprof;
+
+  // If there's a pending hard error, don't do more work.
+  if (WC->Err)
+    return;
+
+  WC->ErrWhence = Input.Filename;
+
+  auto ReaderOrErr = SampleProfileReader::create(Input.Filename, WC->Context);
+  if (std::error_code EC = ReaderOrErr.getError()) {
+    WC->Err = EC;
+    return;
+  }
+
+  WC->Readers.push_back(std::move(ReaderOrErr.get()));
+  const auto Reader = WC->Readers.back().get();
+  if (std::error_code EC = Reader->read()) {
+    WC->Err = EC;
+    return;
+  }
+
+  for (auto &I : Reader->getProfiles()) {
+    StringRef FName = I.first();
+    sampleprof_error Result =
+        WC->ProfileMap[FName].merge(I.second, Input.Weight);
+    if (Result != sampleprof_error::success)
+      handleSampleMergeError(Result, WC->ErrLock, Input.Filename, FName);
+  }
+}
+
+/// Merge the \p Src sample writer context into \p Dst. Sample counts are
+/// added with saturation, so the result does not depend on the order in
+/// which the contexts are merged.
+static void mergeSampleContexts(SampleWriterContext *Dst,
+                                SampleWriterContext *Src) {
+  for (auto &I : Src->ProfileMap) {
+    StringRef FName = I.first();
+    sampleprof_error Result = Dst->ProfileMap[FName].merge(I.second);
+    if (Result != sampleprof_error::success)
+      handleSampleMergeError(Result, Dst->ErrLock, "", FName);
+  }
+}
 
 static void mergeSampleProfile(const WeightedFileVector &Inputs,
                                StringRef OutputFilename,
-                               ProfileFormat OutputFormat) {
+                               ProfileFormat OutputFormat,
+                               unsigned NumThreads) {
   using namespace sampleprof;
   auto WriterOrErr =
       SampleProfileWriter::create(OutputFilename, FormatMap[OutputFormat]);
   if (std::error_code EC = WriterOrErr.getError())
     exitWithErrorCode(EC, OutputFilename);
 
+  std::mutex ErrorLock;
+
+  // If NumThreads is not specified, auto-detect a good default.
+  if (NumThreads == 0)
+    NumThreads = getDefaultNumThreads(Inputs.size());
+
+  // Initialize the writer contexts. They all stay alive until the merged
+  // profile has been written, as it refers to names owned by their readers.
+  SmallVector<std::unique_ptr<SampleWriterContext>, 4> Contexts;
+  for (unsigned I = 0; I < NumThreads; ++I)
+    Contexts.emplace_back(llvm::make_unique<SampleWriterContext>(ErrorLock));
+
+  loadAndMergeInputs(Inputs, Contexts, loadSampleInput, mergeSampleContexts);
+
+  // Handle deferred hard errors encountered during loading.
+  for (std::unique_ptr<SampleWriterContext> &WC : Contexts)
+    if (WC->Err)
+      exitWithErrorCode(WC->Err, WC->ErrWhence);
+
   auto Writer = std::move(WriterOrErr.get());
-  StringMap<FunctionSamples> ProfileMap;
-  SmallVector<std::unique_ptr<sampleprof::SampleProfileReader>, 5> Readers;
-  LLVMContext Context;
-  for (const auto &Input : Inputs) {
-    auto ReaderOrErr = SampleProfileReader::create(Input.Filename, Context);
-    if (std::error_code EC = ReaderOrErr.getError())
-      exitWithErrorCode(EC, Input.Filename);
-
-    // We need to keep the readers around until after all the files are
-    // read so that we do not lose the function names stored in each
-    // reader's memory. The function names are needed to write out the
-    // merged profile map.
-    Readers.push_back(std::move(ReaderOrErr.get()));
-    const auto Reader = Readers.back().get();
-    if (std::error_code EC = Reader->read())
-      exitWithErrorCode(EC, Input.Filename);
-
-    StringMap<FunctionSamples> &Profiles = Reader->getProfiles();
-    for (StringMap<FunctionSamples>::iterator I = Profiles.begin(),
-                                              E = Profiles.end();
-         I != E; ++I) {
-      StringRef FName = I->first();
-      FunctionSamples &Samples = I->second;
-      sampleprof_error Result = ProfileMap[FName].merge(Samples, Input.Weight);
-      if (Result != sampleprof_error::success) {
-        std::error_code EC = make_error_code(Result);
-        handleMergeWriterError(errorCodeToError(EC), Input.Filename, FName);
-      }
-    }
-  }
-  Writer->write(ProfileMap);
+  Writer->write(Contexts[0]->ProfileMap);
 }
 
 static WeightedFile parseWeightedFile(const StringRef &WeightedFilename) {
@@ -405,7 +489,10 @@ static int merge_main(int argc, const char *argv[]) {
       cl::values(clEnumValN(PF_Binary, "binary", "Binary encoding (default)"),
                  clEnumValN(PF_Text, "text", "Text encoding"),
                  clEnumValN(PF_GCC, "gcc",
-                            "GCC encoding (only meaningful for -sample)")));
+                            "GCC encoding (only meaningful for -sample)"),
+                 clEnumValN(PF_Compact_Binary, "compbinary",
+                            "Compact binary encoding with a function index "
+                            "(only meaningful for -sample)")));
   cl::opt<bool> OutputSparse("sparse", cl::init(false),
       cl::desc("Generate a sparse profile (only meaningful for -instr)"));
   cl::opt<unsigned> NumThreads(
@@ -441,7 +528,8 @@ static int merge_main(int argc, const char *argv[]) {
     mergeInstrProfile(WeightedInputs, OutputFilename, OutputFormat,
                       OutputSparse, NumThreads);
   else
-    mergeSampleProfile(WeightedInputs, OutputFilename, OutputFormat);
+    mergeSampleProfile(WeightedInputs, OutputFilename, OutputFormat,
+                       NumThreads);
 
   return 0;
 }
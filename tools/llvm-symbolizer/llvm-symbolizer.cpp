@@ -26,10 +26,14 @@
 #include "llvm/Support/Path.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
+#include <map>
 #include <string>
+#include <vector>
 
 using namespace llvm;
 using namespace symbolize;
@@ -85,11 +89,22 @@ static cl::opt<int> ClPrintSourceContextLines(
     "print-source-context-lines", cl::init(0),
     cl::desc("Print N number of source file context"));
 
+static cl::opt<unsigned long long> ClCacheSize(
+    "cache-size", cl::init(0),
+    cl::desc("Approximate number of bytes of binaries to keep loaded "
+             "(0 = no limit)"));
+
+static cl::opt<unsigned>
+    ClThreads("j", cl::Prefix, cl::init(1),
+              cl::desc("Number of threads to symbolize different binaries "
+                       "with. With more than one, all input is read before "
+                       "any result is printed"));
+
 template<typename T>
-static bool error(Expected<T> &ResOrErr) {
+static bool error(Expected<T> &ResOrErr, raw_ostream &OS = errs()) {
   if (ResOrErr)
     return false;
-  logAllUnhandledErrors(ResOrErr.takeError(), errs(),
+  logAllUnhandledErrors(ResOrErr.takeError(), OS,
                         "LLVMSymbolizer: error reading file: ");
   return true;
 }
@@ -137,6 +152,117 @@ static bool parseCommand(StringRef InputString, bool &IsData,
   return !StringRef(pos, offset_length).getAsInteger(0, ModuleOffset);
 }
 
+namespace {
+/// A line of input and, once symbolized, what to print for it.
+struct Query {
+  std::string Input;
+  bool IsValid = false;
+  bool IsData = false;
+  uint64_t ModuleOffset = 0;
+  std::string Output;
+  std::string Errors;
+};
+} // end anonymous namespace
+
+static void printAddress(raw_ostream &OS, uint64_t ModuleOffset) {
+  OS << "0x";
+  OS.write_hex(ModuleOffset);
+  StringRef Delimiter = (ClPrettyPrint == true) ? ": " : "\n";
+  OS << Delimiter;
+}
+
+/// Print the results of symbolizing the queries \p Batch into their outputs.
+template <typename T>
+static void printBatch(Expected<std::vector<T>> ResOrErr,
+                       ArrayRef<size_t> Batch, std::vector<Query> &Queries,
+                       raw_ostream &ErrOS) {
+  bool Failed = error(ResOrErr, ErrOS);
+  for (size_t N = 0; N != Batch.size(); ++N) {
+    Query &Q = Queries[Batch[N]];
+    raw_string_ostream OS(Q.Output);
+    DIPrinter Printer(OS, ClPrintFunctions != FunctionNameKind::None,
+                      ClPrettyPrint, ClPrintSourceContextLines);
+    if (ClPrintAddress)
+      printAddress(OS, Q.ModuleOffset);
+    Printer << (Failed ? T() : (*ResOrErr)[N]);
+    OS << "\n";
+  }
+}
+
+/// Symbolize the queries \p Indices into \p Queries, which are all for the
+/// module \p ModuleName, with a symbolizer of their own.
+static void symbolizeModule(const LLVMSymbolizer::Options &Opts,
+                            const std::string &ModuleName,
+                            ArrayRef<size_t> Indices,
+                            std::vector<Query> &Queries) {
+  LLVMSymbolizer Symbolizer(Opts);
+
+  // Look code and data up in one batch each, sorted by address.
+  std::vector<size_t> Code, Data;
+  for (size_t I : Indices)
+    (Queries[I].IsData ? Data : Code).push_back(I);
+  auto ByOffset = [&](size_t LHS, size_t RHS) {
+    return Queries[LHS].ModuleOffset < Queries[RHS].ModuleOffset;
+  };
+  std::stable_sort(Code.begin(), Code.end(), ByOffset);
+  std::stable_sort(Data.begin(), Data.end(), ByOffset);
+  auto getOffsets = [&](ArrayRef<size_t> Batch) {
+    std::vector<uint64_t> Offsets;
+    for (size_t I : Batch)
+      Offsets.push_back(Queries[I].ModuleOffset);
+    return Offsets;
+  };
+
+  // An error loading the module is printed before the first query for it.
+  raw_string_ostream ErrOS(Queries[Indices.front()].Errors);
+  if (!Code.empty()) {
+    if (ClPrintInlining)
+      printBatch(
+          Symbolizer.symbolizeInlinedCodeBatch(ModuleName, getOffsets(Code)),
+          Code, Queries, ErrOS);
+    else
+      printBatch(Symbolizer.symbolizeCodeBatch(ModuleName, getOffsets(Code)),
+                 Code, Queries, ErrOS);
+  }
+  if (!Data.empty())
+    printBatch(Symbolizer.symbolizeDataBatch(ModuleName, getOffsets(Data)),
+               Data, Queries, ErrOS);
+}
+
+/// Read all of the input, then symbolize the queries for different modules
+/// on \p Threads threads and print the results in input order.
+static void symbolizeInParallel(const LLVMSymbolizer::Options &Opts,
+                                unsigned Threads) {
+  const int kMaxInputStringLength = 1024;
+  char InputString[kMaxInputStringLength];
+
+  std::vector<Query> Queries;
+  std::map<std::string, std::vector<size_t>> QueriesForModule;
+  while (fgets(InputString, sizeof(InputString), stdin)) {
+    Queries.emplace_back();
+    Query &Q = Queries.back();
+    Q.Input = InputString;
+    std::string ModuleName;
+    Q.IsValid = parseCommand(StringRef(InputString), Q.IsData, ModuleName,
+                             Q.ModuleOffset);
+    if (Q.IsValid)
+      QueriesForModule[ModuleName].push_back(Queries.size() - 1);
+  }
+
+  ThreadPool Pool(Threads);
+  for (const auto &Entry : QueriesForModule)
+    Pool.async([&Opts, &Entry, &Queries] {
+      symbolizeModule(Opts, Entry.first, Entry.second, Queries);
+    });
+  Pool.wait();
+
+  for (const Query &Q : Queries) {
+    errs() << Q.Errors;
+    outs() << (Q.IsValid ? Q.Output : Q.Input);
+  }
+  outs().flush();
+}
+
 int main(int argc, char **argv) {
   // Print stack trace if we signal out.
   sys::PrintStackTraceOnErrorSignal(argv[0]);
@@ -157,6 +283,13 @@ int main(int argc, char **argv) {
                 "\" (must have the '.dSYM' extension).\n";
     }
   }
+  Opts.MaxCacheSize = ClCacheSize;
+
+  if (ClThreads > 1) {
+    symbolizeInParallel(Opts, ClThreads);
+    return 0;
+  }
+
   LLVMSymbolizer Symbolizer(Opts);
 
   DIPrinter Printer(outs(), ClPrintFunctions != FunctionNameKind::None,
@@ -178,12 +311,8 @@ int main(int argc, char **argv) {
       continue;
     }
 
-    if (ClPrintAddress) {
-      outs() << "0x";
-      outs().write_hex(ModuleOffset);
-      StringRef Delimiter = (ClPrettyPrint == true) ? ": " : "\n";
-      outs() << Delimiter;
-    }
+    if (ClPrintAddress)
+      printAddress(outs(), ModuleOffset);
     if (IsData) {
       auto ResOrErr = Symbolizer.symbolizeData(ModuleName, ModuleOffset);
       Printer << (error(ResOrErr) ? DIGlobal() : ResOrErr.get());
@@ -0,0 +1,213 @@
+//===- llvm/unittest/ADT/FlatHashMapTest.cpp - FlatHashMap unit tests -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/FlatHashMap.h"
+#include "gtest/gtest.h"
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+using namespace llvm;
+
+namespace {
+
+/// A value type that checks that every constructed object is destroyed
+/// exactly once.
+class Tracked {
+  static std::set<const Tracked *> Live;
+  int Value;
+
+public:
+  explicit Tracked(int Value = 0) : Value(Value) {
+    EXPECT_TRUE(Live.insert(this).second);
+  }
+  Tracked(const Tracked &Arg) : Value(Arg.Value) {
+    EXPECT_TRUE(Live.insert(this).second);
+  }
+  Tracked &operator=(const Tracked &) = default;
+  ~Tracked() { EXPECT_EQ(1u, Live.erase(this)); }
+
+  int getValue() const { return Value; }
+  static size_t getNumLive() { return Live.size(); }
+};
+
+std::set<const Tracked *> Tracked::Live;
+
+/// Every key hashes to the same value, so all entries share one probe
+/// sequence and one control byte tag.
+struct CollidingInfo {
+  static unsigned getEmptyKey() { return ~0u; }
+  static unsigned getTombstoneKey() { return ~0u - 1; }
+  static unsigned getHashValue(unsigned) { return 0; }
+  static bool isEqual(unsigned LHS, unsigned RHS) { return LHS == RHS; }
+};
+
+TEST(FlatHashMapTest, EmptyMap) {
+  FlatHashMap<unsigned, unsigned> M;
+  EXPECT_TRUE(M.empty());
+  EXPECT_EQ(0u, M.size());
+  EXPECT_TRUE(M.begin() == M.end());
+  EXPECT_EQ(0u, M.count(1));
+  EXPECT_TRUE(M.find(1) == M.end());
+  EXPECT_EQ(0u, M.lookup(1));
+  EXPECT_FALSE(M.erase(1));
+}
+
+TEST(FlatHashMapTest, InsertFindErase) {
+  FlatHashMap<unsigned, unsigned> M;
+  auto R = M.insert(std::make_pair(1u, 2u));
+  EXPECT_TRUE(R.second);
+  EXPECT_EQ(1u, R.first->first);
+  EXPECT_EQ(2u, R.first->second);
+
+  R = M.insert(std::make_pair(1u, 3u));
+  EXPECT_FALSE(R.second);
+  EXPECT_EQ(2u, R.first->second);
+
+  EXPECT_EQ(1u, M.size());
+  EXPECT_EQ(2u, M.lookup(1));
+  EXPECT_EQ(2u, M[1]);
+  M[5] = 6;
+  EXPECT_EQ(2u, M.size());
+  EXPECT_EQ(6u, M.find(5)->second);
+
+  EXPECT_TRUE(M.erase(1));
+  EXPECT_FALSE(M.erase(1));
+  EXPECT_EQ(1u, M.size());
+  EXPECT_EQ(0u, M.count(1));
+
+  M.erase(M.find(5));
+  EXPECT_TRUE(M.empty());
+}
+
+// DenseMap reserves two key values as sentinels; FlatHashMap does not.
+TEST(FlatHashMapTest, SentinelKeys) {
+  FlatHashMap<unsigned, unsigned> M;
+  M[DenseMapInfo<unsigned>::getEmptyKey()] = 1;
+  M[DenseMapInfo<unsigned>::getTombstoneKey()] = 2;
+  EXPECT_EQ(2u, M.size());
+  EXPECT_EQ(1u, M.lookup(DenseMapInfo<unsigned>::getEmptyKey()));
+  EXPECT_EQ(2u, M.lookup(DenseMapInfo<unsigned>::getTombstoneKey()));
+}
+
+TEST(FlatHashMapTest, ManyEntriesMatchStdMap) {
+  FlatHashMap<unsigned, unsigned> M;
+  std::map<unsigned, unsigned> Ref;
+  for (unsigned I = 0; I != 10000; ++I) {
+    unsigned Key = I * 7919u;
+    M[Key] = I;
+    Ref[Key] = I;
+  }
+  // Erase every third entry, then reinsert half of them to exercise reuse of
+  // deleted buckets.
+  for (unsigned I = 0; I < 10000; I += 3) {
+    M.erase(I * 7919u);
+    Ref.erase(I * 7919u);
+  }
+  for (unsigned I = 0; I < 10000; I += 6) {
+    M[I * 7919u] = I + 1;
+    Ref[I * 7919u] = I + 1;
+  }
+
+  EXPECT_EQ(Ref.size(), M.size());
+  for (const auto &KV : Ref) {
+    auto It = M.find(KV.first);
+    ASSERT_TRUE(It != M.end());
+    EXPECT_EQ(KV.second, It->second);
+  }
+
+  size_t Visited = 0;
+  for (const auto &KV : M) {
+    EXPECT_EQ(Ref[KV.first], KV.second);
+    ++Visited;
+  }
+  EXPECT_EQ(Ref.size(), Visited);
+}
+
+TEST(FlatHashMapTest, FullCollisions) {
+  FlatHashMap<unsigned, unsigned, CollidingInfo> M;
+  for (unsigned I = 0; I != 100; ++I)
+    M[I] = I;
+  for (unsigned I = 0; I != 100; I += 2)
+    EXPECT_TRUE(M.erase(I));
+  for (unsigned I = 0; I != 100; ++I)
+    EXPECT_EQ(I % 2, M.count(I));
+}
+
+TEST(FlatHashMapTest, ChurnDoesNotGrow) {
+  FlatHashMap<unsigned, unsigned> M;
+  M.reserve(100);
+  size_t Size = M.getMemorySize();
+  for (unsigned I = 0; I != 100000; ++I) {
+    M[I] = I;
+    if (I >= 50) {
+      EXPECT_TRUE(M.erase(I - 50));
+    }
+  }
+  EXPECT_EQ(50u, M.size());
+  EXPECT_EQ(Size, M.getMemorySize());
+}
+
+TEST(FlatHashMapTest, ConstructionAndDestruction) {
+  {
+    FlatHashMap<unsigned, Tracked> M;
+    for (unsigned I = 0; I != 100; ++I)
+      M.try_emplace(I, I);
+    EXPECT_EQ(100u, Tracked::getNumLive());
+
+    for (unsigned I = 0; I != 50; ++I)
+      M.erase(I);
+    EXPECT_EQ(50u, Tracked::getNumLive());
+
+    FlatHashMap<unsigned, Tracked> Copy(M);
+    EXPECT_EQ(100u, Tracked::getNumLive());
+    EXPECT_EQ(75, Copy.find(75)->second.getValue());
+
+    Copy.clear();
+    EXPECT_EQ(50u, Tracked::getNumLive());
+    EXPECT_TRUE(Copy.empty());
+  }
+  EXPECT_EQ(0u, Tracked::getNumLive());
+}
+
+TEST(FlatHashMapTest, MoveOnlyValues) {
+  FlatHashMap<unsigned, std::unique_ptr<int>> M;
+  for (unsigned I = 0; I != 64; ++I)
+    M.try_emplace(I, new int(I));
+
+  FlatHashMap<unsigned, std::unique_ptr<int>> Moved(std::move(M));
+  EXPECT_TRUE(M.empty());
+  EXPECT_EQ(64u, Moved.size());
+  EXPECT_EQ(17, *Moved.find(17)->second);
+
+  M = std::move(Moved);
+  EXPECT_EQ(64u, M.size());
+  EXPECT_EQ(0u, Moved.size());
+}
+
+TEST(FlatHashMapTest, StringValuesAndSwap) {
+  FlatHashMap<int *, std::string> A, B;
+  int Objs[3];
+  A[&Objs[0]] = "zero";
+  B[&Objs[1]] = "one";
+  B[&Objs[2]] = "two";
+
+  A.swap(B);
+  EXPECT_EQ(2u, A.size());
+  EXPECT_EQ(1u, B.size());
+  EXPECT_EQ("two", A.lookup(&Objs[2]));
+  EXPECT_EQ("zero", B.lookup(&Objs[0]));
+
+  B = A;
+  EXPECT_EQ(2u, B.size());
+  EXPECT_EQ("one", B.lookup(&Objs[1]));
+}
+
+} // end anonymous namespace
@@ -0,0 +1,164 @@
+//===- llvm/unittest/ADT/FlatStringMapTest.cpp - FlatStringMap tests ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/FlatStringMap.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/ADT/Twine.h"
+#include "gtest/gtest.h"
+#include <string>
+using namespace llvm;
+
+namespace {
+
+TEST(FlatStringMapTest, EmptyMap) {
+  FlatStringMap<int> Map;
+  EXPECT_TRUE(Map.empty());
+  EXPECT_EQ(0u, Map.size());
+  EXPECT_TRUE(Map.begin() == Map.end());
+  EXPECT_EQ(0u, Map.count("key"));
+  EXPECT_TRUE(Map.find("key") == Map.end());
+  EXPECT_FALSE(Map.erase("key"));
+  EXPECT_EQ(0, Map.lookup("key"));
+}
+
+TEST(FlatStringMapTest, InsertFindErase) {
+  FlatStringMap<int> Map;
+  auto R = Map.insert(std::make_pair("key", 1));
+  EXPECT_TRUE(R.second);
+  EXPECT_EQ("key", R.first->first());
+  EXPECT_EQ(1, R.first->second);
+
+  // A second insertion of the same key leaves the value alone.
+  R = Map.insert(std::make_pair("key", 2));
+  EXPECT_FALSE(R.second);
+  EXPECT_EQ(1, R.first->second);
+  EXPECT_EQ(1u, Map.size());
+
+  // Keys need not be null terminated.
+  const char Buf[] = "keys";
+  EXPECT_EQ(1u, Map.count(StringRef(Buf, 3)));
+  EXPECT_EQ(0u, Map.count(StringRef(Buf, 4)));
+
+  // The empty string is a key like any other.
+  Map[""] = 5;
+  EXPECT_EQ(5, Map.lookup(""));
+  EXPECT_EQ(2u, Map.size());
+
+  EXPECT_TRUE(Map.erase("key"));
+  EXPECT_FALSE(Map.erase("key"));
+  EXPECT_EQ(0u, Map.count("key"));
+  EXPECT_EQ(1u, Map.size());
+
+  Map.erase(Map.find(""));
+  EXPECT_TRUE(Map.empty());
+  EXPECT_TRUE(Map.begin() == Map.end());
+}
+
+TEST(FlatStringMapTest, ManyKeys) {
+  // Enough keys to grow the table several times, with long common prefixes
+  // like mangled names have.
+  const unsigned N = 5000;
+  FlatStringMap<unsigned> Map;
+  for (unsigned I = 0; I != N; ++I)
+    Map["_ZN4llvm12_GLOBAL__N_19SomeClass" + Twine(I).str() + "Ev"] = I;
+  EXPECT_EQ(N, Map.size());
+
+  for (unsigned I = 0; I != N; ++I)
+    EXPECT_EQ(I, Map.lookup("_ZN4llvm12_GLOBAL__N_19SomeClass" +
+                            Twine(I).str() + "Ev"));
+
+  // Iteration visits every key exactly once.
+  StringSet<> Seen;
+  for (auto &E : Map)
+    EXPECT_TRUE(Seen.insert(E.first()).second);
+  EXPECT_EQ(N, Seen.size());
+
+  // Erase every other key, then add them back, which reuses the freed
+  // buckets.
+  for (unsigned I = 0; I < N; I += 2)
+    EXPECT_TRUE(Map.erase("_ZN4llvm12_GLOBAL__N_19SomeClass" +
+                          Twine(I).str() + "Ev"));
+  EXPECT_EQ(N / 2, Map.size());
+  for (unsigned I = 0; I != N; ++I)
+    EXPECT_EQ(I % 2 ? 1u : 0u,
+              Map.count("_ZN4llvm12_GLOBAL__N_19SomeClass" + Twine(I).str() +
+                        "Ev"));
+  for (unsigned I = 0; I < N; I += 2)
+    EXPECT_TRUE(Map.try_emplace("_ZN4llvm12_GLOBAL__N_19SomeClass" +
+                                    Twine(I).str() + "Ev",
+                                I)
+                    .second);
+  EXPECT_EQ(N, Map.size());
+  for (unsigned I = 0; I != N; ++I)
+    EXPECT_EQ(I, Map.lookup("_ZN4llvm12_GLOBAL__N_19SomeClass" +
+                            Twine(I).str() + "Ev"));
+}
+
+TEST(FlatStringMapTest, ChurnDoesNotGrow) {
+  // Repeatedly inserting and erasing keys must recycle deleted buckets rather
+  // than grow the table without bound.
+  FlatStringMap<int> Map(64);
+  unsigned Buckets = Map.getNumBuckets();
+  for (unsigned I = 0; I != 10000; ++I) {
+    std::string Key = "key" + Twine(I).str();
+    Map[Key] = I;
+    if (Map.size() > 32)
+      Map.erase("key" + Twine(I - 32).str());
+  }
+  EXPECT_EQ(32u, Map.size());
+  EXPECT_EQ(Buckets, Map.getNumBuckets());
+}
+
+TEST(FlatStringMapTest, EntriesOutliveGrowth) {
+  // Entries are allocated separately, so references to them stay valid when
+  // the table grows.
+  FlatStringMap<int> Map;
+  FlatStringMap<int>::MapEntryTy &First = *Map.try_emplace("first", 1).first;
+  for (unsigned I = 0; I != 1000; ++I)
+    Map["k" + Twine(I).str()] = I;
+  EXPECT_EQ("first", First.first());
+  EXPECT_EQ(1, First.second);
+  EXPECT_EQ(&First, &*Map.find("first"));
+}
+
+TEST(FlatStringMapTest, NonDefaultConstructibleValue) {
+  struct Value {
+    explicit Value(int V) : V(V) {}
+    int V;
+  };
+  FlatStringMap<Value> Map;
+  EXPECT_TRUE(Map.try_emplace("a", 1).second);
+  EXPECT_FALSE(Map.try_emplace("a", 2).second);
+  EXPECT_EQ(1, Map.find("a")->second.V);
+}
+
+TEST(FlatStringMapTest, MoveAndClear) {
+  FlatStringMap<std::string> A;
+  A["one"] = "1";
+  A["two"] = "2";
+
+  FlatStringMap<std::string> B(std::move(A));
+  EXPECT_EQ(2u, B.size());
+  EXPECT_EQ("2", B.lookup("two"));
+
+  FlatStringMap<std::string> C;
+  C["three"] = "3";
+  C = std::move(B);
+  EXPECT_EQ(2u, C.size());
+  EXPECT_EQ("1", C.lookup("one"));
+  EXPECT_EQ(0u, C.count("three"));
+
+  C.clear();
+  EXPECT_TRUE(C.empty());
+  EXPECT_EQ(0u, C.count("one"));
+  C["one"] = "uno";
+  EXPECT_EQ("uno", C.lookup("one"));
+}
+
+} // end anonymous namespace
@@ -11,9 +11,12 @@
 #include "llvm/AsmParser/Parser.h"
 #include "llvm/AsmParser/SlotMapping.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/Error.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -415,4 +418,139 @@ TEST(AsmParserTest, TypeAtBeginningWithSlotMappingParsing) {
   ASSERT_TRUE(Read == 4);
 }
 
+std::unique_ptr<Module> parseLazyAssemblyString(StringRef Source,
+                                                SMDiagnostic &Error,
+                                                LLVMContext &Ctx) {
+  return parseLazyAssembly(MemoryBuffer::getMemBuffer(Source), Error, Ctx);
+}
+
+TEST(AsmParserTest, LazyFunctionBodies) {
+  LLVMContext Ctx;
+  StringRef Source = "declare void @\"a}b\"()\n"
+                     "define void @f() {\n"
+                     "  ; a comment with a } in it\n"
+                     "  call void @\"a}b\"()\n"
+                     "  call void @g()\n"
+                     "  ret void\n"
+                     "}\n"
+                     "define void @g() {\n"
+                     "  ret void\n"
+                     "}\n";
+  SMDiagnostic Error;
+  auto Mod = parseLazyAssemblyString(Source, Error, Ctx);
+  ASSERT_TRUE(Mod != nullptr);
+
+  Function *F = Mod->getFunction("f");
+  Function *G = Mod->getFunction("g");
+  EXPECT_TRUE(F->isMaterializable());
+  EXPECT_TRUE(G->isMaterializable());
+  EXPECT_FALSE(Mod->getFunction("a}b")->isMaterializable());
+
+  ASSERT_FALSE(F->materialize());
+  EXPECT_FALSE(F->isMaterializable());
+  EXPECT_EQ(3u, F->front().size());
+  EXPECT_TRUE(G->isMaterializable());
+
+  ASSERT_FALSE(Mod->materializeAll());
+  EXPECT_FALSE(G->isMaterializable());
+  EXPECT_EQ(1u, G->front().size());
+}
+
+TEST(AsmParserTest, LazyBlockAddress) {
+  LLVMContext Ctx;
+  StringRef Source = "@ba = global i8* blockaddress(@f, %bb)\n"
+                     "define void @f() {\n"
+                     "entry:\n"
+                     "  br label %bb\n"
+                     "bb:\n"
+                     "  ret void\n"
+                     "}\n"
+                     "define i8* @g() {\n"
+                     "  ret i8* blockaddress(@h, %2)\n"
+                     "}\n"
+                     "define void @h(i32) {\n"
+                     "  br label %2\n"
+                     "  ret void\n"
+                     "}\n";
+  SMDiagnostic Error;
+  auto Mod = parseLazyAssemblyString(Source, Error, Ctx);
+  ASSERT_TRUE(Mod != nullptr);
+
+  // The body of @f is needed to resolve the initializer of @ba.
+  Function *F = Mod->getFunction("f");
+  EXPECT_FALSE(F->isMaterializable());
+  auto *BA = cast<BlockAddress>(Mod->getNamedGlobal("ba")->getInitializer());
+  EXPECT_EQ(&F->back(), BA->getBasicBlock());
+
+  // Parsing @g parses @h too, and finds its block by number.
+  Function *H = Mod->getFunction("h");
+  EXPECT_TRUE(H->isMaterializable());
+  ASSERT_FALSE(Mod->getFunction("g")->materialize());
+  EXPECT_FALSE(H->isMaterializable());
+  auto *Ret = cast<ReturnInst>(Mod->getFunction("g")->front().getTerminator());
+  BA = cast<BlockAddress>(Ret->getReturnValue());
+  EXPECT_EQ(&H->back(), BA->getBasicBlock());
+}
+
+TEST(AsmParserTest, LazyBodyError) {
+  LLVMContext Ctx;
+  StringRef Source = "define void @f() {\n"
+                     "  ret i32 0\n"
+                     "}\n";
+  SMDiagnostic Err;
+  auto Mod = parseLazyAssemblyString(Source, Err, Ctx);
+  ASSERT_TRUE(Mod != nullptr);
+
+  // The error is only found when the body is parsed.
+  Error E = Mod->getFunction("f")->materialize();
+  ASSERT_TRUE(!!E);
+  EXPECT_NE(std::string::npos,
+            toString(std::move(E)).find("value doesn't match function result"));
+
+  // An unterminated body is caught up front.
+  Mod = parseLazyAssemblyString("define void @f() {\n  ret void\n", Err,
+                                Ctx);
+  EXPECT_TRUE(Mod == nullptr);
+  EXPECT_EQ("expected '}' at end of function body", Err.getMessage());
+}
+
+TEST(AsmParserTest, LazyUseListOrder) {
+  LLVMContext Ctx;
+  StringRef Source = "@g = global i32 0\n"
+                     "define void @f() {\n"
+                     "  store i32 1, i32* @g\n"
+                     "  store i32 2, i32* @g\n"
+                     "  ret void\n"
+                     "}\n"
+                     "uselistorder i32* @g, { 1, 0 }\n";
+  SMDiagnostic Err;
+  auto Mod = parseLazyAssemblyString(Source, Err, Ctx);
+  ASSERT_TRUE(Mod != nullptr);
+
+  // The order of the uses of @g needs both stores, so nothing is deferred.
+  EXPECT_FALSE(Mod->getFunction("f")->isMaterializable());
+  std::string S;
+  raw_string_ostream OS(S);
+  Mod->print(OS, nullptr, /*ShouldPreserveUseListOrder=*/true);
+  EXPECT_NE(std::string::npos,
+            OS.str().find("uselistorder i32* @g, { 1, 0 }"));
+}
+
+TEST(AsmParserTest, LazyUseListOrderLookalikes) {
+  LLVMContext Ctx;
+  StringRef Source = "; uselistorder i32* @g, { 1, 0 }\n"
+                     "@s = constant [13 x i8] c\"uselistorder \"\n"
+                     "define void @uselistorder() {\n"
+                     "uselistorder:\n"
+                     "  %uselistorder_bb = alloca i32\n"
+                     "  ret void\n"
+                     "}\n";
+  SMDiagnostic Err;
+  auto Mod = parseLazyAssemblyString(Source, Err, Ctx);
+  ASSERT_TRUE(Mod != nullptr);
+
+  // None of these is a directive, so the body is still parsed lazily.
+  EXPECT_TRUE(Mod->getFunction("uselistorder")->isMaterializable());
+}
+
 } // end anonymous namespace
@@ -15,6 +15,7 @@
 #include "llvm/Bitcode/BitstreamReader.h"
 #include "llvm/Bitcode/BitstreamWriter.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
@@ -23,6 +24,7 @@
 #include "llvm/Support/Error.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -51,17 +53,25 @@ static void writeModuleToBuffer(std::unique_ptr<Module> Mod,
   WriteBitcodeToFile(Mod.get(), OS);
 }
 
-static std::unique_ptr<Module> getLazyModuleFromAssembly(LLVMContext &Context,
-                                                         SmallString<1024> &Mem,
-                                                         const char *Assembly) {
+static std::unique_ptr<Module>
+getLazyModuleFromAssembly(LLVMContext &Context, SmallString<1024> &Mem,
+                          const char *Assembly, bool IsImporting = false) {
   writeModuleToBuffer(parseAssembly(Context, Assembly), Mem);
-  Expected<std::unique_ptr<Module>> ModuleOrErr =
-      getLazyBitcodeModule(MemoryBufferRef(Mem.str(), "test"), Context);
+  Expected<std::unique_ptr<Module>> ModuleOrErr = getLazyBitcodeModule(
+      MemoryBufferRef(Mem.str(), "test"), Context,
+      /*ShouldLazyLoadMetadata=*/IsImporting, IsImporting);
   if (!ModuleOrErr)
     report_fatal_error("Could not parse bitcode module");
   return std::move(ModuleOrErr.get());
 }
 
+static std::string printModule(const Module &M) {
+  std::string Str;
+  raw_string_ostream OS(Str);
+  M.print(OS, nullptr);
+  return OS.str();
+}
+
 // Tests that lazy evaluation can parse functions out of order.
 TEST(BitReaderTest, MaterializeFunctionsOutOfOrder) {
   SmallString<1024> Mem;
@@ -195,4 +205,93 @@ TEST(BitReaderTest, MaterializeFunctionsForBlockAddrInFunctionAfter) {
   EXPECT_FALSE(verifyModule(*M, &dbgs()));
 }
 
+// More metadata than the threshold for writing an index, reached from named
+// metadata, global and function attachments, with cycles through distinct
+// nodes.
+static const char *MetadataAssembly =
+    "@g = global i32 0, !attach !1\n"
+    "define void @f() !attach !2 {\n"
+    "  ret void, !attach !3\n"
+    "}\n"
+    "define void @h() {\n"
+    "  ret void, !attach !4\n"
+    "}\n"
+    "!named = !{!0}\n"
+    "!0 = !{!\"root\"}\n"
+    "!1 = !{!\"global\", !6, !21}\n"
+    "!2 = distinct !{!2, !5}\n"
+    "!3 = !{!6}\n"
+    "!4 = distinct !{!4, !20}\n"
+    "!5 = !{!2}\n"
+    "!6 = !{!7}\n!7 = !{!8}\n!8 = !{!9}\n!9 = !{!10}\n!10 = !{!11}\n"
+    "!11 = !{!12}\n!12 = !{!13}\n!13 = !{!14}\n!14 = !{!15}\n"
+    "!15 = !{!16}\n!16 = !{!17}\n!17 = !{!18}\n!18 = !{!19}\n"
+    "!19 = !{!\"leaf\"}\n"
+    "!20 = !{!21, !4}\n!21 = !{!22}\n!22 = !{!23}\n!23 = !{!24}\n"
+    "!24 = !{!25}\n!25 = !{!26}\n!26 = !{!27}\n!27 = !{!28}\n"
+    "!28 = !{!29}\n!29 = !{!30}\n!30 = !{!31}\n!31 = !{!\"other leaf\"}\n";
+
+// Metadata that is loaded on demand through the index must form the same
+// graph as metadata that is loaded all at once.
+TEST(BitReaderTest, LazyLoadMetadataForImport) {
+  LLVMContext Context;
+  SmallString<1024> EagerMem;
+  std::unique_ptr<Module> Eager =
+      getLazyModuleFromAssembly(Context, EagerMem, MetadataAssembly);
+  ASSERT_FALSE(Eager->materializeAll());
+
+  LLVMContext LazyContext;
+  SmallString<1024> LazyMem;
+  std::unique_ptr<Module> Lazy = getLazyModuleFromAssembly(
+      LazyContext, LazyMem, MetadataAssembly, /*IsImporting=*/true);
+  ASSERT_FALSE(Lazy->materializeMetadata());
+
+  // The roots are loaded up front.
+  auto *Root = cast<MDNode>(Lazy->getNamedMetadata("named")->getOperand(0));
+  EXPECT_EQ("root", cast<MDString>(Root->getOperand(0))->getString());
+  EXPECT_TRUE(Lazy->getGlobalVariable("g")->hasMetadata());
+
+  // Function bodies pull in what they reference.
+  ASSERT_FALSE(Lazy->getFunction("h")->materialize());
+  MDNode *H = Lazy->getFunction("h")->getEntryBlock().getTerminator()->getMetadata(
+      "attach");
+  ASSERT_TRUE(H);
+  EXPECT_TRUE(H->isDistinct());
+  EXPECT_EQ(H, cast<MDNode>(H->getOperand(1))->getOperand(1));
+  ASSERT_FALSE(Lazy->materializeAll());
+  EXPECT_FALSE(verifyModule(*Lazy, &dbgs()));
+
+  EXPECT_EQ(printModule(*Eager), printModule(*Lazy));
+}
+
+// Compile units of modules loaded for importing leave out the lists that
+// are not imported.
+TEST(BitReaderTest, LazyLoadCompileUnitForImport) {
+  std::string Assembly = MetadataAssembly;
+  Assembly += "!llvm.dbg.cu = !{!40}\n"
+              "!llvm.module.flags = !{!45}\n"
+              "!40 = distinct !DICompileUnit(language: DW_LANG_C99, "
+              "file: !41, producer: \"p\", isOptimized: false, "
+              "runtimeVersion: 0, emissionKind: FullDebug, "
+              "retainedTypes: !42)\n"
+              "!41 = !DIFile(filename: \"t.c\", directory: \"/\")\n"
+              "!42 = !{!43}\n"
+              "!43 = !DIBasicType(name: \"int\", size: 32, "
+              "encoding: DW_ATE_signed)\n"
+              "!45 = !{i32 2, !\"Debug Info Version\", i32 3}\n";
+
+  for (bool IsImporting : {false, true}) {
+    LLVMContext Context;
+    SmallString<1024> Mem;
+    std::unique_ptr<Module> M = getLazyModuleFromAssembly(
+        Context, Mem, Assembly.c_str(), IsImporting);
+    ASSERT_FALSE(M->materializeAll());
+    auto *CU = cast<DICompileUnit>(
+        M->getNamedMetadata("llvm.dbg.cu")->getOperand(0));
+    EXPECT_EQ("t.c", CU->getFilename());
+    EXPECT_EQ(IsImporting ? 0u : 1u, CU->getRetainedTypes().size());
+    EXPECT_FALSE(verifyModule(*M, &dbgs()));
+  }
+}
+
 } // end namespace
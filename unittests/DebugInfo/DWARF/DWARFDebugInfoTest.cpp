@@ -967,5 +967,71 @@ TEST(DWARFDebugInfo, TestDWARF32Version4Addr8Addresses) {
   TestAddresses<4, AddrType>();
 }
 
+TEST(DWARFDebugInfo, TestSubprogramForAddress) {
+  // Test that the subprogram containing an address is found whatever order
+  // the subprograms appear in, including subprograms nested in other DIEs,
+  // and that the first subprogram in DIE order wins when ranges overlap.
+  initLLVMIfNeeded();
+  Triple Triple = getHostTripleForAddrSize(8);
+  auto ExpectedDG = dwarfgen::Generator::create(Triple, 4);
+  if (HandleExpectedError(ExpectedDG))
+    return;
+  dwarfgen::Generator *DG = ExpectedDG.get().get();
+  dwarfgen::CompileUnit &CU = DG->addCompileUnit();
+  dwarfgen::DIE CUDie = CU.getUnitDIE();
+  CUDie.addAttribute(DW_AT_name, DW_FORM_strp, "/tmp/main.c");
+  CUDie.addAttribute(DW_AT_language, DW_FORM_data2, DW_LANG_C);
+
+  auto addSubprogram = [](dwarfgen::DIE Parent, const char *Name,
+                          uint64_t LowPC, uint64_t HighPC) {
+    dwarfgen::DIE SP = Parent.addChild(DW_TAG_subprogram);
+    SP.addAttribute(DW_AT_name, DW_FORM_strp, Name);
+    SP.addAttribute(DW_AT_low_pc, DW_FORM_addr, LowPC);
+    SP.addAttribute(DW_AT_high_pc, DW_FORM_data4, HighPC - LowPC);
+    return SP;
+  };
+  addSubprogram(CUDie, "c", 0x3000, 0x3100);
+  dwarfgen::DIE Namespace = CUDie.addChild(DW_TAG_namespace);
+  Namespace.addAttribute(DW_AT_name, DW_FORM_strp, "ns");
+  addSubprogram(Namespace, "a", 0x1000, 0x1100);
+  dwarfgen::DIE B = addSubprogram(CUDie, "b", 0x2000, 0x2100);
+  dwarfgen::DIE Inlined = B.addChild(DW_TAG_inlined_subroutine);
+  Inlined.addAttribute(DW_AT_name, DW_FORM_strp, "inlined");
+  Inlined.addAttribute(DW_AT_low_pc, DW_FORM_addr, 0x2010U);
+  Inlined.addAttribute(DW_AT_high_pc, DW_FORM_data4, 0x10U);
+  // Overlaps the end of "b" and the start of "c".
+  addSubprogram(CUDie, "overlap", 0x2080, 0x3080);
+  // A subprogram without a range is never found.
+  CUDie.addChild(DW_TAG_subprogram)
+      .addAttribute(DW_AT_name, DW_FORM_strp, "decl");
+
+  StringRef FileBytes = DG->generate();
+  MemoryBufferRef FileBuffer(FileBytes, "dwarf");
+  auto Obj = object::ObjectFile::createObjectFile(FileBuffer);
+  EXPECT_TRUE((bool)Obj);
+  DWARFContextInMemory DwarfContext(*Obj.get());
+  DWARFCompileUnit *U = DwarfContext.getCompileUnitAtIndex(0);
+
+  auto getChain = [&](uint64_t Address) {
+    SmallVector<DWARFDie, 4> Chain;
+    U->getInlinedChainForAddress(Address, Chain);
+    std::vector<std::string> Names;
+    for (const DWARFDie &D : Chain)
+      Names.push_back(D.getName(DINameKind::ShortName));
+    return Names;
+  };
+  typedef std::vector<std::string> Names;
+  EXPECT_EQ(Names(), getChain(0xfff));
+  EXPECT_EQ(Names({"a"}), getChain(0x1000));
+  EXPECT_EQ(Names({"a"}), getChain(0x10ff));
+  EXPECT_EQ(Names(), getChain(0x1100));
+  EXPECT_EQ(Names({"b"}), getChain(0x2000));
+  EXPECT_EQ(Names({"inlined", "b"}), getChain(0x2010));
+  EXPECT_EQ(Names({"b"}), getChain(0x2090));
+  EXPECT_EQ(Names({"overlap"}), getChain(0x2100));
+  EXPECT_EQ(Names({"c"}), getChain(0x3000));
+  EXPECT_EQ(Names({"c"}), getChain(0x30ff));
+  EXPECT_EQ(Names(), getChain(0x3100));
+}
 
 } // end anonymous namespace
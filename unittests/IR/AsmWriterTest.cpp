@@ -6,11 +6,13 @@
 // License. See LICENSE.TXT for details.
 //
 //===----------------------------------------------------------------------===//
+#include "llvm/AsmParser/Parser.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/SourceMgr.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -34,4 +36,37 @@ TEST(AsmWriterTest, DebugPrintDetachedInstruction) {
   EXPECT_TRUE(r != std::string::npos);
 }
 
+TEST(AsmWriterTest, PrintModuleOnThreads) {
+  // Enough functions to be split into several runs, each with unnamed
+  // values, call attributes and metadata that is only used in its body, so
+  // that the numbering depends on the order the functions are printed in.
+  std::string Source = "declare void @g(i32)\n";
+  for (unsigned I = 0; I != 600; ++I) {
+    std::string N = std::to_string(I);
+    Source += "define i32 @f" + N + "(i32, i32 %x) {\n";
+    for (unsigned J = 0; J != 30; ++J)
+      Source += "  %" + std::to_string(J + 2) + " = add i32 %" +
+                std::to_string(J ? J + 1 : 0) + ", %x, !md !{i32 " + N +
+                ", i32 " + std::to_string(J) + "}\n";
+    Source += "  call void @g(i32 %0) #" + std::to_string(I % 7) +
+              "\n  br label %32\n"
+              "  ret i32 %31\n}\n";
+  }
+  for (unsigned I = 0; I != 7; ++I)
+    Source += "attributes #" + std::to_string(I) + " = { alignstack=" +
+              std::to_string(1 << I) + " }\n";
+
+  LLVMContext Ctx;
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseAssemblyString(Source, Err, Ctx);
+  ASSERT_TRUE(M != nullptr) << Err.getMessage().str();
+
+  std::string Serial, Threaded;
+  raw_string_ostream SerialOS(Serial), ThreadedOS(Threaded);
+  M->print(SerialOS, nullptr);
+  M->print(ThreadedOS, nullptr, /*ShouldPreserveUseListOrder=*/false,
+           /*IsForDebug=*/false, /*Threads=*/4);
+  EXPECT_EQ(SerialOS.str(), ThreadedOS.str());
+}
+
 }
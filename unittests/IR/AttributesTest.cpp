@@ -53,4 +53,104 @@ TEST(Attributes, Ordering) {
   EXPECT_NE(SetA, SetB);
 }
 
+TEST(Attributes, IndexQueries) {
+  LLVMContext C;
+
+  AttributeSet ASs[] = {
+    AttributeSet::get(C, AttributeSet::FunctionIndex, Attribute::NoUnwind),
+    AttributeSet::get(C, AttributeSet::ReturnIndex, Attribute::NonNull),
+    AttributeSet::get(C, 3, Attribute::NoCapture),
+    AttributeSet::get(C, 1, Attribute::ZExt)
+  };
+  AttributeSet AS = AttributeSet::get(C, ASs);
+  EXPECT_TRUE(AS.hasAttribute(AttributeSet::FunctionIndex,
+                              Attribute::NoUnwind));
+  EXPECT_TRUE(AS.hasAttribute(AttributeSet::ReturnIndex, Attribute::NonNull));
+  EXPECT_TRUE(AS.hasAttribute(1, Attribute::ZExt));
+  EXPECT_FALSE(AS.hasAttributes(2));
+  EXPECT_TRUE(AS.hasAttribute(3, Attribute::NoCapture));
+  EXPECT_FALSE(AS.hasAttribute(3, Attribute::ZExt));
+  EXPECT_FALSE(AS.hasAttributes(4));
+  EXPECT_FALSE(AS.hasAttribute(1000, Attribute::ZExt));
+
+  unsigned Index = 0;
+  EXPECT_TRUE(AS.hasAttrSomewhere(Attribute::NoCapture, &Index));
+  EXPECT_EQ(3u, Index);
+  EXPECT_FALSE(AS.hasAttrSomewhere(Attribute::SExt));
+
+  // Attributes on parameters past the direct lookup table.
+  AttributeSet Far = AS.addAttribute(C, 200, Attribute::SExt);
+  EXPECT_TRUE(Far.hasAttribute(200, Attribute::SExt));
+  EXPECT_TRUE(Far.hasAttribute(3, Attribute::NoCapture));
+  EXPECT_FALSE(Far.hasAttributes(2));
+  EXPECT_FALSE(Far.hasAttributes(199));
+  EXPECT_FALSE(Far.hasAttributes(201));
+  EXPECT_TRUE(Far.hasFnAttribute(Attribute::NoUnwind));
+  EXPECT_TRUE(Far.hasAttrSomewhere(Attribute::SExt, &Index));
+  EXPECT_EQ(200u, Index);
+}
+
+TEST(Attributes, AddRemove) {
+  LLVMContext C;
+
+  AttributeSet AS = AttributeSet::get(C, 2, Attribute::ZExt);
+  AttributeSet Added = AS.addAttribute(C, 1, Attribute::NonNull)
+                           .addAttribute(C, 2, Attribute::NoAlias)
+                           .addAttribute(C, AttributeSet::FunctionIndex,
+                                         Attribute::ReadNone);
+  EXPECT_EQ(3u, Added.getNumSlots());
+  EXPECT_TRUE(Added.hasAttribute(2, Attribute::ZExt));
+  EXPECT_TRUE(Added.hasAttribute(2, Attribute::NoAlias));
+
+  // Adding an attribute that is already there returns the same list.
+  EXPECT_EQ(Added, Added.addAttribute(C, 2, Attribute::ZExt));
+
+  // Removing what was added gives back the original, uniqued list.
+  AttributeSet Removed =
+      Added.removeAttribute(C, AttributeSet::FunctionIndex,
+                            Attribute::ReadNone)
+          .removeAttribute(C, 2, Attribute::NoAlias)
+          .removeAttribute(C, 1, Attribute::NonNull);
+  EXPECT_EQ(AS, Removed);
+  EXPECT_EQ(AttributeSet(), Removed.removeAttribute(C, 2, Attribute::ZExt));
+
+  AttrBuilder B;
+  B.addAttribute(Attribute::NoAlias);
+  B.addAttribute("key", "value");
+  AttributeSet WithB = AS.addAttributes(C, 2, AttributeSet::get(C, 2, B));
+  EXPECT_TRUE(WithB.hasAttribute(2, "key"));
+  EXPECT_EQ(AS, WithB.removeAttributes(C, 2, B));
+
+  unsigned Indices[] = {1, 2, 5};
+  AttributeSet Multi =
+      AS.addAttribute(C, Indices, Attribute::get(C, Attribute::NoCapture));
+  for (unsigned I : Indices)
+    EXPECT_TRUE(Multi.hasAttribute(I, Attribute::NoCapture));
+  EXPECT_TRUE(Multi.hasAttribute(2, Attribute::ZExt));
+  EXPECT_FALSE(Multi.hasAttributes(3));
+}
+
+TEST(Attributes, MergeKeepsIndexOrder) {
+  LLVMContext C;
+
+  AttributeSet ASs[] = {
+    AttributeSet::get(C, 4, Attribute::ZExt),
+    AttributeSet::get(C, AttributeSet::FunctionIndex, Attribute::NoUnwind),
+    AttributeSet::get(C, 1, Attribute::SExt),
+    AttributeSet::get(C, 2, Attribute::NoAlias),
+    AttributeSet::get(C, AttributeSet::ReturnIndex, Attribute::NonNull)
+  };
+  AttributeSet AS = AttributeSet::get(C, ASs);
+  ASSERT_EQ(5u, AS.getNumSlots());
+  EXPECT_EQ(unsigned(AttributeSet::ReturnIndex), AS.getSlotIndex(0));
+  EXPECT_EQ(1u, AS.getSlotIndex(1));
+  EXPECT_EQ(2u, AS.getSlotIndex(2));
+  EXPECT_EQ(4u, AS.getSlotIndex(3));
+  EXPECT_EQ(unsigned(AttributeSet::FunctionIndex), AS.getSlotIndex(4));
+
+  // The order in which lists are merged does not matter.
+  AttributeSet Reversed[] = {ASs[4], ASs[3], ASs[2], ASs[1], ASs[0]};
+  EXPECT_EQ(AS, AttributeSet::get(C, Reversed));
+}
+
 } // end anonymous namespace
@@ -17,6 +17,7 @@
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/Support/SourceMgr.h"
 #include "gtest/gtest.h"
+#include <random>
 
 using namespace llvm;
 
@@ -251,6 +252,165 @@ namespace llvm {
       Passes.add(P);
       Passes.run(*M);
     }
+
+    /// A function whose CFG is given by successor lists that tests can edit.
+    /// Blocks end in a return, a branch or a switch depending on how many
+    /// successors they have.
+    struct TestCFG {
+      LLVMContext Context;
+      std::unique_ptr<Module> M;
+      Function *F;
+      std::vector<BasicBlock *> Blocks;
+      std::vector<std::vector<unsigned>> Succs;
+
+      explicit TestCFG(unsigned NumBlocks)
+          : M(new Module("m", Context)), Succs(NumBlocks) {
+        F = Function::Create(
+            FunctionType::get(Type::getVoidTy(Context),
+                              {Type::getInt32Ty(Context)}, false),
+            GlobalValue::ExternalLinkage, "f", M.get());
+        for (unsigned I = 0; I != NumBlocks; ++I) {
+          Blocks.push_back(BasicBlock::Create(Context, "", F));
+          ReturnInst::Create(Context, Blocks.back());
+        }
+      }
+
+      bool hasEdge(unsigned From, unsigned To) const {
+        return is_contained(Succs[From], To);
+      }
+
+      void addEdge(unsigned From, unsigned To) {
+        Succs[From].push_back(To);
+        rebuildTerminator(From);
+      }
+
+      void removeEdge(unsigned From, unsigned To) {
+        Succs[From].erase(find(Succs[From], To));
+        rebuildTerminator(From);
+      }
+
+      void rebuildTerminator(unsigned N) {
+        BasicBlock *BB = Blocks[N];
+        BB->getTerminator()->eraseFromParent();
+        const std::vector<unsigned> &S = Succs[N];
+        if (S.empty()) {
+          ReturnInst::Create(Context, BB);
+        } else if (S.size() == 1) {
+          BranchInst::Create(Blocks[S[0]], BB);
+        } else {
+          SwitchInst *SI =
+              SwitchInst::Create(&*F->arg_begin(), Blocks[S[0]], S.size(), BB);
+          for (unsigned I = 1; I != S.size(); ++I)
+            SI->addCase(ConstantInt::get(Type::getInt32Ty(Context), I),
+                        Blocks[S[I]]);
+        }
+      }
+    };
+
+    TEST(DominatorTree, InsertAndDeleteEdges) {
+      // 0 -> 1 -> 3, and 2 -> 3 with 2 unreachable.
+      TestCFG G(4);
+      G.addEdge(0, 1);
+      G.addEdge(1, 3);
+      G.addEdge(2, 3);
+      BasicBlock **B = G.Blocks.data();
+      DominatorTree DT(*G.F);
+      PostDominatorTree PDT;
+      PDT.recalculate(*G.F);
+      EXPECT_EQ(nullptr, DT.getNode(B[2]));
+      EXPECT_EQ(B[1], DT.getNode(B[3])->getIDom()->getBlock());
+
+      // Making 2 reachable moves the immediate dominator of 3 up to 0.
+      G.addEdge(0, 2);
+      DT.insertEdge(B[0], B[2]);
+      PDT.insertEdge(B[0], B[2]);
+      ASSERT_TRUE(DT.getNode(B[2]) != nullptr);
+      EXPECT_EQ(B[0], DT.getNode(B[2])->getIDom()->getBlock());
+      EXPECT_EQ(B[0], DT.getNode(B[3])->getIDom()->getBlock());
+      EXPECT_EQ(1u, DT.getNode(B[3])->getLevel());
+      EXPECT_TRUE(DT.verify());
+      EXPECT_TRUE(PDT.verify());
+
+      // Deleting the only edge to 1 makes it unreachable.
+      G.removeEdge(0, 1);
+      DT.deleteEdge(B[0], B[1]);
+      PDT.deleteEdge(B[0], B[1]);
+      EXPECT_EQ(nullptr, DT.getNode(B[1]));
+      EXPECT_EQ(B[2], DT.getNode(B[3])->getIDom()->getBlock());
+      EXPECT_EQ(2u, DT.getNode(B[3])->getLevel());
+      EXPECT_TRUE(DT.verify());
+      EXPECT_TRUE(PDT.verify());
+
+      // A tree that was not updated fails verification.
+      G.addEdge(0, 3);
+      EXPECT_FALSE(DT.verify());
+      DT.insertEdge(B[0], B[3]);
+      EXPECT_TRUE(DT.verify());
+    }
+
+    TEST(DominatorTree, RandomIncrementalUpdates) {
+      const unsigned NumBlocks = 24;
+      TestCFG G(NumBlocks);
+      std::mt19937 Rand(42);
+      auto RandomBlock = [&]() { return unsigned(Rand() % NumBlocks); };
+      for (unsigned I = 1; I != NumBlocks; ++I)
+        G.addEdge(Rand() % I, I);
+
+      DominatorTree DT(*G.F);
+      PostDominatorTree PDT;
+      PDT.recalculate(*G.F);
+      for (unsigned Step = 0; Step != 500; ++Step) {
+        unsigned From = RandomBlock(), To = RandomBlock();
+        if (To == 0)
+          continue;
+        BasicBlock *FromBB = G.Blocks[From], *ToBB = G.Blocks[To];
+        if (G.hasEdge(From, To)) {
+          G.removeEdge(From, To);
+          DT.deleteEdge(FromBB, ToBB);
+          PDT.deleteEdge(FromBB, ToBB);
+        } else {
+          G.addEdge(From, To);
+          DT.insertEdge(FromBB, ToBB);
+          PDT.insertEdge(FromBB, ToBB);
+        }
+        ASSERT_TRUE(DT.verify()) << "step " << Step;
+        ASSERT_TRUE(PDT.verify()) << "step " << Step;
+      }
+    }
+
+    TEST(DominatorTree, RandomBatchUpdates) {
+      const unsigned NumBlocks = 24;
+      TestCFG G(NumBlocks);
+      std::mt19937 Rand(7);
+      auto RandomBlock = [&]() { return unsigned(Rand() % NumBlocks); };
+      for (unsigned I = 1; I != NumBlocks; ++I)
+        G.addEdge(Rand() % I, I);
+
+      DominatorTree DT(*G.F);
+      PostDominatorTree PDT;
+      PDT.recalculate(*G.F);
+      for (unsigned Round = 0; Round != 100; ++Round) {
+        // Some of the changes undo earlier ones of the same batch.
+        SmallVector<DominatorTree::UpdateType, 8> Updates;
+        for (unsigned I = 0, E = 1 + Rand() % 8; I != E; ++I) {
+          unsigned From = RandomBlock(), To = RandomBlock();
+          if (To == 0)
+            continue;
+          BasicBlock *FromBB = G.Blocks[From], *ToBB = G.Blocks[To];
+          if (G.hasEdge(From, To)) {
+            G.removeEdge(From, To);
+            Updates.push_back({DominatorTree::Delete, FromBB, ToBB});
+          } else {
+            G.addEdge(From, To);
+            Updates.push_back({DominatorTree::Insert, FromBB, ToBB});
+          }
+        }
+        DT.applyUpdates(Updates);
+        PDT.applyUpdates(Updates);
+        ASSERT_TRUE(DT.verify()) << "round " << Round;
+        ASSERT_TRUE(PDT.verify()) << "round " << Round;
+      }
+    }
   }
 }
 
@@ -8,6 +8,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/Constants.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
@@ -109,4 +110,50 @@ TEST(UseTest, reverse) {
   ASSERT_EQ(8u, I);
 }
 
+TEST(UseTest, rauwOrder) {
+  LLVMContext C;
+
+  const char *ModuleString = "define void @f(i32 %x, i32 %y) {\n"
+                             "entry:\n"
+                             "  %y0 = add i32 %y, 0\n"
+                             "  %x0 = add i32 %x, 0\n"
+                             "  %x1 = add i32 %x, 1\n"
+                             "  %x2 = add i32 %x, 2\n"
+                             "  ret void\n"
+                             "}\n";
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseAssemblyString(ModuleString, Err, C);
+  Function *F = M->getFunction("f");
+  ASSERT_TRUE(F);
+  Argument &X = *F->arg_begin();
+  Argument &Y = *std::next(F->arg_begin());
+
+  // Uses are added to the front of the list, so the parser leaves them in
+  // reverse order of appearance.
+  std::vector<StringRef> XUsers;
+  for (User *U : X.users())
+    XUsers.push_back(U->getName());
+  ASSERT_EQ((std::vector<StringRef>{"x2", "x1", "x0"}), XUsers);
+
+  // The uses move over reversed, in front of the ones Y already had, as if
+  // each had been set individually.
+  X.replaceAllUsesWith(&Y);
+  EXPECT_TRUE(X.use_empty());
+  std::vector<StringRef> YUsers;
+  for (Use &U : Y.uses()) {
+    EXPECT_EQ(&Y, U.get());
+    YUsers.push_back(U.getUser()->getName());
+  }
+  EXPECT_EQ((std::vector<StringRef>{"x0", "x1", "x2", "y0"}), YUsers);
+
+  // The list must still be well linked: removing a use from the middle
+  // leaves the others in place.
+  cast<Instruction>(F->getEntryBlock().begin()->getNextNode())->setOperand(
+      0, UndefValue::get(Y.getType()));
+  YUsers.clear();
+  for (User *U : Y.users())
+    YUsers.push_back(U->getName());
+  EXPECT_EQ((std::vector<StringRef>{"x1", "x2", "y0"}), YUsers);
+}
+
 } // end anonymous namespace
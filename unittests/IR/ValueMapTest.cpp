@@ -8,6 +8,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/IR/ValueMap.h"
+#include "llvm/ADT/FlatHashMap.h"
 #include "llvm/Config/llvm-config.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/Instructions.h"
@@ -292,4 +293,35 @@ TYPED_TEST(ValueMapTest, SurvivesModificationByConfig) {
   EXPECT_EQ(0u, VM.count(this->AddV.get()));
 }
 
+template<typename KeyT>
+struct FlatStorage : ValueMapConfig<KeyT> {
+  template <typename MapKeyT, typename MapValueT, typename MapKeyInfoT>
+  using MapType = FlatHashMap<MapKeyT, MapValueT, MapKeyInfoT>;
+};
+
+TYPED_TEST(ValueMapTest, FlatHashMapStorage) {
+  ValueMap<TypeParam*, int, FlatStorage<TypeParam*> > VM;
+  VM[nullptr] = 3;
+  VM[this->BitcastV.get()] = 7;
+  EXPECT_EQ(3, VM.lookup(nullptr));
+  EXPECT_EQ(7, VM.lookup(this->BitcastV.get()));
+  EXPECT_EQ(0u, VM.count(this->AddV.get()));
+  this->BitcastV->replaceAllUsesWith(this->AddV.get());
+  EXPECT_EQ(7, VM.lookup(this->AddV.get()));
+  EXPECT_EQ(0u, VM.count(this->BitcastV.get()));
+
+  int size = 0;
+  for (auto I = VM.begin(), E = VM.end(); I != E; ++I) {
+    ++size;
+    EXPECT_TRUE(I->first == nullptr || I->first == this->AddV.get());
+  }
+  EXPECT_EQ(2, size);
+
+  this->AddV.reset();
+  EXPECT_EQ(1U, VM.size());
+  EXPECT_EQ(3, VM.lookup(nullptr));
+  EXPECT_TRUE(VM.erase(nullptr));
+  EXPECT_TRUE(VM.empty());
+}
+
 } // end namespace
@@ -7,6 +7,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/AsmParser/Parser.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DIBuilder.h"
 #include "llvm/IR/DerivedTypes.h"
@@ -19,6 +20,7 @@
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/Support/SourceMgr.h"
 #include "gtest/gtest.h"
 
 namespace llvm {
@@ -226,5 +228,56 @@ TEST(VerifierTest, StripInvalidDebugInfoLegacy) {
   EXPECT_FALSE(verifyModule(M));
 }
 
+TEST(VerifierTest, ConcurrentFunctions) {
+  // Enough functions for several chunks per thread, using overloaded
+  // intrinsics and llvm.localescape/llvm.localrecover across functions.
+  std::string IR = "declare i32 @llvm.ctpop.i32(i32)\n"
+                   "declare void @llvm.localescape(...)\n"
+                   "declare i8* @llvm.localrecover(i8*, i8*, i32)\n"
+                   "define void @parent() {\n"
+                   "  %a = alloca i32\n"
+                   "  call void (...) @llvm.localescape(i32* %a)\n"
+                   "  ret void\n"
+                   "}\n";
+  for (unsigned I = 0; I != 64; ++I)
+    IR += "define i32 @f" + std::to_string(I) + "(i32 %x, i8* %fp) {\n"
+          "  %r = call i8* @llvm.localrecover(i8* bitcast (void ()* @parent "
+          "to i8*), i8* %fp, i32 0)\n"
+          "  %c = call i32 @llvm.ctpop.i32(i32 %x)\n"
+          "  %s = add i32 %c, " + std::to_string(I) + "\n"
+          "  ret i32 %s\n"
+          "}\n";
+
+  LLVMContext C;
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseAssemblyString(IR, Err, C);
+  ASSERT_TRUE(M != nullptr);
+  std::string Error;
+  raw_string_ostream ErrorOS(Error);
+  EXPECT_FALSE(verifyModule(*M, &ErrorOS, nullptr, 4));
+  EXPECT_TRUE(ErrorOS.str().empty());
+
+  // Break a function: the messages must be the ones a sequential run prints.
+  Function *F = M->getFunction("f37");
+  ReturnInst *Ret = cast<ReturnInst>(F->getEntryBlock().getTerminator());
+  Ret->setOperand(0, ConstantInt::get(Type::getInt64Ty(C), 0));
+  std::string Expected;
+  raw_string_ostream ExpectedOS(Expected);
+  EXPECT_TRUE(verifyModule(*M, &ExpectedOS));
+  EXPECT_TRUE(verifyModule(*M, &ErrorOS, nullptr, 4));
+  EXPECT_FALSE(ExpectedOS.str().empty());
+  EXPECT_EQ(ExpectedOS.str(), ErrorOS.str());
+
+  // Recovering an index that was never escaped is only caught once all
+  // functions have been seen.
+  Ret->setOperand(0, ConstantInt::get(Type::getInt32Ty(C), 0));
+  cast<CallInst>(&F->getEntryBlock().front())
+      ->setArgOperand(2, ConstantInt::get(Type::getInt32Ty(C), 1));
+  Error.clear();
+  EXPECT_TRUE(verifyModule(*M, &ErrorOS, nullptr, 4));
+  EXPECT_TRUE(StringRef(ErrorOS.str())
+                  .startswith("all indices passed to llvm.localrecover"));
+}
+
 } // end anonymous namespace
 } // end namespace llvm
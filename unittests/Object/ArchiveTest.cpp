@@ -0,0 +1,124 @@
+//===- ArchiveTest.cpp - Tests for Archive.cpp and ArchiveWriter.cpp ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Object/Archive.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Object/ArchiveWriter.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace llvm::object;
+
+namespace {
+
+class ArchiveTest : public ::testing::Test {
+protected:
+  SmallString<128> TestDir;
+  /// Everything created in TestDir, to be removed in reverse order.
+  std::vector<std::string> Created;
+
+  void SetUp() override {
+    ASSERT_FALSE(sys::fs::createUniqueDirectory("ArchiveTest", TestDir));
+  }
+
+  void TearDown() override {
+    for (auto I = Created.rbegin(), E = Created.rend(); I != E; ++I)
+      sys::fs::remove(*I);
+    sys::fs::remove(TestDir);
+  }
+
+  std::string getPath(StringRef Name) {
+    SmallString<128> Path(TestDir);
+    sys::path::append(Path, Name);
+    Created.push_back(Path.str());
+    return Path.str();
+  }
+
+  std::string writeFile(StringRef Name, StringRef Contents) {
+    std::string Path = getPath(Name);
+    std::error_code EC;
+    raw_fd_ostream OS(Path, EC, sys::fs::F_None);
+    EXPECT_FALSE(EC);
+    OS << Contents;
+    return Path;
+  }
+};
+
+TEST_F(ArchiveTest, LazyMembersAndFindMember) {
+  std::vector<NewArchiveMember> Members;
+  for (auto &NameAndContents :
+       {std::make_pair("a.txt", "aaa"), std::make_pair("b.txt", "bbbb")}) {
+    std::string Path = writeFile(NameAndContents.first, NameAndContents.second);
+    Expected<NewArchiveMember> MemberOrErr =
+        NewArchiveMember::getLazyFile(Path, /*Deterministic=*/true);
+    ASSERT_TRUE(!!MemberOrErr);
+    EXPECT_FALSE(MemberOrErr->Buf);
+    EXPECT_EQ(strlen(NameAndContents.second), MemberOrErr->getSize());
+    Members.push_back(std::move(*MemberOrErr));
+  }
+  // A second member called a.txt, which findMember() must not return.
+  ASSERT_FALSE(sys::fs::create_directory(getPath("sub")));
+  std::string DupPath = writeFile("sub/a.txt", "");
+  Expected<NewArchiveMember> DupOrErr =
+      NewArchiveMember::getFile(DupPath, /*Deterministic=*/true);
+  ASSERT_TRUE(!!DupOrErr);
+  Members.push_back(std::move(*DupOrErr));
+
+  std::string ArchivePath = getPath("test.a");
+  auto Result =
+      writeArchive(ArchivePath, Members, /*WriteSymtab=*/true, Archive::K_GNU,
+                   /*Deterministic=*/true, /*Thin=*/false,
+                   /*OldArchiveBuf=*/nullptr, /*NumThreads=*/2);
+  ASSERT_FALSE(Result.second) << Result.first;
+
+  auto BufOrErr = MemoryBuffer::getFile(ArchivePath);
+  ASSERT_TRUE(!!BufOrErr);
+  Expected<std::unique_ptr<Archive>> ArchiveOrErr =
+      Archive::create((*BufOrErr)->getMemBufferRef());
+  ASSERT_TRUE(!!ArchiveOrErr);
+  Archive &A = **ArchiveOrErr;
+
+  for (auto &NameAndContents :
+       {std::make_pair("a.txt", "aaa"), std::make_pair("b.txt", "bbbb")}) {
+    Expected<Optional<Archive::Child>> ChildOrErr =
+        A.findMember(NameAndContents.first);
+    ASSERT_TRUE(!!ChildOrErr);
+    ASSERT_TRUE(ChildOrErr->hasValue());
+    Expected<StringRef> ContentsOrErr = (*ChildOrErr)->getBuffer();
+    ASSERT_TRUE(!!ContentsOrErr);
+    EXPECT_EQ(NameAndContents.second, *ContentsOrErr);
+  }
+
+  Expected<Optional<Archive::Child>> MissingOrErr = A.findMember("c.txt");
+  ASSERT_TRUE(!!MissingOrErr);
+  EXPECT_FALSE(MissingOrErr->hasValue());
+}
+
+TEST_F(ArchiveTest, MissingLazyMember) {
+  std::string Path = writeFile("gone.txt", "x");
+  Expected<NewArchiveMember> MemberOrErr =
+      NewArchiveMember::getLazyFile(Path, /*Deterministic=*/true);
+  ASSERT_TRUE(!!MemberOrErr);
+  std::vector<NewArchiveMember> Members;
+  Members.push_back(std::move(*MemberOrErr));
+  ASSERT_FALSE(sys::fs::remove(Path));
+
+  std::string ArchivePath = getPath("test.a");
+  auto Result = writeArchive(ArchivePath, Members, /*WriteSymtab=*/true,
+                             Archive::K_GNU, /*Deterministic=*/true,
+                             /*Thin=*/false);
+  EXPECT_TRUE(!!Result.second);
+  EXPECT_EQ(Path, Result.first);
+  EXPECT_FALSE(sys::fs::exists(ArchivePath));
+}
+
+} // end anonymous namespace
@@ -14,8 +14,12 @@
 #include "llvm/ProfileData/InstrProfReader.h"
 #include "llvm/ProfileData/InstrProfWriter.h"
 #include "llvm/Support/Compression.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
 #include <cstdarg>
+#include <cstddef>
 
 using namespace llvm;
 
@@ -202,6 +206,60 @@ TEST_F(InstrProfTest, get_profile_summary) {
   delete PSFromMD;
 }
 
+TEST_F(InstrProfTest, read_profile_from_file) {
+  // Enough functions that the file is mapped rather than read.
+  for (unsigned I = 0; I < 2000; ++I) {
+    InstrProfRecord Record("func" + std::to_string(I), 0x1234, {I, 2 * I});
+    NoError(Writer.addRecord(std::move(Record)));
+  }
+
+  int FD;
+  SmallString<64> Path;
+  ASSERT_FALSE(sys::fs::createTemporaryFile("InstrProfTest", "profdata", FD,
+                                            Path));
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    Writer.write(OS);
+  }
+
+  auto ReaderOrErr = IndexedInstrProfReader::create(Path);
+  ASSERT_TRUE(NoError(ReaderOrErr.takeError()));
+  Reader = std::move(ReaderOrErr.get());
+
+  // The summary comes from the header, without reading any records.
+  ASSERT_EQ(2000U, Reader->getSummary().getNumFunctions());
+  ASSERT_EQ(1999U, Reader->getMaximumFunctionCount());
+
+  Expected<InstrProfRecord> R = Reader->getInstrProfRecord("func1234", 0x1234);
+  ASSERT_TRUE(NoError(R.takeError()));
+  ASSERT_EQ(2U, R->Counts.size());
+  ASSERT_EQ(1234U, R->Counts[0]);
+  ASSERT_EQ(2468U, R->Counts[1]);
+
+  R = Reader->getInstrProfRecord("func2000", 0x1234);
+  ASSERT_TRUE(ErrorEquals(instrprof_error::unknown_function, R.takeError()));
+
+  Reader.reset();
+  sys::fs::remove(Path);
+}
+
+TEST_F(InstrProfTest, hash_table_past_end_of_file) {
+  InstrProfRecord Record("func1", 0x1234, {42});
+  NoError(Writer.addRecord(std::move(Record)));
+  auto Profile = Writer.writeBuffer();
+
+  // Point the hash table at the end of the buffer.
+  std::string Data = Profile->getBuffer();
+  uint64_t HashOffset = Data.size();
+  support::endian::write<uint64_t, support::little, support::unaligned>(
+      &Data[offsetof(IndexedInstrProf::Header, HashOffset)], HashOffset);
+
+  auto ReaderOrErr =
+      IndexedInstrProfReader::create(MemoryBuffer::getMemBufferCopy(Data));
+  ASSERT_TRUE(
+      ErrorEquals(instrprof_error::truncated, ReaderOrErr.takeError()));
+}
+
 TEST_F(InstrProfTest, test_writer_merge) {
   InstrProfRecord Record1("func1", 0x1234, {42});
   NoError(Writer.addRecord(std::move(Record1)));
@@ -9,6 +9,9 @@
 
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Metadata.h"
 #include "llvm/IR/Module.h"
@@ -168,6 +171,62 @@ TEST_F(SampleProfTest, roundtrip_binary_profile) {
   testRoundTrip(SampleProfileFormat::SPF_Binary);
 }
 
+TEST_F(SampleProfTest, roundtrip_compact_binary_profile) {
+  testRoundTrip(SampleProfileFormat::SPF_Compact_Binary);
+}
+
+TEST_F(SampleProfTest, compact_binary_reads_only_used_functions) {
+  createWriter(SampleProfileFormat::SPF_Compact_Binary);
+
+  StringRef FooName("_Z3fooi");
+  FunctionSamples FooSamples;
+  FooSamples.setName(FooName);
+  FooSamples.addTotalSamples(7711);
+  FooSamples.addHeadSamples(610);
+  FooSamples.addBodySamples(1, 0, 610);
+
+  StringRef BarName("_Z3bari");
+  FunctionSamples BarSamples;
+  BarSamples.setName(BarName);
+  BarSamples.addTotalSamples(20301);
+  BarSamples.addHeadSamples(1437);
+  BarSamples.addBodySamples(1, 0, 1437);
+  BarSamples.addCalledTargetSamples(1, 0, FooName, 1000);
+
+  StringMap<FunctionSamples> Profiles;
+  Profiles[FooName] = std::move(FooSamples);
+  Profiles[BarName] = std::move(BarSamples);
+  ASSERT_TRUE(NoError(Writer->write(Profiles)));
+  Writer->getOutputStream().flush();
+
+  auto Profile = MemoryBuffer::getMemBufferCopy(Data);
+  readProfile(Profile);
+
+  // Only _Z3bari is defined in the module; _Z3fooi is just declared.
+  Module M("my_module", Context);
+  FunctionType *FnTy = FunctionType::get(Type::getVoidTy(Context), false);
+  Function *Bar =
+      Function::Create(FnTy, GlobalValue::ExternalLinkage, BarName, &M);
+  ReturnInst::Create(Context, BasicBlock::Create(Context, "entry", Bar));
+  Function::Create(FnTy, GlobalValue::ExternalLinkage, FooName, &M);
+
+  Reader->collectFuncsToUse(M);
+  ASSERT_TRUE(NoError(Reader->read()));
+
+  StringMap<FunctionSamples> &ReadProfiles = Reader->getProfiles();
+  ASSERT_EQ(1u, ReadProfiles.size());
+  ASSERT_EQ(0u, ReadProfiles.count(FooName));
+  FunctionSamples &ReadBarSamples = ReadProfiles[BarName];
+  ASSERT_EQ(20301u, ReadBarSamples.getTotalSamples());
+  ASSERT_EQ(1437u, ReadBarSamples.getHeadSamples());
+  ErrorOr<uint64_t> CallSamples = ReadBarSamples.findCallSamplesAt(1, 0);
+  ASSERT_TRUE(NoError(CallSamples.getError()));
+  ASSERT_EQ(1000u, CallSamples.get());
+
+  // The summary covers the whole profile, not just the functions read.
+  ASSERT_EQ(2u, Reader->getSummary().getNumFunctions());
+}
+
 TEST_F(SampleProfTest, sample_overflow_saturation) {
   const uint64_t Max = std::numeric_limits<uint64_t>::max();
   sampleprof_error Result;